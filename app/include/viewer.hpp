@@ -2,8 +2,14 @@
 #define VIEWER_HPP
 
 #include <QtQuick/QQuickItem>
+#include <QImage>
+#include <cstdint>
+#include <memory>
+#include <thread>
 #include "fborenderer.hpp"
 
+class Renderer;
+
 class Viewer : public QQuickItem
 {
     Q_OBJECT
@@ -17,6 +23,7 @@ protected:
 
 Q_SIGNALS:
     void computeHasEnded();
+    void frameUpdated(const QImage& image);
 
 public Q_SLOTS:
     void sync();
@@ -27,10 +34,16 @@ public Q_SLOTS:
 
 private Q_SLOTS:
     void handleWindowChanged(QQuickWindow *win);
+    void showFrame(const QImage& image);
 
 private:
+    void stopCompute();
+
     FBORenderer * m_renderer;
     int m_timerId;
+    std::unique_ptr<Renderer> m_frameRenderer;
+    std::thread m_computeThread;
+    std::uint64_t m_computeFrame;
 };
 
 #endif // VIEWER_HPP
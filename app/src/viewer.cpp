@@ -11,7 +11,12 @@
 #include <raytracer-sandbox/sphere.hpp>
 #include <raytracer-sandbox/plane.hpp>
 #include <raytracer-sandbox/pathtracing.hpp>
+#include <raytracer-sandbox/renderer.hpp>
+#include <raytracer-sandbox/framebuffer.hpp>
+#include <raytracer-sandbox/scene.hpp>
 
+#include <algorithm>
+#include <array>
 #include <iostream>
 #include <memory>
 #include <QImage>
@@ -35,14 +40,29 @@ QColor toColor(const glm::vec3& c)
     return QColor(255*clamp(c[0],0,1), 255*clamp(c[1],0,1), 255*clamp(c[2],0,1));
 }
 
-Viewer::~Viewer()
+QImage toImage(const FrameBuffer& frame)
 {
+    QImage image(frame.width(), frame.height(), QImage::Format_ARGB32);
+    for(int y=0; y<frame.height(); ++y)
+    {
+        for(int x=0; x<frame.width(); ++x)
+        {
+            image.setPixelColor(x, y, toColor(frame.color(x, y)));
+        }
+    }
+    return image;
+}
 
+Viewer::~Viewer()
+{
+    stopCompute();
 }
 
-Viewer::Viewer() : m_renderer(0), m_timerId(0)
+Viewer::Viewer() : m_renderer(0), m_timerId(0), m_frameRenderer(new Renderer()), m_computeFrame(0)
 {
     connect(this, &QQuickItem::windowChanged, this, &Viewer::handleWindowChanged);
+    //The frames are computed on another thread and displayed from the thread of the item
+    connect(this, &Viewer::frameUpdated, this, &Viewer::showFrame, Qt::QueuedConnection);
 }
 
 void Viewer::handleWindowChanged(QQuickWindow *win)
@@ -168,40 +188,48 @@ void Viewer::compute()
     objects.push_back( std::make_shared<TMesh>(meshFilename, PhongMaterial::Emerald()) );
     */
 
-    QImage result(width, height, QImage::Format_ARGB32);
-    result.fill( Qt::GlobalColor::black);
-
-    std::vector<QVector2D> pixelOffset;
-    pixelOffset.push_back(QVector2D(0,0));
-    pixelOffset.push_back(QVector2D(0.5,0));
-    pixelOffset.push_back(QVector2D(0,0.5));
-    pixelOffset.push_back(QVector2D(0.5,0.5));
-    int depth = 0;
-
-    auto startTime = std::chrono::high_resolution_clock::now();
-
-#pragma omp parallel for
-    for(int i=0; i<result.width(); ++i)
+    RenderSettings settings;
+    settings.backgroundColor = backgroundColor;
+    settings.shadowColor = shadowColor;
+    settings.bias = bias;
+    settings.maxDepth = maxDepth;
+
+    //A frame still being computed is restarted with the new camera and scene
+    stopCompute();
+    //The frame of the thread, so that it can be stopped even before it starts
+    m_computeFrame = m_frameRenderer->frameCount()+1;
+    m_computeThread = std::thread([this, camera, lights, objects, settings]()
     {
-        for(int j=0; j<result.height(); ++j)
+        //Build the acceleration structure once for all the passes of the frame
+        Scene scene(objects);
+
+        //A preview is displayed after each pass, the first one sampling each pixel once and
+        //the next ones only adding samples to the edges and noisy pixels
+        FrameBuffer frame;
+        auto startTime = std::chrono::high_resolution_clock::now();
+        const bool done = m_frameRenderer->renderAdaptive(scene, lights, camera, settings, frame, [&](const FrameBuffer& f)
         {
-            glm::vec3 pixelColor(0,0,0);
-            for(size_t k=0; k<pixelOffset.size(); ++k)
-            {
-                Ray viewRay = camera.computeRayThroughPixel( i+pixelOffset[k][0], j+pixelOffset[k][1] );
-                pixelColor += castRay(viewRay, lights, objects, backgroundColor, shadowColor, bias, maxDepth, depth);
-            }
-            pixelColor/=(float)(pixelOffset.size());
-            result.setPixelColor(i, j, toColor(pixelColor));
-        }
-    }
+            emit frameUpdated(toImage(f));
+            std::chrono::duration<double, std::milli> time_ms = std::chrono::high_resolution_clock::now() - startTime;
+            std::cout << "Pass " << f.passes() << " : " << time_ms.count() << " ms, " << f.sampleCount() << " samples" << std::endl;
+            return true;
+        });
+        if(done) emit computeHasEnded();
+    });
+}
 
-    auto endTime = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double, std::milli> time_ms = endTime - startTime;
-    std::cout << "Computation time : " << time_ms.count() << " ms" << std::endl;
+void Viewer::stopCompute()
+{
+    if(m_computeThread.joinable())
+    {
+        m_frameRenderer->cancel(m_computeFrame);
+        m_computeThread.join();
+    }
+}
 
-    //Update display
-    m_renderer->setBackgroundImage(result);
+void Viewer::showFrame(const QImage& image)
+{
+    if(m_renderer) m_renderer->setBackgroundImage(image);
 }
 
 bool Viewer::save()
@@ -0,0 +1,106 @@
+#include <raytracer-sandbox/tmesh.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#include "config.h"
+
+using namespace std;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+//Thin planks oriented along the diagonals of the cube, whose bounding boxes are mostly empty
+static string writeDiagonalPlanks(const string& filename, const int& plankCount)
+{
+    mt19937 generator(3);
+    uniform_real_distribution<float> position(-1.0f, 1.0f);
+    const glm::vec3 diagonals[4] = { glm::normalize(glm::vec3(1,1,1)), glm::normalize(glm::vec3(-1,1,1)),
+                                     glm::normalize(glm::vec3(1,-1,1)), glm::normalize(glm::vec3(1,1,-1)) };
+    ofstream file(filename);
+    for(int i=0; i<plankCount; ++i)
+    {
+        const glm::vec3 center(position(generator), position(generator), position(generator));
+        const glm::vec3 d = 0.1f*diagonals[i%4];
+        const glm::vec3 w = 0.005f*glm::normalize(glm::cross(diagonals[i%4], glm::vec3(position(generator), position(generator), position(generator))));
+        for(const glm::vec3& v : { center-d-w, center+d-w, center+d+w, center-d+w }) file << "v " << v[0] << " " << v[1] << " " << v[2] << "\n";
+        file << "f " << 4*i+1 << " " << 4*i+2 << " " << 4*i+3 << "\n";
+        file << "f " << 4*i+1 << " " << 4*i+3 << " " << 4*i+4 << "\n";
+    }
+    return filename;
+}
+
+//Rays from a sphere around the mesh, aimed at its center
+static vector<Ray> randomRays(const TMesh& mesh, const int& rayCount)
+{
+    Box bounds = Box::Empty();
+    for(const glm::vec3& p : mesh.positions()) bounds.extend(p);
+    const glm::vec3 center = bounds.center();
+    const float radius = glm::length(bounds.size());
+
+    mt19937 generator(7);
+    uniform_real_distribution<float> position(-1.0f, 1.0f);
+    vector<Ray> rays;
+    for(int i=0; i<rayCount; ++i)
+    {
+        const glm::vec3 origin = center + 1.5f*radius*glm::normalize(glm::vec3(position(generator), position(generator), position(generator)));
+        const glm::vec3 target = center + 0.25f*radius*glm::vec3(position(generator), position(generator), position(generator));
+        rays.push_back(Ray(origin, target-origin));
+    }
+    return rays;
+}
+
+//Time of TMesh::Intersect() over the rays, in milliseconds
+static double traceRays(const TMesh& mesh, const vector<Ray>& rays, int& hitCount)
+{
+    hitCount = 0;
+    const Clock::time_point start = Clock::now();
+    for(const Ray& r : rays)
+    {
+        float tMax = numeric_limits<float>::max();
+        HitRecord hit;
+        if(mesh.Intersect(r, tMax, hit)) ++hitCount;
+    }
+    return std::chrono::duration<double, milli>(Clock::now()-start).count();
+}
+
+int main(int argc, char** argv)
+{
+    vector<string> filenames;
+    for(int i=1; i<argc; ++i) filenames.push_back(argv[i]);
+    if(filenames.empty())
+    {
+        filenames.push_back(CurrentSourceDir()+"/../app/meshes/suzanneHighRes.obj");
+        filenames.push_back(writeDiagonalPlanks(CurrentBinaryDir()+"/diagonalPlanks.obj", 5000));
+    }
+
+    const int rayCount = 200000;
+    const vector< pair<string, ExtentSettingsPtr> > volumes = { { "AABB", nullptr }, { "14-DOP", ExtentSettings::KDOP7_Settings() },
+                                                               { "26-DOP", ExtentSettings::KDOP13_Settings() } };
+    for(const string& filename : filenames)
+    {
+        //The default settings, whose hierarchy is as wide as the processor allows
+        vector<TMesh> meshes;
+        for(const pair<string, ExtentSettingsPtr>& volume : volumes) meshes.push_back(TMesh(filename, PhongMaterial::Pearl(), BVHBuildSettings(), volume.second));
+        const vector<Ray> rays = randomRays(meshes[0], rayCount);
+
+        //The runs alternate between the volumes so that a slower period of the machine penalizes them all
+        vector<double> best(volumes.size(), numeric_limits<double>::max());
+        vector<int> hitCounts(volumes.size(), 0);
+        for(int run=0; run<7; ++run)
+        {
+            for(size_t v=0; v<volumes.size(); ++v) best[v] = std::min(best[v], traceRays(meshes[v], rays, hitCounts[v]));
+        }
+
+        cout << filename << endl;
+        for(size_t v=0; v<volumes.size(); ++v)
+        {
+            cout << "  " << volumes[v].first << " (width " << meshes[v].bvh().settings().width << "): " << best[v] << " ms for "
+                 << rayCount << " rays, " << hitCounts[v] << " hits" << endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include <raytracer-sandbox/io.hpp>
+#include <raytracer-sandbox/renderer.hpp>
+#include <raytracer-sandbox/scene.hpp>
+#include <raytracer-sandbox/scenedescription.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double seconds(const Clock::time_point& start)
+{
+    return std::chrono::duration<double>(Clock::now()-start).count();
+}
+
+static void usage(const char* program)
+{
+    cerr << "Usage: " << program << " <scene file> [options]" << endl
+         << "  --width <pixels>     width of the frame (640)" << endl
+         << "  --height <pixels>    height of the frame (480)" << endl
+         << "  --spp <samples>      samples per pixel, the maximum per pixel with --adaptive (4)" << endl
+         << "  --threads <count>    rendering threads, 0 for one per hardware thread (0)" << endl
+         << "  --output <file.ppm>  path of the image (render.ppm)" << endl
+         << "  --adaptive           add samples only where the frame is noisy" << endl
+         << "  --shadow-cache       test the shadow rays against the last occluder of their light first" << endl;
+}
+
+static bool parseInt(const char* text, const int& minimum, int& value)
+{
+    char* end = nullptr;
+    const long parsed = std::strtol(text, &end, 10);
+    if(end==text || *end!='\0' || parsed<minimum || parsed>1<<20) return false;
+    value = (int)parsed;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    string sceneFilename, output = "render.ppm";
+    int width = 640, height = 480, spp = 4, threads = 0;
+    bool adaptive = false, shadowCache = false;
+    for(int i=1; i<argc; ++i)
+    {
+        const string option = argv[i];
+        const bool hasValue = i+1<argc;
+        bool valid = true;
+        if(option=="--width") valid = hasValue && parseInt(argv[++i], 1, width);
+        else if(option=="--height") valid = hasValue && parseInt(argv[++i], 1, height);
+        else if(option=="--spp") valid = hasValue && parseInt(argv[++i], 1, spp);
+        else if(option=="--threads") valid = hasValue && parseInt(argv[++i], 0, threads);
+        else if(option=="--output")
+        {
+            valid = hasValue;
+            if(valid) output = argv[++i];
+        }
+        else if(option=="--adaptive") adaptive = true;
+        else if(option=="--shadow-cache") shadowCache = true;
+        else if(option=="--help" || option=="-h")
+        {
+            usage(argv[0]);
+            return 0;
+        }
+        else if(option.compare(0, 2, "--")!=0 && sceneFilename.empty()) sceneFilename = option;
+        else valid = false;
+
+        if(!valid)
+        {
+            cerr << "Invalid argument '" << option << "'" << endl;
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if(sceneFilename.empty())
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+#ifdef _OPENMP
+    //The hierarchies of the meshes are built with OpenMP
+    if(threads>0) omp_set_num_threads(threads);
+#endif
+
+    Clock::time_point start = Clock::now();
+    SceneDescription description;
+    string error;
+    if(!read_scene(sceneFilename, description, error))
+    {
+        cerr << "Cannot read the scene: " << error << endl;
+        return 1;
+    }
+    const double loadTime = seconds(start);
+
+    start = Clock::now();
+    const Scene scene(description.objects);
+    const double buildTime = seconds(start);
+
+    const Camera camera = description.camera(width, height);
+    RenderSettings settings = description.settings;
+    settings.shadowCache = shadowCache;
+    Renderer renderer(threads);
+    std::vector<glm::vec3> image;
+    std::uint64_t primaryRays = 0;
+
+    start = Clock::now();
+    if(adaptive)
+    {
+        settings.maxSamples = spp;
+        FrameBuffer frame;
+        renderer.renderAdaptive(scene, description.lights, camera, settings, frame);
+        frame.resolve(image);
+        primaryRays = frame.sampleCount();
+    }
+    else
+    {
+        settings.pixelOffsets.clear();
+        for(int s=0; s<spp; ++s) settings.pixelOffsets.push_back(Renderer::sampleOffset(s));
+        renderer.render(scene, description.lights, camera, settings, image);
+        primaryRays = (std::uint64_t)width*height*spp;
+    }
+    const double renderTime = seconds(start);
+
+    if(!write_ppm(output, width, height, image))
+    {
+        cerr << "Cannot write the image " << output << endl;
+        return 1;
+    }
+
+    cout << "scene:        " << sceneFilename << " (" << description.objects.size() << " objects, " << description.lights.size() << " lights)" << endl
+         << "frame:        " << width << "x" << height << ", " << spp << (adaptive ? " max spp (adaptive)" : " spp") << ", "
+         << renderer.threadCount() << " threads" << endl
+         << "load:         " << loadTime << " s" << endl
+         << "build:        " << buildTime << " s" << endl
+         << "render:       " << renderTime << " s" << endl
+         << "primary rays: " << primaryRays << " (" << primaryRays/renderTime << " rays/s)" << endl;
+    if(shadowCache)
+    {
+        const ShadowCache counters = renderer.shadowCacheCounters();
+        cout << "shadow cache: " << 100.0f*counters.hitRate() << "% hits (" << counters.hits() << " of " << counters.lookups() << " shadow rays)" << endl;
+    }
+    cout << "output:       " << output << endl;
+    return 0;
+}
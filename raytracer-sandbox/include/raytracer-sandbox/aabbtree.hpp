@@ -2,7 +2,9 @@
 #define TREE_HPP
 
 #include "box.hpp"
+#include <functional>
 #include <memory>
+#include <unordered_map>
 
 class Node
 {
@@ -16,26 +18,127 @@ public:
     const NodePtr& left() const;
     NodePtr& right();
     const NodePtr& right() const;
-    const int& data();
-    const Box& aabb();
+    std::weak_ptr<Node>& parent();
+    const std::weak_ptr<Node>& parent() const;
+    int& height();
+    const int& height() const;
+    bool isLeaf() const;
+    const int& data() const;
+    Box& aabb();
+    const Box& aabb() const;
 private:
     int m_data; //Triangle id, only for leaves, -1 otherwise
+    int m_height; //0 for leaves, 1 + max height of the children for branches
     Box m_aabb; //Fat AABB for leaves, bounding AABB for branches
     std::array<NodePtr,2> m_children; //Only for branches, null_ptr otherwise
+    std::weak_ptr<Node> m_parent; //Null for the root
 };
 
 typedef std::shared_ptr< Node > NodePtr;
 
+/** @brief Dynamic bounding volume hierarchy.
+ *
+ * Leaves can be inserted, removed and updated one at a time in O(log n).
+ * Each leaf stores a fat AABB, the user AABB enlarged by a margin, so that an
+ * object moving a little does not require any update of the tree.
+ * The sibling of a new leaf is chosen with a surface area cost heuristic and the
+ * tree is kept balanced with rotations, as in an AVL tree.
+ */
 class AABBTree
 {
 public:
+    typedef std::function<bool(const int& data, const Ray& r, float& tMax)> Intersector;
+
     ~AABBTree();
     AABBTree() = default;
-    AABBTree(const AABBTree& tree) = default;
+    //The nodes are shared and point to their parents: a copy would alias and corrupt them
+    AABBTree(const AABBTree& tree) = delete;
+    AABBTree& operator=(const AABBTree& tree) = delete;
+
+    /**
+     * @brief Build an empty tree.
+     * @param fatMargin The margin added on each side of the AABB of a leaf.
+     */
+    AABBTree(const float& fatMargin);
+
+    /**
+     * @brief Insert a new leaf.
+     *
+     * If a leaf already holds this id, its AABB is updated instead, see update().
+     * @param aabb The AABB of the object.
+     * @param data The id of the object.
+     */
     void insert(const Box& aabb, const int& data);
+
+    /**
+     * @brief Remove a leaf.
+     * @param data The id of the object.
+     * @return False if no leaf holds this id, true otherwise.
+     */
+    bool remove(const int& data);
+
+    /**
+     * @brief Update the AABB of a leaf.
+     *
+     * The leaf is re-inserted only if the new AABB is not contained in its fat AABB anymore.
+     * @param aabb The new AABB of the object.
+     * @param data The id of the object.
+     * @return True if the leaf has been re-inserted, false otherwise.
+     */
+    bool update(const Box& aabb, const int& data);
+
+    /**
+     * @brief Find the leaf whose fat AABB is entered first by the ray.
+     * @param r The ray.
+     * @param data The id of the object of this leaf.
+     * @return True if a leaf is hit, false otherwise.
+     */
     bool intersect(const Ray& r, int &data);
+
+    /**
+     * @brief Find the closest intersection between a ray and the objects of the tree.
+     *
+     * Nodes are visited front to back and skipped when they lie beyond tMax.
+     * The intersector is called for each leaf hit by the ray and must return true only if
+     * it found a hit closer than tMax, in which case it updates tMax.
+     * @param r The ray.
+     * @param tMax The maximum distance along the ray, updated with the closest hit distance.
+     * @param intersector The object intersector.
+     * @return True if an object has been hit, false otherwise.
+     */
+    bool intersect(const Ray& r, float& tMax, const Intersector& intersector) const;
+
+    const NodePtr& root() const;
+    const float& fatMargin() const;
+
+    /**
+     * @brief Number of leaves of the tree.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Height of the tree, -1 if it is empty.
+     */
+    int height() const;
+
+    /**
+     * @brief Surface area cost of the tree.
+     *
+     * The sum of the surface areas of the branches, the quantity minimized when choosing a sibling.
+     */
+    float cost() const;
+
 private:
     NodePtr m_root;
+    float m_fatMargin = 0.1f;
+    std::unordered_map<int, NodePtr> m_leaves; //Leaves indexed by the id of their object
+
+    void insertLeaf(const NodePtr& leaf);
+    void removeLeaf(const NodePtr& leaf);
+    NodePtr findBestSibling(const Box& aabb) const;
+    void refitAncestors(NodePtr node);
+    NodePtr balance(const NodePtr& a);
+    void replaceChild(const NodePtr& parent, const NodePtr& oldChild, const NodePtr& newChild);
 };
 
 #endif // TREE_HPP
@@ -0,0 +1,68 @@
+#ifndef ALIGNEDALLOCATOR_HPP
+#define ALIGNEDALLOCATOR_HPP
+
+/** @file
+ * @brief Define an allocator of aligned memory.
+ *
+ * This file defines an allocator for standard containers whose storage must start
+ * on a given boundary, for instance a cache line or the width of a SIMD register.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+/** @brief Allocator returning memory aligned on Alignment bytes.
+ *
+ * The block is over-allocated and the address returned by the global operator new
+ * is stored just before the aligned address, so that it can be released later.
+ * Alignment must be a power of two at least equal to the size of a pointer.
+ */
+template<typename T, std::size_t Alignment>
+class AlignedAllocator
+{
+public:
+    typedef T value_type;
+
+    template<typename U>
+    struct rebind
+    {
+        typedef AlignedAllocator<U, Alignment> other;
+    };
+
+    ~AlignedAllocator() = default;
+    AlignedAllocator() = default;
+    AlignedAllocator(const AlignedAllocator& allocator) = default;
+
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&)
+    {}
+
+    T* allocate(std::size_t n)
+    {
+        static_assert(Alignment>=sizeof(void*) && (Alignment & (Alignment-1))==0, "Alignment must be a power of two at least equal to the size of a pointer");
+        void* block = ::operator new(n*sizeof(T) + Alignment);
+        std::uintptr_t aligned = (reinterpret_cast<std::uintptr_t>(block) + Alignment) & ~(std::uintptr_t)(Alignment-1);
+        reinterpret_cast<void**>(aligned)[-1] = block;
+        return reinterpret_cast<T*>(aligned);
+    }
+
+    void deallocate(T* p, std::size_t)
+    {
+        ::operator delete(reinterpret_cast<void**>(p)[-1]);
+    }
+};
+
+template<typename T, typename U, std::size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&)
+{
+    return true;
+}
+
+template<typename T, typename U, std::size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&)
+{
+    return false;
+}
+
+#endif // ALIGNEDALLOCATOR_HPP
@@ -18,6 +18,14 @@ public:
     const glm::vec3& maxBound() const;
     glm::vec3& minBound();
     const glm::vec3& minBound() const;
+    glm::vec3 center() const;
+    glm::vec3 size() const;
+    float surfaceArea() const;
+    int largestAxis() const;
+    bool isFinite() const;
+    void extend(const glm::vec3& point);
+    void extend(const Box& box);
+    static Box Empty();
 private:
     std::array< glm::vec3, 2 > m_bounds;
 };
@@ -0,0 +1,459 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+/** @file
+ * @brief Define a bounding volume hierarchy.
+ *
+ * This file defines a binary bounding volume hierarchy built over a set of
+ * axis-aligned bounding boxes. The hierarchy only knows the boxes of the
+ * primitives it indexes: the actual ray/primitive intersection is delegated
+ * to a user provided intersector during the traversal.
+ */
+
+#include <array>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include "alignedallocator.hpp"
+#include "box.hpp"
+#include "cache.hpp"
+#include "ray.hpp"
+#include "raypacket.hpp"
+#include "widebvh.hpp"
+
+/** @brief Node of a bounding volume hierarchy during its construction.
+ *
+ * The builders link the nodes with shared pointers, the tree is then flattened
+ * into an array of BVHFlatNode used for the traversal. A leaf references a contiguous
+ * range [firstPrimitive, firstPrimitive+primitiveCount) of the primitive indices of the
+ * hierarchy. A branch has exactly two children.
+ */
+class BVHNode
+{
+    typedef std::shared_ptr< BVHNode > BVHNodePtr;
+public:
+    ~BVHNode();
+    BVHNode() = delete;
+    BVHNode(const BVHNode& node) = default;
+
+    /**
+     * @brief Build a leaf.
+     * @param aabb The bounding box of the primitives of the leaf.
+     * @param firstPrimitive The offset of the first primitive of the leaf in BVH::primitiveIndices().
+     * @param primitiveCount The number of primitives of the leaf.
+     */
+    BVHNode(const Box& aabb, const int& firstPrimitive, const int& primitiveCount);
+
+    /**
+     * @brief Build a branch.
+     * @param aabb The bounding box of the two children.
+     * @param left The left child.
+     * @param right The right child.
+     * @param splitAxis The axis used to split the primitives between the two children.
+     */
+    BVHNode(const Box& aabb, const BVHNodePtr& left, const BVHNodePtr& right, const int& splitAxis);
+
+    bool isLeaf() const;
+    const Box& aabb() const;
+    const int& firstPrimitive() const;
+    const int& primitiveCount() const;
+    const int& splitAxis() const;
+    const BVHNodePtr& left() const;
+    const BVHNodePtr& right() const;
+private:
+    Box m_aabb; /*!< Bounding box of the node. */
+    int m_firstPrimitive; /*!< Offset of the first primitive, only for leaves, -1 otherwise. */
+    int m_primitiveCount; /*!< Number of primitives, only for leaves, 0 otherwise. */
+    int m_splitAxis; /*!< Split axis, only for branches, -1 otherwise. */
+    std::array<BVHNodePtr,2> m_children; /*!< Only for branches, nullptr otherwise. */
+};
+
+typedef std::shared_ptr< BVHNode > BVHNodePtr;
+
+/** @brief Node of a flattened bounding volume hierarchy.
+ *
+ * The nodes are stored in depth-first order: the first child of a branch directly
+ * follows it and only the index of the second child is stored. A node is 32 bytes,
+ * so that a cache line holds two of them.
+ */
+struct BVHFlatNode
+{
+    Box aabb; /*!< Bounding box of the node. */
+    int offset; /*!< For a leaf, the offset of its first primitive in BVH::primitiveIndices(). For a branch, the index of its second child. */
+    int primitiveCount; /*!< Number of primitives of a leaf, 0 for a branch. */
+
+    bool isLeaf() const { return primitiveCount>0; }
+};
+
+static_assert(sizeof(BVHFlatNode)==32, "A BVHFlatNode must fit in 32 bytes");
+
+/** @brief The nodes of a flattened hierarchy, aligned on a cache line. */
+typedef std::vector< BVHFlatNode, AlignedAllocator<BVHFlatNode,64> > BVHFlatNodes;
+
+/** @brief The strategies available to build a hierarchy.
+ *
+ * MEDIAN_SPLIT and BINNED_SAH split the primitives top-down. LINEAR sorts the primitives
+ * along the Morton curve of their centroids and emits the hierarchy from the sorted codes,
+ * which is much faster to build but of lower quality unless its treelets are restructured.
+ * SPATIAL_SPLIT extends BINNED_SAH with splits that clip the primitives straddling a plane,
+ * so that a primitive can be referenced by several leaves. It needs a BVH::PrimitiveSplitter
+ * and falls back to BINNED_SAH without one.
+ */
+enum BVHBuildMethod { MEDIAN_SPLIT, BINNED_SAH, LINEAR, SPATIAL_SPLIT };
+
+/** @brief Parameters of the construction of a BVH.
+ *
+ * The surface area heuristic (SAH) estimates the cost of a node as
+ * traversalCost + intersectionCost * (A(left)*N(left) + A(right)*N(right)) / A(node)
+ * where A is the surface area of a bounding box and N a number of primitives.
+ * Only the ratio between the two costs matters.
+ */
+struct BVHBuildSettings
+{
+    BVHBuildMethod method = BINNED_SAH; /*!< The strategy used to split the primitives. */
+    int maxLeafSize = 4; /*!< The maximum number of primitives of a leaf, except when the primitives cannot be separated. */
+    float traversalCost = 1.0f; /*!< The SAH cost of visiting a branch. */
+    float intersectionCost = 1.0f; /*!< The SAH cost of intersecting a primitive. */
+    int binCount = 16; /*!< The number of bins per axis of the binned SAH. */
+    int parallelThreshold = 4096; /*!< Sub-trees with more primitives are built by a separate task. */
+    int width = 0; /*!< The number of children per node traversed: 2, 4 with SSE or 8 with AVX2. 0 picks the widest supported by the processor. */
+    float rebuildThreshold = 2.0f; /*!< BVH::refit() rebuilds the hierarchy once its SAH cost exceeds this factor times its cost when built, 0 to never rebuild. */
+    int treeletSize = 0; /*!< Only for LINEAR: the number of leaves, from 3 to 8, of the treelets whose topology is optimized for the SAH, 0 to disable. */
+    float spatialSplitBudget = 0.3f; /*!< Only for SPATIAL_SPLIT: the maximum number of duplicated references, relative to the number of primitives. */
+    float spatialSplitOverlap = 1e-5f; /*!< Only for SPATIAL_SPLIT: spatial splits are tried when the children of the best object split overlap by more than this fraction of the surface area of the root. */
+};
+
+/** @brief Binary bounding volume hierarchy.
+ *
+ * The hierarchy is built top-down, either by splitting the primitives at the median
+ * of their centroids along the largest axis of the centroid bounds, or by choosing the
+ * split minimizing the surface area heuristic among a fixed number of bins per axis
+ * (Wald, "On fast construction of SAH-based bounding volume hierarchies", 2007).
+ * The construction runs in parallel with OpenMP tasks over the sub-trees and over
+ * chunks of primitives when binning large nodes.
+ *
+ * The linear builder follows Karras, "Maximizing parallelism in the construction of BVHs,
+ * octrees, and k-d trees", 2012: Morton codes are radix sorted and every branch of the
+ * binary radix tree is emitted independently. Its treelets can then be restructured as in
+ * Karras and Aila, "Fast parallel construction of high-quality bounding volume hierarchies", 2013.
+ *
+ * The spatial split builder follows Stich et al., "Spatial splits in bounding volume
+ * hierarchies", 2009, including the unsplitting of references.
+ *
+ * Once built, the binary hierarchy can be collapsed into a 4-wide or 8-wide one, by
+ * repeatedly opening the child of largest surface area, so that one traversal step
+ * tests all the children of a node with SIMD instructions.
+ */
+class BVH
+{
+public:
+    ~BVH();
+    BVH() = default;
+    BVH(const BVH& bvh) = default;
+
+    /**
+     * @brief Function computing the bounds of the parts of a primitive on each side of a plane.
+     *
+     * It is called as splitter(primitiveId, axis, position, left, right) and writes in left and right
+     * the bounding boxes of the parts of the primitive below and above the plane normal to the axis
+     * at the position. A box is Box::Empty() when the primitive has no part on its side.
+     */
+    typedef std::function<void(const int& primitive, const int& axis, const float& position, Box& left, Box& right)> PrimitiveSplitter;
+
+    /**
+     * @brief Build a hierarchy over a set of primitives.
+     * @param primitiveBoxes The bounding box of each primitive. The primitive id is its index in this vector.
+     * @param settings The parameters of the construction.
+     * @param splitter The function clipping the primitives, only used by SPATIAL_SPLIT.
+     */
+    BVH(const std::vector<Box>& primitiveBoxes, const BVHBuildSettings& settings = BVHBuildSettings(), const PrimitiveSplitter& splitter = nullptr);
+
+    /**
+     * @brief Restore a hierarchy built before, for instance read back from a cache.
+     *
+     * The arrays are used in place, typically within a mapped cache file, until refit() modifies them.
+     * The wide nodes given are kept if they have the width the processor in use supports, the wide nodes are collapsed
+     * again from the binary ones otherwise. The nodes and primitive ids are used as is: they must have been checked
+     * with IsValid() when read from an untrusted source.
+     * @param settings The settings of the hierarchy, as returned by settings().
+     * @param nodes The nodes of the hierarchy, as returned by nodes().
+     * @param primitiveIndices The primitive ids ordered as referenced by the leaves, as returned by primitiveIndices().
+     * @param builtSahCost The SAH cost of the hierarchy when built, as returned by builtSahCost().
+     * @param nodes4 The 4-wide nodes, as returned by nodes4(), or empty.
+     * @param nodes8 The 8-wide nodes, as returned by nodes8(), or empty.
+     */
+    BVH(const BVHBuildSettings& settings, MappedArray<BVHFlatNodes> nodes, MappedArray< std::vector<int> > primitiveIndices,
+        const float& builtSahCost, MappedArray< WideBVHNodes<4> > nodes4 = MappedArray< WideBVHNodes<4> >(),
+        MappedArray< WideBVHNodes<8> > nodes8 = MappedArray< WideBVHNodes<8> >());
+
+    /**
+     * @brief Check that restored nodes form a hierarchy which can be traversed safely.
+     *
+     * The nodes must be in depth-first order, each branch having its second child after its first sub-tree
+     * and before the end of its own sub-tree, no deeper than MaxDepth. The leaves must reference consecutive ranges
+     * of the primitive ids in depth-first order, covering them all, and the primitive ids must be below the number of primitives.
+     * @param nodes The nodes of the hierarchy.
+     * @param nodeCount The number of nodes.
+     * @param primitiveIndices The primitive ids ordered as referenced by the leaves.
+     * @param primitiveIndexCount The number of primitive ids.
+     * @param primitiveCount The number of primitives of the hierarchy.
+     * @return True if the nodes and primitive ids are consistent, false otherwise.
+     */
+    static bool IsValid(const BVHFlatNode* nodes, const int& nodeCount, const int* primitiveIndices, const int& primitiveIndexCount,
+                        const int& primitiveCount);
+
+    /**
+     * @brief Check that restored wide nodes collapse valid binary nodes and can be traversed safely.
+     *
+     * Each branch must have its children after it, be reached from a single parent and be no deeper than MaxDepth.
+     * Each leaf must be a leaf of the binary nodes.
+     * @param wideNodes The wide nodes of the hierarchy.
+     * @param wideNodeCount The number of wide nodes.
+     * @param nodes The binary nodes of the hierarchy, checked with IsValid() before.
+     * @param nodeCount The number of binary nodes.
+     * @param primitiveIndexCount The number of primitive ids.
+     * @return True if the wide nodes are consistent with the binary ones, false otherwise.
+     */
+    template<int Width>
+    static bool IsValid(const WideBVHNode<Width>* wideNodes, const int& wideNodeCount, const BVHFlatNode* nodes, const int& nodeCount,
+                        const int& primitiveIndexCount);
+
+    const BVHBuildSettings& settings() const;
+
+    /**
+     * @brief Access to the nodes of the hierarchy in depth-first order, the root being the first one.
+     */
+    const MappedArray<BVHFlatNodes>& nodes() const;
+
+    /**
+     * @brief Access to the nodes of the 4-wide hierarchy, empty unless settings().width is 4.
+     */
+    const MappedArray< WideBVHNodes<4> >& nodes4() const;
+
+    /**
+     * @brief Access to the nodes of the 8-wide hierarchy, empty unless settings().width is 8.
+     */
+    const MappedArray< WideBVHNodes<8> >& nodes8() const;
+
+    /**
+     * @brief Compute the SAH cost of the whole hierarchy.
+     *
+     * Sum of the costs of the nodes weighted by the probability of hitting them,
+     * that is the ratio between their surface area and the one of the root.
+     * The lower, the faster the expected traversal.
+     */
+    float sahCost() const;
+
+    /**
+     * @brief Update the bounds of the nodes after the primitives moved, keeping the topology.
+     *
+     * The bounds are recomputed bottom-up, in parallel over the sub-trees. Refitting is
+     * much faster than building but the quality of the hierarchy degrades as the primitives
+     * move away from their initial positions. The hierarchy is therefore rebuilt when its
+     * SAH cost grows beyond settings().rebuildThreshold times its cost when built.
+     *
+     * The references of a primitive duplicated by spatial splits are bounded by the whole primitive
+     * and the hierarchy is rebuilt without spatial splits.
+     *
+     * @param primitiveBoxes The new bounding box of each primitive, as many as when built.
+     * @return True if the hierarchy has been rebuilt, false if it has only been refitted.
+     */
+    bool refit(const std::vector<Box>& primitiveBoxes);
+
+    /**
+     * @brief The SAH cost of the hierarchy when it was last built.
+     */
+    const float& builtSahCost() const;
+
+    /**
+     * @brief Access to the primitive ids ordered as referenced by the leaves.
+     *
+     * With spatial splits, a primitive id can appear several times.
+     */
+    const MappedArray< std::vector<int> >& primitiveIndices() const;
+
+    /**
+     * @brief Check if the hierarchy indexes no primitive.
+     */
+    bool empty() const;
+
+    /**
+     * @brief Collapse the binary nodes into a wide hierarchy, as for nodes4() and nodes8().
+     *
+     * Used by the hierarchies bounding the same nodes by other volumes, which attach their own bounds
+     * to the children of the wide nodes.
+     * @param wideNodes The wide nodes, in depth-first order.
+     * @param binaryChildren For each wide node, the index in nodes() of each of its children, -1 for an empty slot.
+     */
+    template<int Width>
+    void collapseNodes(WideBVHNodes<Width>& wideNodes, std::vector< std::array<int,Width> >& binaryChildren) const;
+
+    /**
+     * @brief Find the closest intersection between a ray and the primitives.
+     *
+     * Nodes are visited front to back and a node is skipped as soon as its entry
+     * distance lies beyond the closest distance found so far. The wide hierarchy is
+     * traversed when there is one.
+     *
+     * The intersector is called as intersector(primitiveId, ray, tMax). It must return
+     * true only if it found a hit closer than tMax, in which case it updates tMax
+     * with the distance of this hit.
+     *
+     * @param r The ray.
+     * @param tMax The maximum distance along the ray, updated with the closest hit distance.
+     * @param intersector The primitive intersector.
+     * @return True if a primitive has been hit, false otherwise.
+     */
+    template<typename TIntersector>
+    bool intersect(const Ray& r, float& tMax, TIntersector& intersector) const;
+
+    /**
+     * @brief Find the closest intersection between a ray and the primitives, leaf by leaf.
+     *
+     * Same traversal as intersect(), but the leaf intersector is called once per leaf reached,
+     * as leafIntersector(first, count, ray, tMax), to test the primitives at the positions
+     * [first, first+count) of primitiveIndices() together, for instance with SIMD instructions.
+     * It must return true only if it found a hit closer than tMax, in which case it updates tMax
+     * with the distance of this hit.
+     *
+     * @param r The ray.
+     * @param tMax The maximum distance along the ray, updated with the closest hit distance.
+     * @param leafIntersector The leaf intersector.
+     * @return True if a primitive has been hit, false otherwise.
+     */
+    template<typename TLeafIntersector>
+    bool intersectLeaves(const Ray& r, float& tMax, TLeafIntersector& leafIntersector) const;
+
+    /**
+     * @brief Check if any primitive is hit by a ray before a maximum distance.
+     *
+     * Unlike intersect(), the traversal stops at the first hit found, whichever it is, which
+     * is enough for shadow rays. The occluder is called as occluder(primitiveId, ray, tMax)
+     * and must return true if the primitive is hit before tMax.
+     *
+     * @param r The ray.
+     * @param tMax The maximum distance along the ray.
+     * @param occluder The primitive occlusion test.
+     * @return True if a primitive is hit before tMax, false otherwise.
+     */
+    template<typename TOccluder>
+    bool occluded(const Ray& r, const float& tMax, TOccluder& occluder) const;
+
+    /**
+     * @brief Check if any primitive is hit by a ray before a maximum distance, leaf by leaf.
+     *
+     * Same traversal as occluded(), but the leaf occluder is called once per leaf reached, as
+     * leafOccluder(first, count, ray, tMax), and must return true if any of the primitives at the
+     * positions [first, first+count) of primitiveIndices() is hit before tMax.
+     *
+     * @param r The ray.
+     * @param tMax The maximum distance along the ray.
+     * @param leafOccluder The leaf occlusion test.
+     * @return True if a primitive is hit before tMax, false otherwise.
+     */
+    template<typename TLeafOccluder>
+    bool occludedLeaves(const Ray& r, const float& tMax, TLeafOccluder& leafOccluder) const;
+
+    /**
+     * @brief Find the closest intersections between the rays of a packet and the primitives, leaf by leaf.
+     *
+     * The binary hierarchy is traversed once for the whole packet: a node is culled by the interval
+     * test of IntersectInterval() against the largest closest hit distance of the rays, and the nodes
+     * are visited front to back according to the lower bound of the entry distances. At a leaf, the
+     * rays are tested one by one against its box with IntersectBox(), so that only the rays reaching it
+     * are tested against its primitives. An incoherent packet, such as secondary rays, is traced ray
+     * after ray with intersectLeaves().
+     *
+     * The leaf intersector is called as leafIntersector(first, count, packet, mask, tMax) to test the
+     * rays of mask against the primitives at the positions [first, first+count) of primitiveIndices().
+     * It must return the mask of the rays for which it found a hit closer than their tMax, whose tMax
+     * it updates with the distance of this hit.
+     *
+     * @param packet The packet of rays.
+     * @param mask The rays to trace, bit i standing for ray i.
+     * @param tMax The maximum distance along each ray, RayPacket::MaxSize values updated with the closest hit distances.
+     * @param leafIntersector The leaf intersector.
+     * @return The mask of the rays which hit a primitive.
+     */
+    template<typename TLeafIntersector>
+    int intersectPacket(const RayPacket& packet, const int& mask, float* tMax, TLeafIntersector& leafIntersector) const;
+
+    static const int MaxDepth = 64; /*!< The maximum depth of a hierarchy, which bounds the traversal stack. */
+
+private:
+    MappedArray<BVHFlatNodes> m_nodes;
+    MappedArray< WideBVHNodes<4> > m_nodes4;
+    MappedArray< WideBVHNodes<8> > m_nodes8;
+    float m_builtSahCost = 0.0f;
+    MappedArray< std::vector<int> > m_primitiveIndices;
+    BVHBuildSettings m_settings;
+
+    BVHNodePtr build(const std::vector<Box>& primitiveBoxes, const std::vector<glm::vec3>& centroids, const int& begin, const int& end, const int& depth);
+    int splitMedian(const std::vector<glm::vec3>& centroids, const Box& centroidBounds, const int& begin, const int& end, int& axis);
+    int splitSAH(const std::vector<Box>& primitiveBoxes, const std::vector<glm::vec3>& centroids, const Box& aabb, const Box& centroidBounds,
+                 const int& begin, const int& end, int& axis);
+    BVHNodePtr buildLinear(const std::vector<Box>& primitiveBoxes, const std::vector<glm::vec3>& centroids);
+    void flatten(const BVHNodePtr& node);
+    void orderLeaves();
+    void refitSubtree(const std::vector<Box>& primitiveBoxes, const int& begin, const int& end);
+    void collapseWideNodes();
+    template<int Width>
+    int collapse(WideBVHNodes<Width>& wideNodes, const int& node, std::vector< std::array<int,Width> >* binaryChildren = nullptr) const;
+    void computeBounds(const std::vector<Box>& primitiveBoxes, const std::vector<glm::vec3>& centroids, const int& begin, const int& end,
+                       Box& aabb, Box& centroidBounds) const;
+};
+
+/**
+ * @brief Find the closest intersection between a ray and the primitives of a binary hierarchy, leaf by leaf.
+ *
+ * The traversal of BVH::intersectLeaves(), shared by the hierarchies whose binary nodes only differ
+ * by their bounding volumes. The nodes are in depth-first order, the first child of a branch following
+ * it, and provide isLeaf(), offset and primitiveCount as BVHFlatNode does.
+ * The node test is called as nodeIntersector(node, tMax, tEntry) and must return true if the ray enters
+ * the node of this index before tMax, tEntry being its entry distance clamped to 0.
+ *
+ * @param nodes The nodes, the root being the first one.
+ * @param r The ray.
+ * @param tMax The maximum distance along the ray, updated with the closest hit distance.
+ * @param nodeIntersector The node test.
+ * @param leafIntersector The leaf intersector, as for BVH::intersectLeaves().
+ * @return True if a primitive has been hit, false otherwise.
+ */
+template<typename TNode, typename TNodeIntersector, typename TLeafIntersector>
+bool TraverseBinary(const TNode* nodes, const Ray& r, float& tMax, TNodeIntersector& nodeIntersector, TLeafIntersector& leafIntersector);
+
+/**
+ * @brief Find the closest intersection between a ray and the primitives of a wide hierarchy, leaf by leaf.
+ *
+ * The traversal of the 4-wide and 8-wide nodes, shared as TraverseBinary() is. The children test is called
+ * as childrenIntersector(node, index, tMax, tEntry) and must return the mask of the children of the node
+ * entered before tMax, with their entry distances, as IntersectChildren() does.
+ *
+ * @param wideNodes The nodes, the root being the first one.
+ * @param r The ray.
+ * @param tMax The maximum distance along the ray, updated with the closest hit distance.
+ * @param childrenIntersector The children test.
+ * @param leafIntersector The leaf intersector, as for BVH::intersectLeaves().
+ * @return True if a primitive has been hit, false otherwise.
+ */
+template<int Width, typename TChildrenIntersector, typename TLeafIntersector>
+bool TraverseWide(const WideBVHNode<Width>* wideNodes, const Ray& r, float& tMax, TChildrenIntersector& childrenIntersector, TLeafIntersector& leafIntersector);
+
+/**
+ * @brief Check if any primitive of a hierarchy is hit by a ray before a maximum distance, leaf by leaf.
+ *
+ * The occlusion test of BVH::occludedLeaves() on top of the intersectLeaves() of any hierarchy.
+ * @param hierarchy The hierarchy, a BVH or an ExtentBVH.
+ * @param r The ray.
+ * @param tMax The maximum distance along the ray.
+ * @param leafOccluder The leaf occlusion test, as for BVH::occludedLeaves().
+ * @return True if a primitive is hit before tMax, false otherwise.
+ */
+template<typename THierarchy, typename TLeafOccluder>
+bool OccludedLeaves(const THierarchy& hierarchy, const Ray& r, const float& tMax, TLeafOccluder& leafOccluder);
+
+#include "bvh.inl"
+
+#endif // BVH_HPP
@@ -0,0 +1,285 @@
+#ifndef BVH_INL
+#define BVH_INL
+
+#include "bvh.hpp"
+
+template<typename TIntersector>
+bool BVH::intersect(const Ray& r, float& tMax, TIntersector& intersector) const
+{
+    //Test the primitives of a leaf one after another
+    auto leafIntersector = [&](const int& first, const int& count, const Ray& ray, float& t)
+    {
+        bool hit = false;
+        for(int i=first; i<first+count; ++i)
+        {
+            hit = intersector(m_primitiveIndices[i], ray, t) || hit;
+        }
+        return hit;
+    };
+    return intersectLeaves(r, tMax, leafIntersector);
+}
+
+template<typename TLeafIntersector>
+bool BVH::intersectLeaves(const Ray& r, float& tMax, TLeafIntersector& leafIntersector) const
+{
+    if(m_nodes.empty()) return false;
+
+    //The same test for the children of the 4-wide and the 8-wide nodes
+    auto childrenIntersector = [&](const auto& node, const int&, const float& t, float* tEntry)
+    {
+        return IntersectChildren(node, r, t, tEntry);
+    };
+    if(!m_nodes8.empty()) return TraverseWide(m_nodes8.data(), r, tMax, childrenIntersector, leafIntersector);
+    if(!m_nodes4.empty()) return TraverseWide(m_nodes4.data(), r, tMax, childrenIntersector, leafIntersector);
+
+    auto nodeIntersector = [&](const int& node, const float& t, float& tEntry)
+    {
+        std::array<float,2> tBox;
+        if( !::Intersect(r, m_nodes[node].aabb, tBox) || tBox[1]<0 || tBox[0]>t ) return false;
+        tEntry = std::max(tBox[0], 0.0f);
+        return true;
+    };
+    return TraverseBinary(m_nodes.data(), r, tMax, nodeIntersector, leafIntersector);
+}
+
+template<typename TOccluder>
+bool BVH::occluded(const Ray& r, const float& tMax, TOccluder& occluder) const
+{
+    auto leafOccluder = [&](const int& first, const int& count, const Ray& ray, const float& t)
+    {
+        for(int i=first; i<first+count; ++i)
+        {
+            if(occluder(m_primitiveIndices[i], ray, t)) return true;
+        }
+        return false;
+    };
+    return occludedLeaves(r, tMax, leafOccluder);
+}
+
+template<typename TLeafOccluder>
+bool BVH::occludedLeaves(const Ray& r, const float& tMax, TLeafOccluder& leafOccluder) const
+{
+    return OccludedLeaves(*this, r, tMax, leafOccluder);
+}
+
+template<typename TLeafIntersector>
+int BVH::intersectPacket(const RayPacket& packet, const int& mask, float* tMax, TLeafIntersector& leafIntersector) const
+{
+    if(m_nodes.empty() || mask==0) return 0;
+
+    int hitMask = 0;
+    if(!packet.coherent)
+    {
+        //The interval test requires the same direction signs: fall back to one traversal per ray
+        for(int i=0; i<packet.size; ++i)
+        {
+            if((mask & (1<<i))==0) continue;
+            auto rayIntersector = [&](const int& first, const int& count, const Ray&, float&)
+            {
+                return leafIntersector(first, count, packet, 1<<i, tMax)!=0;
+            };
+            if(intersectLeaves(packet.rays[i], tMax[i], rayIntersector)) hitMask |= 1<<i;
+        }
+        return hitMask;
+    }
+
+    //A node is culled once it lies beyond the closest hit of every ray
+    auto packetTMax = [&]()
+    {
+        float t = 0.0f;
+        for(int i=0; i<packet.size; ++i)
+        {
+            if(mask & (1<<i)) t = std::max(t, tMax[i]);
+        }
+        return t;
+    };
+    float tPacket = packetTMax();
+
+    float tRoot;
+    if( !IntersectInterval(packet, m_nodes[0].aabb, tPacket, tRoot) ) return 0;
+
+    //Stack of the indices of the nodes to visit with the lower bound of their entry distance
+    std::array< std::pair<int, float>, MaxDepth+1 > stack;
+    int stackSize = 0;
+    stack[stackSize++] = std::make_pair(0, tRoot);
+
+    while(stackSize>0)
+    {
+        const std::pair<int, float> entry = stack[--stackSize];
+        if(entry.second > tPacket) continue;
+
+        const BVHFlatNode& node = m_nodes[entry.first];
+        if(node.isLeaf())
+        {
+            //Only the rays actually reaching the leaf are tested against its primitives
+            const int leafMask = IntersectBox(packet, mask, node.aabb, tMax);
+            if(leafMask==0) continue;
+            const int leafHitMask = leafIntersector(node.offset, node.primitiveCount, packet, leafMask, tMax);
+            if(leafHitMask!=0)
+            {
+                hitMask |= leafHitMask;
+                tPacket = packetTMax();
+            }
+        }
+        else
+        {
+            //The first child follows its parent
+            const int left = entry.first+1;
+            const int right = node.offset;
+            float entryLeft, entryRight;
+            bool hitLeft = IntersectInterval(packet, m_nodes[left].aabb, tPacket, entryLeft);
+            bool hitRight = IntersectInterval(packet, m_nodes[right].aabb, tPacket, entryRight);
+            if(hitLeft && hitRight)
+            {
+                //Push the farthest child first so that the nearest one is visited first
+                if(entryLeft<=entryRight)
+                {
+                    stack[stackSize++] = std::make_pair(right, entryRight);
+                    stack[stackSize++] = std::make_pair(left, entryLeft);
+                }
+                else
+                {
+                    stack[stackSize++] = std::make_pair(left, entryLeft);
+                    stack[stackSize++] = std::make_pair(right, entryRight);
+                }
+            }
+            else if(hitLeft)
+            {
+                stack[stackSize++] = std::make_pair(left, entryLeft);
+            }
+            else if(hitRight)
+            {
+                stack[stackSize++] = std::make_pair(right, entryRight);
+            }
+        }
+    }
+    return hitMask;
+}
+
+template<typename TNode, typename TNodeIntersector, typename TLeafIntersector>
+bool TraverseBinary(const TNode* nodes, const Ray& r, float& tMax, TNodeIntersector& nodeIntersector, TLeafIntersector& leafIntersector)
+{
+    float tRoot;
+    if( !nodeIntersector(0, tMax, tRoot) ) return false;
+
+    //Stack of the indices of the nodes to visit with their entry distance
+    std::array< std::pair<int, float>, BVH::MaxDepth+1 > stack;
+    int stackSize = 0;
+    stack[stackSize++] = std::make_pair(0, tRoot);
+
+    bool hit = false;
+    while(stackSize>0)
+    {
+        const std::pair<int, float> entry = stack[--stackSize];
+        //The node lies beyond the closest hit found so far
+        if(entry.second > tMax) continue;
+
+        const TNode& node = nodes[entry.first];
+        if(node.isLeaf())
+        {
+            hit = leafIntersector(node.offset, node.primitiveCount, r, tMax) || hit;
+        }
+        else
+        {
+            //The first child follows its parent
+            const int left = entry.first+1;
+            const int right = node.offset;
+            float entryLeft, entryRight;
+            bool hitLeft = nodeIntersector(left, tMax, entryLeft);
+            bool hitRight = nodeIntersector(right, tMax, entryRight);
+            if(hitLeft && hitRight)
+            {
+                //Push the farthest child first so that the nearest one is visited first
+                if(entryLeft<=entryRight)
+                {
+                    stack[stackSize++] = std::make_pair(right, entryRight);
+                    stack[stackSize++] = std::make_pair(left, entryLeft);
+                }
+                else
+                {
+                    stack[stackSize++] = std::make_pair(left, entryLeft);
+                    stack[stackSize++] = std::make_pair(right, entryRight);
+                }
+            }
+            else if(hitLeft)
+            {
+                stack[stackSize++] = std::make_pair(left, entryLeft);
+            }
+            else if(hitRight)
+            {
+                stack[stackSize++] = std::make_pair(right, entryRight);
+            }
+        }
+    }
+    return hit;
+}
+
+template<int Width, typename TChildrenIntersector, typename TLeafIntersector>
+bool TraverseWide(const WideBVHNode<Width>* wideNodes, const Ray& r, float& tMax, TChildrenIntersector& childrenIntersector, TLeafIntersector& leafIntersector)
+{
+    //A child to visit: the index of its node or its first primitive, its primitive count and its entry distance
+    struct Entry
+    {
+        int child;
+        int primitiveCount;
+        float t;
+    };
+
+    //Each level pushes at most Width children and pops its node
+    std::array< Entry, BVH::MaxDepth*(Width-1)+1 > stack;
+    int stackSize = 0;
+    stack[stackSize++] = Entry{0, 0, 0.0f};
+
+    bool hit = false;
+    float tEntry[Width];
+    while(stackSize>0)
+    {
+        const Entry entry = stack[--stackSize];
+        //The child lies beyond the closest hit found so far
+        if(entry.t > tMax) continue;
+
+        if(entry.primitiveCount>0)
+        {
+            hit = leafIntersector(entry.child, entry.primitiveCount, r, tMax) || hit;
+            continue;
+        }
+
+        const WideBVHNode<Width>& node = wideNodes[entry.child];
+        const int mask = childrenIntersector(node, entry.child, tMax, tEntry);
+
+        //Insert the children hit by decreasing distance so that the nearest one is visited first
+        const int first = stackSize;
+        for(int i=0; i<Width; ++i)
+        {
+            if((mask & (1<<i))==0 || node.primitiveCounts[i]<0) continue;
+            const Entry child = Entry{node.children[i], node.primitiveCounts[i], tEntry[i]};
+            int j = stackSize++;
+            while(j>first && stack[j-1].t<child.t)
+            {
+                stack[j] = stack[j-1];
+                --j;
+            }
+            stack[j] = child;
+        }
+    }
+    return hit;
+}
+
+template<typename THierarchy, typename TLeafOccluder>
+bool OccludedLeaves(const THierarchy& hierarchy, const Ray& r, const float& tMax, TLeafOccluder& leafOccluder)
+{
+    //The first hit drops the maximum distance below any entry distance, which culls all the nodes left on the stack
+    bool occluded = false;
+    auto leafIntersector = [&](const int& first, const int& count, const Ray& ray, float& t)
+    {
+        if(!leafOccluder(first, count, ray, t)) return false;
+        occluded = true;
+        t = -std::numeric_limits<float>::infinity();
+        return true;
+    };
+    float t = tMax;
+    hierarchy.intersectLeaves(r, t, leafIntersector);
+    return occluded;
+}
+
+#endif // BVH_INL
@@ -8,6 +8,7 @@
  */
 
 #include "ray.hpp"
+#include "raypacket.hpp"
 #include <glm/glm.hpp>
 #include <iostream>
 
@@ -150,12 +151,27 @@ public:
     /**
      * @brief Compute a ray going from the position of camera to the world coordinate of a pixel.
      *
+     * The matrices of the camera are inverted for each ray: CameraRayGenerator computes
+     * the rays of a whole image from matrices inverted once.
+     *
      * @param x The x coordinate of the pixel.
      * @param y The y coordinate of the pixel.
      * @return A ray whose origin is the position of the camera and direction points to the world position of the pixel situated at (x, y).
      */
     Ray computeRayThroughPixel(const float& x, const float& y);
 
+    /**
+     * @brief Compute the rays going from the position of the camera to the pixels of a square block.
+     *
+     * The ray through the pixel (x+i, y+j) is the ray i+j*packetWidth of the packet, the same as
+     * computeRayThroughPixel(x+i, y+j).
+     * @param x The x coordinate of the first pixel of the block.
+     * @param y The y coordinate of the first pixel of the block.
+     * @param packetWidth The width of the block, 2 or 4 so that the packet holds 4 or 16 rays.
+     * @return The packet of the rays through the pixels of the block.
+     */
+    RayPacket computeRayPacket(const float& x, const float& y, const int& packetWidth);
+
 private:
     int m_width; /*!< The width of the displayed window handle by the camera. */
     int m_height; /*!< The height of the displayed window handle by the camera. */
@@ -1,6 +1,7 @@
 #ifndef EXTENT_HPP
 #define EXTENT_HPP
 
+#include <array>
 #include <vector>
 #include <glm/glm.hpp>
 #include <memory>
@@ -14,8 +15,18 @@ public:
     ExtentSettings() = default;
     ExtentSettings( const std::vector<glm::vec3>& planeSetNormals );
     ExtentSettings( const ExtentSettings& extentSettings ) = default;
-    const std::vector<glm::vec3>& planeSetNormals();
+    const std::vector<glm::vec3>& planeSetNormals() const;
     static ExtentSettingsPtr AABB_Settings();
+
+    /**
+     * @brief The 7 plane-set normals of a 14-DOP: the 3 axes and the 4 diagonals of a cube.
+     */
+    static ExtentSettingsPtr KDOP7_Settings();
+
+    /**
+     * @brief The 13 plane-set normals of a 26-DOP: the ones of the 14-DOP and the 6 diagonals of the faces of a cube.
+     */
+    static ExtentSettingsPtr KDOP13_Settings();
 private:
     std::vector<glm::vec3> m_planeSetNormals;
 };
@@ -30,9 +41,9 @@ public:
     Extent( std::array<glm::vec3,2>& bounds );
     Extent( const ExtentSettingsPtr& settings, std::vector<glm::vec3>& points );
     Extent( const Extent& extent ) = default;
-    const ExtentSettingsPtr& settings();
-    const std::vector< std::array<float,2> >& slabOffsets();
-    const std::array<glm::vec3,2> & bounds();
+    const ExtentSettingsPtr& settings() const;
+    const std::vector< std::array<float,2> >& slabOffsets() const;
+    const std::array<glm::vec3,2> & bounds() const;
 private:
     ExtentSettingsPtr m_settings;
     std::vector< std::array<float,2> > m_slabOffsets; /*!< Pair of in/out distance to origins for each plane-set normal*/
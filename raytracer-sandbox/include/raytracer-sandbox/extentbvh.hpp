@@ -0,0 +1,211 @@
+#ifndef EXTENTBVH_HPP
+#define EXTENTBVH_HPP
+
+/** @file
+ * @brief Define a bounding volume hierarchy whose nodes are k-DOPs.
+ *
+ * This file defines a hierarchy bounding its nodes by discrete oriented polytopes,
+ * that is the intersection of k slabs whose normals are given by an ExtentSettings,
+ * and the SIMD kernel testing a ray against all the slabs of a node at once.
+ */
+
+#include <array>
+#include <limits>
+#include <vector>
+#include "alignedallocator.hpp"
+#include "bvh.hpp"
+#include "extent.hpp"
+#include "ray.hpp"
+
+/** @brief Node of a hierarchy of k-DOPs.
+ *
+ * The nodes share the depth-first layout of BVHFlatNode: the first child of a branch
+ * directly follows it and only the index of the second child is stored. Their slabs
+ * are stored apart, in ExtentBVH::slabs().
+ */
+struct ExtentBVHNode
+{
+    int offset; /*!< For a leaf, the offset of its first primitive in ExtentBVH::primitiveIndices(). For a branch, the index of its second child. */
+    int primitiveCount; /*!< Number of primitives of a leaf, 0 for a branch. */
+
+    bool isLeaf() const { return primitiveCount>0; }
+};
+
+/** @brief The slabs of the nodes of a hierarchy of k-DOPs, aligned on a cache line. */
+typedef std::vector< float, AlignedAllocator<float,64> > ExtentBVHSlabs;
+
+/** @brief A ray expressed in the plane-set normals of a hierarchy.
+ *
+ * Kay and Kajiya, "Ray tracing complex scenes", 1986: the distance to the plane
+ * dot(n,x)=d along the ray is (d-dot(n,origin))/dot(n,direction), so the two dot
+ * products are computed once per ray and each slab only costs a subtraction and a
+ * multiplication.
+ */
+struct ExtentRay
+{
+    alignas(64) std::array<float,16> origins; /*!< dot(n,origin) for each plane-set normal n. */
+    alignas(64) std::array<float,16> invDirections; /*!< 1/dot(n,direction) for each plane-set normal n. */
+};
+
+/**
+ * @brief Test a ray against the slabs of a node, 4 slabs at a time with SSE.
+ *
+ * @param slabs The near offsets of the slabs of the node followed by their far offsets, lanes values each.
+ * @param r The ray expressed in the plane-set normals.
+ * @param lanes The number of plane-set normals rounded up to a multiple of 4.
+ * @param tMax The maximum distance along the ray.
+ * @param tEntry The entry distance of the ray in the node, clamped to 0.
+ * @return True if the ray enters the node before tMax.
+ */
+bool IntersectSlabs(const float* slabs, const ExtentRay& r, const int& lanes, const float& tMax, float& tEntry);
+
+/**
+ * @brief Test a ray against the slabs of the children of a wide node, beyond their bounding boxes.
+ *
+ * The slabs of a plane-set normal are tested for all the children at once, 4 children with SSE
+ * or 8 children with AVX2.
+ * @param slabs The near offsets of the slabs of the children, Width values per normal, followed by their far offsets.
+ * @param r The ray expressed in the plane-set normals.
+ * @param normalCount The number of plane-set normals.
+ * @param width The number of children of the node, 4 or 8. 8 requires SupportsAVX2().
+ * @param tMax The maximum distance along the ray.
+ * @param tEntry The entry distance of the ray in each child, as given by IntersectChildren(), updated with the entry in its slabs.
+ * @return The mask of the children whose slabs are entered before they are left and before tMax, bit i standing for child i.
+ */
+int IntersectChildrenSlabs(const float* slabs, const ExtentRay& r, const int& normalCount, const int& width, const float& tMax, float* tEntry);
+
+/** @brief Bounding volume hierarchy whose nodes are k-DOPs.
+ *
+ * The topology is the one of a BVH built over the bounding boxes of the primitives:
+ * only the bounding volumes change. A k-DOP is the intersection of the slabs enclosing
+ * the primitives between two planes of normal n, for each plane-set normal n. With the
+ * 7 or 13 normals of ExtentSettings::KDOP7_Settings() and ExtentSettings::KDOP13_Settings(),
+ * the diagonal slabs cut the corners of the boxes, which are mostly empty for geometry
+ * that is not aligned with the axes, so that fewer rays reach the leaves.
+ *
+ * The binary nodes are collapsed as the ones of the BVH when it is 4-wide or 8-wide. The children
+ * of a wide node are first tested against their bounding boxes with IntersectChildren(), then the
+ * children hit are tested against the slabs of the normals not aligned with an axis with
+ * IntersectChildrenSlabs(). A binary hierarchy tests each node against all its slabs, padded to a
+ * multiple of 4 with infinite ones, so that 3, 7 and 13 normals are tested in one, two and four SSE steps.
+ *
+ * Fewer rays reach the leaves, but each node is larger and costs more to test. k-DOPs pay off on long
+ * thin triangles that are not aligned with the axes, and not on meshes of small triangles whose boxes
+ * are already tight: compare both on the meshes at hand with extentbvhBenchmark.
+ */
+class ExtentBVH
+{
+public:
+    ~ExtentBVH();
+    ExtentBVH() = default;
+    ExtentBVH(const ExtentBVH& bvh) = default;
+
+    /**
+     * @brief Bound the nodes of a hierarchy by k-DOPs.
+     * @param bvh The hierarchy whose topology and primitive indices are reused.
+     * @param primitiveExtents The k-DOP of each primitive, computed with settings. The primitive id is its index in this vector.
+     * @param settings The plane-set normals, at most 16.
+     */
+    ExtentBVH(const BVH& bvh, const std::vector<Extent>& primitiveExtents, const ExtentSettingsPtr& settings);
+
+    const ExtentSettingsPtr& settings() const;
+
+    /**
+     * @brief The number of plane-set normals rounded up to a multiple of 4, the number of near or far offsets per node.
+     */
+    const int& lanes() const;
+
+    /**
+     * @brief The number of children per node traversed: 2, 4 or 8, the width of the BVH it has been built from.
+     */
+    const int& width() const;
+
+    /**
+     * @brief Access to the binary nodes of the hierarchy in depth-first order, the root being the first one.
+     */
+    const std::vector<ExtentBVHNode>& nodes() const;
+
+    /**
+     * @brief Access to the slabs of the binary nodes, 2*lanes() offsets per node as expected by IntersectSlabs().
+     */
+    const ExtentBVHSlabs& slabs() const;
+
+    /**
+     * @brief Access to the plane-set normals not aligned with an axis, whose slabs bound the children of the wide nodes.
+     */
+    const std::vector<glm::vec3>& cullingNormals() const;
+
+    /**
+     * @brief Access to the slabs of the children of the wide nodes, 2*width()*cullingNormals().size() offsets per wide node
+     * as expected by IntersectChildrenSlabs(), empty unless width() is 4 or 8.
+     */
+    const ExtentBVHSlabs& wideSlabs() const;
+
+    /**
+     * @brief Access to the primitive ids ordered as referenced by the leaves.
+     */
+    const std::vector<int>& primitiveIndices() const;
+
+    /**
+     * @brief Check if the hierarchy indexes no primitive.
+     */
+    bool empty() const;
+
+    /**
+     * @brief Find the closest intersection between a ray and the primitives.
+     *
+     * Same contract as BVH::intersect().
+     * @param r The ray.
+     * @param tMax The maximum distance along the ray, updated with the closest hit distance.
+     * @param intersector The primitive intersector.
+     * @return True if a primitive has been hit, false otherwise.
+     */
+    template<typename TIntersector>
+    bool intersect(const Ray& r, float& tMax, TIntersector& intersector) const;
+
+    /**
+     * @brief Find the closest intersection between a ray and the primitives, leaf by leaf.
+     *
+     * Same contract as BVH::intersectLeaves().
+     * @param r The ray.
+     * @param tMax The maximum distance along the ray, updated with the closest hit distance.
+     * @param leafIntersector The leaf intersector.
+     * @return True if a primitive has been hit, false otherwise.
+     */
+    template<typename TLeafIntersector>
+    bool intersectLeaves(const Ray& r, float& tMax, TLeafIntersector& leafIntersector) const;
+
+    /**
+     * @brief Check if any primitive is hit by a ray before a maximum distance, leaf by leaf.
+     *
+     * Same contract as BVH::occludedLeaves().
+     * @param r The ray.
+     * @param tMax The maximum distance along the ray.
+     * @param leafOccluder The leaf occlusion test.
+     * @return True if a primitive is hit before tMax, false otherwise.
+     */
+    template<typename TLeafOccluder>
+    bool occludedLeaves(const Ray& r, const float& tMax, TLeafOccluder& leafOccluder) const;
+
+private:
+    ExtentSettingsPtr m_settings;
+    int m_lanes = 0;
+    int m_width = 2;
+    std::vector<ExtentBVHNode> m_nodes;
+    ExtentBVHSlabs m_slabs;
+    std::vector<glm::vec3> m_cullingNormals;
+    WideBVHNodes<4> m_nodes4;
+    WideBVHNodes<8> m_nodes8;
+    ExtentBVHSlabs m_wideSlabs;
+    std::vector<int> m_primitiveIndices;
+
+    ExtentRay toExtentRay(const Ray& r, const std::vector<glm::vec3>& normals) const;
+    template<int Width>
+    void collapseSlabs(const BVH& bvh, WideBVHNodes<Width>& wideNodes);
+    template<int Width, typename TLeafIntersector>
+    bool intersectWide(const WideBVHNodes<Width>& wideNodes, const Ray& r, float& tMax, TLeafIntersector& leafIntersector) const;
+};
+
+#include "extentbvh.inl"
+
+#endif // EXTENTBVH_HPP
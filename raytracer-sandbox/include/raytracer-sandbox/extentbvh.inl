@@ -0,0 +1,61 @@
+#ifndef EXTENTBVH_INL
+#define EXTENTBVH_INL
+
+#include "extentbvh.hpp"
+
+template<typename TIntersector>
+bool ExtentBVH::intersect(const Ray& r, float& tMax, TIntersector& intersector) const
+{
+    //Test the primitives of a leaf one after another
+    auto leafIntersector = [&](const int& first, const int& count, const Ray& ray, float& t)
+    {
+        bool hit = false;
+        for(int i=first; i<first+count; ++i)
+        {
+            hit = intersector(m_primitiveIndices[i], ray, t) || hit;
+        }
+        return hit;
+    };
+    return intersectLeaves(r, tMax, leafIntersector);
+}
+
+template<typename TLeafIntersector>
+bool ExtentBVH::intersectLeaves(const Ray& r, float& tMax, TLeafIntersector& leafIntersector) const
+{
+    if(m_nodes.empty()) return false;
+    if(!m_nodes8.empty()) return intersectWide(m_nodes8, r, tMax, leafIntersector);
+    if(!m_nodes4.empty()) return intersectWide(m_nodes4, r, tMax, leafIntersector);
+
+    const ExtentRay extentRay = toExtentRay(r, m_settings->planeSetNormals());
+    const int stride = 2*m_lanes;
+    auto nodeIntersector = [&](const int& node, const float& t, float& tEntry)
+    {
+        return IntersectSlabs(&m_slabs[node*stride], extentRay, m_lanes, t, tEntry);
+    };
+    return TraverseBinary(m_nodes.data(), r, tMax, nodeIntersector, leafIntersector);
+}
+
+template<int Width, typename TLeafIntersector>
+bool ExtentBVH::intersectWide(const WideBVHNodes<Width>& wideNodes, const Ray& r, float& tMax, TLeafIntersector& leafIntersector) const
+{
+    const ExtentRay cullingRay = toExtentRay(r, m_cullingNormals);
+    const int cullingCount = m_cullingNormals.size();
+    const int stride = 2*Width*cullingCount;
+
+    //The slabs are only loaded for the nodes with children whose box is hit
+    auto childrenIntersector = [&](const WideBVHNode<Width>& node, const int& index, const float& t, float* tEntry)
+    {
+        int mask = IntersectChildren(node, r, t, tEntry);
+        if(mask!=0 && cullingCount>0) mask &= IntersectChildrenSlabs(&m_wideSlabs[index*stride], cullingRay, cullingCount, Width, t, tEntry);
+        return mask;
+    };
+    return TraverseWide(wideNodes.data(), r, tMax, childrenIntersector, leafIntersector);
+}
+
+template<typename TLeafOccluder>
+bool ExtentBVH::occludedLeaves(const Ray& r, const float& tMax, TLeafOccluder& leafOccluder) const
+{
+    return OccludedLeaves(*this, r, tMax, leafOccluder);
+}
+
+#endif // EXTENTBVH_INL
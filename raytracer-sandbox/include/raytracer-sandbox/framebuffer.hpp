@@ -0,0 +1,119 @@
+#ifndef FRAMEBUFFER_HPP
+#define FRAMEBUFFER_HPP
+
+/** @file
+ * @brief Define a frame accumulating the samples of its pixels.
+ *
+ * This file defines the float frame buffer summing the colors of the samples of each pixel
+ * over the passes of a progressive or adaptive rendering.
+ */
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/** @brief Frame summing the colors of the samples of each pixel.
+ *
+ * The color of a pixel is the mean of the samples added so far, so that a frame can be displayed
+ * after any pass and converges as passes are added. Each pixel keeps its own number of samples:
+ * a pass interrupted midway leaves the pixels it reached with one more sample than the others,
+ * and an adaptive rendering only adds samples to the pixels whose variance is high.
+ *
+ * Samples of different pixels may be added concurrently, the samples of a pixel may not.
+ */
+class FrameBuffer
+{
+public:
+    ~FrameBuffer();
+    FrameBuffer() = default;
+    FrameBuffer(const FrameBuffer& frame) = default;
+
+    /**
+     * @brief Construct an empty frame.
+     * @param width The width of the frame, in pixels.
+     * @param height The height of the frame, in pixels.
+     */
+    FrameBuffer(const int& width, const int& height);
+
+    /**
+     * @brief Change the size of the frame, which empties it.
+     * @param width The width of the frame, in pixels.
+     * @param height The height of the frame, in pixels.
+     */
+    void resize(const int& width, const int& height);
+
+    /**
+     * @brief Remove all the samples and passes, for instance when the camera moves.
+     */
+    void clear();
+
+    /**
+     * @brief Access to the width of the frame, in pixels.
+     */
+    const int& width() const;
+
+    /**
+     * @brief Access to the height of the frame, in pixels.
+     */
+    const int& height() const;
+
+    /**
+     * @brief Access to the number of passes over the frame, each having added a sample to all the pixels or, for an adaptive rendering, to the pixels left to refine.
+     */
+    const int& passes() const;
+
+    /**
+     * @brief Count a pass having added samples to the pixels.
+     */
+    void addPass();
+
+    /**
+     * @brief Add a sample to a pixel.
+     * @param x The x coordinate of the pixel.
+     * @param y The y coordinate of the pixel.
+     * @param color The color of the sample.
+     */
+    void add(const int& x, const int& y, const glm::vec3& color);
+
+    /**
+     * @brief Access to the number of samples of a pixel.
+     * @param x The x coordinate of the pixel.
+     * @param y The y coordinate of the pixel.
+     */
+    const int& sampleCount(const int& x, const int& y) const;
+
+    /**
+     * @brief The number of samples of all the pixels.
+     */
+    std::uint64_t sampleCount() const;
+
+    /**
+     * @brief The color of a pixel, the mean of its samples, black if it has none.
+     * @param x The x coordinate of the pixel.
+     * @param y The y coordinate of the pixel.
+     */
+    glm::vec3 color(const int& x, const int& y) const;
+
+    /**
+     * @brief The variance of the samples of a pixel, the largest of its color channels, 0 if it has less than 2 samples.
+     * @param x The x coordinate of the pixel.
+     * @param y The y coordinate of the pixel.
+     */
+    float variance(const int& x, const int& y) const;
+
+    /**
+     * @brief Compute the color of all the pixels.
+     * @param image The color of each pixel, the pixel (x,y) being at x+y*width().
+     */
+    void resolve(std::vector<glm::vec3>& image) const;
+
+private:
+    int m_width = 0; /*!< The width of the frame, in pixels. */
+    int m_height = 0; /*!< The height of the frame, in pixels. */
+    int m_passes = 0; /*!< The number of passes over the frame. */
+    std::vector<glm::vec3> m_colorSums; /*!< The sum of the colors of the samples of each pixel. */
+    std::vector<glm::vec3> m_squaredColorSums; /*!< The sum of the squared colors of the samples of each pixel, channel by channel. */
+    std::vector<int> m_sampleCounts; /*!< The number of samples of each pixel. */
+};
+
+#endif // FRAMEBUFFER_HPP
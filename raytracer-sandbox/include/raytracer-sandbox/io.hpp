@@ -4,7 +4,7 @@
 /** @file
  * @brief Input/Output functions.
  *
- * Currently, this file only contains I/O functions for OBJ meshes.
+ * This file contains the I/O functions for OBJ meshes and rendered images.
  * Some of the functions use external libraries.
 */
 
@@ -33,4 +33,22 @@ bool read_obj(
         std::vector<glm::vec2>& texcoords
         );
 
+/** @brief Write an image to a binary PPM file.
+ *
+ * The PPM format needs no external library, which lets the frames be saved on machines without Qt.
+ * The colors are clamped to [0,1] and quantized to 8 bits per channel.
+ *
+ * @param filename The path to the image file.
+ * @param width The width of the image, in pixels.
+ * @param height The height of the image, in pixels.
+ * @param image The color of each pixel, the pixel (x,y) being at x+y*width, the row 0 being the top of the image.
+ * @return False if the file cannot be written, true otherwise.
+ */
+bool write_ppm(
+        const std::string& filename,
+        const int& width,
+        const int& height,
+        const std::vector<glm::vec3>& image
+        );
+
 #endif //IO_HPP
@@ -39,6 +39,17 @@ public:
      * @param position The position from where we want to get the light direction.
      */
     virtual glm::vec3 lightDirectionFrom(const glm::vec3& position) const = 0;
+
+    /**
+     * @brief Return the distance from a given position to the light.
+     *
+     * An object farther along the shadow ray than the light does not block it.
+     * For a directional light, the light is infinitely far.
+     *
+     * @return The distance from the position to the light.
+     * @param position The position from where we want to get the distance to the light.
+     */
+    virtual float distanceFrom(const glm::vec3& position) const = 0;
 };
 
 typedef std::shared_ptr<Light> LightPtr;
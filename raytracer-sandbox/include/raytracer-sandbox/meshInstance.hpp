@@ -0,0 +1,101 @@
+#ifndef MESHINSTANCE_HPP
+#define MESHINSTANCE_HPP
+
+/** @file
+ * @brief Define an instance of a triangular mesh.
+ *
+ * This file defines an object placing a shared mesh in the scene with its own
+ * transform and material, so that the geometry and the hierarchy of the mesh are
+ * stored once whatever the number of times it is placed.
+ */
+
+#include "object.hpp"
+#include "tmesh.hpp"
+#include <glm/glm.hpp>
+
+/** @brief Instance of a triangular mesh.
+ *
+ * The mesh, with its hierarchy over the triangles, is shared between the instances
+ * and never modified by them. The rays are transformed into the object space of the mesh
+ * to be tested against it, and the hit is transformed back into world space.
+ * Together with the hierarchy of the scene over the instances, this forms a two-level
+ * acceleration structure.
+ */
+class MeshInstance : public Object
+{
+public:
+    /**
+     * @brief Destructor
+     */
+    ~MeshInstance();
+
+    /**
+     * @brief Default constructor
+     */
+    MeshInstance() = delete;
+
+    /**
+     * @brief Clone constructor
+     */
+    MeshInstance(const MeshInstance& instance) = default;
+
+    /** @brief Build an instance of a mesh.
+     *
+     * @param mesh The shared mesh. Its material is ignored in favour of the one of the instance.
+     * @param transform The affine transform from the object space of the mesh to world space.
+     * @param material A reference to the material's pointer.
+     */
+    MeshInstance(const std::shared_ptr<const TMesh>& mesh, const glm::mat4& transform, const MaterialPtr& material);
+
+    using Object::Intersect;
+
+    /** @brief Compute the closest intersection between the instance and a ray, nearer than a maximum distance.
+     *
+     * The ray and tMax are transformed into the object space of the mesh, whose distances are scaled by the
+     * transform, and the distance of the hit is brought back to world space.
+     * @param r The ray tested for intersection, in world space.
+     * @param tMax The maximum distance along the ray in world space, updated with the distance of the hit.
+     * @param hit The hit, updated if the instance is hit before tMax. The primitive id is the triangle id in the mesh.
+     * @return True if the instance is hit before tMax, false otherwise.
+     */
+    virtual bool Intersect(const Ray& r, float& tMax, HitRecord& hit) const;
+
+    /** @brief Compute the position of a hit and the normal of the surface there, in world space.
+     * @param r The ray which hit the instance, in world space.
+     * @param hit The hit, as found by Intersect().
+     * @param hitPosition The position of the hit, in world space.
+     * @param hitNormal The normal of the surface at the position of the hit, in world space.
+     */
+    virtual void HitSurface(const Ray& r, const HitRecord& hit, glm::vec3& hitPosition, glm::vec3& hitNormal) const;
+
+    /** @brief Check if the instance is hit by a ray before a maximum distance.
+     * @param r The ray tested for intersection, in world space.
+     * @param tMax The maximum distance along the ray in world space.
+     * @return True if the instance is hit before tMax, false otherwise.
+     */
+    virtual bool Occluded(const Ray& r, const float& tMax) const;
+
+    /**
+     * @brief Access to the shared mesh.
+     *
+     * @return A const reference to m_mesh.
+     */
+    const std::shared_ptr<const TMesh>& mesh() const;
+
+    /**
+     * @brief Access to the transform of the instance.
+     *
+     * @return A const reference to m_transform.
+     */
+    const glm::mat4& transform() const;
+
+private:
+    std::shared_ptr<const TMesh> m_mesh; /*!< The mesh shared between the instances. */
+    glm::mat4 m_transform; /*!< The transform from object space to world space. */
+    glm::mat4 m_invTransform; /*!< The transform from world space to object space. */
+    glm::mat3 m_normalTransform; /*!< The transform of the normals from object space to world space. */
+};
+
+typedef std::shared_ptr<MeshInstance> MeshInstancePtr;
+
+#endif // MESHINSTANCE_HPP
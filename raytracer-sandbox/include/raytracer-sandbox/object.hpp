@@ -8,6 +8,22 @@
 #include "ray.hpp"
 #include "utils.hpp"
 #include "box.hpp"
+#include "raypacket.hpp"
+#include <limits>
+
+/** @brief The closest hit of a ray found so far.
+ *
+ * A hit only records where it lies on the ray and on the surface it hit. The position and
+ * the normal are computed from it with Object::HitSurface() once the closest hit is known,
+ * instead of for every candidate hit.
+ */
+struct HitRecord
+{
+    float t = std::numeric_limits<float>::max(); /*!< The distance of the hit along the ray. */
+    int objectId = -1; /*!< The index of the object hit in Scene::objects(), or in the vector of objects traced, -1 if none. */
+    int primitiveId = -1; /*!< The primitive hit inside the object, such as a triangle of a mesh, -1 for objects made of a single primitive. */
+    glm::vec2 barycentrics = glm::vec2(0.0f); /*!< The barycentric coordinates of the hit relative to the second and third vertices of a triangle. */
+};
 
 class Object
 {
@@ -15,7 +31,63 @@ public:
     Object() = default;
     Object(const Object& object) = default;
     virtual ~Object();
-    virtual bool Intersect(const Ray& r, glm::vec3& hitPosition, glm::vec3& hitNormal) const = 0;
+
+    /**
+     * @brief Compute the closest intersection between the object and a ray, nearer than a maximum distance.
+     *
+     * The distance, primitive id and barycentric coordinates of the hit are written only if it lies before tMax,
+     * so that an object behind the closest hit found so far is rejected as early as possible. The object id is
+     * left to the caller.
+     * @param r The ray tested for intersection.
+     * @param tMax The maximum distance along the ray, updated with the distance of the hit.
+     * @param hit The hit, updated if the object is hit before tMax.
+     * @return True if the object is hit before tMax, false otherwise.
+     */
+    virtual bool Intersect(const Ray& r, float& tMax, HitRecord& hit) const = 0;
+
+    /**
+     * @brief Compute the position of a hit and the normal of the surface there.
+     * @param r The ray which hit the object.
+     * @param hit The hit, as found by Intersect().
+     * @param hitPosition The position of the hit.
+     * @param hitNormal The normalized normal of the surface at the position of the hit.
+     */
+    virtual void HitSurface(const Ray& r, const HitRecord& hit, glm::vec3& hitPosition, glm::vec3& hitNormal) const = 0;
+
+    /**
+     * @brief Check if the object is hit by a ray before a maximum distance.
+     *
+     * Any hit before tMax answers the query, not necessarily the closest one, and no hit record is
+     * computed, which is enough for shadow rays. By default, the closest hit is searched with Intersect().
+     * @param r The ray tested for intersection.
+     * @param tMax The maximum distance along the ray, typically the distance to a light.
+     * @return True if the object is hit before tMax, false otherwise.
+     */
+    virtual bool Occluded(const Ray& r, const float& tMax) const;
+
+    /**
+     * @brief Compute the closest intersection between the object and a ray, with its position and normal.
+     *
+     * @param r The ray tested for intersection.
+     * @param hitPosition The position of the intersection.
+     * @param hitNormal The normal of the surface at the position of the intersection.
+     * @return True if an intersection occured and false otherwise.
+     */
+    bool Intersect(const Ray& r, glm::vec3& hitPosition, glm::vec3& hitNormal) const;
+
+    /**
+     * @brief Compute the intersections between the object and the rays of a packet.
+     *
+     * The distance, primitive id and barycentric coordinates of the hits of the rays are only updated where
+     * the object is hit closer than their current closest hit. By default, the rays are tested one after
+     * another with Intersect().
+     * @param packet The packet of rays.
+     * @param mask The rays to test, bit i standing for ray i.
+     * @param hits The closest hits of the rays, updated where the object is hit closer.
+     * @return The mask of the rays whose closest hit is now on the object.
+     */
+    virtual int IntersectPacket(const RayPacket& packet, const int& mask, RayPacketHits& hits) const;
+
     MaterialPtr& material();
     const MaterialPtr& material() const;
     const Box& bbox() const;
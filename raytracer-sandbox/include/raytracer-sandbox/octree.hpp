@@ -19,6 +19,9 @@
  * ( x,-y, z) = 5
  * ( x, y,-z) = 6
  * ( x, y, z) = 7
+ *
+ * A leaf stores all the objects inserted in its cell. A branch only stores the objects
+ * straddling the planes that split it into its children.
  */
 template<typename TData>
 class OctreeNode
@@ -35,8 +38,8 @@ public:
     glm::vec3& center();
     const Extent& extent() const;
     Extent& extent();
-    const std::vector< std::pair<TData,glm::vec3> > & dataObject() const;
-    std::vector< std::pair<TData,glm::vec3> > & dataObject();
+    const std::vector< std::pair<TData,Box> > & dataObject() const;
+    std::vector< std::pair<TData,Box> > & dataObject();
     const std::array<OctreeNodePtr,8>& children() const;
     std::array<OctreeNodePtr,8>& children();
 private:
@@ -44,7 +47,7 @@ private:
     glm::vec3 m_center;
     Extent m_extent;
     std::array<OctreeNodePtr, 8> m_children;
-    std::vector< std::pair<TData,glm::vec3> > m_dataObject;
+    std::vector< std::pair<TData,Box> > m_dataObject; /*!< The objects of the node with their bounding box. */
 };
 
 
@@ -57,24 +60,86 @@ public:
     ~Octree();
     Octree(const Extent& extent, const int& maxDepth);
     Octree(const Octree& octree) = default;
-    const int& maxDepth();
-    const Extent& extent();
-    const OctreeNodePtr& root();
+    const int& maxDepth() const;
+    const Extent& extent() const;
+    const OctreeNodePtr& root() const;
+
+    /**
+     * @brief Insert an object represented by a single position, usually its centroid.
+     * @param o The object to insert representing as a pair containing the data of the object and its position.
+     */
     void insert(const std::pair<TData, glm::vec3>& o);
+
+    /**
+     * @brief Insert an object represented by its bounding box.
+     *
+     * The object is stored in the deepest node whose cell contains its whole bounding box,
+     * so that an object straddling cells is stored once and still found by the ray traversal.
+     * @param data The data of the object.
+     * @param bbox The bounding box of the object.
+     */
+    void insert(const TData& data, const Box& bbox);
+
     int computeDepth();
+
+    /**
+     * @brief Find the closest intersection between a ray and the objects of the octree.
+     *
+     * The cells are traversed front to back with the parametric algorithm of Revelles et al.,
+     * "An efficient parametric algorithm for octree traversal" (2000). The ray is mirrored
+     * so that its direction is positive on every axis, using Ray::sign() and Ray::invDirection(),
+     * and the order of the children is recovered by flipping their index accordingly.
+     * A cell is skipped as soon as it is entered beyond the closest hit found so far.
+     *
+     * The intersector is called as intersector(data, ray, tMax). It must return true only
+     * if it found a hit closer than tMax, in which case it updates tMax.
+     *
+     * @param r The ray.
+     * @param tMax The maximum distance along the ray, updated with the closest hit distance.
+     * @param intersector The object intersector.
+     * @return True if an object has been hit, false otherwise.
+     */
+    template<typename TIntersector>
+    bool intersect(const Ray& r, float& tMax, TIntersector& intersector) const;
+
+    /**
+     * @brief Check if any object of the octree is hit by a ray before a maximum distance.
+     *
+     * Same traversal as intersect(), stopped at the first hit found. The occluder is called as
+     * occluder(data, ray, tMax) and must return true if the object is hit before tMax.
+     *
+     * @param r The ray.
+     * @param tMax The maximum distance along the ray.
+     * @param occluder The object occlusion test.
+     * @return True if an object is hit before tMax, false otherwise.
+     */
+    template<typename TOccluder>
+    bool occluded(const Ray& r, const float& tMax, TOccluder& occluder) const;
+
 private:
     OctreeNodePtr m_root;
     Extent m_extent;
     int m_maxDepth;
     /**
      * @brief Insert an object into the octree.
-     * @param o The object to insert representing as a pair containing the data of the object and its position.
+     * @param o The object to insert representing as a pair containing the data of the object and its bounding box.
      * @param node The octree's node where the object tries to be inserted.
      * @param nodeBB The bounding box of the octree's node.
      * @param depth The depth of the octree's node.
      */
-    void insert(const std::pair<TData, glm::vec3>& o, OctreeNodePtr& node, std::array<glm::vec3,2> nodeBB, int depth);
+    void insert(const std::pair<TData, Box>& o, OctreeNodePtr& node, std::array<glm::vec3,2> nodeBB, int depth);
     void computeDepth(const OctreeNodePtr& node, int& depth);
+
+    /**
+     * @brief Return the index of the child cell containing a bounding box, -1 if the box straddles several cells.
+     */
+    int childIndex(const Box& bbox, const glm::vec3& nodeCentroid) const;
+
+    template<typename TIntersector>
+    bool intersect(const OctreeNode<TData>* node, const std::array<glm::vec3,2>& mirroredBB, const glm::vec3& origin, const glm::vec3& invDirection,
+                   const int& mirrorMask, const Ray& r, float& tMax, TIntersector& intersector) const;
 };
 
+#include "octree.inl"
+
 #endif // OCTREE_HPP
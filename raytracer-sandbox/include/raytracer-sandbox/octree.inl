@@ -2,15 +2,17 @@
 #define OCTREE_INL
 
 #include "octree.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 template<typename TData>
 OctreeNode<TData>::~OctreeNode(){}
 
 template<typename TData>
-OctreeNode<TData>::OctreeNode(const Extent& extent)
+OctreeNode<TData>::OctreeNode(const Extent& extent) : m_extent(extent)
 {
     m_dataObject.clear();
-    m_extent = extent;
     m_children.fill(nullptr);
     m_isLeaf = true;
     std::array<glm::vec3,2> bounds = m_extent.bounds();
@@ -18,13 +20,13 @@ OctreeNode<TData>::OctreeNode(const Extent& extent)
 }
 
 template<typename TData>
-const std::vector< std::pair<TData,glm::vec3> >  &OctreeNode<TData>::dataObject() const
+const std::vector< std::pair<TData,Box> >  &OctreeNode<TData>::dataObject() const
 {
     return m_dataObject;
 }
 
 template<typename TData>
-std::vector< std::pair<TData,glm::vec3> >  &OctreeNode<TData>::dataObject()
+std::vector< std::pair<TData,Box> >  &OctreeNode<TData>::dataObject()
 {
     return m_dataObject;
 }
@@ -83,23 +85,23 @@ Octree<TData>::~Octree(){}
 template<typename TData>
 Octree<TData>::Octree(const Extent &extent, const int& maxDepth) : m_extent(extent), m_maxDepth(maxDepth)
 {
-    m_root = std::make_shared< OctreeNode<TData> >();
+    m_root = std::make_shared< OctreeNode<TData> >(m_extent);
 }
 
 template<typename TData>
-const int& Octree<TData>::maxDepth()
+const int& Octree<TData>::maxDepth() const
 {
     return m_maxDepth;
 }
 
 template<typename TData>
-const Extent& Octree<TData>::extent()
+const Extent& Octree<TData>::extent() const
 {
     return m_extent;
 }
 
 template<typename TData>
-const std::shared_ptr< OctreeNode<TData> >& Octree<TData>::root()
+const std::shared_ptr< OctreeNode<TData> >& Octree<TData>::root() const
 {
     return m_root;
 }
@@ -107,7 +109,13 @@ const std::shared_ptr< OctreeNode<TData> >& Octree<TData>::root()
 template<typename TData>
 void Octree<TData>::insert(const std::pair<TData, glm::vec3>& o)
 {
-    insert(o, m_root, m_extent.bounds(), 0);
+    insert(std::make_pair(o.first, Box(o.second, o.second)), m_root, m_extent.bounds(), 0);
+}
+
+template<typename TData>
+void Octree<TData>::insert(const TData& data, const Box& bbox)
+{
+    insert(std::make_pair(data, bbox), m_root, m_extent.bounds(), 0);
 }
 
 template<typename TData>
@@ -119,26 +127,40 @@ int Octree<TData>::computeDepth()
 }
 
 template<typename TData>
-void Octree<TData>::insert(const std::pair<TData, glm::vec3>& o, OctreeNodePtr& node, std::array<glm::vec3, 2> nodeBB, int depth)
+int Octree<TData>::childIndex(const Box& bbox, const glm::vec3& nodeCentroid) const
 {
+    int cellIndex = 0;
+    std::array<int,3> axisBit = {{4, 2, 1}};
+    for(size_t i=0; i<3; ++i)
+    {
+        if(bbox.minBound()[i]>nodeCentroid[i]) cellIndex += axisBit[i];
+        else if(bbox.maxBound()[i]>nodeCentroid[i]) return -1; //The box straddles the splitting plane
+    }
+    return cellIndex;
+}
+
+template<typename TData>
+void Octree<TData>::insert(const std::pair<TData, Box>& o, OctreeNodePtr& node, std::array<glm::vec3, 2> nodeBB, int depth)
+{
+    glm::vec3 nodeCentroid = 0.5f*(nodeBB[0]+nodeBB[1]);
     if(node->isLeaf() == true)
     {
         //If the leaf is empty or the max depth of the octree has been reached
         //Just add the object to the leaf
         if(node->dataObject().empty() || depth>=m_maxDepth)
         {
-            node->dataObject().push_back(o.first);
+            node->dataObject().push_back(o);
         }
         else
         {
             //Mark the leaf as a branch
             node->isLeaf() = false;
             //Empty the content of the leaf and re-insert in the octree from this node
-            std::vector<ObjectPtr>& nodeObjects = node->dataObject();
-            while(!nodeObjects.empty())
+            std::vector< std::pair<TData,Box> > nodeObjects;
+            nodeObjects.swap(node->dataObject());
+            for(const std::pair<TData,Box>& nodeObject : nodeObjects)
             {
-                insert(nodeObjects.back(), node, nodeBB, depth);
-                nodeObjects.pop_back();
+                insert(nodeObject, node, nodeBB, depth);
             }
             //Also Insert the current object from this node.
             insert(o, node, nodeBB, depth);
@@ -146,26 +168,28 @@ void Octree<TData>::insert(const std::pair<TData, glm::vec3>& o, OctreeNodePtr&
     }
     else //The node is a branch
     {
-        //Between the 8 nodes, find the right one that contains the centroid of the object
-        int cellIndex = 0;
-        glm::vec3 nodeCentroid = 0.5f*(nodeBB[0]+nodeBB[1]);
-        glm::vec3 oCentroid = o.second;
-        if(oCentroid[2]>nodeCentroid[2]) cellIndex += 4;
-        if(oCentroid[1]>nodeCentroid[1]) cellIndex += 2;
-        if(oCentroid[0]>nodeCentroid[0]) cellIndex += 1;
+        //Between the 8 nodes, find the right one that contains the object
+        int cellIndex = childIndex(o.second, nodeCentroid);
+        //The object straddles several cells: keep it in the branch
+        if(cellIndex<0 || !o.second.isFinite())
+        {
+            node->dataObject().push_back(o);
+            return;
+        }
         OctreeNodePtr& child = node->children()[cellIndex];
 
         //Compute the bounding box of the child node:
         //  For each axis, for mininmum and maximum bound,
-        //      1- Compare the centroid of the object with the centroid of the node
+        //      1- Check on which side of the node centroid the child cell is
         //      2- Choose between the coordinate of the node centroid and the coordinate of th node bounding box.
         std::array<glm::vec3,2> childBB;
-        childBB[0][0] =  oCentroid[0]>nodeCentroid[0] ? nodeCentroid[0] : nodeBB[0][0];
-        childBB[1][0] =  oCentroid[0]>nodeCentroid[0] ? nodeBB[1][0] : nodeCentroid[0];
-        childBB[0][1] =  oCentroid[1]>nodeCentroid[1] ? nodeCentroid[1] : nodeBB[0][1];
-        childBB[1][1] =  oCentroid[1]>nodeCentroid[1] ? nodeBB[1][1] : nodeCentroid[1];
-        childBB[0][2] =  oCentroid[2]>nodeCentroid[2] ? nodeCentroid[2] : nodeBB[0][2];
-        childBB[1][2] =  oCentroid[2]>nodeCentroid[2] ? nodeBB[1][2] : nodeCentroid[2];
+        std::array<int,3> axisBit = {{4, 2, 1}};
+        for(size_t i=0; i<3; ++i)
+        {
+            bool upper = (cellIndex & axisBit[i]) != 0;
+            childBB[0][i] = upper ? nodeCentroid[i] : nodeBB[0][i];
+            childBB[1][i] = upper ? nodeBB[1][i] : nodeCentroid[i];
+        }
 
         //Add the object to the child node
         if(child == nullptr)
@@ -200,6 +224,149 @@ void Octree<TData>::computeDepth(const OctreeNodePtr& node, int& depth)
     }
 }
 
+template<typename TData>
+template<typename TIntersector>
+bool Octree<TData>::intersect(const Ray& r, float& tMax, TIntersector& intersector) const
+{
+    //Mirror the ray with respect to the center of the octree so that its direction is positive on every axis.
+    //A mirrored cell of index i is then the actual cell of index i^mirrorMask.
+    const std::array<glm::vec3,2>& bounds = m_extent.bounds();
+    glm::vec3 origin = r.origin();
+    glm::vec3 invDirection = r.invDirection();
+    int mirrorMask = 0;
+    std::array<int,3> axisBit = {{4, 2, 1}};
+    for(size_t i=0; i<3; ++i)
+    {
+        if(r.sign()[i])
+        {
+            origin[i] = bounds[0][i] + bounds[1][i] - origin[i];
+            invDirection[i] = -invDirection[i];
+            mirrorMask |= axisBit[i];
+        }
+    }
+    return intersect(m_root.get(), bounds, origin, invDirection, mirrorMask, r, tMax, intersector);
+}
+
+template<typename TData>
+template<typename TOccluder>
+bool Octree<TData>::occluded(const Ray& r, const float& tMax, TOccluder& occluder) const
+{
+    //The first hit drops the maximum distance below any entry distance, which skips all the cells left
+    bool occluded = false;
+    auto intersector = [&](const TData& data, const Ray& ray, float& t)
+    {
+        if(occluded || !occluder(data, ray, t)) return false;
+        occluded = true;
+        t = -std::numeric_limits<float>::infinity();
+        return true;
+    };
+    float t = tMax;
+    intersect(r, t, intersector);
+    return occluded;
+}
+
+/**
+ * @brief Parametric distance to a plane orthogonal to an axis for a ray with a positive direction.
+ *
+ * A ray parallel to the plane never crosses it, the distance is then infinite: the
+ * sign tells on which side of the plane the ray lies, a ray lying on the plane taking onPlaneValue.
+ */
+inline float octreeSlabDistance(const float& planeCoord, const float& origin, const float& invDirection, const float& onPlaneValue)
+{
+    float d = planeCoord-origin;
+    if(std::isinf(invDirection)) return d==0 ? onPlaneValue : (d>0 ? invDirection : -invDirection);
+    return d*invDirection;
+}
+
+/**
+ * @brief Return the first child crossed by the ray in the cell (see Revelles et al.).
+ */
+inline int octreeFirstNode(const glm::vec3& t0, const glm::vec3& tm)
+{
+    int answer = 0;
+    if(t0[0]>t0[1] && t0[0]>t0[2]) //Entry plane YZ
+    {
+        if(tm[1]<t0[0]) answer |= 2;
+        if(tm[2]<t0[0]) answer |= 1;
+    }
+    else if(t0[1]>t0[2]) //Entry plane XZ
+    {
+        if(tm[0]<t0[1]) answer |= 4;
+        if(tm[2]<t0[1]) answer |= 1;
+    }
+    else //Entry plane XY
+    {
+        if(tm[0]<t0[2]) answer |= 4;
+        if(tm[1]<t0[2]) answer |= 2;
+    }
+    return answer;
+}
+
+/**
+ * @brief Return the next child crossed by the ray: the one behind the exit plane of the current child (see Revelles et al.).
+ */
+inline int octreeNextNode(const float& tx, const int& x, const float& ty, const int& y, const float& tz, const int& z)
+{
+    if(tx<ty) return tx<tz ? x : z;
+    return ty<tz ? y : z;
+}
+
+template<typename TData>
+template<typename TIntersector>
+bool Octree<TData>::intersect(const OctreeNode<TData>* node, const std::array<glm::vec3,2>& mirroredBB, const glm::vec3& origin, const glm::vec3& invDirection,
+                              const int& mirrorMask, const Ray& r, float& tMax, TIntersector& intersector) const
+{
+    glm::vec3 t0, t1, tm;
+    glm::vec3 middle = 0.5f*(mirroredBB[0]+mirroredBB[1]);
+    for(size_t i=0; i<3; ++i)
+    {
+        t0[i] = octreeSlabDistance(mirroredBB[0][i], origin[i], invDirection[i], -std::numeric_limits<float>::infinity());
+        t1[i] = octreeSlabDistance(mirroredBB[1][i], origin[i], invDirection[i], std::numeric_limits<float>::infinity());
+        tm[i] = octreeSlabDistance(middle[i], origin[i], invDirection[i], -std::numeric_limits<float>::infinity());
+    }
+    float tEntry = std::max(std::max(t0[0], t0[1]), t0[2]);
+    float tExit = std::min(std::min(t1[0], t1[1]), t1[2]);
+    //The cell is missed, behind the ray or beyond the closest hit found so far
+    if(tEntry>tExit || tExit<0 || tEntry>tMax) return false;
+
+    bool hit = false;
+    for(const std::pair<TData,Box>& o : node->dataObject())
+    {
+        hit = intersector(o.first, r, tMax) || hit;
+    }
+    if(node->isLeaf()) return hit;
 
+    //Visit the children crossed by the ray in order, a value of 8 meaning the ray exits the node
+    int currentNode = octreeFirstNode(t0, tm);
+    while(currentNode<8)
+    {
+        //Parametric bounds of the current child
+        glm::vec3 childT0, childT1;
+        std::array<glm::vec3,2> childBB;
+        std::array<int,3> axisBit = {{4, 2, 1}};
+        for(size_t i=0; i<3; ++i)
+        {
+            bool upper = (currentNode & axisBit[i]) != 0;
+            childT0[i] = upper ? tm[i] : t0[i];
+            childT1[i] = upper ? t1[i] : tm[i];
+            childBB[0][i] = upper ? middle[i] : mirroredBB[0][i];
+            childBB[1][i] = upper ? mirroredBB[1][i] : middle[i];
+        }
+
+        //The children are visited front to back: once a child is entered beyond tMax, so are the next ones
+        if(std::max(std::max(childT0[0], childT0[1]), childT0[2])>tMax) break;
+
+        const OctreeNode<TData>* child = node->children()[currentNode ^ mirrorMask].get();
+        if(child != nullptr)
+        {
+            hit = intersect(child, childBB, origin, invDirection, mirrorMask, r, tMax, intersector) || hit;
+        }
+
+        currentNode = octreeNextNode(childT1[0], (currentNode & 4) ? 8 : currentNode|4,
+                                     childT1[1], (currentNode & 2) ? 8 : currentNode|2,
+                                     childT1[2], (currentNode & 1) ? 8 : currentNode|1);
+    }
+    return hit;
+}
 
 #endif
@@ -4,10 +4,51 @@
 #include "ray.hpp"
 #include "object.hpp"
 #include "light.hpp"
+#include "scene.hpp"
+#include "shadowcache.hpp"
 #include <glm/glm.hpp>
 
 bool pathTrace(const Ray& viewRay, const std::vector<ObjectPtr>& objects, ObjectPtr &closestHitObject, glm::vec3& closestHitPosition, glm::vec3& closestHitNormal);
+
+/**
+ * @brief Compute the color of a ray, its reflection, refraction and shadow rays being traced depth first.
+ *
+ * @param shadowCache The last occluder of each light, tested first by the shadow rays, nullptr to always traverse the scene.
+ * The cache and its counters are updated.
+ */
 glm::vec3 castRay(const Ray& ray, const std::vector<LightPtr> &lights, const std::vector<ObjectPtr> &objects,
-                  const glm::vec3& backgroundColor, const glm::vec3& shadowColor, const float& bias, const int &maxDepth, int depth);
+                  const glm::vec3& backgroundColor, const glm::vec3& shadowColor, const float& bias, const int &maxDepth, int depth,
+                  ShadowCache* shadowCache = nullptr);
+
+bool pathTrace(const Ray& viewRay, const Scene& scene, ObjectPtr &closestHitObject, glm::vec3& closestHitPosition, glm::vec3& closestHitNormal);
+glm::vec3 castRay(const Ray& ray, const std::vector<LightPtr> &lights, const Scene &scene,
+                  const glm::vec3& backgroundColor, const glm::vec3& shadowColor, const float& bias, const int &maxDepth, int depth,
+                  ShadowCache* shadowCache = nullptr);
+
+/**
+ * @brief Check if a shadow ray is blocked before reaching a light.
+ *
+ * The objects are tested with Object::Occluded() and the first blocking one ends the query.
+ * Objects with a FRESNEL material let the light through, as does ignoredObject.
+ * @param shadowRay The ray from a surface towards the light.
+ * @param tMax The distance to the light.
+ * @param ignoredObject The object the shadow ray starts from, nullptr if none.
+ * @param occluder The object found blocking the ray, nullptr if none.
+ * @return True if an object blocks the ray before tMax, false otherwise.
+ */
+bool occluded(const Ray& shadowRay, const std::vector<ObjectPtr>& objects, const float& tMax, const Object* ignoredObject, const Object*& occluder);
+bool occluded(const Ray& shadowRay, const Scene& scene, const float& tMax, const Object* ignoredObject, const Object*& occluder);
+
+/**
+ * @brief Compute the color of the rays of a packet.
+ *
+ * The packet is traced through the scene at once with Scene::intersect(), then every hit is shaded
+ * as by castRay(), its reflection, refraction and shadow rays being traced one after another.
+ * @param packet The packet of rays, typically the primary rays of a block of pixels.
+ * @param colors The color of each ray of the packet, packet.size values.
+ */
+void castRayPacket(const RayPacket& packet, const std::vector<LightPtr> &lights, const Scene &scene,
+                   const glm::vec3& backgroundColor, const glm::vec3& shadowColor, const float& bias, const int &maxDepth, int depth, glm::vec3* colors,
+                   ShadowCache* shadowCache = nullptr);
 
 #endif //PATHTRACING_HPP
@@ -67,7 +67,11 @@ public:
    */
   glm::vec3 projectOnPlane(const glm::vec3& p) const;
 
-  virtual bool Intersect(const Ray& r, glm::vec3& hitPosition, glm::vec3& hitNormal) const;
+  using Object::Intersect;
+  virtual bool Intersect(const Ray& r, float& tMax, HitRecord& hit) const;
+  virtual void HitSurface(const Ray& r, const HitRecord& hit, glm::vec3& hitPosition, glm::vec3& hitNormal) const;
+  virtual bool Occluded(const Ray& r, const float& tMax) const;
+  virtual int IntersectPacket(const RayPacket& packet, const int& mask, RayPacketHits& hits) const;
 
 private:
     glm::vec3 m_n; /*!< Plane normal. Points x on the plane satisfy dot(m_n,x)=m_d */
@@ -23,7 +23,7 @@ public:
      *
      * Instance destructor.
     */
-    ~Ray();
+    ~Ray() = default;
 
     /** @brief Default constructor
      *
@@ -45,6 +45,16 @@ public:
      */
     Ray(const glm::vec3& origin, const glm::vec3& direction);
 
+    /** @brief Constructor with ray origin, normalized direction and inverse direction.
+     *
+     * Construct a new ray whose direction is already normalized and inverted, for instance by
+     * SIMD instructions for several rays at once: neither is computed again.
+     * \param origin The origin of the ray.
+     * \param direction The normalized direction of the ray.
+     * \param invDirection The inverse of each component of the direction.
+     */
+    Ray(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& invDirection);
+
     /** @brief Read-only accessor to the direction of the ray.
      *
      * Allow to read the direction of the ray.
@@ -80,6 +90,13 @@ private:
     glm::vec3 m_origin; /*!< The origin of the ray. */
 };
 
+//Inline so that the rays generated by blocks, such as by CameraRayGenerator::generateRow(), are built in place
+inline Ray::Ray(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& invDirection)
+    : m_direction(direction), m_invDirection(invDirection), m_origin(origin)
+{
+    m_sign = {{ m_invDirection[0]<0, m_invDirection[1]<0, m_invDirection[2]<0 }};
+}
+
 /*! \fn std::ostream& operator << ( std::ostream& out, const Ray& ray)
     \brief Return a stream containing human readable informations about the input ray.
     \param out The input stream.
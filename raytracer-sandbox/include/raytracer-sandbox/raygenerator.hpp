@@ -0,0 +1,108 @@
+#ifndef RAYGENERATOR_HPP
+#define RAYGENERATOR_HPP
+
+/** @file
+ * @brief Define the generator of the primary rays of a camera.
+ *
+ * This file defines the object computing the rays through the pixels of a camera from
+ * quantities precomputed once per camera, a row or a tile of pixels at a time.
+ */
+
+#include <glm/glm.hpp>
+#include "camera.hpp"
+#include "ray.hpp"
+#include "raypacket.hpp"
+
+/** @brief Generate the primary rays of a camera.
+ *
+ * Camera::computeRayThroughPixel() inverts the view and projection matrices for every ray.
+ * The position of a pixel on the near plane is however an affine function of its coordinates:
+ * the generator inverts the matrices once, in update(), and keeps the position of the camera,
+ * the direction towards the corner pixel (0,0) and the steps of the direction from one pixel
+ * to the next along x and y. A ray then costs two multiply-adds, a normalization and an inversion,
+ * which generateDirections() runs on 4 pixels at a time with SSE.
+ *
+ * The rays are the ones of Camera::computeRayThroughPixel() up to rounding errors. The view
+ * matrix of a camera being modifiable through Camera::view(), update() must be called whenever
+ * the camera changes.
+ */
+class CameraRayGenerator
+{
+public:
+    ~CameraRayGenerator();
+    CameraRayGenerator() = default;
+    CameraRayGenerator(const CameraRayGenerator& generator) = default;
+
+    /**
+     * @brief Construct the generator of the rays of a camera.
+     * @param camera The camera.
+     */
+    CameraRayGenerator(const Camera& camera);
+
+    /**
+     * @brief Precompute the quantities of a camera, once after each change of the camera.
+     * @param camera The camera.
+     */
+    void update(const Camera& camera);
+
+    /**
+     * @brief Access to the world position of the camera, the origin of all the rays.
+     */
+    const glm::vec3& origin() const;
+
+    /**
+     * @brief Compute the ray through a pixel.
+     * @param x The x coordinate of the pixel.
+     * @param y The y coordinate of the pixel.
+     * @return The ray from the position of the camera to the world position of the pixel.
+     */
+    Ray generate(const float& x, const float& y) const;
+
+    /**
+     * @brief Compute the normalized directions of the rays through a row of pixels, 4 at a time with SSE.
+     * @param x The x coordinate of the first pixel.
+     * @param y The y coordinate of the pixels.
+     * @param count The number of pixels, (x+i, y) being the pixel i.
+     * @param directions The x, y and z components of the directions, each of count elements.
+     * @param invDirections The x, y and z components of the inverse of the directions, each of count elements, nullptr to skip them.
+     */
+    void generateDirections(const float& x, const float& y, const int& count, float* directions[3], float* invDirections[3] = nullptr) const;
+
+    /**
+     * @brief Compute the rays through a row of pixels.
+     * @param x The x coordinate of the first pixel.
+     * @param y The y coordinate of the pixels.
+     * @param count The number of pixels, (x+i, y) being the pixel i.
+     * @param rays The count rays.
+     */
+    void generateRow(const float& x, const float& y, const int& count, Ray* rays) const;
+
+    /**
+     * @brief Compute the rays through a tile of pixels.
+     * @param x The x coordinate of the first pixel of the tile.
+     * @param y The y coordinate of the first pixel of the tile.
+     * @param width The width of the tile.
+     * @param height The height of the tile.
+     * @param rays The width*height rays, (x+i, y+j) being the pixel i+j*width.
+     */
+    void generateTile(const float& x, const float& y, const int& width, const int& height, Ray* rays) const;
+
+    /**
+     * @brief Compute the packet of the rays through a square block of pixels.
+     *
+     * The ray through the pixel (x+i, y+j) is the ray i+j*packetWidth of the packet, as in Camera::computeRayPacket().
+     * @param x The x coordinate of the first pixel of the block.
+     * @param y The y coordinate of the first pixel of the block.
+     * @param packetWidth The width of the block, 2 or 4 so that the packet holds 4 or 16 rays.
+     * @return The packet of the rays through the pixels of the block.
+     */
+    RayPacket generatePacket(const float& x, const float& y, const int& packetWidth) const;
+
+private:
+    glm::vec3 m_origin; /*!< The world position of the camera. */
+    glm::vec3 m_corner; /*!< The unnormalized direction from the camera to the world position of the pixel (0,0). */
+    glm::vec3 m_stepX; /*!< The change of the unnormalized direction from a pixel to the next one along x. */
+    glm::vec3 m_stepY; /*!< The change of the unnormalized direction from a pixel to the next one along y. */
+};
+
+#endif // RAYGENERATOR_HPP
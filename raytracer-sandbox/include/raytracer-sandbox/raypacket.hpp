@@ -0,0 +1,148 @@
+#ifndef RAYPACKET_HPP
+#define RAYPACKET_HPP
+
+/** @file
+ * @brief Define packets of coherent rays.
+ *
+ * This file defines a packet of up to 16 rays traced together through a hierarchy,
+ * the interval test culling a box for the whole packet and the SIMD kernels testing
+ * 4 rays of a packet at once against a box, a sphere, a plane or a triangle.
+ */
+
+#include <array>
+#include <glm/glm.hpp>
+#include "box.hpp"
+#include "ray.hpp"
+#include "utils.hpp"
+
+/** @brief Packet of rays traced together.
+ *
+ * The rays of a small block of pixels, such as the primary rays of 2x2 or 4x4 pixels, start
+ * from the same point and have close directions: they visit the same nodes of a hierarchy and
+ * hit the same primitives. Tracing them as a packet amortizes the traversal over the rays and
+ * lets the primitive tests run on 4 rays at once with SIMD instructions.
+ *
+ * The rays are stored as structure of arrays, padded to a multiple of 4 by copies of the first
+ * ray which are never reported as hit. The bounds of their origins and of their inverse directions
+ * are kept for the interval test of IntersectInterval().
+ */
+struct RayPacket
+{
+    static const int MaxSize = 16; /*!< The maximum number of rays of a packet. */
+    static constexpr float CoherentCosine = 0.9f; /*!< The smallest cosine between the direction of the first ray and the others for a coherent packet. */
+
+    alignas(64) float origins[3][MaxSize]; /*!< The origins of the rays, axis by axis. */
+    alignas(64) float directions[3][MaxSize]; /*!< The directions of the rays, axis by axis. */
+    alignas(64) float invDirections[3][MaxSize]; /*!< The inverse directions of the rays, axis by axis. */
+    std::array<Ray, MaxSize> rays; /*!< The rays, for the scalar fallback. */
+    int size = 0; /*!< The number of rays of the packet. */
+    int lanes = 0; /*!< The number of rays rounded up to a multiple of 4. */
+    bool coherent = false; /*!< True if the directions of all the rays have the same signs, which the interval test requires, and lie in a narrow cone, without which the packet visits most of a hierarchy. */
+    glm::vec3 minOrigin; /*!< The lower bound of the origins of the rays. */
+    glm::vec3 maxOrigin; /*!< The upper bound of the origins of the rays. */
+    glm::vec3 minInvDirection; /*!< The lower bound of the inverse directions of the rays, clamped to finite values. */
+    glm::vec3 maxInvDirection; /*!< The upper bound of the inverse directions of the rays, clamped to finite values. */
+
+    RayPacket() = default;
+
+    /**
+     * @brief Gather rays into a packet.
+     * @param r The rays.
+     * @param count The number of rays, between 1 and MaxSize.
+     */
+    RayPacket(const Ray* r, const int& count);
+
+    /**
+     * @brief The mask of all the rays of the packet, bit i standing for ray i.
+     */
+    int mask() const { return (1<<size)-1; }
+};
+
+/** @brief The closest hits of the rays of a packet.
+ *
+ * A ray without any hit keeps an infinite distance. The objects only record the distances, primitive ids
+ * and barycentric coordinates of their hits, the positions and normals being computed once the closest
+ * hits are known, as for HitRecord.
+ */
+struct RayPacketHits
+{
+    alignas(64) float t[RayPacket::MaxSize]; /*!< The distance of the closest hit of each ray. */
+    std::array<int, RayPacket::MaxSize> objectIds; /*!< The index of the object of the closest hit of each ray in Scene::objects(), -1 if none. */
+    std::array<int, RayPacket::MaxSize> primitiveIds; /*!< The primitive of the closest hit of each ray inside its object, -1 for objects made of a single primitive. */
+    std::array<glm::vec2, RayPacket::MaxSize> barycentrics; /*!< The barycentric coordinates of the closest hit of each ray relative to the second and third vertices of a triangle. */
+    std::array<glm::vec3, RayPacket::MaxSize> positions; /*!< The position of the closest hit of each ray. */
+    std::array<glm::vec3, RayPacket::MaxSize> normals; /*!< The normal of the surface at the closest hit of each ray. */
+
+    RayPacketHits();
+};
+
+/**
+ * @brief Test a packet against a box with interval arithmetic.
+ *
+ * Wald et al., "Ray tracing animated scenes using coherent grid traversal", 2006: the slab
+ * distances are bounded over the whole packet from the bounds of the origins and of the inverse
+ * directions, so that a box is culled for all the rays at the cost of a single ray/box test.
+ * The test is conservative: a box missed by every ray may be kept, but a box hit by any ray is
+ * never culled. The packet must be coherent.
+ * @param packet The packet.
+ * @param box The box.
+ * @param tMax The largest distance of the closest hits of the rays.
+ * @param tEntry A lower bound of the entry distance of the rays in the box, clamped to 0.
+ * @return False if no ray of the packet can hit the box before tMax.
+ */
+bool IntersectInterval(const RayPacket& packet, const Box& box, const float& tMax, float& tEntry);
+
+/**
+ * @brief Test the rays of a packet against a box, 4 rays at a time with SSE.
+ *
+ * Unlike IntersectInterval(), each ray is tested on its own, for instance to find the rays
+ * reaching a leaf of a hierarchy before testing them against its primitives.
+ * @param packet The packet.
+ * @param mask The rays to test.
+ * @param box The box.
+ * @param tMax The maximum distance along each ray.
+ * @return The mask of the rays entering the box before their tMax.
+ */
+int IntersectBox(const RayPacket& packet, const int& mask, const Box& box, const float* tMax);
+
+/**
+ * @brief Test the rays of a packet against a sphere, 4 rays at a time with SSE.
+ *
+ * Each lane solves the quadratic of Sphere::Intersect() and keeps the same root.
+ * @param packet The packet.
+ * @param mask The rays to test.
+ * @param center The center of the sphere.
+ * @param radius The radius of the sphere.
+ * @param t The distance of the closest hit of each ray, updated for the rays hitting the sphere closer.
+ * @return The mask of the rays whose closest hit is now on the sphere.
+ */
+int IntersectSphere(const RayPacket& packet, const int& mask, const glm::vec3& center, const float& radius, float* t);
+
+/**
+ * @brief Test the rays of a packet against a plane, 4 rays at a time with SSE.
+ *
+ * Both sides of the plane are hit, as in Plane::Intersect().
+ * @param packet The packet.
+ * @param mask The rays to test.
+ * @param normal The normal of the plane.
+ * @param distanceToOrigin The distance of the plane to the origin along its normal.
+ * @param t The distance of the closest hit of each ray, updated for the rays hitting the plane closer.
+ * @return The mask of the rays whose closest hit is now on the plane.
+ */
+int IntersectPlane(const RayPacket& packet, const int& mask, const glm::vec3& normal, const float& distanceToOrigin, float* t);
+
+/**
+ * @brief Test the rays of a packet against a precomputed triangle, 4 rays at a time with SSE.
+ *
+ * Each lane runs the Möller-Trumbore test of precomputedTriangleRayIntersection().
+ * @param packet The packet.
+ * @param mask The rays to test.
+ * @param triangle The triangle.
+ * @param t The distance of the closest hit of each ray, updated for the rays hitting the triangle closer.
+ * @param u The barycentric coordinate of the hit relative to the second vertex, written for the rays hitting the triangle closer.
+ * @param v The barycentric coordinate of the hit relative to the third vertex, written for the rays hitting the triangle closer.
+ * @return The mask of the rays whose closest hit is now on the triangle.
+ */
+int IntersectTriangle(const RayPacket& packet, const int& mask, const PrecomputedTriangle& triangle, float* t, float* u, float* v);
+
+#endif // RAYPACKET_HPP
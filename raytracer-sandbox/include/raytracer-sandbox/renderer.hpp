@@ -0,0 +1,273 @@
+#ifndef RENDERER_HPP
+#define RENDERER_HPP
+
+/** @file
+ * @brief Define the renderer of the frames of a camera.
+ *
+ * This file defines the tiles a frame is split into, the shading parameters of a frame
+ * and the renderer tracing the tiles of a frame on a pool of threads, at once or pass after pass.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <glm/glm.hpp>
+#include "camera.hpp"
+#include "framebuffer.hpp"
+#include "light.hpp"
+#include "scene.hpp"
+#include "shadowcache.hpp"
+#include "threadpool.hpp"
+
+/** @brief A rectangle of pixels of a frame, rendered as a whole by a thread. */
+struct Tile
+{
+    int x = 0; /*!< The x coordinate of the first pixel of the tile. */
+    int y = 0; /*!< The y coordinate of the first pixel of the tile. */
+    int width = 0; /*!< The width of the tile, smaller than the tile size on the right border of the frame. */
+    int height = 0; /*!< The height of the tile, smaller than the tile size on the bottom border of the frame. */
+};
+
+/** @brief The shading parameters of a frame, as given to castRay(). */
+struct RenderSettings
+{
+    glm::vec3 backgroundColor = glm::vec3(0,0,0); /*!< The color of the rays leaving the scene. */
+    glm::vec3 shadowColor = glm::vec3(0,0,0); /*!< The color of the points in the shadow of a light. */
+    float bias = 0.001f; /*!< The offset of the secondary rays from the surfaces. */
+    int maxDepth = 4; /*!< The maximum number of bounces of a ray. */
+    std::vector<glm::vec2> pixelOffsets = { glm::vec2(0,0), glm::vec2(0.5,0), glm::vec2(0,0.5), glm::vec2(0.5,0.5) }; /*!< The position of the samples of a pixel relative to its corner, averaged into its color by Renderer::render(). */
+    int maxSamples = 16; /*!< The maximum number of samples of a pixel for Renderer::renderAdaptive(). */
+    float contrastThreshold = 0.05f; /*!< The difference of color with a neighbour, clamped to [0,1], above which a pixel of Renderer::renderAdaptive() is an edge. */
+    float errorThreshold = 0.01f; /*!< The standard error of the color of a pixel above which Renderer::renderAdaptive() adds samples to it. */
+    bool shadowCache = false; /*!< True to test the shadow rays against the last occluder of their light first, with a ShadowCache per thread. */
+};
+
+/** @brief Render the frames of a camera tile by tile on a pool of threads.
+ *
+ * A frame is split into square tiles visited along a Hilbert curve, so that consecutive tiles are
+ * neighbours in the image and share the nodes of the hierarchy of the scene they traverse. The tiles
+ * are the jobs of a ThreadPool: each thread renders a contiguous part of the curve and the threads
+ * done first steal the remaining tiles of the others, which balances frames whose cost varies
+ * across the image, such as a few objects on an empty background.
+ *
+ * Inside a tile, the primary rays of blocks of 4x4 pixels are traced as packets with castRayPacket().
+ * With RenderSettings::shadowCache, each thread shades with its own ShadowCache.
+ *
+ * A frame is either rendered at once with render(), or progressively with renderProgressive(), which
+ * adds one sample per pixel to a FrameBuffer pass after pass so that a preview is available after
+ * the first pass, or adaptively with renderAdaptive(), which only adds samples where the frame is
+ * noisy. All can be interrupted from another thread with cancel(), for instance to restart the frame
+ * when the camera moves. The frames are numbered as they start, so that a thread about to render a frame
+ * can also be stopped before the frame starts, with cancel(frame).
+ */
+class Renderer
+{
+public:
+    /**
+     * @brief The function called once a tile of the frame is rendered.
+     *
+     * The function is called from the thread having rendered the tile, concurrently with the rendering
+     * of the other tiles: it may read the pixels of the tile in the frame, but must be thread-safe.
+     */
+    typedef std::function<void(const Tile& tile)> TileCallback;
+
+    /**
+     * @brief The function called once a pass of a progressive rendering is complete.
+     *
+     * The function is called from the thread calling renderProgressive(), between two passes: it may read
+     * the whole frame, for instance to display it. Returning false stops the rendering.
+     */
+    typedef std::function<bool(const FrameBuffer& frame)> PassCallback;
+
+    static const int DefaultTileSize = 16; /*!< The default width and height of a tile, in pixels. */
+    static const int PacketWidth = 4; /*!< The width of the blocks of pixels whose primary rays are traced as a packet. */
+    static const int EdgeSamples = 4; /*!< The number of samples of the pixels of an edge for renderAdaptive(), before their variance is trusted. */
+
+    ~Renderer();
+
+    /**
+     * @brief Create the threads of the renderer.
+     * @param threadCount The number of threads, the number of hardware threads if 0 or less.
+     * @param tileSize The width and height of the tiles, in pixels, rounded up to a multiple of PacketWidth.
+     */
+    Renderer(const int& threadCount = 0, const int& tileSize = DefaultTileSize);
+
+    Renderer(const Renderer& renderer) = delete;
+    Renderer& operator=(const Renderer& renderer) = delete;
+
+    /**
+     * @brief Access to the width and height of the tiles, in pixels.
+     */
+    const int& tileSize() const;
+
+    /**
+     * @brief Access to the number of threads rendering the tiles.
+     */
+    int threadCount() const;
+
+    /**
+     * @brief Access to the pool of threads, for instance to read its statistics after a frame.
+     */
+    const ThreadPool& pool() const;
+
+    /**
+     * @brief The counters of the shadow caches of the threads, summed, for the last frame rendered.
+     *
+     * The counters are zero unless the frame has been rendered with RenderSettings::shadowCache.
+     * @return A cache holding the summed counters and no occluder.
+     */
+    ShadowCache shadowCacheCounters() const;
+
+    /**
+     * @brief Split a frame into tiles ordered along a Hilbert curve.
+     * @param width The width of the frame, in pixels.
+     * @param height The height of the frame, in pixels.
+     * @param tileSize The width and height of the tiles, in pixels.
+     * @return The tiles covering the frame, each pixel belonging to a single tile.
+     */
+    static std::vector<Tile> tiles(const int& width, const int& height, const int& tileSize);
+
+    /**
+     * @brief The position of a sample of a progressive rendering relative to the corner of its pixel.
+     *
+     * The positions follow the Halton sequence in bases 2 and 3, whose first n points cover the
+     * pixel evenly for any n: the frame is anti-aliased a bit more after each pass.
+     * @param index The index of the sample among the ones of its pixel.
+     * @return The position of the sample, in [0,1)x[0,1).
+     */
+    static glm::vec2 sampleOffset(const int& index);
+
+    /**
+     * @brief Render a frame.
+     * @param scene The scene.
+     * @param lights The lights.
+     * @param camera The camera, whose width and height are the ones of the frame.
+     * @param settings The shading parameters.
+     * @param image The color of each pixel, the pixel (x,y) being at x+y*width.
+     * @param tileDone The function called once each tile is rendered, none if empty.
+     * @return False if the rendering has been cancelled, the image being incomplete.
+     */
+    bool render(const Scene& scene, const std::vector<LightPtr>& lights, const Camera& camera, const RenderSettings& settings,
+                std::vector<glm::vec3>& image, const TileCallback& tileDone = TileCallback());
+
+    /**
+     * @brief Add passes of one sample per pixel to a frame.
+     *
+     * Each pass adds a sample to each pixel, the sample i of a pixel being taken at sampleOffset(i): a frame
+     * whose passes have been stopped or cancelled may be completed by a later call with the same camera, the
+     * pixels already reached by the cancelled pass getting their next sample rather than the same one again. The frame is resized, which empties
+     * it, if its size is not the one of the camera, and must be cleared by the caller when the scene or
+     * the camera changes. RenderSettings::pixelOffsets is not used.
+     * @param scene The scene.
+     * @param lights The lights.
+     * @param camera The camera, whose width and height are the ones of the frame.
+     * @param settings The shading parameters.
+     * @param frame The frame the samples are added to.
+     * @param passCount The number of passes the frame has once complete.
+     * @param passDone The function called after each pass, none if empty.
+     * @param tileDone The function called once each tile of a pass is rendered, none if empty.
+     * @return False if the rendering has been cancelled, the last pass being incomplete.
+     */
+    bool renderProgressive(const Scene& scene, const std::vector<LightPtr>& lights, const Camera& camera, const RenderSettings& settings,
+                           FrameBuffer& frame, const int& passCount, const PassCallback& passDone = PassCallback(),
+                           const TileCallback& tileDone = TileCallback());
+
+    /**
+     * @brief Render a frame with more samples where its color varies.
+     *
+     * The first pass adds one sample to each pixel. Each following pass adds a sample to the pixels left to refine,
+     * up to RenderSettings::maxSamples samples: the pixels whose color differs from the one of a neighbour by more
+     * than RenderSettings::contrastThreshold until they have EdgeSamples samples, since a pixel on an edge may have
+     * all its first samples on the same side, and the pixels whose standard error, the square root of their variance
+     * over their number of samples, is above RenderSettings::errorThreshold. The sample i of a pixel is taken at
+     * sampleOffset(i). Flat regions thus keep a single sample while the edges, reflections and refractions
+     * get more, the passes ending once no pixel is left to refine. RenderSettings::pixelOffsets is not used.
+     * @param scene The scene.
+     * @param lights The lights.
+     * @param camera The camera, whose width and height are the ones of the frame.
+     * @param settings The shading and sampling parameters.
+     * @param frame The frame, emptied before the first pass.
+     * @param passDone The function called after each pass, none if empty.
+     * @param tileDone The function called once each tile of a pass is rendered, none if empty.
+     * @return False if the rendering has been cancelled, the last pass being incomplete.
+     */
+    bool renderAdaptive(const Scene& scene, const std::vector<LightPtr>& lights, const Camera& camera, const RenderSettings& settings,
+                        FrameBuffer& frame, const PassCallback& passDone = PassCallback(), const TileCallback& tileDone = TileCallback());
+
+    /**
+     * @brief Find the pixels of a frame needing more samples, as in renderAdaptive().
+     *
+     * Once a pixel has enough samples, it is not tested again even if the colors of its neighbours change.
+     * @param frame The frame.
+     * @param settings The sampling parameters.
+     * @param refined For each pixel, the pixel (x,y) being at x+y*width, true if it needs more samples.
+     * On input, the pixels refined by the previous pass, the only ones tested, or empty to test all the pixels.
+     * @return The number of pixels needing more samples.
+     */
+    static int refinedPixels(const FrameBuffer& frame, const RenderSettings& settings, std::vector<char>& refined);
+
+    /**
+     * @brief Stop the frame being rendered by render(), renderProgressive() or renderAdaptive() as soon as possible.
+     *
+     * This function may be called from any thread. The tiles being rendered stop after their current
+     * block of pixels and the remaining tiles are skipped. A call while no frame is rendered is ignored:
+     * use cancel(frame) to also stop a frame which has not started yet.
+     */
+    void cancel();
+
+    /**
+     * @brief Stop the frames up to a given one, whether they are being rendered or have not started yet.
+     *
+     * This function may be called from any thread. A frame whose number is at most the one given stops as in
+     * cancel(), or returns false at once if it starts afterwards. The frames started later are not affected.
+     * @param frame The number of the last frame to stop, as counted by frameCount().
+     */
+    void cancel(const std::uint64_t& frame);
+
+    /**
+     * @brief The number of frames started by render(), renderProgressive() and renderAdaptive().
+     *
+     * The frame being rendered is the last one: the next frame to start will be the frame frameCount()+1.
+     */
+    std::uint64_t frameCount() const;
+
+private:
+    /**
+     * @brief Add samples to all the pixels of a frame, tile by tile.
+     * @param offsets The position of the samples of each pixel relative to its corner or, if empty, a single
+     * sample per pixel, the sample i of a pixel being taken at sampleOffset(i).
+     * @return False if the rendering has been cancelled.
+     */
+    bool renderPass(const Scene& scene, const std::vector<LightPtr>& lights, const Camera& camera, const RenderSettings& settings,
+                    const std::vector<glm::vec2>& offsets, FrameBuffer& frame, const TileCallback& tileDone);
+
+    /**
+     * @brief Add a sample to some pixels of a frame, tile by tile.
+     *
+     * The rays of the selected pixels of a tile are traced by packets of RayPacket::MaxSize rays, the sample i
+     * of a pixel being taken at sampleOffset(i).
+     * @param refined For each pixel, the pixel (x,y) being at x+y*width, true if it gets a sample.
+     * @return False if the rendering has been cancelled.
+     */
+    bool renderPixels(const Scene& scene, const std::vector<LightPtr>& lights, const Camera& camera, const RenderSettings& settings,
+                      const std::vector<char>& refined, FrameBuffer& frame, const TileCallback& tileDone);
+
+    /**
+     * @brief Start a frame, the frame being rendered until the next one starts.
+     */
+    void startFrame();
+
+    /**
+     * @brief Check if the frame being rendered has been cancelled.
+     */
+    bool cancelled() const;
+
+    int m_tileSize; /*!< The width and height of the tiles, in pixels. */
+    ThreadPool m_pool; /*!< The threads rendering the tiles. */
+    std::vector<ShadowCache> m_shadowCaches; /*!< The shadow cache of each thread. */
+    std::atomic<std::uint64_t> m_frameCount; /*!< The number of frames started, the last one being the frame being rendered. */
+    std::atomic<std::uint64_t> m_cancelledFrame; /*!< The number of the last frame cancelled, 0 if none. */
+};
+
+#endif // RENDERER_HPP
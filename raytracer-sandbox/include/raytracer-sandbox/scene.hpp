@@ -0,0 +1,175 @@
+#ifndef SCENE_HPP
+#define SCENE_HPP
+
+/** @file
+ * @brief Define a scene.
+ *
+ * A scene gathers the objects to render and the acceleration structure used
+ * to answer ray queries against them.
+ */
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "object.hpp"
+#include "bvh.hpp"
+#include "octree.hpp"
+
+/** @brief The acceleration structures a scene can be indexed with. */
+enum AccelerationType { BOUNDING_VOLUME_HIERARCHY, OCTREE };
+
+/** @brief Objects of a scene indexed by an acceleration structure.
+ *
+ * Objects with a finite bounding box are stored in a BVH, or an octree, built from Object::bbox().
+ * Unbounded objects, such as infinite planes, cannot be placed in the hierarchy
+ * and are tested one after another.
+ */
+class Scene
+{
+public:
+    /**
+     * @brief Destructor
+     */
+    ~Scene();
+
+    /**
+     * @brief Default constructor
+     */
+    Scene() = default;
+
+    /**
+     * @brief Clone constructor
+     */
+    Scene(const Scene& scene) = default;
+
+    /**
+     * @brief Build a scene and its hierarchy from a set of objects.
+     *
+     * @param objects The objects of the scene.
+     * @param accelerationType The acceleration structure indexing the bounded objects.
+     * @param bvhSettings The parameters of the construction of the BVH, unused by the octree.
+     */
+    Scene(const std::vector<ObjectPtr>& objects, const AccelerationType& accelerationType = BOUNDING_VOLUME_HIERARCHY,
+          const BVHBuildSettings& bvhSettings = BVHBuildSettings());
+
+    /**
+     * @brief Access to the objects of the scene.
+     *
+     * @return A const reference to m_objects.
+     */
+    const std::vector<ObjectPtr>& objects() const;
+
+    /**
+     * @brief Access to the hierarchy over the bounded objects of the scene.
+     *
+     * @return A const reference to m_bvh.
+     */
+    const BVH& bvh() const;
+
+    /**
+     * @brief Access to the octree over the bounded objects of the scene.
+     *
+     * @return A const reference to m_octree, nullptr unless the scene is indexed by an octree.
+     */
+    const std::shared_ptr< Octree<int> >& octree() const;
+
+    /**
+     * @brief Access to the acceleration structure used by the scene.
+     *
+     * @return A const reference to m_accelerationType.
+     */
+    const AccelerationType& accelerationType() const;
+
+    /**
+     * @brief Update the acceleration structure after bounded objects moved or deformed.
+     *
+     * The bounding boxes of the objects are read again. The BVH is refitted, and rebuilt
+     * if it degraded too much, while the octree is rebuilt.
+     * @return True if the acceleration structure has been rebuilt, false if it has only been refitted.
+     */
+    bool refit();
+
+    /**
+     * @brief Find the closest intersection between a ray and the objects of the scene, nearer than a maximum distance.
+     *
+     * The objects and the nodes of the acceleration structure lying beyond the closest hit found so far
+     * are skipped. Only the hit record is computed: call HitSurface() for its position and normal.
+     * @param r The ray tested for intersection.
+     * @param tMax The maximum distance along the ray, updated with the distance of the closest hit.
+     * @param hit The closest hit, with the index of the object hit in objects().
+     * @return True if an object is hit before tMax, false otherwise.
+     */
+    bool intersect(const Ray& r, float& tMax, HitRecord& hit) const;
+
+    /**
+     * @brief Compute the position of a hit on an object of the scene and the normal of the surface there.
+     *
+     * @param r The ray which hit the object.
+     * @param hit The hit, as found by intersect().
+     * @param hitPosition The position of the hit.
+     * @param hitNormal The normalized normal of the surface at the position of the hit.
+     */
+    void HitSurface(const Ray& r, const HitRecord& hit, glm::vec3& hitPosition, glm::vec3& hitNormal) const;
+
+    /**
+     * @brief Check if a ray is blocked by an object of the scene before a maximum distance.
+     *
+     * This is the query of shadow rays: the traversal of the acceleration structure stops at
+     * the first blocking hit found, which is not necessarily the closest one, and neither the
+     * position nor the normal of the hit are computed. Objects with a FRESNEL material are
+     * transparent and let the ray through.
+     * @param r The ray, typically from a surface towards a light.
+     * @param tMax The maximum distance along the ray, typically the distance to the light.
+     * @param ignoredObject An object which never blocks the ray, typically the surface the ray starts from, nullptr if none.
+     * @return True if an object blocks the ray before tMax, false otherwise.
+     */
+    bool occluded(const Ray& r, const float& tMax, const Object* ignoredObject = nullptr) const;
+
+    /**
+     * @brief Check if a ray is blocked by an object of the scene before a maximum distance, and by which one.
+     *
+     * Same query as occluded(), which also returns the object found blocking the ray, for instance to
+     * remember it in a ShadowCache.
+     * @param occluder The object found blocking the ray, nullptr if none.
+     */
+    bool occluded(const Ray& r, const float& tMax, const Object* ignoredObject, const Object*& occluder) const;
+
+    /**
+     * @brief Compute the closest intersection between a ray and the objects of the scene.
+     *
+     * @param r The ray tested for intersection.
+     * @param closestHitObject The closest object hit by the ray, nullptr if none.
+     * @param closestHitPosition The position of the closest intersection.
+     * @param closestHitNormal The normal of the surface at the position of the closest intersection.
+     * @return True if an intersection occured and false otherwise.
+     */
+    bool intersect(const Ray& r, ObjectPtr& closestHitObject, glm::vec3& closestHitPosition, glm::vec3& closestHitNormal) const;
+
+    /**
+     * @brief Compute the closest intersections between the rays of a packet and the objects of the scene.
+     *
+     * A coherent packet traverses the BVH once for all its rays with BVH::intersectPacket(). An incoherent
+     * packet, or a scene indexed by an octree, is traced ray after ray with the scalar intersect().
+     * @param packet The packet of rays.
+     * @param closestHitObjects The closest object hit by each ray, nullptr if none. RayPacket::MaxSize values.
+     * @param hits The closest hit of each ray, with its position and normal.
+     * @return The mask of the rays which hit an object, bit i standing for ray i.
+     */
+    int intersect(const RayPacket& packet, ObjectPtr* closestHitObjects, RayPacketHits& hits) const;
+
+private:
+    std::vector<ObjectPtr> m_objects; /*!< The objects of the scene. */
+    std::vector<ObjectPtr> m_boundedObjects; /*!< The objects indexed by m_bvh, the primitive id of the BVH is the index in this vector. */
+    std::vector<int> m_boundedObjectIds; /*!< The index in m_objects of each object of m_boundedObjects. */
+    std::vector<int> m_unboundedObjectIds; /*!< The indices in m_objects of the objects with an infinite bounding box. */
+    AccelerationType m_accelerationType = BOUNDING_VOLUME_HIERARCHY; /*!< The acceleration structure in use. */
+    BVH m_bvh; /*!< The hierarchy over m_boundedObjects. */
+    BVHBuildSettings m_bvhSettings; /*!< The parameters of the construction of m_bvh. */
+    std::shared_ptr< Octree<int> > m_octree; /*!< The octree over m_boundedObjects, the data of an octree item is the index in this vector. */
+
+    /**
+     * @brief Build the octree over the bounding boxes of the bounded objects.
+     */
+    void buildOctree(const std::vector<Box>& boxes);
+};
+
+#endif // SCENE_HPP
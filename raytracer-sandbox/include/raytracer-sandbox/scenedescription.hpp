@@ -0,0 +1,84 @@
+#ifndef SCENEDESCRIPTION_HPP
+#define SCENEDESCRIPTION_HPP
+
+/** @file
+ * @brief Define the description of a scene read from a text file.
+ *
+ * This file defines the objects, lights, camera and shading parameters of a scene file,
+ * and the functions reading them, so that a frame can be rendered without hardcoding its scene.
+ */
+
+#include <istream>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "camera.hpp"
+#include "light.hpp"
+#include "object.hpp"
+#include "renderer.hpp"
+
+/** @brief The content of a scene file: what to render and from where.
+ *
+ * The camera is stored by its position and target rather than as a Camera, whose size is the one
+ * of the frame and is only known when rendering.
+ */
+struct SceneDescription
+{
+    std::vector<ObjectPtr> objects; /*!< The objects of the scene. */
+    std::vector<LightPtr> lights; /*!< The lights of the scene. */
+    float fov = glm::radians(60.0f); /*!< The vertical field of view of the camera, in radians. */
+    glm::vec3 eye = glm::vec3(0,0,8); /*!< The position of the camera. */
+    glm::vec3 target = glm::vec3(0,0,0); /*!< The point the camera looks at. */
+    glm::vec3 up = glm::vec3(0,1,0); /*!< The up direction of the camera. */
+    float nearPlane = 1.0f; /*!< The distance to the near clipping plane. */
+    float farPlane = 100.0f; /*!< The distance to the far clipping plane. */
+    RenderSettings settings; /*!< The shading parameters of the frames. */
+
+    /**
+     * @brief Build the camera of the scene for a frame.
+     * @param width The width of the frame, in pixels.
+     * @param height The height of the frame, in pixels.
+     * @return The camera at eye looking at target.
+     */
+    Camera camera(const int& width, const int& height) const;
+};
+
+/** @brief Read a scene file.
+ *
+ * A scene file has one statement per line, the text following a # being a comment. The vectors and
+ * colors are given by their 3 components and the angles in degrees:
+ *
+ *     camera <fov> <eye> <target> [<up>]
+ *     clip <near> <far>
+ *     background <color>
+ *     shadow <color>
+ *     bias <bias>
+ *     depth <maxDepth>
+ *     sphere <center> <radius> <material>
+ *     plane <normal> <point> <material>
+ *     mesh <obj path> <material>
+ *     directional <direction> <ambient> <diffuse> <specular>
+ *     point <position> <ambient> <diffuse> <specular> <constant> <linear> <quadratic>
+ *     spot <position> <direction> <ambient> <diffuse> <specular> <constant> <linear> <quadratic> <inner cut off> <outer cut off>
+ *
+ * A material is one of pearl, emerald, bronze, glossy, fresnel <ior> or phong <ambient> <diffuse> <specular> <shininess>.
+ * The paths of the meshes are relative to the directory of the scene file, and may not contain spaces.
+ *
+ * @param filename The path to the scene file.
+ * @param description The content of the scene, objects and lights being appended to it.
+ * @param error The line and reason of the failure, if any.
+ * @return False if the file cannot be read or a line is invalid, true otherwise.
+ */
+bool read_scene(const std::string& filename, SceneDescription& description, std::string& error);
+
+/** @brief Read a scene from a stream, in the format of read_scene(const std::string&, SceneDescription&, std::string&).
+ *
+ * @param stream The stream the scene is read from.
+ * @param directory The directory the paths of the meshes are relative to, the current directory if empty.
+ * @param description The content of the scene, objects and lights being appended to it.
+ * @param error The line and reason of the failure, if any.
+ * @return False if a line is invalid, true otherwise.
+ */
+bool read_scene(std::istream& stream, const std::string& directory, SceneDescription& description, std::string& error);
+
+#endif // SCENEDESCRIPTION_HPP
@@ -0,0 +1,82 @@
+#ifndef SHADOWCACHE_HPP
+#define SHADOWCACHE_HPP
+
+/** @file
+ * @brief Define a cache of the last occluder of the shadow rays towards each light.
+ *
+ * This file defines the cache remembering, light by light, the last object found
+ * blocking a shadow ray, and the counters telling how often it answered the query.
+ */
+
+#include <cstdint>
+#include <vector>
+#include "object.hpp"
+
+/** @brief The last object found blocking the shadow rays towards each light.
+ *
+ * Neighbouring shading points usually have their shadow rays towards a given light blocked
+ * by the same object. Testing this object first with Object::Occluded() answers the query
+ * without traversing the acceleration structure of the scene whenever it still blocks the ray.
+ *
+ * A cache is not thread-safe: each thread shades with its own cache, and the counters of the
+ * caches of the threads are summed with operator+=() afterwards.
+ */
+class ShadowCache
+{
+public:
+    ~ShadowCache();
+    ShadowCache() = default;
+    ShadowCache(const ShadowCache& cache) = default;
+
+    /**
+     * @brief The last object found blocking a shadow ray towards a light.
+     * @param light The index of the light.
+     * @return The object, nullptr if none has been found yet.
+     */
+    const Object* occluder(const int& light) const;
+
+    /**
+     * @brief Remember the object found blocking a shadow ray towards a light.
+     * @param light The index of the light.
+     * @param occluder The object.
+     */
+    void setOccluder(const int& light, const Object* occluder);
+
+    /**
+     * @brief Count a shadow ray answered with the cache.
+     * @param hit True if the cached occluder blocked the ray, false if the scene had to be traversed.
+     */
+    void count(const bool& hit);
+
+    /**
+     * @brief The number of shadow rays answered with the cache.
+     */
+    const std::uint64_t& lookups() const;
+
+    /**
+     * @brief The number of shadow rays blocked by the cached occluder.
+     */
+    const std::uint64_t& hits() const;
+
+    /**
+     * @brief The ratio of the shadow rays blocked by the cached occluder, 0 before any lookup.
+     */
+    float hitRate() const;
+
+    /**
+     * @brief Forget the occluders and reset the counters.
+     */
+    void clear();
+
+    /**
+     * @brief Add the counters of another cache, typically the one of another thread.
+     */
+    ShadowCache& operator+=(const ShadowCache& cache);
+
+private:
+    std::vector<const Object*> m_occluders; /*!< The last occluder of each light, grown on demand. */
+    std::uint64_t m_lookups = 0; /*!< The number of shadow rays answered with the cache. */
+    std::uint64_t m_hits = 0; /*!< The number of shadow rays blocked by the cached occluder. */
+};
+
+#endif // SHADOWCACHE_HPP
@@ -13,7 +13,11 @@ public:
     Sphere(const glm::vec3& position, const float& radius, const MaterialPtr& material);
     const glm::vec3& position() const;
     const float& radius() const;
-    virtual bool Intersect(const Ray& r, glm::vec3& hitPosition, glm::vec3& hitNormal) const;
+    using Object::Intersect;
+    virtual bool Intersect(const Ray& r, float& tMax, HitRecord& hit) const;
+    virtual void HitSurface(const Ray& r, const HitRecord& hit, glm::vec3& hitPosition, glm::vec3& hitNormal) const;
+    virtual bool Occluded(const Ray& r, const float& tMax) const;
+    virtual int IntersectPacket(const RayPacket& packet, const int& mask, RayPacketHits& hits) const;
 private:
     float m_radius;
     glm::vec3 m_position;
@@ -208,6 +208,7 @@ public:
     virtual glm::vec3 phongIllumination(const glm::vec3& eyePosition, const glm::vec3& surfacePosition,
                                         const glm::vec3& surfaceNormal, const PhongMaterialPtr& material) const;
     virtual glm::vec3 lightDirectionFrom(const glm::vec3& position) const;
+    virtual float distanceFrom(const glm::vec3& position) const;
 
 private:
     glm::vec3 m_position; /*!< The position of the light. */
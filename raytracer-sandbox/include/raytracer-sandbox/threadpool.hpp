@@ -0,0 +1,110 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+/** @file
+ * @brief Define a pool of threads balancing jobs by work stealing.
+ *
+ * This file defines the persistent threads running the jobs of a batch, each thread
+ * taking jobs from its own queue first and stealing from the others once it is empty.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** @brief Pool of threads running batches of jobs with work stealing.
+ *
+ * The jobs of a batch are split into as many contiguous ranges as threads, each range going
+ * to the queue of a thread. A thread runs the jobs of its queue from the front, in order, and
+ * once it is empty steals the jobs at the back of the queue of another thread. Consecutive jobs
+ * thus stay on the same thread as long as the load is balanced, and a thread finishing early
+ * takes over the jobs the busiest threads would have run last.
+ *
+ * The threads are created once and wait between the batches. The queues are protected by a
+ * mutex each: a job being a whole tile of pixels, taking it costs nothing in comparison.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * @brief The function running a job.
+     *
+     * The arguments are the index of the job in the batch and the index of the thread running it,
+     * between 0 and threadCount()-1, for instance to select a per-thread cache.
+     */
+    typedef std::function<void(const int& job, const int& thread)> Job;
+
+    /**
+     * @brief Stop and join the threads.
+     */
+    ~ThreadPool();
+
+    /**
+     * @brief Create the threads of the pool.
+     * @param threadCount The number of threads, the number of hardware threads if 0 or less.
+     */
+    ThreadPool(const int& threadCount = 0);
+
+    ThreadPool(const ThreadPool& pool) = delete;
+    ThreadPool& operator=(const ThreadPool& pool) = delete;
+
+    /**
+     * @brief Access to the number of threads of the pool.
+     */
+    int threadCount() const;
+
+    /**
+     * @brief Run a batch of jobs and wait for all of them to complete.
+     *
+     * A batch must not be run from a job, nor from two threads at once.
+     * @param jobCount The number of jobs, run with the indices 0 to jobCount-1.
+     * @param job The function running a job, called concurrently from the threads of the pool.
+     */
+    void run(const int& jobCount, const Job& job);
+
+    /**
+     * @brief The number of jobs stolen from the queue of another thread during the last batch.
+     */
+    std::uint64_t steals() const;
+
+private:
+    /** @brief The queue of the jobs of a thread. */
+    struct Queue
+    {
+        std::mutex mutex; /*!< The mutex protecting the jobs. */
+        std::deque<int> jobs; /*!< The indices of the jobs left. */
+    };
+
+    /**
+     * @brief The loop of a thread, running its share of each batch.
+     * @param thread The index of the thread.
+     */
+    void work(const int& thread);
+
+    /**
+     * @brief Take the next job of a thread: the front of its queue, else the back of another queue.
+     * @param thread The index of the thread.
+     * @param job The index of the job taken.
+     * @return False if all the queues are empty.
+     */
+    bool take(const int& thread, int& job);
+
+    std::vector<std::unique_ptr<Queue>> m_queues; /*!< The queue of each thread. */
+    std::vector<std::thread> m_threads; /*!< The threads. */
+    std::mutex m_mutex; /*!< The mutex protecting the state of the batch. */
+    std::condition_variable m_batchStarted; /*!< Signaled when a batch starts or the pool stops. */
+    std::condition_variable m_batchDone; /*!< Signaled when the last thread is done with a batch. */
+    const Job* m_job = nullptr; /*!< The function running the jobs of the current batch. */
+    std::uint64_t m_batch = 0; /*!< The index of the current batch. */
+    int m_busyThreads = 0; /*!< The number of threads still running the current batch. */
+    bool m_stop = false; /*!< True once the threads have to exit. */
+    std::atomic<std::uint64_t> m_steals; /*!< The number of jobs stolen during the current batch. */
+};
+
+#endif // THREADPOOL_HPP
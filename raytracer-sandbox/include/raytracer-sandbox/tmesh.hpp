@@ -2,6 +2,11 @@
 #define TMESH_HPP
 
 #include "object.hpp"
+#include "bvh.hpp"
+#include "cache.hpp"
+#include "extentbvh.hpp"
+#include "triangleblock.hpp"
+#include <cstdint>
 #include <vector>
 #include <glm/glm.hpp>
 
@@ -27,30 +32,177 @@ public:
      * Build a triangular mesh from an obj file and a specific material.
      * @param filename The path to the obj file.
      * @param material A reference to the material's pointer.
+     * @param bvhSettings The parameters of the construction of the hierarchy over the triangles.
+     * When a cache directory is given, the mesh and its hierarchy are read in place from the cache file of
+     * CacheFilename() if it exists, instead of parsing the obj file and building the hierarchy. Otherwise,
+     * the cache file is written once the hierarchy is built.
+     * @param extentSettings The plane-set normals bounding the nodes of the hierarchy by k-DOPs, nullptr to keep bounding boxes.
+     * @param cacheDirectory The directory of the cache files, empty to disable the cache.
      */
-    TMesh(const std::string& filename, const MaterialPtr &material);
+    TMesh(const std::string& filename, const MaterialPtr &material, const BVHBuildSettings& bvhSettings = BVHBuildSettings(),
+          const ExtentSettingsPtr& extentSettings = nullptr, const std::string& cacheDirectory = std::string());
 
     /**
      * @brief Clone constructor
      */
     TMesh(const TMesh& mesh) = default;
 
-    /** @brief Compute the intersection between the object and a ray.
+    using Object::Intersect;
+
+    /** @brief Compute the closest intersection between the mesh and a ray, nearer than a maximum distance.
+     *
+     * The triangles are looked up through the hierarchy of the mesh, which only visits the nodes
+     * entered before tMax, and the closest hit is returned. The triangles of a leaf are tested together,
+     * by blocks of 4 or 8 with SIMD instructions. The primitive id of the hit is the triangle id.
+     * @param r The ray tested for intersection.
+     * @param tMax The maximum distance along the ray, updated with the distance of the hit.
+     * @param hit The hit, updated if the mesh is hit before tMax.
+     * @return True if the mesh is hit before tMax, false otherwise.
+     */
+    virtual bool Intersect(const Ray& r, float& tMax, HitRecord& hit) const;
+
+    /** @brief Compute the position of a hit and the normal of the surface there.
+     *
+     * The normal interpolates the normals of the vertices of the triangle hit with the barycentric coordinates of the hit.
+     * @param r The ray which hit the mesh.
+     * @param hit The hit, as found by Intersect().
+     * @param hitPosition The position of the hit.
+     * @param hitNormal The normal of the surface at the position of the hit.
+     */
+    virtual void HitSurface(const Ray& r, const HitRecord& hit, glm::vec3& hitPosition, glm::vec3& hitNormal) const;
+
+    /** @brief Check if the mesh is hit by a ray before a maximum distance.
      *
-     * Compute the intersection between the object and a ray. It return true if an intersection occured or false otherwise.
-     * The position of the intersection and the normal of the surface at the position of intersection are written in the referenced parameters.
+     * The traversal of the hierarchy stops at the first triangle hit before tMax, and no normal is interpolated.
      * @param r The ray tested for intersection.
-     * @param hitPosition The position of the intersection.
-     * @param hitNormal The normal of the surface at the position of the intersection.
-     * @return True if intersection occured and False otherwise.
+     * @param tMax The maximum distance along the ray.
+     * @return True if a triangle is hit before tMax, false otherwise.
+     */
+    virtual bool Occluded(const Ray& r, const float& tMax) const;
+
+    /** @brief Compute the intersections between the object and the rays of a packet.
+     *
+     * The packet traverses the hierarchy of bounding boxes of the mesh with BVH::intersectPacket(),
+     * even when the mesh has a hierarchy of k-DOPs, and each triangle of a leaf is tested against
+     * 4 rays at a time with SIMD instructions.
+     * @param packet The packet of rays.
+     * @param mask The rays to test, bit i standing for ray i.
+     * @param hits The closest hits of the rays, updated where the mesh is hit closer.
+     * @return The mask of the rays whose closest hit is now on the mesh.
+     */
+    virtual int IntersectPacket(const RayPacket& packet, const int& mask, RayPacketHits& hits) const;
+
+    /**
+     * @brief Access to the hierarchy over the triangles of the mesh.
+     *
+     * @return A const reference to m_bvh.
+     */
+    const BVH& bvh() const;
+
+    /**
+     * @brief Access to the hierarchy of k-DOPs over the triangles of the mesh, used instead of bvh() when it is not empty.
+     *
+     * @return A const reference to m_extentBVH.
+     */
+    const ExtentBVH& extentBVH() const;
+
+    /**
+     * @brief Access to the positions of the vertices of the mesh.
+     *
+     * The topology of the mesh is fixed but its vertices can move, for instance to animate it.
+     * Call refit() once they have been modified. The non-const access copies the positions
+     * out of the cache file the mesh was read from, if any.
+     * @return A reference to m_positions.
+     */
+    std::vector<glm::vec3>& positions();
+    const MappedArray< std::vector<glm::vec3> >& positions() const;
+
+    /**
+     * @brief Access to the normals of the vertices of the mesh.
+     *
+     * The non-const access copies the normals out of the cache file the mesh was read from, if any.
+     * @return A reference to m_normals.
+     */
+    std::vector<glm::vec3>& normals();
+    const MappedArray< std::vector<glm::vec3> >& normals() const;
+
+    /**
+     * @brief Update the bounding box of the mesh and its hierarchy after its vertices moved.
+     *
+     * @return True if the hierarchy has been rebuilt because refitting degraded it too much, false otherwise.
+     */
+    bool refit();
+
+    /**
+     * @brief The path of the file caching a mesh and its hierarchy.
+     *
+     * The name of the file is a hash of the content of the obj file, see HashFile(), and of the parameters of the
+     * construction of the hierarchy, so that editing any of them misses the cache while a copy of the obj file
+     * at another path shares the cache file.
+     * @param cacheDirectory The directory of the cache files.
+     * @param filename The path to the obj file.
+     * @param bvhSettings The parameters of the construction of the hierarchy.
+     * @return The path of the cache file, empty if the obj file cannot be read.
      */
-    virtual bool Intersect(const Ray& r, glm::vec3& hitPosition, glm::vec3& hitNormal) const;
+    static std::string CacheFilename(const std::string& cacheDirectory, const std::string& filename, const BVHBuildSettings& bvhSettings);
 
 private:
-    std::vector<unsigned int> m_indices; /*!< The indices of the triangles of the mesh. For instance, the indices of a triangle i are m_indices[3*i+0], m_indices[3*i+1] and m_indices[3*i+2]. */
-    std::vector<glm::vec2> m_texCoords; /*!< The texture coordinates of the vertices of the mesh. */
-    std::vector<glm::vec3> m_positions; /*!< The positions of the vertices of the mesh. */
-    std::vector<glm::vec3> m_normals; /*!< The normals of the vertices of the mesh. */
+    MappedArray< std::vector<unsigned int> > m_indices; /*!< The indices of the triangles of the mesh. For instance, the indices of a triangle i are m_indices[3*i+0], m_indices[3*i+1] and m_indices[3*i+2]. */
+    MappedArray< std::vector<glm::vec2> > m_texCoords; /*!< The texture coordinates of the vertices of the mesh. */
+    MappedArray< std::vector<glm::vec3> > m_positions; /*!< The positions of the vertices of the mesh. */
+    MappedArray< std::vector<glm::vec3> > m_normals; /*!< The normals of the vertices of the mesh. */
+    TriangleBlocks<4> m_triangleBlocks4; /*!< The triangles of the leaves of the hierarchy by blocks of 4, empty if stored by blocks of 8. */
+    TriangleBlocks<8> m_triangleBlocks8; /*!< The triangles of the leaves of the hierarchy by blocks of 8, only with AVX2 and leaves larger than 4. */
+    std::vector<int> m_leafBlocks; /*!< The index of the first block of the leaf starting at each position of the primitive indices of the hierarchy. */
+    BVH m_bvh; /*!< The hierarchy over the triangles of the mesh. The primitive id of the BVH is the triangle id. */
+    ExtentBVH m_extentBVH; /*!< The same hierarchy bounded by k-DOPs, empty unless the mesh has been built with extent settings. */
+
+    /**
+     * @brief Update m_bbox from the positions.
+     */
+    void computeBBox();
+
+    /**
+     * @brief Gather the triangles of each leaf of the hierarchy into blocks, from the positions.
+     */
+    void computeTriangleBlocks();
+
+    /**
+     * @brief Update m_bbox from the positions and compute the bounding box of each triangle.
+     */
+    std::vector<Box> computeBoxes();
+
+    /**
+     * @brief Bound the nodes of m_bvh by the k-DOPs of the triangles.
+     */
+    void buildExtentBVH(const ExtentSettingsPtr& extentSettings);
+
+    /**
+     * @brief Read the mesh and its hierarchy from a cache file.
+     *
+     * The file is memory mapped and its arrays, down to the wide nodes, are used in place once checked: a file whose
+     * indices or hierarchy would be read out of bounds is treated as a cache miss. The wide nodes are only collapsed
+     * again if the file was written on a processor supporting another SIMD width. The triangle blocks, which would
+     * duplicate the positions in the file, are gathered again from the mapped arrays.
+     * @param cacheFilename The path of the cache file.
+     * @param key The hash of the obj file and the build settings, which the file must have been written with.
+     * @return False if the file does not exist or is not a valid cache file, true otherwise.
+     */
+    bool readCache(const std::string& cacheFilename, const std::uint64_t& key);
+
+    /**
+     * @brief Write the mesh and its hierarchy to a cache file.
+     *
+     * The file is written under a temporary name then renamed, so that a reader never sees it partially written.
+     */
+    void writeCache(const std::string& cacheFilename, const std::uint64_t& key) const;
+
+    /**
+     * @brief Compute the bounding boxes of the parts of a triangle on each side of an axis-aligned plane, for the spatial splits.
+     */
+    void splitTriangle(const int& i, const int& axis, const float& position, Box& left, Box& right) const;
 };
 
+typedef std::shared_ptr<TMesh> TMeshPtr;
+
 #endif // TMESH_HPP
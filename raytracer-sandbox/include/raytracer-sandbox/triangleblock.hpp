@@ -0,0 +1,63 @@
+#ifndef TRIANGLEBLOCK_HPP
+#define TRIANGLEBLOCK_HPP
+
+/** @file
+ * @brief Define blocks of triangles stored as structure of arrays.
+ *
+ * This file defines the blocks of 4 or 8 triangles of a leaf of a hierarchy and
+ * the SIMD kernels testing a ray against all the triangles of a block at once.
+ */
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "alignedallocator.hpp"
+#include "ray.hpp"
+
+/** @brief Block of triangles prepared for ray intersection.
+ *
+ * Each triangle is stored as its first vertex and its two edges from it, as a
+ * PrecomputedTriangle, but every coordinate of the block lies in its own array so
+ * that one SIMD register holds a coordinate of all the triangles. An unused slot
+ * has null edges, which no ray hits, and a triangle id of -1.
+ */
+template<int Width>
+struct TriangleBlock
+{
+    alignas(32) float v0[3][Width]; /*!< The first vertex of the triangles, axis by axis. */
+    alignas(32) float edge1[3][Width]; /*!< The edge from the first to the second vertex, axis by axis. */
+    alignas(32) float edge2[3][Width]; /*!< The edge from the first to the third vertex, axis by axis. */
+    int triangles[Width]; /*!< The id of the triangles, -1 for an unused slot. */
+};
+
+/** @brief The blocks of triangles of a mesh, aligned on a cache line. */
+template<int Width>
+using TriangleBlocks = std::vector< TriangleBlock<Width>, AlignedAllocator<TriangleBlock<Width>,64> >;
+
+/**
+ * @brief Test a ray against the 4 triangles of a block with SSE.
+ *
+ * Each lane runs the Möller-Trumbore test of precomputedTriangleRayIntersection() and
+ * the nearest hit is selected by a horizontal minimum over the lanes.
+ * @param block The block.
+ * @param r The ray.
+ * @param tMax The maximum distance along the ray, a hit at this distance or beyond is rejected.
+ * @param t The distance of the nearest hit along the ray.
+ * @param barycentricCoords The barycentric coordinates of the nearest hit.
+ * @return The slot of the nearest triangle hit, -1 if none.
+ */
+int IntersectTriangles(const TriangleBlock<4>& block, const Ray& r, const float& tMax, float& t, glm::vec3& barycentricCoords);
+
+/**
+ * @brief Test a ray against the 8 triangles of a block with AVX.
+ *
+ * Only call it if SupportsAVX2() is true.
+ * @param block The block.
+ * @param r The ray.
+ * @param tMax The maximum distance along the ray, a hit at this distance or beyond is rejected.
+ * @param t The distance of the nearest hit along the ray.
+ * @param barycentricCoords The barycentric coordinates of the nearest hit.
+ * @return The slot of the nearest triangle hit, -1 if none.
+ */
+int IntersectTriangles(const TriangleBlock<8>& block, const Ray& r, const float& tMax, float& t, glm::vec3& barycentricCoords);
+
+#endif // TRIANGLEBLOCK_HPP
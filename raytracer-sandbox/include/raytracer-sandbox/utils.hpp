@@ -2,6 +2,7 @@
 #define UTILS_HPP
 
 #include <glm/glm.hpp>
+#include <vector>
 
 #include "ray.hpp"
 
@@ -15,6 +16,57 @@ void barycentric(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, con
 bool triangleRayIntersection(const glm::vec3 & t1, const glm::vec3 & t2, const glm::vec3 & t3,
                              const Ray & r, glm::vec3 & hitPosition, glm::vec3 & hitNormal, glm::vec3 & barycentricCoords);
 
+/** @brief A triangle prepared for ray intersection, computed once and reused by every ray.
+ */
+struct PrecomputedTriangle
+{
+    glm::vec3 v0; /*!< The first vertex. */
+    glm::vec3 edge1; /*!< The edge from the first to the second vertex. */
+    glm::vec3 edge2; /*!< The edge from the first to the third vertex. */
+};
+
+/**
+ * @brief Prepare a triangle for precomputedTriangleRayIntersection().
+ */
+PrecomputedTriangle precomputeTriangle(const glm::vec3 & t1, const glm::vec3 & t2, const glm::vec3 & t3);
+
+/**
+ * @brief Compute the intersection between a ray and a precomputed triangle, both sides being hit.
+ *
+ * Möller and Trumbore, "Fast, minimum storage ray/triangle intersection", 1997: the barycentric
+ * coordinates and the distance are solved with Cramer's rule and a single division, and the
+ * tests on the barycentric coordinates reject most rays before the distance is computed.
+ * @param triangle The triangle.
+ * @param r The ray.
+ * @param tMax The maximum distance along the ray, a hit at this distance or beyond is rejected.
+ * @param t The distance of the hit along the ray.
+ * @param barycentricCoords The barycentric coordinates of the hit, relative to the first, second and third vertex.
+ * @return True if the ray hits the triangle between 0 and tMax, false otherwise.
+ */
+bool precomputedTriangleRayIntersection(const PrecomputedTriangle & triangle, const Ray & r, const float & tMax, float & t, glm::vec3 & barycentricCoords);
+
+/**
+ * @brief Compute the Morton code of a point of the unit cube.
+ *
+ * The coordinates are quantized on 10 bits and their bits interleaved, so that points
+ * close along the Morton curve are close in space.
+ * @param p The point, clamped to the unit cube.
+ * @return The 30 bits Morton code of the point.
+ */
+unsigned int MortonCode(const glm::vec3& p);
+
+/**
+ * @brief Sort keys and the values attached to them.
+ *
+ * Stable least significant digit radix sort, 8 bits per pass. Each pass counts then scatters
+ * chunks of keys in parallel, each chunk writing its keys of a digit after the ones of the
+ * previous chunks.
+ * @param keys The keys, sorted in place.
+ * @param values The value of each key, moved along with it.
+ * @param keyBits The number of low bits the keys may have set, the higher ones being zero.
+ */
+void RadixSort(std::vector<unsigned int>& keys, std::vector<int>& values, const int& keyBits);
+
 std::ostream& operator << ( std::ostream& out, const glm::vec3& v);
 std::ostream& operator << ( std::ostream& out, const glm::mat4& m);
 
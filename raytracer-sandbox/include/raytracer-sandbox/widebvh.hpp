@@ -0,0 +1,73 @@
+#ifndef WIDEBVH_HPP
+#define WIDEBVH_HPP
+
+/** @file
+ * @brief Define the nodes of a wide bounding volume hierarchy.
+ *
+ * This file defines the nodes of a hierarchy with up to 4 or 8 children per node,
+ * obtained by collapsing a binary hierarchy, and the SIMD kernels testing a ray
+ * against all the children of such a node at once.
+ */
+
+#include <vector>
+#include "alignedallocator.hpp"
+#include "ray.hpp"
+
+/** @brief Node of a wide bounding volume hierarchy.
+ *
+ * The bounds of the children are stored as structure of arrays, bounds[0] holding
+ * the minimum and bounds[1] the maximum bounds, so that one SIMD register holds a
+ * coordinate of all the children. A child slot is either:
+ * - a branch if primitiveCounts[i]==0, children[i] being the index of its node,
+ * - a leaf if primitiveCounts[i]>0, children[i] being the offset of its first primitive in BVH::primitiveIndices(),
+ * - empty if primitiveCounts[i]<0, its bounds being inverted so that no ray hits it.
+ */
+template<int Width>
+struct WideBVHNode
+{
+    alignas(32) float bounds[2][3][Width]; /*!< The minimum and maximum bounds of the children, axis by axis. */
+    int children[Width]; /*!< The index of the node of a branch or the first primitive of a leaf. */
+    int primitiveCounts[Width]; /*!< The number of primitives of a leaf, 0 for a branch, -1 for an empty slot. */
+};
+
+static_assert(sizeof(WideBVHNode<4>)==128, "A WideBVHNode<4> must fit in two cache lines");
+static_assert(sizeof(WideBVHNode<8>)==256, "A WideBVHNode<8> must fit in four cache lines");
+
+/** @brief The nodes of a wide hierarchy in depth-first order, aligned on a cache line. */
+template<int Width>
+using WideBVHNodes = std::vector< WideBVHNode<Width>, AlignedAllocator<WideBVHNode<Width>,64> >;
+
+/**
+ * @brief Test a ray against the 4 children of a node with SSE.
+ *
+ * @param node The node.
+ * @param r The ray.
+ * @param tMax The maximum distance along the ray.
+ * @param tEntry The entry distance of the ray in each child, clamped to 0.
+ * @return The mask of the children hit before tMax, bit i being set if the child i is hit.
+ */
+int IntersectChildren(const WideBVHNode<4>& node, const Ray& r, const float& tMax, float* tEntry);
+
+/**
+ * @brief Test a ray against the 8 children of a node with AVX.
+ *
+ * Only call it if SupportsAVX2() is true.
+ * @param node The node.
+ * @param r The ray.
+ * @param tMax The maximum distance along the ray.
+ * @param tEntry The entry distance of the ray in each child, clamped to 0.
+ * @return The mask of the children hit before tMax, bit i being set if the child i is hit.
+ */
+int IntersectChildren(const WideBVHNode<8>& node, const Ray& r, const float& tMax, float* tEntry);
+
+/**
+ * @brief Check at runtime if the processor supports SSE, used by the 4-wide hierarchy.
+ */
+bool SupportsSSE();
+
+/**
+ * @brief Check at runtime if the processor supports AVX2, used by the 8-wide hierarchy.
+ */
+bool SupportsAVX2();
+
+#endif // WIDEBVH_HPP
@@ -1,7 +1,25 @@
 #include "./../include/raytracer-sandbox/aabbtree.hpp"
+#include <limits>
+#include <vector>
 
 using namespace std;
 
+static Box merge(const Box& a, const Box& b)
+{
+    Box box = a;
+    box.extend(b);
+    return box;
+}
+
+static bool contains(const Box& a, const Box& b)
+{
+    for(size_t i=0; i<3; ++i)
+    {
+        if(b.minBound()[i]<a.minBound()[i] || b.maxBound()[i]>a.maxBound()[i]) return false;
+    }
+    return true;
+}
+
 Node::~Node()
 {}
 
@@ -9,6 +27,7 @@ Node::Node(const Box &aabb, const int &data)
 {
     m_aabb = aabb;
     m_data = data;
+    m_height = 0;
     m_children = {{nullptr, nullptr}};
 }
 
@@ -32,12 +51,42 @@ const NodePtr& Node::right() const
     return m_children[1];
 }
 
-const int& Node::data()
+weak_ptr<Node>& Node::parent()
+{
+    return m_parent;
+}
+
+const weak_ptr<Node>& Node::parent() const
+{
+    return m_parent;
+}
+
+int& Node::height()
+{
+    return m_height;
+}
+
+const int& Node::height() const
+{
+    return m_height;
+}
+
+bool Node::isLeaf() const
+{
+    return m_children[0] == nullptr;
+}
+
+const int& Node::data() const
 {
     return m_data;
 }
 
-const Box& Node::aabb()
+Box& Node::aabb()
+{
+    return m_aabb;
+}
+
+const Box& Node::aabb() const
 {
     return m_aabb;
 }
@@ -45,34 +94,325 @@ const Box& Node::aabb()
 AABBTree::~AABBTree()
 {}
 
+AABBTree::AABBTree(const float& fatMargin) : m_fatMargin(fatMargin)
+{}
+
 void AABBTree::insert(const Box& aabb, const int& data)
 {
-    if(m_root == nullptr)
+    //A second leaf with the same id would be left in the tree without any handle to it
+    if(m_leaves.count(data))
     {
-        //Left and right children are set to null_ptr in the constructor
-        m_root = std::make_shared<Node>(aabb, data);
-    }
-    else
-    {
-        //TODO
+        update(aabb, data);
+        return;
     }
+    glm::vec3 margin(m_fatMargin, m_fatMargin, m_fatMargin);
+    NodePtr leaf = make_shared<Node>(Box(aabb.minBound()-margin, aabb.maxBound()+margin), data);
+    m_leaves[data] = leaf;
+    insertLeaf(leaf);
+}
+
+bool AABBTree::remove(const int& data)
+{
+    auto it = m_leaves.find(data);
+    if(it == m_leaves.end()) return false;
+    removeLeaf(it->second);
+    m_leaves.erase(it);
+    return true;
+}
+
+bool AABBTree::update(const Box& aabb, const int& data)
+{
+    auto it = m_leaves.find(data);
+    if(it == m_leaves.end()) return false;
+
+    NodePtr leaf = it->second;
+    //The object is still inside its fat AABB: nothing to do
+    if(contains(leaf->aabb(), aabb)) return false;
+
+    removeLeaf(leaf);
+    glm::vec3 margin(m_fatMargin, m_fatMargin, m_fatMargin);
+    leaf->aabb() = Box(aabb.minBound()-margin, aabb.maxBound()+margin);
+    insertLeaf(leaf);
+    return true;
 }
 
 bool AABBTree::intersect(const Ray& r, int& data)
 {
-    //TODO
+    //The fat AABB of the leaves play the role of the objects
+    auto intersector = [&](const int& leafData, const Ray& ray, float& tMax)
+    {
+        std::array<float, 2> t;
+        if(Intersect(ray, m_leaves[leafData]->aabb(), t) && t[1]>=0)
+        {
+            float entry = max(t[0], 0.0f);
+            if(entry < tMax)
+            {
+                tMax = entry;
+                data = leafData;
+                return true;
+            }
+        }
+        return false;
+    };
+    float tMax = numeric_limits<float>::max();
+    return intersect(r, tMax, intersector);
+}
+
+bool AABBTree::intersect(const Ray& r, float& tMax, const Intersector& intersector) const
+{
+    if(m_root == nullptr) return false;
+
     std::array<float, 2> t;
-    if( Intersect(r, m_root->aabb(), t) )
+    if( !Intersect(r, m_root->aabb(), t) || t[1]<0 || t[0]>tMax ) return false;
+
+    vector< pair<const Node*, float> > stack;
+    stack.reserve(2*(m_root->height()+1));
+    stack.push_back(make_pair(m_root.get(), max(t[0], 0.0f)));
+
+    bool hit = false;
+    while(!stack.empty())
     {
-        if(t[0]>0 || t[1] >0)
+        pair<const Node*, float> entry = stack.back();
+        stack.pop_back();
+        if(entry.second > tMax) continue;
+
+        const Node* node = entry.first;
+        if(node->isLeaf())
         {
-            data = m_root->data();
-            return true;
+            hit = intersector(node->data(), r, tMax) || hit;
+            continue;
+        }
+
+        std::array<float, 2> tLeft, tRight;
+        bool hitLeft = Intersect(r, node->left()->aabb(), tLeft) && tLeft[1]>=0 && tLeft[0]<=tMax;
+        bool hitRight = Intersect(r, node->right()->aabb(), tRight) && tRight[1]>=0 && tRight[0]<=tMax;
+        float entryLeft = max(tLeft[0], 0.0f), entryRight = max(tRight[0], 0.0f);
+        //Push the farthest child first so that the nearest one is visited first
+        if(hitLeft && hitRight && entryRight<entryLeft)
+        {
+            stack.push_back(make_pair(node->left().get(), entryLeft));
+            stack.push_back(make_pair(node->right().get(), entryRight));
         }
         else
         {
-            return false;
+            if(hitRight) stack.push_back(make_pair(node->right().get(), entryRight));
+            if(hitLeft) stack.push_back(make_pair(node->left().get(), entryLeft));
         }
     }
-    return false;
+    return hit;
+}
+
+const NodePtr& AABBTree::root() const
+{
+    return m_root;
+}
+
+const float& AABBTree::fatMargin() const
+{
+    return m_fatMargin;
+}
+
+size_t AABBTree::size() const
+{
+    return m_leaves.size();
+}
+
+int AABBTree::height() const
+{
+    return m_root == nullptr ? -1 : m_root->height();
+}
+
+float AABBTree::cost() const
+{
+    float cost = 0.0f;
+    vector<const Node*> stack;
+    if(m_root != nullptr) stack.push_back(m_root.get());
+    while(!stack.empty())
+    {
+        const Node* node = stack.back();
+        stack.pop_back();
+        if(node->isLeaf()) continue;
+        cost += node->aabb().surfaceArea();
+        stack.push_back(node->left().get());
+        stack.push_back(node->right().get());
+    }
+    return cost;
+}
+
+NodePtr AABBTree::findBestSibling(const Box& aabb) const
+{
+    //Greedy descent: at each branch, compare the cost of making the branch itself the sibling
+    //with the lowest cost obtained by pushing the leaf down into one of its children.
+    NodePtr node = m_root;
+    while(!node->isLeaf())
+    {
+        float area = node->aabb().surfaceArea();
+        float combinedArea = merge(node->aabb(), aabb).surfaceArea();
+
+        //Cost of creating a new parent for this node and the new leaf
+        float cost = 2.0f*combinedArea;
+        //Minimum cost of pushing the leaf further down the tree
+        float inheritanceCost = 2.0f*(combinedArea-area);
+
+        std::array<float,2> childCost;
+        std::array<NodePtr,2> children = {{ node->left(), node->right() }};
+        for(size_t i=0; i<2; ++i)
+        {
+            float mergedArea = merge(children[i]->aabb(), aabb).surfaceArea();
+            childCost[i] = children[i]->isLeaf() ? mergedArea + inheritanceCost
+                                                 : mergedArea - children[i]->aabb().surfaceArea() + inheritanceCost;
+        }
+
+        if(cost < childCost[0] && cost < childCost[1]) break;
+        node = childCost[0] < childCost[1] ? children[0] : children[1];
+    }
+    return node;
+}
+
+void AABBTree::insertLeaf(const NodePtr& leaf)
+{
+    leaf->parent().reset();
+    if(m_root == nullptr)
+    {
+        m_root = leaf;
+        return;
+    }
+
+    NodePtr sibling = findBestSibling(leaf->aabb());
+
+    //Create a new parent for the sibling and the leaf
+    NodePtr oldParent = sibling->parent().lock();
+    NodePtr newParent = make_shared<Node>(merge(leaf->aabb(), sibling->aabb()), -1);
+    newParent->height() = sibling->height()+1;
+    newParent->left() = sibling;
+    newParent->right() = leaf;
+    newParent->parent() = oldParent;
+    sibling->parent() = newParent;
+    leaf->parent() = newParent;
+    if(oldParent != nullptr)
+    {
+        replaceChild(oldParent, sibling, newParent);
+    }
+    else
+    {
+        m_root = newParent;
+    }
+
+    refitAncestors(leaf->parent().lock());
+}
+
+void AABBTree::removeLeaf(const NodePtr& leaf)
+{
+    if(leaf == m_root)
+    {
+        m_root = nullptr;
+        return;
+    }
+
+    //The sibling of the leaf takes the place of their parent
+    NodePtr parent = leaf->parent().lock();
+    NodePtr grandParent = parent->parent().lock();
+    NodePtr sibling = parent->left() == leaf ? parent->right() : parent->left();
+    leaf->parent().reset();
+
+    if(grandParent != nullptr)
+    {
+        replaceChild(grandParent, parent, sibling);
+        sibling->parent() = grandParent;
+        refitAncestors(grandParent);
+    }
+    else
+    {
+        m_root = sibling;
+        sibling->parent().reset();
+    }
+}
+
+void AABBTree::refitAncestors(NodePtr node)
+{
+    while(node != nullptr)
+    {
+        node = balance(node);
+        node->height() = 1 + max(node->left()->height(), node->right()->height());
+        node->aabb() = merge(node->left()->aabb(), node->right()->aabb());
+        node = node->parent().lock();
+    }
+}
+
+void AABBTree::replaceChild(const NodePtr& parent, const NodePtr& oldChild, const NodePtr& newChild)
+{
+    if(parent->left() == oldChild)
+        parent->left() = newChild;
+    else
+        parent->right() = newChild;
+}
+
+NodePtr AABBTree::balance(const NodePtr& a)
+{
+    //Perform a left or right rotation if the node a is imbalanced, return the new root of the sub-tree.
+    if(a->isLeaf() || a->height()<2) return a;
+
+    NodePtr b = a->left();
+    NodePtr c = a->right();
+    int imbalance = c->height() - b->height();
+
+    //Rotate c up
+    if(imbalance > 1)
+    {
+        NodePtr f = c->left();
+        NodePtr g = c->right();
+
+        //Swap a and c
+        c->left() = a;
+        c->parent() = a->parent();
+        a->parent() = c;
+        NodePtr cParent = c->parent().lock();
+        if(cParent != nullptr)
+            replaceChild(cParent, a, c);
+        else
+            m_root = c;
+
+        //Keep the highest grandchild under c, move the other one under a
+        NodePtr high = f->height() > g->height() ? f : g;
+        NodePtr low = f->height() > g->height() ? g : f;
+        c->right() = high;
+        a->right() = low;
+        low->parent() = a;
+        a->aabb() = merge(b->aabb(), low->aabb());
+        c->aabb() = merge(a->aabb(), high->aabb());
+        a->height() = 1 + max(b->height(), low->height());
+        c->height() = 1 + max(a->height(), high->height());
+        return c;
+    }
+
+    //Rotate b up
+    if(imbalance < -1)
+    {
+        NodePtr d = b->left();
+        NodePtr e = b->right();
+
+        //Swap a and b
+        b->left() = a;
+        b->parent() = a->parent();
+        a->parent() = b;
+        NodePtr bParent = b->parent().lock();
+        if(bParent != nullptr)
+            replaceChild(bParent, a, b);
+        else
+            m_root = b;
+
+        //Keep the highest grandchild under b, move the other one under a
+        NodePtr high = d->height() > e->height() ? d : e;
+        NodePtr low = d->height() > e->height() ? e : d;
+        b->right() = high;
+        a->left() = low;
+        low->parent() = a;
+        a->aabb() = merge(c->aabb(), low->aabb());
+        b->aabb() = merge(a->aabb(), high->aabb());
+        a->height() = 1 + max(c->height(), low->height());
+        b->height() = 1 + max(a->height(), high->height());
+        return b;
+    }
+
+    return a;
 }
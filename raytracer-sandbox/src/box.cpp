@@ -1,4 +1,6 @@
 #include "./../include/raytracer-sandbox/box.hpp"
+#include <cmath>
+#include <limits>
 
 Box::Box(const glm::vec3& minBounds, const glm::vec3& maxBounds)
 {
@@ -36,6 +38,59 @@ const glm::vec3& Box::minBound() const
     return m_bounds[0];
 }
 
+glm::vec3 Box::center() const
+{
+    return 0.5f*(m_bounds[0]+m_bounds[1]);
+}
+
+glm::vec3 Box::size() const
+{
+    return m_bounds[1]-m_bounds[0];
+}
+
+float Box::surfaceArea() const
+{
+    glm::vec3 d = size();
+    if(d[0]<0 || d[1]<0 || d[2]<0) return 0.0f;
+    return 2.0f*(d[0]*d[1] + d[1]*d[2] + d[2]*d[0]);
+}
+
+int Box::largestAxis() const
+{
+    glm::vec3 d = size();
+    if(d[0]>d[1] && d[0]>d[2]) return 0;
+    return d[1]>d[2] ? 1 : 2;
+}
+
+bool Box::isFinite() const
+{
+    const float maxValue = std::numeric_limits<float>::max();
+    for(size_t i=0; i<3; ++i)
+    {
+        if(!(std::abs(m_bounds[0][i])<maxValue) || !(std::abs(m_bounds[1][i])<maxValue))
+            return false;
+    }
+    return true;
+}
+
+void Box::extend(const glm::vec3& point)
+{
+    m_bounds[0] = glm::min(m_bounds[0], point);
+    m_bounds[1] = glm::max(m_bounds[1], point);
+}
+
+void Box::extend(const Box& box)
+{
+    m_bounds[0] = glm::min(m_bounds[0], box.minBound());
+    m_bounds[1] = glm::max(m_bounds[1], box.maxBound());
+}
+
+Box Box::Empty()
+{
+    const float maxValue = std::numeric_limits<float>::max();
+    return Box(glm::vec3(maxValue,maxValue,maxValue), glm::vec3(-maxValue,-maxValue,-maxValue));
+}
+
 bool Intersect(const Ray &r, const Box& box, std::array<float,2>& t)
 {
     float tmin, tmax, tymin, tymax, tzmin, tzmax;
@@ -0,0 +1,1364 @@
+#include "./../include/raytracer-sandbox/bvh.hpp"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <numeric>
+
+using namespace std;
+
+BVHNode::~BVHNode()
+{}
+
+BVHNode::BVHNode(const Box& aabb, const int& firstPrimitive, const int& primitiveCount)
+{
+    m_aabb = aabb;
+    m_firstPrimitive = firstPrimitive;
+    m_primitiveCount = primitiveCount;
+    m_splitAxis = -1;
+    m_children = {{nullptr, nullptr}};
+}
+
+BVHNode::BVHNode(const Box& aabb, const BVHNodePtr& left, const BVHNodePtr& right, const int& splitAxis)
+{
+    m_aabb = aabb;
+    m_firstPrimitive = -1;
+    m_primitiveCount = 0;
+    m_splitAxis = splitAxis;
+    m_children = {{left, right}};
+}
+
+bool BVHNode::isLeaf() const
+{
+    return m_children[0] == nullptr;
+}
+
+const Box& BVHNode::aabb() const
+{
+    return m_aabb;
+}
+
+const int& BVHNode::firstPrimitive() const
+{
+    return m_firstPrimitive;
+}
+
+const int& BVHNode::primitiveCount() const
+{
+    return m_primitiveCount;
+}
+
+const int& BVHNode::splitAxis() const
+{
+    return m_splitAxis;
+}
+
+const BVHNodePtr& BVHNode::left() const
+{
+    return m_children[0];
+}
+
+const BVHNodePtr& BVHNode::right() const
+{
+    return m_children[1];
+}
+
+//A bin of the binned SAH: the bounds of the primitives whose centroid falls in the bin and their number
+struct BVHBin
+{
+    Box aabb = Box::Empty();
+    int count = 0;
+};
+
+//Nodes with more primitives have their bounds and bins computed by several tasks
+static const int ParallelChunkSize = 16384;
+
+//Bits of the Morton codes of the linear builder, 10 per axis
+static const int MortonBits = 30;
+
+//The width of the hierarchy collapsed for a requested one, the processor supporting the SIMD kernels of that width
+static int supportedWidth(const int& requestedWidth)
+{
+    int width = requestedWidth;
+    if(width==0) width = SupportsAVX2() ? 8 : (SupportsSSE() ? 4 : 2);
+    if(width>=8 && !SupportsAVX2()) width = 4;
+    return width>=8 ? 8 : (width>=4 ? 4 : 2);
+}
+
+//Node of the binary radix tree of the linear builder. The n-1 branches come first, then one leaf per sorted primitive.
+struct LinearBVHNode
+{
+    Box aabb = Box::Empty();
+    std::array<int,2> children = {{-1, -1}};
+    int primitiveCount = 0;
+    float cost = 0.0f; //SAH cost of the sub-tree, not divided by the area of the root
+    bool collapse = false; //The sub-tree is cheaper as a single leaf
+};
+
+static BVHNodePtr buildSpatialSplits(const vector<Box>& primitiveBoxes, const BVHBuildSettings& settings,
+                                     const BVH::PrimitiveSplitter& splitter, vector<int>& primitiveIndices);
+
+BVH::~BVH()
+{}
+
+BVH::BVH(const vector<Box>& primitiveBoxes, const BVHBuildSettings& settings, const PrimitiveSplitter& splitter)
+{
+    m_settings = settings;
+    m_settings.maxLeafSize = max(m_settings.maxLeafSize, 1);
+    m_settings.binCount = max(m_settings.binCount, 2);
+    if(m_settings.method == SPATIAL_SPLIT && splitter == nullptr) m_settings.method = BINNED_SAH;
+    if(primitiveBoxes.empty()) return;
+
+    vector<glm::vec3> centroids(primitiveBoxes.size());
+    vector<int>& primitiveIndices = m_primitiveIndices.detach();
+    primitiveIndices.resize(primitiveBoxes.size());
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for(int i=0; i<(int)primitiveBoxes.size(); ++i)
+    {
+        centroids[i] = primitiveBoxes[i].center();
+        primitiveIndices[i] = i;
+    }
+
+    BVHNodePtr root;
+    if(m_settings.method == LINEAR)
+    {
+        root = buildLinear(primitiveBoxes, centroids);
+    }
+    else if(m_settings.method == SPATIAL_SPLIT)
+    {
+        root = buildSpatialSplits(primitiveBoxes, m_settings, splitter, primitiveIndices);
+    }
+    else
+    {
+#ifdef _OPENMP
+#pragma omp parallel
+#pragma omp single
+#endif
+        root = build(primitiveBoxes, centroids, 0, primitiveBoxes.size(), 0);
+    }
+
+    //The pointer tree is released once flattened
+    flatten(root);
+    if(m_settings.method == SPATIAL_SPLIT) orderLeaves();
+
+    collapseWideNodes();
+    m_builtSahCost = sahCost();
+}
+
+BVH::BVH(const BVHBuildSettings& settings, MappedArray<BVHFlatNodes> nodes, MappedArray< vector<int> > primitiveIndices, const float& builtSahCost,
+         MappedArray< WideBVHNodes<4> > nodes4, MappedArray< WideBVHNodes<8> > nodes8)
+    : m_nodes(std::move(nodes)), m_builtSahCost(builtSahCost), m_primitiveIndices(std::move(primitiveIndices)), m_settings(settings)
+{
+    //The processor may differ from the one which built the hierarchy
+    m_settings.width = supportedWidth(m_settings.width);
+    if(m_settings.width==8 && !nodes8.empty()) m_nodes8 = std::move(nodes8);
+    else if(m_settings.width==4 && !nodes4.empty()) m_nodes4 = std::move(nodes4);
+    else collapseWideNodes();
+}
+
+bool BVH::IsValid(const BVHFlatNode* nodes, const int& nodeCount, const int* primitiveIndices, const int& primitiveIndexCount,
+                  const int& primitiveCount)
+{
+    if(nodeCount<0 || primitiveIndexCount<0) return false;
+    for(int i=0; i<primitiveIndexCount; ++i)
+    {
+        if(primitiveIndices[i]<0 || primitiveIndices[i]>=primitiveCount) return false;
+    }
+    if(nodeCount==0) return true;
+
+    //Each sub-tree, given by its root, the end of its nodes and its depth, must cover its nodes exactly
+    vector< std::array<int,3> > stack(1, {{0, nodeCount, 0}});
+    while(!stack.empty())
+    {
+        const std::array<int,3> subtree = stack.back();
+        stack.pop_back();
+        const int& index = subtree[0];
+        const int& end = subtree[1];
+        const int& depth = subtree[2];
+        const BVHFlatNode& node = nodes[index];
+        if(depth>=MaxDepth || node.primitiveCount<0) return false;
+        if(node.isLeaf())
+        {
+            if(end!=index+1 || node.offset<0 || node.offset>primitiveIndexCount-node.primitiveCount) return false;
+        }
+        else
+        {
+            if(node.offset<=index+1 || node.offset>=end) return false;
+            stack.push_back({{index+1, node.offset, depth+1}});
+            stack.push_back({{node.offset, end, depth+1}});
+        }
+    }
+
+    //The nodes being in depth-first order, so are the leaves, whose ranges must follow each other: overlapping
+    //ranges would make the leaves of a range fill the same triangle blocks
+    int nextOffset = 0;
+    for(int i=0; i<nodeCount; ++i)
+    {
+        if(!nodes[i].isLeaf()) continue;
+        if(nodes[i].offset!=nextOffset) return false;
+        nextOffset += nodes[i].primitiveCount;
+    }
+    return nextOffset==primitiveIndexCount;
+}
+
+template<int Width>
+bool BVH::IsValid(const WideBVHNode<Width>* wideNodes, const int& wideNodeCount, const BVHFlatNode* nodes, const int& nodeCount,
+                  const int& primitiveIndexCount)
+{
+    if(wideNodeCount<0 || (wideNodeCount==0)!=(nodeCount==0)) return false;
+
+    //The number of primitives of the binary leaf starting at each primitive id, 0 where none starts
+    vector<int> leafSizes(primitiveIndexCount, 0);
+    for(int i=0; i<nodeCount; ++i)
+    {
+        if(nodes[i].isLeaf()) leafSizes[nodes[i].offset] = nodes[i].primitiveCount;
+    }
+
+    //The children follow their parent, so that the depth of a node is known before it is visited
+    vector<int> depths(wideNodeCount, -1);
+    if(wideNodeCount>0) depths[0] = 0;
+    for(int i=0; i<wideNodeCount; ++i)
+    {
+        if(depths[i]<0) return false;
+        for(int c=0; c<Width; ++c)
+        {
+            const int& child = wideNodes[i].children[c];
+            const int& primitiveCount = wideNodes[i].primitiveCounts[c];
+            if(primitiveCount>0)
+            {
+                if(child<0 || child>=primitiveIndexCount || leafSizes[child]!=primitiveCount) return false;
+            }
+            else if(primitiveCount==0)
+            {
+                if(child<=i || child>=wideNodeCount || depths[child]>=0 || depths[i]+1>=MaxDepth) return false;
+                depths[child] = depths[i]+1;
+            }
+        }
+    }
+    return true;
+}
+
+template bool BVH::IsValid<4>(const WideBVHNode<4>* wideNodes, const int& wideNodeCount, const BVHFlatNode* nodes, const int& nodeCount,
+                              const int& primitiveIndexCount);
+template bool BVH::IsValid<8>(const WideBVHNode<8>* wideNodes, const int& wideNodeCount, const BVHFlatNode* nodes, const int& nodeCount,
+                              const int& primitiveIndexCount);
+
+void BVH::collapseWideNodes()
+{
+    m_settings.width = supportedWidth(m_settings.width);
+    m_nodes4 = WideBVHNodes<4>();
+    m_nodes8 = WideBVHNodes<8>();
+    if(m_nodes.empty()) return;
+    if(m_settings.width==8) collapse(m_nodes8.detach(), 0);
+    if(m_settings.width==4) collapse(m_nodes4.detach(), 0);
+}
+
+bool BVH::refit(const vector<Box>& primitiveBoxes)
+{
+    if(m_nodes.empty()) return false;
+
+    //The nodes of a restored hierarchy are copied out of their file before the sub-trees write them in parallel
+    m_nodes.detach();
+#ifdef _OPENMP
+#pragma omp parallel
+#pragma omp single
+#endif
+    refitSubtree(primitiveBoxes, 0, m_nodes.size());
+
+    //Rebuild once the hierarchy degraded too much
+    if(m_settings.rebuildThreshold>0 && sahCost() > m_settings.rebuildThreshold*m_builtSahCost)
+    {
+        BVHBuildSettings settings = m_settings;
+        if(settings.method == SPATIAL_SPLIT) settings.method = BINNED_SAH;
+        *this = BVH(primitiveBoxes, settings);
+        return true;
+    }
+
+    //The wide nodes copy the bounds of the binary ones
+    collapseWideNodes();
+    return false;
+}
+
+void BVH::refitSubtree(const vector<Box>& primitiveBoxes, const int& begin, const int& end)
+{
+    //In depth-first order, the sub-tree of a node spans [begin, end) and the one of its first child [begin+1, offset)
+    BVHFlatNodes& nodes = m_nodes.detach();
+    BVHFlatNode& node = nodes[begin];
+    if(node.isLeaf())
+    {
+        node.aabb = Box::Empty();
+        for(int i=node.offset; i<node.offset+node.primitiveCount; ++i)
+        {
+            node.aabb.extend(primitiveBoxes[m_primitiveIndices[i]]);
+        }
+        return;
+    }
+
+#ifdef _OPENMP
+#pragma omp task shared(primitiveBoxes) if(end-begin>m_settings.parallelThreshold)
+#endif
+    refitSubtree(primitiveBoxes, begin+1, node.offset);
+    refitSubtree(primitiveBoxes, node.offset, end);
+#ifdef _OPENMP
+#pragma omp taskwait
+#endif
+    node.aabb = nodes[begin+1].aabb;
+    node.aabb.extend(nodes[node.offset].aabb);
+}
+
+const float& BVH::builtSahCost() const
+{
+    return m_builtSahCost;
+}
+
+template<int Width>
+void BVH::collapseNodes(WideBVHNodes<Width>& wideNodes, std::vector< std::array<int,Width> >& binaryChildren) const
+{
+    wideNodes.clear();
+    binaryChildren.clear();
+    if(!m_nodes.empty()) collapse<Width>(wideNodes, 0, &binaryChildren);
+}
+
+template<int Width>
+int BVH::collapse(WideBVHNodes<Width>& wideNodes, const int& node, std::vector< std::array<int,Width> >* binaryChildren) const
+{
+    //Gather up to Width children by opening the branch of largest surface area
+    std::array<int,Width> children;
+    int childCount = 0;
+    if(m_nodes[node].isLeaf())
+    {
+        children[childCount++] = node;
+    }
+    else
+    {
+        children[childCount++] = node+1;
+        children[childCount++] = m_nodes[node].offset;
+        while(childCount<Width)
+        {
+            int opened = -1;
+            float largestArea = -1.0f;
+            for(int i=0; i<childCount; ++i)
+            {
+                const BVHFlatNode& child = m_nodes[children[i]];
+                if(!child.isLeaf() && child.aabb.surfaceArea()>largestArea)
+                {
+                    largestArea = child.aabb.surfaceArea();
+                    opened = i;
+                }
+            }
+            if(opened<0) break;
+            const int branch = children[opened];
+            children[opened] = branch+1;
+            children[childCount++] = m_nodes[branch].offset;
+        }
+    }
+
+    const int index = wideNodes.size();
+    wideNodes.push_back(WideBVHNode<Width>());
+    if(binaryChildren!=nullptr)
+    {
+        binaryChildren->push_back(std::array<int,Width>());
+        for(int i=0; i<Width; ++i) (*binaryChildren)[index][i] = i<childCount ? children[i] : -1;
+    }
+    for(int i=0; i<Width; ++i)
+    {
+        //Empty slots have inverted bounds
+        float minBound = numeric_limits<float>::infinity(), maxBound = -numeric_limits<float>::infinity();
+        int child = -1, primitiveCount = -1;
+        if(i<childCount)
+        {
+            const BVHFlatNode& binaryChild = m_nodes[children[i]];
+            primitiveCount = binaryChild.primitiveCount;
+            child = binaryChild.isLeaf() ? binaryChild.offset : collapse<Width>(wideNodes, children[i], binaryChildren);
+        }
+        for(int a=0; a<3; ++a)
+        {
+            wideNodes[index].bounds[0][a][i] = i<childCount ? m_nodes[children[i]].aabb.minBound()[a] : minBound;
+            wideNodes[index].bounds[1][a][i] = i<childCount ? m_nodes[children[i]].aabb.maxBound()[a] : maxBound;
+        }
+        wideNodes[index].children[i] = child;
+        wideNodes[index].primitiveCounts[i] = primitiveCount;
+    }
+    return index;
+}
+
+template void BVH::collapseNodes<4>(WideBVHNodes<4>& wideNodes, std::vector< std::array<int,4> >& binaryChildren) const;
+template void BVH::collapseNodes<8>(WideBVHNodes<8>& wideNodes, std::vector< std::array<int,8> >& binaryChildren) const;
+
+void BVH::flatten(const BVHNodePtr& node)
+{
+    BVHFlatNodes& nodes = m_nodes.detach();
+    const int index = nodes.size();
+    nodes.push_back(BVHFlatNode());
+    nodes[index].aabb = node->aabb();
+    if(node->isLeaf())
+    {
+        nodes[index].offset = node->firstPrimitive();
+        nodes[index].primitiveCount = node->primitiveCount();
+    }
+    else
+    {
+        flatten(node->left());
+        nodes[index].offset = nodes.size();
+        nodes[index].primitiveCount = 0;
+        flatten(node->right());
+    }
+}
+
+void BVH::orderLeaves()
+{
+    //The concurrent leaves of the spatial split builder fill the indices in any order: copy their ranges in
+    //depth-first order, so that the layout is deterministic and the ranges follow each other
+    BVHFlatNodes& nodes = m_nodes.detach();
+    const MappedArray< vector<int> >& primitiveIndices = m_primitiveIndices;
+    vector<int> orderedIndices;
+    orderedIndices.reserve(primitiveIndices.size());
+    for(BVHFlatNode& node : nodes)
+    {
+        if(!node.isLeaf()) continue;
+        const int offset = orderedIndices.size();
+        orderedIndices.insert(orderedIndices.end(), primitiveIndices.begin()+node.offset, primitiveIndices.begin()+node.offset+node.primitiveCount);
+        node.offset = offset;
+    }
+    m_primitiveIndices.detach().swap(orderedIndices);
+}
+
+const MappedArray<BVHFlatNodes>& BVH::nodes() const
+{
+    return m_nodes;
+}
+
+const MappedArray< WideBVHNodes<4> >& BVH::nodes4() const
+{
+    return m_nodes4;
+}
+
+const MappedArray< WideBVHNodes<8> >& BVH::nodes8() const
+{
+    return m_nodes8;
+}
+
+const BVHBuildSettings& BVH::settings() const
+{
+    return m_settings;
+}
+
+float BVH::sahCost() const
+{
+    if(m_nodes.empty()) return 0.0f;
+
+    float cost = 0.0f;
+    for(const BVHFlatNode& node : m_nodes)
+    {
+        float area = node.aabb.surfaceArea();
+        cost += node.isLeaf() ? m_settings.intersectionCost * node.primitiveCount * area : m_settings.traversalCost * area;
+    }
+    float rootArea = m_nodes[0].aabb.surfaceArea();
+    return rootArea>0 ? cost/rootArea : cost;
+}
+
+const MappedArray< vector<int> >& BVH::primitiveIndices() const
+{
+    return m_primitiveIndices;
+}
+
+bool BVH::empty() const
+{
+    return m_nodes.empty();
+}
+
+void BVH::computeBounds(const vector<Box>& primitiveBoxes, const vector<glm::vec3>& centroids, const int& begin, const int& end,
+                        Box& aabb, Box& centroidBounds) const
+{
+    int chunkCount = (end-begin+ParallelChunkSize-1)/ParallelChunkSize;
+    vector<Box> chunkBoxes(chunkCount, Box::Empty()), chunkCentroidBounds(chunkCount, Box::Empty());
+    for(int c=0; c<chunkCount; ++c)
+    {
+#ifdef _OPENMP
+#pragma omp task shared(primitiveBoxes, centroids, chunkBoxes, chunkCentroidBounds) if(chunkCount>1)
+#endif
+        {
+            int chunkEnd = min(end, begin+(c+1)*ParallelChunkSize);
+            for(int i=begin+c*ParallelChunkSize; i<chunkEnd; ++i)
+            {
+                chunkBoxes[c].extend(primitiveBoxes[m_primitiveIndices[i]]);
+                chunkCentroidBounds[c].extend(centroids[m_primitiveIndices[i]]);
+            }
+        }
+    }
+#ifdef _OPENMP
+#pragma omp taskwait
+#endif
+
+    aabb = Box::Empty();
+    centroidBounds = Box::Empty();
+    for(int c=0; c<chunkCount; ++c)
+    {
+        aabb.extend(chunkBoxes[c]);
+        centroidBounds.extend(chunkCentroidBounds[c]);
+    }
+}
+
+BVHNodePtr BVH::build(const vector<Box>& primitiveBoxes, const vector<glm::vec3>& centroids, const int& begin, const int& end, const int& depth)
+{
+    Box aabb, centroidBounds;
+    computeBounds(primitiveBoxes, centroids, begin, end, aabb, centroidBounds);
+
+    int count = end-begin;
+    //Few primitives, or the maximum depth has been reached
+    if(count<=1 || (m_settings.method == MEDIAN_SPLIT && count<=m_settings.maxLeafSize) || depth>=MaxDepth-1)
+    {
+        return make_shared<BVHNode>(aabb, begin, count);
+    }
+
+    int axis = -1;
+    int middle = m_settings.method == BINNED_SAH ? splitSAH(primitiveBoxes, centroids, aabb, centroidBounds, begin, end, axis)
+                                                 : splitMedian(centroids, centroidBounds, begin, end, axis);
+    //Splitting is either impossible or not worth it
+    if(middle<0)
+    {
+        return make_shared<BVHNode>(aabb, begin, count);
+    }
+
+    BVHNodePtr left, right;
+#ifdef _OPENMP
+#pragma omp task shared(left, primitiveBoxes, centroids) if(count>m_settings.parallelThreshold)
+#endif
+    left = build(primitiveBoxes, centroids, begin, middle, depth+1);
+    right = build(primitiveBoxes, centroids, middle, end, depth+1);
+#ifdef _OPENMP
+#pragma omp taskwait
+#endif
+    return make_shared<BVHNode>(aabb, left, right, axis);
+}
+
+int BVH::splitMedian(const vector<glm::vec3>& centroids, const Box& centroidBounds, const int& begin, const int& end, int& axis)
+{
+    //All the centroids are at the same position: nothing to split
+    axis = centroidBounds.largestAxis();
+    if(centroidBounds.size()[axis]<=0) return -1;
+
+    //Split at the median of the centroids along the largest axis
+    int middle = begin + (end-begin)/2;
+    vector<int>& primitiveIndices = m_primitiveIndices.detach();
+    nth_element(primitiveIndices.begin()+begin, primitiveIndices.begin()+middle, primitiveIndices.begin()+end,
+                [&](const int& a, const int& b){ return centroids[a][axis] < centroids[b][axis]; });
+    return middle;
+}
+
+int BVH::splitSAH(const vector<Box>& primitiveBoxes, const vector<glm::vec3>& centroids, const Box& aabb, const Box& centroidBounds,
+                  const int& begin, const int& end, int& axis)
+{
+    const int binCount = m_settings.binCount;
+    const int count = end-begin;
+    const glm::vec3 centroidMin = centroidBounds.minBound();
+    const glm::vec3 centroidSize = centroidBounds.size();
+
+    //Map a centroid to its bin along an axis
+    glm::vec3 binScale;
+    for(int a=0; a<3; ++a)
+    {
+        binScale[a] = centroidSize[a]>0 ? binCount*(1.0f-1e-6f)/centroidSize[a] : 0.0f;
+    }
+    auto binIndex = [&](const int& primitive, const int& a)
+    {
+        return min(binCount-1, (int)((centroids[primitive][a]-centroidMin[a])*binScale[a]));
+    };
+
+    //Fill the bins of the three axes, by chunks of primitives for the large nodes
+    int chunkCount = (count+ParallelChunkSize-1)/ParallelChunkSize;
+    vector< vector<BVHBin> > chunkBins(chunkCount, vector<BVHBin>(3*binCount));
+    for(int c=0; c<chunkCount; ++c)
+    {
+#ifdef _OPENMP
+#pragma omp task shared(primitiveBoxes, chunkBins, binIndex) if(chunkCount>1)
+#endif
+        {
+            vector<BVHBin>& bins = chunkBins[c];
+            int chunkEnd = min(end, begin+(c+1)*ParallelChunkSize);
+            for(int i=begin+c*ParallelChunkSize; i<chunkEnd; ++i)
+            {
+                int primitive = m_primitiveIndices[i];
+                for(int a=0; a<3; ++a)
+                {
+                    BVHBin& bin = bins[a*binCount + binIndex(primitive, a)];
+                    bin.aabb.extend(primitiveBoxes[primitive]);
+                    bin.count++;
+                }
+            }
+        }
+    }
+#ifdef _OPENMP
+#pragma omp taskwait
+#endif
+    vector<BVHBin> bins = chunkBins[0];
+    for(int c=1; c<chunkCount; ++c)
+    {
+        for(int b=0; b<3*binCount; ++b)
+        {
+            bins[b].aabb.extend(chunkBins[c][b].aabb);
+            bins[b].count += chunkBins[c][b].count;
+        }
+    }
+
+    //Sweep the bins to evaluate the cost of the binCount-1 split planes of each axis
+    float bestCost = numeric_limits<float>::max();
+    int bestAxis = -1, bestSplit = -1;
+    vector<float> leftCost(binCount);
+    for(int a=0; a<3; ++a)
+    {
+        if(centroidSize[a]<=0) continue;
+        const BVHBin* axisBins = &bins[a*binCount];
+
+        //Left to right: area * count of the primitives on the left of each plane
+        Box leftBox = Box::Empty();
+        int leftCount = 0;
+        for(int b=0; b<binCount-1; ++b)
+        {
+            leftBox.extend(axisBins[b].aabb);
+            leftCount += axisBins[b].count;
+            leftCost[b] = leftCount>0 ? leftBox.surfaceArea()*leftCount : 0.0f;
+        }
+
+        //Right to left: add the area * count of the primitives on the right
+        Box rightBox = Box::Empty();
+        int rightCount = 0;
+        for(int b=binCount-1; b>0; --b)
+        {
+            rightBox.extend(axisBins[b].aabb);
+            rightCount += axisBins[b].count;
+            int leftCountOfPlane = count-rightCount;
+            if(rightCount==0 || leftCountOfPlane==0) continue;
+            float cost = leftCost[b-1] + rightBox.surfaceArea()*rightCount;
+            if(cost<bestCost)
+            {
+                bestCost = cost;
+                bestAxis = a;
+                bestSplit = b;
+            }
+        }
+    }
+    if(bestAxis<0) return -1;
+
+    //Compare with the cost of a leaf
+    float area = aabb.surfaceArea();
+    float splitCost = m_settings.traversalCost + m_settings.intersectionCost*(area>0 ? bestCost/area : 0.0f);
+    float leafCost = m_settings.intersectionCost*count;
+    if(count<=m_settings.maxLeafSize && leafCost<=splitCost) return -1;
+
+    axis = bestAxis;
+    vector<int>& primitiveIndices = m_primitiveIndices.detach();
+    auto middle = partition(primitiveIndices.begin()+begin, primitiveIndices.begin()+end,
+                            [&](const int& primitive){ return binIndex(primitive, axis) < bestSplit; });
+    return middle - primitiveIndices.begin();
+}
+
+static int countLeadingZeros(const unsigned int& x)
+{
+#if defined(__GNUC__)
+    return x==0 ? 32 : __builtin_clz(x);
+#else
+    int count = 0;
+    for(unsigned int mask=0x80000000u; mask!=0 && (x&mask)==0; mask>>=1) ++count;
+    return count;
+#endif
+}
+
+//Index of the highest set bit
+static int bitIndex(const unsigned int& x)
+{
+    return 31-countLeadingZeros(x);
+}
+
+//Length of the common prefix of the sorted codes i and j, equal codes being told apart by their position
+static int commonPrefix(const vector<unsigned int>& codes, const int& i, const int& j)
+{
+    if(j<0 || j>=(int)codes.size()) return -1;
+    if(codes[i]==codes[j]) return 32 + countLeadingZeros((unsigned int)(i^j));
+    return countLeadingZeros(codes[i]^codes[j]);
+}
+
+//Find the range of primitives covered by the branch i of the radix tree and the position where it splits
+static void emitLinearBranch(vector<LinearBVHNode>& nodes, const vector<unsigned int>& codes, const int& i)
+{
+    const int n = codes.size();
+    const int d = commonPrefix(codes, i, i+1) >= commonPrefix(codes, i, i-1) ? 1 : -1;
+
+    //The other end of the range, searched by exponential then binary search
+    const int minPrefix = commonPrefix(codes, i, i-d);
+    int maxLength = 2;
+    while(commonPrefix(codes, i, i+maxLength*d) > minPrefix) maxLength *= 2;
+    int length = 0;
+    for(int t=maxLength/2; t>=1; t/=2)
+    {
+        if(commonPrefix(codes, i, i+(length+t)*d) > minPrefix) length += t;
+    }
+    const int j = i + length*d;
+
+    //The split is where the prefix of the range ends
+    const int nodePrefix = commonPrefix(codes, i, j);
+    int split = 0;
+    int t = length;
+    do
+    {
+        t = (t+1)/2;
+        if(commonPrefix(codes, i, i+(split+t)*d) > nodePrefix) split += t;
+    }
+    while(t>1);
+    const int gamma = i + split*d + min(d, 0);
+
+    LinearBVHNode& node = nodes[i];
+    node.children[0] = min(i, j)==gamma ? n-1+gamma : gamma;
+    node.children[1] = max(i, j)==gamma+1 ? n-1+gamma+1 : gamma+1;
+    node.primitiveCount = length+1;
+}
+
+//Update the bounds, the cost and the collapse flag of a branch from its children
+static void updateLinearBranch(vector<LinearBVHNode>& nodes, const int& index, const BVHBuildSettings& settings)
+{
+    LinearBVHNode& node = nodes[index];
+    const LinearBVHNode& left = nodes[node.children[0]];
+    const LinearBVHNode& right = nodes[node.children[1]];
+    node.aabb = left.aabb;
+    node.aabb.extend(right.aabb);
+    node.primitiveCount = left.primitiveCount + right.primitiveCount;
+
+    float area = node.aabb.surfaceArea();
+    float splitCost = settings.traversalCost*area + left.cost + right.cost;
+    float leafCost = settings.intersectionCost*node.primitiveCount*area;
+    node.collapse = node.primitiveCount<=settings.maxLeafSize && leafCost<=splitCost;
+    node.cost = node.collapse ? leafCost : splitCost;
+}
+
+static void updateLinearSubtree(vector<LinearBVHNode>& nodes, const int& index, const BVHBuildSettings& settings)
+{
+    const LinearBVHNode& node = nodes[index];
+    if(node.children[0]<0) return;
+
+#ifdef _OPENMP
+#pragma omp task shared(nodes, settings) if(node.primitiveCount>settings.parallelThreshold)
+#endif
+    updateLinearSubtree(nodes, node.children[0], settings);
+    updateLinearSubtree(nodes, node.children[1], settings);
+#ifdef _OPENMP
+#pragma omp taskwait
+#endif
+    updateLinearBranch(nodes, index, settings);
+}
+
+//Give the subset s of the treelet leaves the topology found by the dynamic programming, reusing the branches of the treelet
+static int rebuildTreelet(vector<LinearBVHNode>& nodes, const vector<int>& leaves, const vector<int>& branches, const vector<int>& partitions,
+                          const int& s, int& nextBranch, const BVHBuildSettings& settings)
+{
+    if((s & (s-1)) == 0) return leaves[bitIndex(s)];
+
+    int index = branches[nextBranch++];
+    int left = rebuildTreelet(nodes, leaves, branches, partitions, partitions[s], nextBranch, settings);
+    int right = rebuildTreelet(nodes, leaves, branches, partitions, s ^ partitions[s], nextBranch, settings);
+    nodes[index].children = {{left, right}};
+    updateLinearBranch(nodes, index, settings);
+    return index;
+}
+
+//Find the topology of the treelet rooted at a branch that minimizes the SAH
+static void restructureTreelet(vector<LinearBVHNode>& nodes, const int& root, const BVHBuildSettings& settings)
+{
+    //Grow the treelet by expanding its leaf of largest surface area
+    vector<int> leaves(nodes[root].children.begin(), nodes[root].children.end());
+    vector<int> branches(1, root);
+    while((int)leaves.size() < settings.treeletSize)
+    {
+        int expanded = -1;
+        float largestArea = -1.0f;
+        for(size_t k=0; k<leaves.size(); ++k)
+        {
+            const LinearBVHNode& leaf = nodes[leaves[k]];
+            if(leaf.children[0]>=0 && leaf.aabb.surfaceArea()>largestArea)
+            {
+                largestArea = leaf.aabb.surfaceArea();
+                expanded = k;
+            }
+        }
+        if(expanded<0) break;
+        int branch = leaves[expanded];
+        branches.push_back(branch);
+        leaves[expanded] = nodes[branch].children[0];
+        leaves.push_back(nodes[branch].children[1]);
+    }
+    if(leaves.size()<3) return;
+
+    //Bounds and primitive count of every subset of the treelet leaves
+    const int subsetCount = 1 << leaves.size();
+    vector<Box> boxes(subsetCount, Box::Empty());
+    vector<int> counts(subsetCount, 0);
+    for(int s=1; s<subsetCount; ++s)
+    {
+        int lowest = s & (-s);
+        const LinearBVHNode& leaf = nodes[leaves[bitIndex(lowest)]];
+        boxes[s] = boxes[s ^ lowest];
+        boxes[s].extend(leaf.aabb);
+        counts[s] = counts[s ^ lowest] + leaf.primitiveCount;
+    }
+
+    //Optimal cost of every subset, the subsets of a set being smaller numbers than the set
+    vector<float> costs(subsetCount, 0.0f);
+    vector<int> partitions(subsetCount, 0);
+    for(int s=1; s<subsetCount; ++s)
+    {
+        int lowest = s & (-s);
+        if(s == lowest)
+        {
+            costs[s] = nodes[leaves[bitIndex(s)]].cost;
+            continue;
+        }
+
+        //Enumerate the partitions once by keeping the lowest leaf on the left
+        float bestCost = numeric_limits<float>::max();
+        int rest = s ^ lowest;
+        for(int q=(rest-1)&rest; ; q=(q-1)&rest)
+        {
+            int p = lowest | q;
+            float cost = costs[p] + costs[s ^ p];
+            if(cost<bestCost)
+            {
+                bestCost = cost;
+                partitions[s] = p;
+            }
+            if(q==0) break;
+        }
+
+        float area = boxes[s].surfaceArea();
+        costs[s] = settings.traversalCost*area + bestCost;
+        if(counts[s]<=settings.maxLeafSize)
+        {
+            costs[s] = min(costs[s], settings.intersectionCost*counts[s]*area);
+        }
+    }
+
+    const int treelet = subsetCount-1;
+    if(costs[treelet] >= nodes[root].cost) return;
+    int nextBranch = 0;
+    rebuildTreelet(nodes, leaves, branches, partitions, treelet, nextBranch, settings);
+}
+
+static void restructureTreelets(vector<LinearBVHNode>& nodes, const int& index, const BVHBuildSettings& settings)
+{
+    const LinearBVHNode& node = nodes[index];
+    if(node.children[0]<0 || node.collapse) return;
+
+    //Bottom-up, so that each treelet is formed from already optimized sub-trees
+#ifdef _OPENMP
+#pragma omp task shared(nodes, settings) if(node.primitiveCount>settings.parallelThreshold)
+#endif
+    restructureTreelets(nodes, node.children[0], settings);
+    restructureTreelets(nodes, node.children[1], settings);
+#ifdef _OPENMP
+#pragma omp taskwait
+#endif
+    restructureTreelet(nodes, index, settings);
+}
+
+//Convert a sub-tree of the radix tree to BVHNode, writing the primitives of its leaves from offset in primitiveIndices
+static BVHNodePtr convertLinearSubtree(const vector<LinearBVHNode>& nodes, const int& index, const vector<int>& sortedPrimitives,
+                                       vector<int>& primitiveIndices, const int& offset, const int& depth, const BVHBuildSettings& settings)
+{
+    const LinearBVHNode& node = nodes[index];
+    if(node.collapse || node.children[0]<0 || depth>=BVH::MaxDepth-1)
+    {
+        const int firstLeaf = sortedPrimitives.size()-1;
+        int k = offset;
+        vector<int> stack(1, index);
+        while(!stack.empty())
+        {
+            int i = stack.back();
+            stack.pop_back();
+            if(nodes[i].children[0]<0)
+            {
+                primitiveIndices[k++] = sortedPrimitives[i-firstLeaf];
+            }
+            else
+            {
+                stack.push_back(nodes[i].children[1]);
+                stack.push_back(nodes[i].children[0]);
+            }
+        }
+        return make_shared<BVHNode>(node.aabb, offset, node.primitiveCount);
+    }
+
+    BVHNodePtr left, right;
+#ifdef _OPENMP
+#pragma omp task shared(left, nodes, sortedPrimitives, primitiveIndices, settings) if(node.primitiveCount>settings.parallelThreshold)
+#endif
+    left = convertLinearSubtree(nodes, node.children[0], sortedPrimitives, primitiveIndices, offset, depth+1, settings);
+    right = convertLinearSubtree(nodes, node.children[1], sortedPrimitives, primitiveIndices, offset+nodes[node.children[0]].primitiveCount, depth+1, settings);
+#ifdef _OPENMP
+#pragma omp taskwait
+#endif
+
+    //The axis along which the children are the most apart
+    glm::vec3 offsetBetweenChildren = glm::abs(nodes[node.children[1]].aabb.center()-nodes[node.children[0]].aabb.center());
+    int axis = 0;
+    for(int a=1; a<3; ++a)
+    {
+        if(offsetBetweenChildren[a]>offsetBetweenChildren[axis]) axis = a;
+    }
+    return make_shared<BVHNode>(node.aabb, left, right, axis);
+}
+
+BVHNodePtr BVH::buildLinear(const vector<Box>& primitiveBoxes, const vector<glm::vec3>& centroids)
+{
+    const int n = primitiveBoxes.size();
+    Box aabb, centroidBounds;
+#ifdef _OPENMP
+#pragma omp parallel
+#pragma omp single
+#endif
+    computeBounds(primitiveBoxes, centroids, 0, n, aabb, centroidBounds);
+
+    //Morton codes of the centroids normalized in their bounds, sorted along with the primitive ids
+    const glm::vec3 centroidMin = centroidBounds.minBound();
+    const glm::vec3 centroidSize = centroidBounds.size();
+    vector<unsigned int> codes(n);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for(int i=0; i<n; ++i)
+    {
+        glm::vec3 p;
+        for(int a=0; a<3; ++a)
+        {
+            p[a] = centroidSize[a]>0 ? (centroids[i][a]-centroidMin[a])/centroidSize[a] : 0.0f;
+        }
+        codes[i] = MortonCode(p);
+    }
+    vector<int> sortedPrimitives = m_primitiveIndices.detach();
+    RadixSort(codes, sortedPrimitives, MortonBits);
+
+    //Emit the leaves and the branches of the radix tree, all independently of each other
+    vector<LinearBVHNode> nodes(2*n-1);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for(int k=0; k<n; ++k)
+    {
+        LinearBVHNode& leaf = nodes[n-1+k];
+        leaf.aabb = primitiveBoxes[sortedPrimitives[k]];
+        leaf.primitiveCount = 1;
+        leaf.cost = m_settings.intersectionCost*leaf.aabb.surfaceArea();
+        leaf.collapse = true;
+    }
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for(int i=0; i<n-1; ++i)
+    {
+        emitLinearBranch(nodes, codes, i);
+    }
+
+    const int treeletSize = min(m_settings.treeletSize, 8);
+    BVHNodePtr root;
+#ifdef _OPENMP
+#pragma omp parallel
+#pragma omp single
+#endif
+    {
+        updateLinearSubtree(nodes, 0, m_settings);
+        if(treeletSize>=3)
+        {
+            BVHBuildSettings treeletSettings = m_settings;
+            treeletSettings.treeletSize = treeletSize;
+            restructureTreelets(nodes, 0, treeletSettings);
+        }
+        root = convertLinearSubtree(nodes, 0, sortedPrimitives, m_primitiveIndices.detach(), 0, 0, m_settings);
+    }
+    return root;
+}
+
+//A reference to a primitive, whose box is clipped by the spatial splits
+struct BVHReference
+{
+    Box aabb;
+    int primitive;
+};
+
+//Top-down builder choosing between object and spatial splits at each node
+class SpatialSplitBuilder
+{
+public:
+    SpatialSplitBuilder(const BVHBuildSettings& settings, const BVH::PrimitiveSplitter& splitter, vector<int>& primitiveIndices,
+                        const int& budget, const float& rootArea)
+        : m_settings(settings), m_splitter(splitter), m_primitiveIndices(primitiveIndices), m_budget(budget), m_rootArea(rootArea)
+    {}
+
+    BVHNodePtr build(vector<BVHReference>& references, const int& depth);
+
+private:
+    struct Split
+    {
+        float cost = numeric_limits<float>::max(); //Sum of the area * count of the children
+        int axis = -1;
+        int bin = -1; //Object splits: the first bin on the right
+        float position = 0.0f; //Spatial splits: the position of the plane
+        Box left = Box::Empty();
+        Box right = Box::Empty();
+    };
+
+    const BVHBuildSettings& m_settings;
+    const BVH::PrimitiveSplitter& m_splitter;
+    vector<int>& m_primitiveIndices;
+    std::atomic<int> m_budget; //The number of references that can still be duplicated
+    float m_rootArea;
+
+    BVHNodePtr makeLeaf(const vector<BVHReference>& references, const Box& aabb);
+    Split findObjectSplit(const vector<BVHReference>& references, const Box& centroidBounds) const;
+    Split findSpatialSplit(const vector<BVHReference>& references, const Box& aabb) const;
+    void partitionObjects(const vector<BVHReference>& references, const Box& centroidBounds, const Split& split,
+                          vector<BVHReference>& left, vector<BVHReference>& right) const;
+    bool partitionSpatially(const vector<BVHReference>& references, const Split& split, vector<BVHReference>& left, vector<BVHReference>& right);
+    void splitReference(const BVHReference& reference, const int& axis, const float& position, BVHReference& left, BVHReference& right) const;
+};
+
+static Box intersection(const Box& a, const Box& b)
+{
+    return Box(glm::max(a.minBound(), b.minBound()), glm::min(a.maxBound(), b.maxBound()));
+}
+
+//A clipped box is empty when its minimum exceeds its maximum on an axis
+static bool isEmpty(const Box& box)
+{
+    for(int a=0; a<3; ++a)
+    {
+        if(box.minBound()[a]>box.maxBound()[a]) return true;
+    }
+    return false;
+}
+
+static Box merge(const Box& a, const Box& b)
+{
+    Box box = a;
+    box.extend(b);
+    return box;
+}
+
+//Index of the bin of the centroid of a box, binScale being 0 on the axes where all the centroids are equal
+static int centroidBin(const Box& aabb, const int& axis, const glm::vec3& centroidMin, const glm::vec3& binScale, const int& binCount)
+{
+    return min(binCount-1, (int)((aabb.center()[axis]-centroidMin[axis])*binScale[axis]));
+}
+
+BVHNodePtr SpatialSplitBuilder::build(vector<BVHReference>& references, const int& depth)
+{
+    Box aabb = Box::Empty(), centroidBounds = Box::Empty();
+    for(const BVHReference& reference : references)
+    {
+        aabb.extend(reference.aabb);
+        centroidBounds.extend(reference.aabb.center());
+    }
+
+    const int count = references.size();
+    if(count<=1 || depth>=BVH::MaxDepth-1) return makeLeaf(references, aabb);
+
+    //Spatial splits only pay off when the children of the best object split overlap
+    Split objectSplit = findObjectSplit(references, centroidBounds);
+    Split spatialSplit;
+    if(m_budget>0 && (objectSplit.axis<0 || intersection(objectSplit.left, objectSplit.right).surfaceArea() > m_settings.spatialSplitOverlap*m_rootArea))
+    {
+        spatialSplit = findSpatialSplit(references, aabb);
+    }
+
+    const float area = aabb.surfaceArea();
+    const float bestCost = min(objectSplit.cost, spatialSplit.cost);
+    if(objectSplit.axis<0 && spatialSplit.axis<0) return makeLeaf(references, aabb);
+    float splitCost = m_settings.traversalCost + m_settings.intersectionCost*(area>0 ? bestCost/area : 0.0f);
+    float leafCost = m_settings.intersectionCost*count;
+    if(count<=m_settings.maxLeafSize && leafCost<=splitCost) return makeLeaf(references, aabb);
+
+    vector<BVHReference> left, right;
+    int axis = objectSplit.axis;
+    bool split = false;
+    if(spatialSplit.cost<objectSplit.cost)
+    {
+        split = partitionSpatially(references, spatialSplit, left, right);
+        axis = spatialSplit.axis;
+    }
+    if(!split)
+    {
+        if(objectSplit.axis<0) return makeLeaf(references, aabb);
+        partitionObjects(references, centroidBounds, objectSplit, left, right);
+        axis = objectSplit.axis;
+    }
+    vector<BVHReference>().swap(references);
+
+    BVHNodePtr leftNode, rightNode;
+#ifdef _OPENMP
+#pragma omp task shared(leftNode, left) if(count>m_settings.parallelThreshold)
+#endif
+    leftNode = build(left, depth+1);
+    rightNode = build(right, depth+1);
+#ifdef _OPENMP
+#pragma omp taskwait
+#endif
+    return make_shared<BVHNode>(aabb, leftNode, rightNode, axis);
+}
+
+BVHNodePtr SpatialSplitBuilder::makeLeaf(const vector<BVHReference>& references, const Box& aabb)
+{
+    //Leaves are built concurrently and append their primitives at the end of the indices
+    int offset = 0;
+#ifdef _OPENMP
+#pragma omp critical(SpatialSplitBuilderLeaves)
+#endif
+    {
+        offset = m_primitiveIndices.size();
+        for(const BVHReference& reference : references) m_primitiveIndices.push_back(reference.primitive);
+    }
+    return make_shared<BVHNode>(aabb, offset, references.size());
+}
+
+SpatialSplitBuilder::Split SpatialSplitBuilder::findObjectSplit(const vector<BVHReference>& references, const Box& centroidBounds) const
+{
+    const int binCount = m_settings.binCount;
+    const glm::vec3 centroidMin = centroidBounds.minBound();
+    const glm::vec3 centroidSize = centroidBounds.size();
+    Split best;
+    for(int a=0; a<3; ++a)
+    {
+        if(centroidSize[a]<=0) continue;
+        glm::vec3 binScale(0.0f);
+        binScale[a] = binCount*(1.0f-1e-6f)/centroidSize[a];
+
+        vector<Box> binBoxes(binCount, Box::Empty());
+        vector<int> binCounts(binCount, 0);
+        for(const BVHReference& reference : references)
+        {
+            int bin = centroidBin(reference.aabb, a, centroidMin, binScale, binCount);
+            binBoxes[bin].extend(reference.aabb);
+            binCounts[bin]++;
+        }
+
+        //Left to right, then right to left to evaluate each plane
+        vector<Box> leftBoxes(binCount, Box::Empty());
+        vector<int> leftCounts(binCount, 0);
+        Box leftBox = Box::Empty();
+        int leftCount = 0;
+        for(int b=0; b<binCount; ++b)
+        {
+            leftBox.extend(binBoxes[b]);
+            leftCount += binCounts[b];
+            leftBoxes[b] = leftBox;
+            leftCounts[b] = leftCount;
+        }
+        Box rightBox = Box::Empty();
+        int rightCount = 0;
+        for(int b=binCount-1; b>0; --b)
+        {
+            rightBox.extend(binBoxes[b]);
+            rightCount += binCounts[b];
+            if(rightCount==0 || leftCounts[b-1]==0) continue;
+            float cost = leftBoxes[b-1].surfaceArea()*leftCounts[b-1] + rightBox.surfaceArea()*rightCount;
+            if(cost<best.cost)
+            {
+                best.cost = cost;
+                best.axis = a;
+                best.bin = b;
+                best.left = leftBoxes[b-1];
+                best.right = rightBox;
+            }
+        }
+    }
+    return best;
+}
+
+SpatialSplitBuilder::Split SpatialSplitBuilder::findSpatialSplit(const vector<BVHReference>& references, const Box& aabb) const
+{
+    const int binCount = m_settings.binCount;
+    const int count = references.size();
+    Split best;
+    for(int a=0; a<3; ++a)
+    {
+        const float origin = aabb.minBound()[a];
+        const float binWidth = aabb.size()[a]/binCount;
+        if(binWidth<=0) continue;
+
+        //Chop each reference into the bins it overlaps, counting where it enters and exits
+        vector<Box> binBoxes(binCount, Box::Empty());
+        vector<int> entries(binCount, 0), exits(binCount, 0);
+        for(const BVHReference& reference : references)
+        {
+            int firstBin = min(binCount-1, max(0, (int)((reference.aabb.minBound()[a]-origin)/binWidth)));
+            int lastBin = min(binCount-1, max(firstBin, (int)((reference.aabb.maxBound()[a]-origin)/binWidth)));
+            BVHReference remaining = reference;
+            for(int b=firstBin; b<lastBin; ++b)
+            {
+                BVHReference left, right;
+                splitReference(remaining, a, origin+(b+1)*binWidth, left, right);
+                if(!isEmpty(left.aabb)) binBoxes[b].extend(left.aabb);
+                remaining = right;
+                if(isEmpty(remaining.aabb)) break;
+            }
+            if(!isEmpty(remaining.aabb)) binBoxes[lastBin].extend(remaining.aabb);
+            entries[firstBin]++;
+            exits[lastBin]++;
+        }
+
+        vector<Box> leftBoxes(binCount, Box::Empty());
+        vector<int> leftCounts(binCount, 0);
+        Box leftBox = Box::Empty();
+        int leftCount = 0;
+        for(int b=0; b<binCount; ++b)
+        {
+            leftBox.extend(binBoxes[b]);
+            leftCount += entries[b];
+            leftBoxes[b] = leftBox;
+            leftCounts[b] = leftCount;
+        }
+        Box rightBox = Box::Empty();
+        int rightCount = 0;
+        for(int b=binCount-1; b>0; --b)
+        {
+            rightBox.extend(binBoxes[b]);
+            rightCount += exits[b];
+            //Skip the planes leaving a side empty or duplicating more references than the budget allows
+            if(rightCount==0 || leftCounts[b-1]==0 || leftCounts[b-1]+rightCount-count>m_budget) continue;
+            float cost = leftBoxes[b-1].surfaceArea()*leftCounts[b-1] + rightBox.surfaceArea()*rightCount;
+            if(cost<best.cost)
+            {
+                best.cost = cost;
+                best.axis = a;
+                best.position = origin+b*binWidth;
+                best.left = leftBoxes[b-1];
+                best.right = rightBox;
+            }
+        }
+    }
+    return best;
+}
+
+void SpatialSplitBuilder::partitionObjects(const vector<BVHReference>& references, const Box& centroidBounds, const Split& split,
+                                           vector<BVHReference>& left, vector<BVHReference>& right) const
+{
+    glm::vec3 binScale(0.0f);
+    binScale[split.axis] = m_settings.binCount*(1.0f-1e-6f)/centroidBounds.size()[split.axis];
+    for(const BVHReference& reference : references)
+    {
+        if(centroidBin(reference.aabb, split.axis, centroidBounds.minBound(), binScale, m_settings.binCount) < split.bin)
+            left.push_back(reference);
+        else
+            right.push_back(reference);
+    }
+}
+
+bool SpatialSplitBuilder::partitionSpatially(const vector<BVHReference>& references, const Split& split,
+                                             vector<BVHReference>& left, vector<BVHReference>& right)
+{
+    const int& axis = split.axis;
+    const float& position = split.position;
+
+    //References entirely on one side of the plane
+    vector<BVHReference> straddling;
+    Box leftBox = Box::Empty(), rightBox = Box::Empty();
+    for(const BVHReference& reference : references)
+    {
+        if(reference.aabb.maxBound()[axis]<=position)
+        {
+            left.push_back(reference);
+            leftBox.extend(reference.aabb);
+        }
+        else if(reference.aabb.minBound()[axis]>=position)
+        {
+            right.push_back(reference);
+            rightBox.extend(reference.aabb);
+        }
+        else
+        {
+            straddling.push_back(reference);
+        }
+    }
+
+    //Split the straddling references unless moving them entirely to one side is cheaper
+    int duplicated = 0;
+    for(const BVHReference& reference : straddling)
+    {
+        BVHReference leftPart, rightPart;
+        splitReference(reference, axis, position, leftPart, rightPart);
+        const float leftCount = left.size(), rightCount = right.size();
+        const float splitCost = merge(leftBox, leftPart.aabb).surfaceArea()*(leftCount+1) + merge(rightBox, rightPart.aabb).surfaceArea()*(rightCount+1);
+        const float leftCost = merge(leftBox, reference.aabb).surfaceArea()*(leftCount+1) + rightBox.surfaceArea()*rightCount;
+        const float rightCost = leftBox.surfaceArea()*leftCount + merge(rightBox, reference.aabb).surfaceArea()*(rightCount+1);
+
+        bool duplicate = splitCost<min(leftCost, rightCost) && !isEmpty(leftPart.aabb) && !isEmpty(rightPart.aabb);
+        if(duplicate && m_budget.fetch_sub(1)<=0)
+        {
+            m_budget++;
+            duplicate = false;
+        }
+
+        if(duplicate)
+        {
+            left.push_back(leftPart);
+            leftBox.extend(leftPart.aabb);
+            right.push_back(rightPart);
+            rightBox.extend(rightPart.aabb);
+            ++duplicated;
+        }
+        else if(leftCost<=rightCost)
+        {
+            left.push_back(reference);
+            leftBox.extend(reference.aabb);
+        }
+        else
+        {
+            right.push_back(reference);
+            rightBox.extend(reference.aabb);
+        }
+    }
+
+    //Give the budget back when the split turns out to be degenerate
+    if(left.empty() || right.empty())
+    {
+        m_budget += duplicated;
+        left.clear();
+        right.clear();
+        return false;
+    }
+    return true;
+}
+
+void SpatialSplitBuilder::splitReference(const BVHReference& reference, const int& axis, const float& position,
+                                         BVHReference& left, BVHReference& right) const
+{
+    Box leftPrimitive, rightPrimitive;
+    m_splitter(reference.primitive, axis, position, leftPrimitive, rightPrimitive);
+
+    //The parts of the primitive are also clipped by the box of the reference
+    left.primitive = right.primitive = reference.primitive;
+    left.aabb = intersection(leftPrimitive, reference.aabb);
+    left.aabb.maxBound()[axis] = min(left.aabb.maxBound()[axis], position);
+    right.aabb = intersection(rightPrimitive, reference.aabb);
+    right.aabb.minBound()[axis] = max(right.aabb.minBound()[axis], position);
+}
+
+static BVHNodePtr buildSpatialSplits(const vector<Box>& primitiveBoxes, const BVHBuildSettings& settings,
+                                     const BVH::PrimitiveSplitter& splitter, vector<int>& primitiveIndices)
+{
+    vector<BVHReference> references(primitiveBoxes.size());
+    Box aabb = Box::Empty();
+    for(size_t i=0; i<primitiveBoxes.size(); ++i)
+    {
+        references[i].aabb = primitiveBoxes[i];
+        references[i].primitive = i;
+        aabb.extend(primitiveBoxes[i]);
+    }
+
+    primitiveIndices.clear();
+    const int budget = settings.spatialSplitBudget*primitiveBoxes.size();
+    SpatialSplitBuilder builder(settings, splitter, primitiveIndices, budget, aabb.surfaceArea());
+    BVHNodePtr root;
+#ifdef _OPENMP
+#pragma omp parallel
+#pragma omp single
+#endif
+    root = builder.build(references, 0);
+    return root;
+}
@@ -0,0 +1,117 @@
+#include "./../include/raytracer-sandbox/cache.hpp"
+#include "./../include/raytracer-sandbox/alignedallocator.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define RAYTRACER_SANDBOX_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+using namespace std;
+
+#ifndef RAYTRACER_SANDBOX_MMAP
+//The arrays read in place from a file need the alignment of a cache line, which a mapping gets from the page size
+typedef AlignedAllocator<char,64> MappedFileAllocator;
+#endif
+
+MappedFile::MappedFile(const string& filename)
+{
+#ifdef RAYTRACER_SANDBOX_MMAP
+    int file = open(filename.c_str(), O_RDONLY);
+    if(file<0) return;
+    struct stat status;
+    if(fstat(file, &status)==0 && status.st_size>0)
+    {
+        void* data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if(data!=MAP_FAILED)
+        {
+            m_data = static_cast<const char*>(data);
+            m_size = status.st_size;
+            m_mapped = true;
+        }
+    }
+    //The mapping stays valid once the file is closed
+    close(file);
+#else
+    ifstream file(filename.c_str(), ios::binary | ios::ate);
+    if(!file) return;
+    streamoff size = file.tellg();
+    if(size<=0) return;
+    char* data = MappedFileAllocator().allocate(size);
+    file.seekg(0);
+    if(!file.read(data, size))
+    {
+        MappedFileAllocator().deallocate(data, size);
+        return;
+    }
+    m_data = data;
+    m_size = size;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    if(m_data==nullptr) return;
+#ifdef RAYTRACER_SANDBOX_MMAP
+    if(m_mapped) munmap(const_cast<char*>(m_data), m_size);
+#else
+    MappedFileAllocator().deallocate(const_cast<char*>(m_data), m_size);
+#endif
+}
+
+bool MappedFile::isOpen() const
+{
+    return m_data!=nullptr;
+}
+
+const char* MappedFile::data() const
+{
+    return m_data;
+}
+
+const size_t& MappedFile::size() const
+{
+    return m_size;
+}
+
+uint64_t HashBytes(const void* data, const size_t& size, const uint64_t& seed)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+    for(size_t i=0; i<size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t HashWords(const void* data, const size_t& size, const uint64_t& seed)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+    size_t i = 0;
+    for(; i+8<=size; i+=8)
+    {
+        //The words are read as little endian whatever the processor, which compilers turn into a single load on x86
+        uint64_t word = 0;
+        for(int b=0; b<8; ++b) word |= (uint64_t)bytes[i+b]<<(8*b);
+        hash ^= word;
+        hash *= 1099511628211ull;
+        //A product only carries the changes of a word to the higher bits, which are folded back into the lower ones
+        hash ^= hash>>29;
+    }
+    return HashBytes(bytes+i, size-i, hash);
+}
+
+bool HashFile(const string& filename, uint64_t& hash)
+{
+    MappedFile file(filename);
+    if(!file.isOpen()) return false;
+    hash = HashWords(file.data(), file.size());
+    return true;
+}
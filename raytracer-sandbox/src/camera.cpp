@@ -100,6 +100,21 @@ Ray Camera::computeRayThroughPixel(const float &x, const float &y)
     return Ray( origin, glm::normalize(direction) );
 }
 
+RayPacket Camera::computeRayPacket(const float &x, const float &y, const int &packetWidth)
+{
+    std::array<Ray, RayPacket::MaxSize> rays;
+    const glm::vec3 origin = computePosition();
+    for(int j=0; j<packetWidth; ++j)
+    {
+        for(int i=0; i<packetWidth; ++i)
+        {
+            glm::vec3 pixelWorld = pixelToWorld(x+i, y+j);
+            rays[i+j*packetWidth] = Ray( origin, glm::normalize(pixelWorld-origin) );
+        }
+    }
+    return RayPacket(rays.data(), packetWidth*packetWidth);
+}
+
 ostream& operator << ( ostream& out, const Camera& camera )
 {
     out << "FOV : " << camera.fov() << endl;
@@ -1,4 +1,5 @@
 #include "./../include/raytracer-sandbox/directionalLight.hpp"
+#include <limits>
 
 using namespace std;
 
@@ -78,3 +79,8 @@ glm::vec3 DirectionalLight::lightDirectionFrom(const glm::vec3 &/*position*/) co
 {
     return m_direction;
 }
+
+float DirectionalLight::distanceFrom(const glm::vec3 &/*position*/) const
+{
+    return numeric_limits<float>::max();
+}
@@ -2,7 +2,7 @@
 
 using namespace std;
 
-const vector<glm::vec3>& ExtentSettings::planeSetNormals()
+const vector<glm::vec3>& ExtentSettings::planeSetNormals() const
 {
     return m_planeSetNormals;
 }
@@ -19,6 +19,26 @@ ExtentSettingsPtr ExtentSettings::AABB_Settings()
     return settings;
 }
 
+ExtentSettingsPtr ExtentSettings::KDOP7_Settings()
+{
+    vector<glm::vec3> normals = { glm::vec3(1,0,0), glm::vec3(0,1,0), glm::vec3(0,0,1),
+                                  glm::normalize(glm::vec3(1,1,1)), glm::normalize(glm::vec3(-1,1,1)),
+                                  glm::normalize(glm::vec3(-1,-1,1)), glm::normalize(glm::vec3(1,-1,1)) };
+    return make_shared<ExtentSettings>(normals);
+}
+
+ExtentSettingsPtr ExtentSettings::KDOP13_Settings()
+{
+    vector<glm::vec3> normals = KDOP7_Settings()->planeSetNormals();
+    normals.push_back(glm::normalize(glm::vec3(1,1,0)));
+    normals.push_back(glm::normalize(glm::vec3(1,-1,0)));
+    normals.push_back(glm::normalize(glm::vec3(1,0,1)));
+    normals.push_back(glm::normalize(glm::vec3(1,0,-1)));
+    normals.push_back(glm::normalize(glm::vec3(0,1,1)));
+    normals.push_back(glm::normalize(glm::vec3(0,1,-1)));
+    return make_shared<ExtentSettings>(normals);
+}
+
 Extent::Extent( std::array<glm::vec3,2>& bounds )
 {
     std::vector<glm::vec3> points = {{ bounds[0], bounds[1] }};
@@ -84,17 +104,17 @@ void Extent::computeBounds( const vector<glm::vec3>& points )
     m_bounds = bounds;
 }
 
-const ExtentSettingsPtr& Extent::settings()
+const ExtentSettingsPtr& Extent::settings() const
 {
     return m_settings;
 }
 
-const vector< array<float, 2> > &Extent::slabOffsets()
+const vector< array<float, 2> > &Extent::slabOffsets() const
 {
     return m_slabOffsets;
 }
 
-const std::array<glm::vec3,2>& Extent::bounds()
+const std::array<glm::vec3,2>& Extent::bounds() const
 {
     return m_bounds;
 }
@@ -0,0 +1,272 @@
+#include "./../include/raytracer-sandbox/extentbvh.hpp"
+#include <algorithm>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RAYTRACER_SANDBOX_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+#ifdef RAYTRACER_SANDBOX_X86
+
+bool IntersectSlabs(const float* slabs, const ExtentRay& r, const int& lanes, const float& tMax, float& tEntry)
+{
+    __m128 tNear = _mm_setzero_ps();
+    __m128 tFar = _mm_set1_ps(tMax);
+    for(int l=0; l<lanes; l+=4)
+    {
+        const __m128 origin = _mm_load_ps(&r.origins[l]);
+        const __m128 invDirection = _mm_load_ps(&r.invDirections[l]);
+        const __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(slabs+l), origin), invDirection);
+        const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(slabs+lanes+l), origin), invDirection);
+        //The second operand is returned when the first one is NaN, which ignores a slab where 0*inf occured
+        tNear = _mm_max_ps(_mm_min_ps(t0, t1), tNear);
+        tFar = _mm_min_ps(_mm_max_ps(t0, t1), tFar);
+    }
+    //Reduce the 4 lanes
+    tNear = _mm_max_ps(tNear, _mm_shuffle_ps(tNear, tNear, _MM_SHUFFLE(2,3,0,1)));
+    tNear = _mm_max_ps(tNear, _mm_movehl_ps(tNear, tNear));
+    tFar = _mm_min_ps(tFar, _mm_shuffle_ps(tFar, tFar, _MM_SHUFFLE(2,3,0,1)));
+    tFar = _mm_min_ps(tFar, _mm_movehl_ps(tFar, tFar));
+    tEntry = _mm_cvtss_f32(tNear);
+    return tEntry <= _mm_cvtss_f32(tFar);
+}
+
+static int intersectChildrenSlabs4(const float* slabs, const ExtentRay& r, const int& normalCount, const float& tMax, float* tEntry)
+{
+    __m128 tNear = _mm_loadu_ps(tEntry);
+    __m128 tFar = _mm_set1_ps(tMax);
+    for(int k=0; k<normalCount; ++k)
+    {
+        const __m128 origin = _mm_set1_ps(r.origins[k]);
+        const __m128 invDirection = _mm_set1_ps(r.invDirections[k]);
+        const __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(slabs+4*k), origin), invDirection);
+        const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(slabs+4*(normalCount+k)), origin), invDirection);
+        tNear = _mm_max_ps(_mm_min_ps(t0, t1), tNear);
+        tFar = _mm_min_ps(_mm_max_ps(t0, t1), tFar);
+    }
+    _mm_storeu_ps(tEntry, tNear);
+    return _mm_movemask_ps(_mm_cmple_ps(tNear, tFar));
+}
+
+__attribute__((target("avx2")))
+static int intersectChildrenSlabs8(const float* slabs, const ExtentRay& r, const int& normalCount, const float& tMax, float* tEntry)
+{
+    __m256 tNear = _mm256_loadu_ps(tEntry);
+    __m256 tFar = _mm256_set1_ps(tMax);
+    for(int k=0; k<normalCount; ++k)
+    {
+        const __m256 origin = _mm256_set1_ps(r.origins[k]);
+        const __m256 invDirection = _mm256_set1_ps(r.invDirections[k]);
+        const __m256 t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(slabs+8*k), origin), invDirection);
+        const __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(slabs+8*(normalCount+k)), origin), invDirection);
+        tNear = _mm256_max_ps(_mm256_min_ps(t0, t1), tNear);
+        tFar = _mm256_min_ps(_mm256_max_ps(t0, t1), tFar);
+    }
+    _mm256_storeu_ps(tEntry, tNear);
+    return _mm256_movemask_ps(_mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ));
+}
+
+int IntersectChildrenSlabs(const float* slabs, const ExtentRay& r, const int& normalCount, const int& width, const float& tMax, float* tEntry)
+{
+    return width==8 ? intersectChildrenSlabs8(slabs, r, normalCount, tMax, tEntry) : intersectChildrenSlabs4(slabs, r, normalCount, tMax, tEntry);
+}
+
+#else
+
+bool IntersectSlabs(const float* slabs, const ExtentRay& r, const int& lanes, const float& tMax, float& tEntry)
+{
+    float tNear = 0.0f, tFar = tMax;
+    for(int l=0; l<lanes; ++l)
+    {
+        float t0 = (slabs[l] - r.origins[l]) * r.invDirections[l];
+        float t1 = (slabs[lanes+l] - r.origins[l]) * r.invDirections[l];
+        if(t0>t1) std::swap(t0, t1);
+        tNear = t0 > tNear ? t0 : tNear;
+        tFar = t1 < tFar ? t1 : tFar;
+    }
+    tEntry = tNear;
+    return tNear <= tFar;
+}
+
+int IntersectChildrenSlabs(const float* slabs, const ExtentRay& r, const int& normalCount, const int& width, const float& tMax, float* tEntry)
+{
+    int mask = 0;
+    for(int i=0; i<width; ++i)
+    {
+        float tNear = tEntry[i], tFar = tMax;
+        for(int k=0; k<normalCount; ++k)
+        {
+            float t0 = (slabs[k*width+i] - r.origins[k]) * r.invDirections[k];
+            float t1 = (slabs[(normalCount+k)*width+i] - r.origins[k]) * r.invDirections[k];
+            if(t0>t1) std::swap(t0, t1);
+            tNear = t0 > tNear ? t0 : tNear;
+            tFar = t1 < tFar ? t1 : tFar;
+        }
+        tEntry[i] = tNear;
+        if(tNear<=tFar) mask |= 1 << i;
+    }
+    return mask;
+}
+
+#endif
+
+ExtentBVH::~ExtentBVH()
+{}
+
+ExtentBVH::ExtentBVH(const BVH& bvh, const vector<Extent>& primitiveExtents, const ExtentSettingsPtr& settings)
+    : m_settings(settings), m_primitiveIndices(bvh.primitiveIndices().begin(), bvh.primitiveIndices().end())
+{
+    const vector<glm::vec3>& normals = m_settings->planeSetNormals();
+    const int normalCount = (int)normals.size();
+    m_lanes = 4*((normalCount+3)/4);
+    const int stride = 2*m_lanes;
+
+    const MappedArray<BVHFlatNodes>& flatNodes = bvh.nodes();
+    const int nodeCount = (int)flatNodes.size();
+    m_nodes.resize(nodeCount);
+
+    //The padding slabs are infinite so that they never cull a ray
+    m_slabs.resize((size_t)nodeCount*stride);
+    for(int n=0; n<nodeCount; ++n)
+    {
+        for(int l=0; l<m_lanes; ++l)
+        {
+            m_slabs[n*stride+l] = l<normalCount ? numeric_limits<float>::max() : -numeric_limits<float>::max();
+            m_slabs[n*stride+m_lanes+l] = l<normalCount ? -numeric_limits<float>::max() : numeric_limits<float>::max();
+        }
+    }
+
+    //The children follow their parent in depth-first order, so the slabs are merged bottom-up in reverse order
+    for(int n=nodeCount-1; n>=0; --n)
+    {
+        const BVHFlatNode& flatNode = flatNodes[n];
+        m_nodes[n].offset = flatNode.offset;
+        m_nodes[n].primitiveCount = flatNode.primitiveCount;
+
+        float* slabs = &m_slabs[n*stride];
+        if(flatNode.isLeaf())
+        {
+            for(int i=flatNode.offset; i<flatNode.offset+flatNode.primitiveCount; ++i)
+            {
+                const vector< array<float,2> >& offsets = primitiveExtents[ m_primitiveIndices[i] ].slabOffsets();
+                for(int l=0; l<normalCount; ++l)
+                {
+                    slabs[l] = min(slabs[l], offsets[l][0]);
+                    slabs[m_lanes+l] = max(slabs[m_lanes+l], offsets[l][1]);
+                }
+            }
+        }
+        else
+        {
+            const float* left = &m_slabs[(n+1)*stride];
+            const float* right = &m_slabs[flatNode.offset*stride];
+            for(int l=0; l<normalCount; ++l)
+            {
+                slabs[l] = min(left[l], right[l]);
+                slabs[m_lanes+l] = max(left[m_lanes+l], right[m_lanes+l]);
+            }
+        }
+    }
+
+    //The wide nodes test the bounding boxes of their children first, which stand for the slabs of the axes
+    for(const glm::vec3& n : normals)
+    {
+        const bool axis = (n[0]==0)+(n[1]==0)+(n[2]==0)==2;
+        if(!axis) m_cullingNormals.push_back(n);
+    }
+    m_width = bvh.settings().width;
+    if(m_width==8) collapseSlabs(bvh, m_nodes8);
+    if(m_width==4) collapseSlabs(bvh, m_nodes4);
+}
+
+template<int Width>
+void ExtentBVH::collapseSlabs(const BVH& bvh, WideBVHNodes<Width>& wideNodes)
+{
+    std::vector< std::array<int,Width> > binaryChildren;
+    bvh.collapseNodes<Width>(wideNodes, binaryChildren);
+
+    const vector<glm::vec3>& normals = m_settings->planeSetNormals();
+    const int cullingCount = m_cullingNormals.size();
+    //The boxes of the wide nodes are then the only bounds, as with the slabs of ExtentSettings::AABB_Settings()
+    if(cullingCount==0) return;
+    const int stride = 2*Width*cullingCount;
+    m_wideSlabs.resize(wideNodes.size()*stride);
+    for(size_t w=0; w<wideNodes.size(); ++w)
+    {
+        float* slabs = &m_wideSlabs[w*stride];
+        for(int i=0; i<Width; ++i)
+        {
+            const int child = binaryChildren[w][i];
+            int k = 0;
+            for(size_t l=0; l<normals.size(); ++l)
+            {
+                if(k==cullingCount || normals[l]!=m_cullingNormals[k]) continue;
+                //Empty slots have inverted slabs
+                slabs[k*Width+i] = child>=0 ? m_slabs[child*2*m_lanes+l] : numeric_limits<float>::max();
+                slabs[(cullingCount+k)*Width+i] = child>=0 ? m_slabs[child*2*m_lanes+m_lanes+l] : -numeric_limits<float>::max();
+                ++k;
+            }
+        }
+    }
+}
+
+ExtentRay ExtentBVH::toExtentRay(const Ray& r, const vector<glm::vec3>& normals) const
+{
+    ExtentRay extentRay;
+    extentRay.origins.fill(0.0f);
+    extentRay.invDirections.fill(1.0f);
+    for(size_t l=0; l<normals.size(); ++l)
+    {
+        extentRay.origins[l] = glm::dot(normals[l], r.origin());
+        extentRay.invDirections[l] = 1.0f/glm::dot(normals[l], r.direction());
+    }
+    return extentRay;
+}
+
+const ExtentSettingsPtr& ExtentBVH::settings() const
+{
+    return m_settings;
+}
+
+const int& ExtentBVH::lanes() const
+{
+    return m_lanes;
+}
+
+const int& ExtentBVH::width() const
+{
+    return m_width;
+}
+
+const vector<ExtentBVHNode>& ExtentBVH::nodes() const
+{
+    return m_nodes;
+}
+
+const ExtentBVHSlabs& ExtentBVH::slabs() const
+{
+    return m_slabs;
+}
+
+const vector<glm::vec3>& ExtentBVH::cullingNormals() const
+{
+    return m_cullingNormals;
+}
+
+const ExtentBVHSlabs& ExtentBVH::wideSlabs() const
+{
+    return m_wideSlabs;
+}
+
+const vector<int>& ExtentBVH::primitiveIndices() const
+{
+    return m_primitiveIndices;
+}
+
+bool ExtentBVH::empty() const
+{
+    return m_nodes.empty();
+}
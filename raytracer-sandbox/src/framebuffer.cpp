@@ -0,0 +1,90 @@
+#include "./../include/raytracer-sandbox/framebuffer.hpp"
+#include <algorithm>
+
+using namespace std;
+
+FrameBuffer::~FrameBuffer(){}
+
+FrameBuffer::FrameBuffer(const int& width, const int& height)
+{
+    resize(width, height);
+}
+
+void FrameBuffer::resize(const int& width, const int& height)
+{
+    m_width = width;
+    m_height = height;
+    clear();
+}
+
+void FrameBuffer::clear()
+{
+    m_passes = 0;
+    m_colorSums.assign(m_width*m_height, glm::vec3(0,0,0));
+    m_squaredColorSums.assign(m_width*m_height, glm::vec3(0,0,0));
+    m_sampleCounts.assign(m_width*m_height, 0);
+}
+
+const int& FrameBuffer::width() const
+{
+    return m_width;
+}
+
+const int& FrameBuffer::height() const
+{
+    return m_height;
+}
+
+const int& FrameBuffer::passes() const
+{
+    return m_passes;
+}
+
+void FrameBuffer::addPass()
+{
+    ++m_passes;
+}
+
+void FrameBuffer::add(const int& x, const int& y, const glm::vec3& color)
+{
+    m_colorSums[x+y*m_width] += color;
+    m_squaredColorSums[x+y*m_width] += color*color;
+    ++m_sampleCounts[x+y*m_width];
+}
+
+const int& FrameBuffer::sampleCount(const int& x, const int& y) const
+{
+    return m_sampleCounts[x+y*m_width];
+}
+
+std::uint64_t FrameBuffer::sampleCount() const
+{
+    std::uint64_t count = 0;
+    for(const int& c : m_sampleCounts) count += c;
+    return count;
+}
+
+glm::vec3 FrameBuffer::color(const int& x, const int& y) const
+{
+    const int& count = m_sampleCounts[x+y*m_width];
+    return count>0 ? m_colorSums[x+y*m_width]/(float)count : glm::vec3(0,0,0);
+}
+
+float FrameBuffer::variance(const int& x, const int& y) const
+{
+    const int& count = m_sampleCounts[x+y*m_width];
+    if(count<2) return 0.0f;
+    const glm::vec3& sum = m_colorSums[x+y*m_width];
+    //Unbiased estimate, clamped as the rounding errors may make it slightly negative
+    const glm::vec3 variance = (m_squaredColorSums[x+y*m_width] - sum*sum/(float)count)/(float)(count-1);
+    return std::max(0.0f, std::max(variance[0], std::max(variance[1], variance[2])));
+}
+
+void FrameBuffer::resolve(std::vector<glm::vec3>& image) const
+{
+    image.resize(m_width*m_height);
+    for(int y=0; y<m_height; ++y)
+    {
+        for(int x=0; x<m_width; ++x) image[x+y*m_width] = color(x, y);
+    }
+}
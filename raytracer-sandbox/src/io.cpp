@@ -1,6 +1,7 @@
 #include "./../include/raytracer-sandbox/io.hpp"
 #include <iostream>
 #include <algorithm>
+#include <fstream>
 
 #define TINYOBJLOADER_IMPLEMENTATION // define this in only *one* .cc
 #include <tiny_obj_loader.h>
@@ -63,3 +64,23 @@ bool read_obj(const string& filename,
 
     return ret;
 }
+
+bool write_ppm(const string& filename, const int& width, const int& height, const vector<glm::vec3>& image)
+{
+    if((int)image.size()!=width*height) return false;
+    ofstream file(filename, ios::binary);
+    if(!file) return false;
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+    vector<unsigned char> row(3*width);
+    for(int y=0; y<height; ++y)
+    {
+        for(int x=0; x<width; ++x)
+        {
+            const glm::vec3 color = glm::clamp(image[x+y*width], 0.0f, 1.0f);
+            for(int c=0; c<3; ++c) row[3*x+c] = (unsigned char)(color[c]*255.0f+0.5f);
+        }
+        file.write((const char*)row.data(), row.size());
+    }
+    return bool(file);
+}
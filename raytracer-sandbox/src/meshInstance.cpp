@@ -0,0 +1,65 @@
+#include "./../include/raytracer-sandbox/meshInstance.hpp"
+
+using namespace std;
+
+MeshInstance::~MeshInstance(){}
+
+MeshInstance::MeshInstance(const shared_ptr<const TMesh>& mesh, const glm::mat4& transform, const MaterialPtr& material)
+{
+    m_mesh = mesh;
+    m_material = material;
+    m_transform = transform;
+    m_invTransform = glm::inverse(transform);
+    m_normalTransform = glm::transpose(glm::inverse(glm::mat3(transform)));
+
+    //The world space box of the instance bounds the transformed corners of the box of the mesh
+    const std::array<glm::vec3,2>& bounds = m_mesh->bbox().bounds();
+    m_bbox = Box::Empty();
+    for(int corner=0; corner<8; ++corner)
+    {
+        glm::vec3 position(bounds[corner&1][0], bounds[(corner>>1)&1][1], bounds[(corner>>2)&1][2]);
+        m_bbox.extend(glm::vec3(m_transform*glm::vec4(position, 1.0f)));
+    }
+}
+
+bool MeshInstance::Intersect(const Ray& r, float& tMax, HitRecord& hit) const
+{
+    //The direction of the ray in object space is normalized, the distances along it are scaled accordingly
+    const glm::vec3 objectDirection = glm::vec3(m_invTransform*glm::vec4(r.direction(), 0.0f));
+    const float scale = glm::length(objectDirection);
+    Ray objectRay(glm::vec3(m_invTransform*glm::vec4(r.origin(), 1.0f)), objectDirection);
+    float objectTMax = tMax==numeric_limits<float>::max() ? tMax : tMax*scale;
+    if(!m_mesh->Intersect(objectRay, objectTMax, hit)) return false;
+
+    tMax = objectTMax/scale;
+    hit.t = tMax;
+    return true;
+}
+
+void MeshInstance::HitSurface(const Ray& r, const HitRecord& hit, glm::vec3& hitPosition, glm::vec3& hitNormal) const
+{
+    //Only the triangle and the barycentric coordinates of the hit are needed for the normal of the mesh
+    Ray objectRay(glm::vec3(m_invTransform*glm::vec4(r.origin(), 1.0f)), glm::vec3(m_invTransform*glm::vec4(r.direction(), 0.0f)));
+    glm::vec3 objectHitPosition, objectHitNormal;
+    m_mesh->HitSurface(objectRay, hit, objectHitPosition, objectHitNormal);
+
+    hitPosition = r.origin() + hit.t*r.direction();
+    hitNormal = glm::normalize(m_normalTransform*objectHitNormal);
+}
+
+bool MeshInstance::Occluded(const Ray& r, const float& tMax) const
+{
+    const glm::vec3 objectDirection = glm::vec3(m_invTransform*glm::vec4(r.direction(), 0.0f));
+    Ray objectRay(glm::vec3(m_invTransform*glm::vec4(r.origin(), 1.0f)), objectDirection);
+    return m_mesh->Occluded(objectRay, tMax==numeric_limits<float>::max() ? tMax : tMax*glm::length(objectDirection));
+}
+
+const shared_ptr<const TMesh>& MeshInstance::mesh() const
+{
+    return m_mesh;
+}
+
+const glm::mat4& MeshInstance::transform() const
+{
+    return m_transform;
+}
@@ -22,3 +22,34 @@ const Box& Object::bbox() const
 {
     return m_bbox;
 }
+
+bool Object::Intersect(const Ray& r, glm::vec3& hitPosition, glm::vec3& hitNormal) const
+{
+    float tMax = numeric_limits<float>::max();
+    HitRecord hit;
+    if(!Intersect(r, tMax, hit)) return false;
+    HitSurface(r, hit, hitPosition, hitNormal);
+    return true;
+}
+
+bool Object::Occluded(const Ray& r, const float& tMax) const
+{
+    float t = tMax;
+    HitRecord hit;
+    return Intersect(r, t, hit);
+}
+
+int Object::IntersectPacket(const RayPacket& packet, const int& mask, RayPacketHits& hits) const
+{
+    int hitMask = 0;
+    for(int i=0; i<packet.size; ++i)
+    {
+        if((mask & (1<<i))==0) continue;
+        HitRecord hit;
+        if(!Intersect(packet.rays[i], hits.t[i], hit)) continue;
+        hits.primitiveIds[i] = hit.primitiveId;
+        hits.barycentrics[i] = hit.barycentrics;
+        hitMask |= 1<<i;
+    }
+    return hitMask;
+}
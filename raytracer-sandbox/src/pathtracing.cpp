@@ -1,130 +1,228 @@
 #include "./../include/raytracer-sandbox/pathtracing.hpp"
+#include "./../include/raytracer-sandbox/shadowcache.hpp"
+#include <algorithm>
 #include <iostream>
 
 bool pathTrace(const Ray& ray, const std::vector<ObjectPtr>& objects, ObjectPtr& closestHitObject, glm::vec3& closestHitPosition, glm::vec3& closestHitNormal)
 {
-    bool narrowIntersection = false;
     closestHitObject = nullptr;
-    glm::vec3 hitPosition, hitNormal;
-    float minDistance = std::numeric_limits<float>::max();
-    for(const ObjectPtr& o : objects)
+    float tMax = std::numeric_limits<float>::max();
+    HitRecord hit;
+    for(size_t i=0; i<objects.size(); ++i)
     {
-        //Broad phase
+        const ObjectPtr& o = objects[i];
+        //Broad phase, the box being skipped when it lies beyond the closest hit found so far
         std::array<float, 2> tValue = {{0,0}};
-        bool broadIntersection = true;
-        broadIntersection = Intersect(ray, o->bbox(), tValue) && (tValue[0] >= 0 || tValue[1] >=0);
+        bool broadIntersection = Intersect(ray, o->bbox(), tValue) && tValue[1] >= 0 && tValue[0] <= tMax;
 
         //Narrow phase
-        if( broadIntersection )
+        if( broadIntersection && o->Intersect(ray, tMax, hit) )
         {
-            if(o->Intersect(ray, hitPosition, hitNormal))
-            {
-                narrowIntersection = true;
-                float distance = (hitPosition-ray.origin()).length();
-                if(distance < minDistance)
-                {
-                    closestHitObject = o;
-                    closestHitPosition = hitPosition;
-                    closestHitNormal = glm::normalize(hitNormal);
-                    minDistance = distance;
-                }
-            }
+            hit.objectId = i;
         }
     }
-    return narrowIntersection;
+    if(hit.objectId<0) return false;
+
+    //The position and the normal are only computed for the closest hit
+    closestHitObject = objects[hit.objectId];
+    closestHitObject->HitSurface(ray, hit, closestHitPosition, closestHitNormal);
+    closestHitNormal = glm::normalize(closestHitNormal);
+    return true;
 }
 
-glm::vec3 castRay(const Ray& ray, const std::vector<LightPtr> &lights, const std::vector<ObjectPtr> &objects,
-                  const glm::vec3& backgroundColor, const glm::vec3& shadowColor, const float& bias, const int& maxDepth, int depth)
+bool pathTrace(const Ray& ray, const Scene& scene, ObjectPtr& closestHitObject, glm::vec3& closestHitPosition, glm::vec3& closestHitNormal)
 {
-    if(depth>maxDepth) return backgroundColor;
+    return scene.intersect(ray, closestHitObject, closestHitPosition, closestHitNormal);
+}
 
-    ObjectPtr closestHitObject = nullptr;
-    glm::vec3 closestHitPosition, closestHitNormal;
+bool occluded(const Ray& shadowRay, const std::vector<ObjectPtr>& objects, const float& tMax, const Object* ignoredObject, const Object*& occluder)
+{
+    occluder = nullptr;
+    for(const ObjectPtr& o : objects)
+    {
+        if(o.get() == ignoredObject || o->material()->type() == MaterialType::FRESNEL) continue;
+        std::array<float, 2> tValue = {{0,0}};
+        if(!Intersect(shadowRay, o->bbox(), tValue) || tValue[1] < 0 || tValue[0] > tMax) continue;
+        if(o->Occluded(shadowRay, tMax))
+        {
+            occluder = o.get();
+            return true;
+        }
+    }
+    return false;
+}
 
-    //Check intersection between the ray and the scene
-    pathTrace(ray, objects, closestHitObject, closestHitPosition, closestHitNormal);
+bool occluded(const Ray& shadowRay, const Scene& scene, const float& tMax, const Object* ignoredObject, const Object*& occluder)
+{
+    return scene.occluded(shadowRay, tMax, ignoredObject, occluder);
+}
+
+//Check if a shadow ray towards a light is blocked, testing first the last occluder of the light when a cache is given
+template<typename TObjects>
+bool occluded(const Ray& shadowRay, const TObjects& objects, const float& tMax, const Object* ignoredObject, const int& light, ShadowCache* shadowCache)
+{
+    const Object* occluder = nullptr;
+    if(shadowCache == nullptr) return occluded(shadowRay, objects, tMax, ignoredObject, occluder);
+
+    //The cached occluder is never the ignored object nor transparent: it has been found blocking a ray with the same rules
+    const Object* cachedOccluder = shadowCache->occluder(light);
+    if(cachedOccluder != nullptr && cachedOccluder != ignoredObject && cachedOccluder->Occluded(shadowRay, tMax))
+    {
+        shadowCache->count(true);
+        return true;
+    }
+    shadowCache->count(false);
+    if(!occluded(shadowRay, objects, tMax, ignoredObject, occluder)) return false;
+    shadowCache->setOccluder(light, occluder);
+    return true;
+}
 
-    //Compute illumination
+//A reflection or refraction ray spawned by a hit, whose color is added to the color of the hit with a weight
+struct SecondaryRay
+{
+    Ray ray;
+    float weight;
+};
+
+//Compute the color of a hit due to the lights and gather the secondary rays it spawns, at most two
+//The shading is the same whatever the way the objects are stored: TObjects is either a std::vector<ObjectPtr> or a Scene
+template<typename TObjects>
+glm::vec3 shadeSurface(const Ray& ray, const ObjectPtr& closestHitObject, const glm::vec3& closestHitPosition, const glm::vec3& closestHitNormal,
+                       const std::vector<LightPtr> &lights, const TObjects &objects, const glm::vec3& shadowColor, const float& bias,
+                       std::array<SecondaryRay,2>& secondaryRays, int& secondaryRayCount, ShadowCache* shadowCache)
+{
     glm::vec3 color(0,0,0);
-    if(closestHitObject != nullptr)
+    secondaryRayCount = 0;
+    switch (closestHitObject->material()->type())
     {
-        switch (closestHitObject->material()->type())
-        {
-        case MaterialType::GLOSSY:
+    case MaterialType::GLOSSY:
+    {
+        glm::vec3 direction = glm::normalize(closestHitPosition-ray.origin());
+        glm::vec3 reflectDirection = glm::normalize(reflect(direction, closestHitNormal));
+        bool outside = glm::dot(direction, closestHitNormal) < 0;
+        glm::vec3 biasVector = glm::vec3(bias,bias,bias) * closestHitNormal;
+        glm::vec3 reflectionRayOrig = outside ? closestHitPosition + biasVector : closestHitPosition - biasVector;
+        secondaryRays[secondaryRayCount++] = SecondaryRay{Ray(reflectionRayOrig, reflectDirection), 1.0f};
+        break;
+    }
+    case MaterialType::FRESNEL:
+    {
+        FresnelMaterialPtr material = std::static_pointer_cast<FresnelMaterial>(closestHitObject->material());
+        float kr=0.0, kt=0.0;
+        glm::vec3 direction = glm::normalize(closestHitPosition-ray.origin());
+        fresnel(direction, closestHitNormal, material->ior(), kr, kt);
+        bool outside = glm::dot(direction, closestHitNormal) < 0;
+        glm::vec3 biasVector = glm::vec3(bias,bias,bias) * closestHitNormal;
+        glm::vec3 reflectionDirection = glm::normalize(reflect(direction, closestHitNormal));
+        glm::vec3 reflectionRayOrig = outside ? closestHitPosition + biasVector : closestHitPosition - biasVector;
+        secondaryRays[secondaryRayCount++] = SecondaryRay{Ray(reflectionRayOrig, reflectionDirection), kr};
+        // compute refraction if it is not a case of total internal reflection
+        if (kr < 1)
         {
-            glm::vec3 direction = glm::normalize(closestHitPosition-ray.origin());
-            glm::vec3 reflectDirection = glm::normalize(reflect(direction, closestHitNormal));
-            bool outside = glm::dot(direction, closestHitNormal) < 0;
-            glm::vec3 biasVector = glm::vec3(bias,bias,bias) * closestHitNormal;
-            glm::vec3 reflectionRayOrig = outside ? closestHitPosition + biasVector : closestHitPosition - biasVector;
-            Ray reflectionRay(reflectionRayOrig, reflectDirection);
-            color += castRay(reflectionRay, lights, objects, backgroundColor, shadowColor, bias, maxDepth, depth+1);
-            break;
+            glm::vec3 refractionDirection = glm::normalize(refract(direction, closestHitNormal, material->ior()));
+            glm::vec3 refractionRayOrig = outside ? closestHitPosition - biasVector : closestHitPosition + biasVector;
+            secondaryRays[secondaryRayCount++] = SecondaryRay{Ray(refractionRayOrig, refractionDirection), kt};
         }
-        case MaterialType::FRESNEL:
+        break;
+    }
+    case MaterialType::PHONG:
+    {
+        for(size_t l=0; l<lights.size(); ++l)
         {
-            glm::vec3 refractionColor(0,0,0), reflectionColor(0,0,0);
-            FresnelMaterialPtr material = std::static_pointer_cast<FresnelMaterial>(closestHitObject->material());
-            float kr=0.0, kt=0.0;
-            glm::vec3 direction = glm::normalize(closestHitPosition-ray.origin());
-            fresnel(direction, closestHitNormal, material->ior(), kr, kt);
-            bool outside = glm::dot(direction, closestHitNormal) < 0;
-            glm::vec3 biasVector = glm::vec3(bias,bias,bias) * closestHitNormal;            
-            // compute refraction if it is not a case of total internal reflection
-            if (kr < 1)
+            const LightPtr& light = lights[l];
+            glm::vec3 biasVector = glm::vec3(bias,bias,bias) * closestHitNormal;
+            glm::vec3 shadowRayOrig = closestHitPosition + biasVector;
+            Ray shadowRay(shadowRayOrig, -light->lightDirectionFrom(closestHitPosition));
+            //Only an object between the surface and the light casts a shadow, the first one found is enough
+            bool isInShadow = occluded(shadowRay, objects, light->distanceFrom(shadowRayOrig), closestHitObject.get(), l, shadowCache);
+            if(isInShadow)
             {
-                glm::vec3 refractionDirection = glm::normalize(refract(direction, closestHitNormal, material->ior()));
-                glm::vec3 refractionRayOrig = outside ? closestHitPosition - biasVector : closestHitPosition + biasVector;
-                Ray refractionRay(refractionRayOrig, refractionDirection);                
-                refractionColor = castRay(refractionRay, lights, objects, backgroundColor, shadowColor, bias, maxDepth, depth+1);
+                color = shadowColor;
             }
-            glm::vec3 reflectionDirection = glm::normalize(reflect(direction, closestHitNormal));
-            glm::vec3 reflectionRayOrig = outside ? closestHitPosition + biasVector : closestHitPosition - biasVector;
-            Ray reflectionRay(reflectionRayOrig, reflectionDirection);
-            reflectionColor = castRay(reflectionRay, lights, objects, backgroundColor, shadowColor, bias, maxDepth, depth+1);
-            color += reflectionColor * kr + refractionColor * kt;
-            break;
-        }
-        case MaterialType::PHONG:
-        {
-            for(const LightPtr& light : lights)
+            else
             {
-                glm::vec3 biasVector = glm::vec3(bias,bias,bias) * closestHitNormal;
-                glm::vec3 shadowRayOrig = closestHitPosition + biasVector;
-                Ray shadowRay(shadowRayOrig, -light->lightDirectionFrom(closestHitPosition));
-                ObjectPtr shadowClosestHitObject = nullptr;
-                glm::vec3 shadowClosestHitPosition, shadowClosestHitNormal;
-                pathTrace(shadowRay, objects, shadowClosestHitObject, shadowClosestHitPosition, shadowClosestHitNormal);
-                bool isInShadow = (shadowClosestHitObject!=nullptr && shadowClosestHitObject.get() != closestHitObject.get()) ? true : false;
-                bool materialWithShadow = false;
-                if(isInShadow)
-                {
-                    materialWithShadow = shadowClosestHitObject->material()->type() != MaterialType::FRESNEL;
-                    //materialWithShadow = materialWithShadow && shadowClosestHitObject->material()->type() != MaterialType::GLOSSY;
-                }
-                if(isInShadow && materialWithShadow)
-                {
-                    color = shadowColor;
-                }
-                else
-                {
-
-                    PhongMaterialPtr material = std::static_pointer_cast<PhongMaterial>(closestHitObject->material());
-                    color += light->phongIllumination(ray.origin(), closestHitPosition,closestHitNormal, material);
-                }
+
+                PhongMaterialPtr material = std::static_pointer_cast<PhongMaterial>(closestHitObject->material());
+                color += light->phongIllumination(ray.origin(), closestHitPosition,closestHitNormal, material);
             }
-            break;
-        }
-        default:
-        {
-            break;
-        }
         }
+        break;
+    }
+    default:
+    {
+        break;
+    }
     }
-    else
+    return color;
+}
+
+template<typename TObjects>
+glm::vec3 shadeRay(const Ray& ray, const std::vector<LightPtr> &lights, const TObjects &objects,
+                   const glm::vec3& backgroundColor, const glm::vec3& shadowColor, const float& bias, const int& maxDepth, int depth, ShadowCache* shadowCache);
+
+//Compute the color of a hit, the secondary rays being traced depth first
+template<typename TObjects>
+glm::vec3 shadeHit(const Ray& ray, const ObjectPtr& closestHitObject, const glm::vec3& closestHitPosition, const glm::vec3& closestHitNormal,
+                   const std::vector<LightPtr> &lights, const TObjects &objects,
+                   const glm::vec3& backgroundColor, const glm::vec3& shadowColor, const float& bias, const int& maxDepth, int depth, ShadowCache* shadowCache)
+{
+    if(closestHitObject == nullptr) return backgroundColor;
+
+    std::array<SecondaryRay,2> secondaryRays;
+    int secondaryRayCount = 0;
+    glm::vec3 color = shadeSurface(ray, closestHitObject, closestHitPosition, closestHitNormal, lights, objects, shadowColor, bias, secondaryRays, secondaryRayCount, shadowCache);
+    for(int i=0; i<secondaryRayCount; ++i)
     {
-        color = backgroundColor;
+        color += secondaryRays[i].weight * shadeRay(secondaryRays[i].ray, lights, objects, backgroundColor, shadowColor, bias, maxDepth, depth+1, shadowCache);
     }
     return color;
 }
+
+template<typename TObjects>
+glm::vec3 shadeRay(const Ray& ray, const std::vector<LightPtr> &lights, const TObjects &objects,
+                   const glm::vec3& backgroundColor, const glm::vec3& shadowColor, const float& bias, const int& maxDepth, int depth, ShadowCache* shadowCache)
+{
+    if(depth>maxDepth) return backgroundColor;
+
+    ObjectPtr closestHitObject = nullptr;
+    glm::vec3 closestHitPosition, closestHitNormal;
+
+    //Check intersection between the ray and the scene
+    pathTrace(ray, objects, closestHitObject, closestHitPosition, closestHitNormal);
+
+    return shadeHit(ray, closestHitObject, closestHitPosition, closestHitNormal, lights, objects, backgroundColor, shadowColor, bias, maxDepth, depth, shadowCache);
+}
+
+glm::vec3 castRay(const Ray& ray, const std::vector<LightPtr> &lights, const std::vector<ObjectPtr> &objects,
+                  const glm::vec3& backgroundColor, const glm::vec3& shadowColor, const float& bias, const int& maxDepth, int depth, ShadowCache* shadowCache)
+{
+    return shadeRay(ray, lights, objects, backgroundColor, shadowColor, bias, maxDepth, depth, shadowCache);
+}
+
+glm::vec3 castRay(const Ray& ray, const std::vector<LightPtr> &lights, const Scene &scene,
+                  const glm::vec3& backgroundColor, const glm::vec3& shadowColor, const float& bias, const int& maxDepth, int depth, ShadowCache* shadowCache)
+{
+    return shadeRay(ray, lights, scene, backgroundColor, shadowColor, bias, maxDepth, depth, shadowCache);
+}
+
+void castRayPacket(const RayPacket& packet, const std::vector<LightPtr> &lights, const Scene &scene,
+                   const glm::vec3& backgroundColor, const glm::vec3& shadowColor, const float& bias, const int& maxDepth, int depth, glm::vec3* colors,
+                   ShadowCache* shadowCache)
+{
+    if(depth>maxDepth)
+    {
+        std::fill(colors, colors+packet.size, backgroundColor);
+        return;
+    }
+
+    //Trace the packet together, then shade each ray and trace its secondary rays one after another
+    std::array<ObjectPtr, RayPacket::MaxSize> closestHitObjects;
+    RayPacketHits hits;
+    scene.intersect(packet, closestHitObjects.data(), hits);
+    for(int i=0; i<packet.size; ++i)
+    {
+        colors[i] = shadeHit(packet.rays[i], closestHitObjects[i], hits.positions[i], hits.normals[i], lights, scene,
+                             backgroundColor, shadowColor, bias, maxDepth, depth, shadowCache);
+    }
+}
+
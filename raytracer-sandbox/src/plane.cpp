@@ -34,20 +34,47 @@ glm::vec3 Plane::projectOnPlane(const glm::vec3& p) const
     return projection;
 }
 
-bool Plane::Intersect(const Ray& r, glm::vec3& hitPosition, glm::vec3& hitNormal) const
+bool Plane::Intersect(const Ray& r, float& tMax, HitRecord& hit) const
 {
     float dotNormalRayDir = glm::dot(r.direction(), m_n);
     if ( abs(dotNormalRayDir) > numeric_limits<float>::epsilon())
     {
-        float t = (m_d - glm::dot(r.origin(), m_n)) / glm::dot(r.direction(), m_n);
-        hitPosition = r.origin() + t*r.direction();
-        hitNormal = m_n;
-        if(t>=0)
+        float t = (m_d - glm::dot(r.origin(), m_n)) / dotNormalRayDir;
+        if(t>=0 && t<tMax)
+        {
+            tMax = t;
+            hit.t = t;
+            hit.primitiveId = -1;
             return true;
+        }
     }
     return false;
 }
 
+void Plane::HitSurface(const Ray& r, const HitRecord& hit, glm::vec3& hitPosition, glm::vec3& hitNormal) const
+{
+    hitPosition = r.origin() + hit.t*r.direction();
+    hitNormal = m_n;
+}
+
+bool Plane::Occluded(const Ray& r, const float& tMax) const
+{
+    float dotNormalRayDir = glm::dot(r.direction(), m_n);
+    if ( abs(dotNormalRayDir) <= numeric_limits<float>::epsilon()) return false;
+    float t = (m_d - glm::dot(r.origin(), m_n)) / dotNormalRayDir;
+    return t>=0 && t<tMax;
+}
+
+int Plane::IntersectPacket(const RayPacket& packet, const int& mask, RayPacketHits& hits) const
+{
+    int hitMask = IntersectPlane(packet, mask, m_n, m_d, hits.t);
+    for(int i=0; i<packet.size; ++i)
+    {
+        if(hitMask & (1<<i)) hits.primitiveIds[i] = -1;
+    }
+    return hitMask;
+}
+
 void Plane::setDistanceToOrigin(const float& d)
 {
     m_d = d;
@@ -120,3 +120,8 @@ glm::vec3 PointLight::lightDirectionFrom(const glm::vec3& position) const
 {
     return glm::normalize(position-m_position);
 }
+
+float PointLight::distanceFrom(const glm::vec3& position) const
+{
+    return glm::length(m_position-position);
+}
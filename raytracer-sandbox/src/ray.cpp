@@ -1,15 +1,13 @@
 #include "./../include/raytracer-sandbox/ray.hpp"
 #include <iostream>
 
-Ray::~Ray(){}
-
 Ray::Ray(const glm::vec3 &origin, const glm::vec3& direction)
 {
     m_origin = origin;
-    m_direction = direction;
-    m_invDirection = glm::vec3(1.0/direction[0], 1.0/direction[1], 1.0/direction[2]);
+    //Normalize first so that slab distances are expressed in the same unit as hit distances
+    m_direction = glm::normalize(direction);
+    m_invDirection = glm::vec3(1.0/m_direction[0], 1.0/m_direction[1], 1.0/m_direction[2]);
     m_sign = {{ m_invDirection[0]<0, m_invDirection[1]<0, m_invDirection[2]<0 }};
-    m_direction = glm::normalize(m_direction);
 }
 
 const glm::vec3& Ray::direction() const{ return m_direction; }
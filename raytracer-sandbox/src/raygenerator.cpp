@@ -0,0 +1,134 @@
+#include "./../include/raytracer-sandbox/raygenerator.hpp"
+#include <algorithm>
+#include <array>
+#include <new>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RAYTRACER_SANDBOX_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+static_assert(std::is_trivially_destructible<Ray>::value, "The rays of a row are built in place over the previous ones");
+
+CameraRayGenerator::~CameraRayGenerator(){}
+
+CameraRayGenerator::CameraRayGenerator(const Camera& camera)
+{
+    update(camera);
+}
+
+void CameraRayGenerator::update(const Camera& camera)
+{
+    //Same mapping as Camera::pixelToWorld(): the pixel (x,y) has the clip coordinates
+    //(2x/width-1, 1-2y/height, ndcZ, znear), an affine function of x and y
+    const glm::mat4 invView = glm::inverse(camera.view());
+    const glm::mat4 invViewProjection = invView*glm::inverse(camera.projection());
+    const float ndcZ = (2.0/(camera.zfar()-camera.znear()))*(camera.znear()-((camera.zfar()+camera.znear())/2.0));
+    m_origin = glm::vec3(invView[3]);
+    m_corner = glm::vec3(invViewProjection*glm::vec4(-1.0f, 1.0f, ndcZ, camera.znear())) - m_origin;
+    m_stepX = glm::vec3(invViewProjection[0])*(2.0f/(float)camera.width());
+    m_stepY = -glm::vec3(invViewProjection[1])*(2.0f/(float)camera.height());
+}
+
+const glm::vec3& CameraRayGenerator::origin() const
+{
+    return m_origin;
+}
+
+Ray CameraRayGenerator::generate(const float& x, const float& y) const
+{
+    return Ray(m_origin, m_corner + x*m_stepX + y*m_stepY);
+}
+
+#ifdef RAYTRACER_SANDBOX_X86
+
+void CameraRayGenerator::generateDirections(const float& x, const float& y, const int& count, float* directions[3], float* invDirections[3]) const
+{
+    const glm::vec3 rowStart = m_corner + y*m_stepY;
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 start[3] = { _mm_set1_ps(rowStart[0]), _mm_set1_ps(rowStart[1]), _mm_set1_ps(rowStart[2]) };
+    const __m128 step[3] = { _mm_set1_ps(m_stepX[0]), _mm_set1_ps(m_stepX[1]), _mm_set1_ps(m_stepX[2]) };
+    int i = 0;
+    for(; i+4<=count; i+=4)
+    {
+        const __m128 px = _mm_add_ps(_mm_set1_ps(x+i), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+        __m128 d[3];
+        for(int a=0; a<3; ++a) d[a] = _mm_add_ps(start[a], _mm_mul_ps(px, step[a]));
+        //A full-precision square root keeps the directions equal to the scalar ones up to rounding
+        const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(d[0], d[0]), _mm_mul_ps(d[1], d[1])), _mm_mul_ps(d[2], d[2])));
+        for(int a=0; a<3; ++a)
+        {
+            d[a] = _mm_div_ps(d[a], length);
+            _mm_storeu_ps(&directions[a][i], d[a]);
+            //A full-precision division too, a zero component giving an infinite inverse of its sign
+            if(invDirections!=nullptr) _mm_storeu_ps(&invDirections[a][i], _mm_div_ps(one, d[a]));
+        }
+    }
+    for(; i<count; ++i)
+    {
+        const glm::vec3 d = glm::normalize(rowStart + (x+i)*m_stepX);
+        for(int a=0; a<3; ++a) directions[a][i] = d[a];
+        if(invDirections!=nullptr)
+        {
+            for(int a=0; a<3; ++a) invDirections[a][i] = 1.0f/d[a];
+        }
+    }
+}
+
+#else
+
+void CameraRayGenerator::generateDirections(const float& x, const float& y, const int& count, float* directions[3], float* invDirections[3]) const
+{
+    const glm::vec3 rowStart = m_corner + y*m_stepY;
+    for(int i=0; i<count; ++i)
+    {
+        const glm::vec3 d = glm::normalize(rowStart + (x+i)*m_stepX);
+        for(int a=0; a<3; ++a) directions[a][i] = d[a];
+        if(invDirections!=nullptr)
+        {
+            for(int a=0; a<3; ++a) invDirections[a][i] = 1.0f/d[a];
+        }
+    }
+}
+
+#endif
+
+void CameraRayGenerator::generateRow(const float& x, const float& y, const int& count, Ray* rays) const
+{
+    //The directions are generated by chunks so that a row of any length fits on the stack
+    const int chunkSize = 64;
+    alignas(16) float buffer[3][chunkSize];
+    alignas(16) float invBuffer[3][chunkSize];
+    float* directions[3] = { buffer[0], buffer[1], buffer[2] };
+    float* invDirections[3] = { invBuffer[0], invBuffer[1], invBuffer[2] };
+    for(int first=0; first<count; first+=chunkSize)
+    {
+        const int chunk = std::min(chunkSize, count-first);
+        generateDirections(x+first, y, chunk, directions, invDirections);
+        //The directions are normalized and inverted already, which the rays do not do again. The rays are built in place
+        //rather than assigned from a temporary, which the compiler copies through the stack
+        for(int i=0; i<chunk; ++i)
+        {
+            new (&rays[first+i]) Ray(m_origin, glm::vec3(buffer[0][i], buffer[1][i], buffer[2][i]),
+                                     glm::vec3(invBuffer[0][i], invBuffer[1][i], invBuffer[2][i]));
+        }
+    }
+}
+
+void CameraRayGenerator::generateTile(const float& x, const float& y, const int& width, const int& height, Ray* rays) const
+{
+    for(int j=0; j<height; ++j)
+    {
+        generateRow(x, y+j, width, &rays[j*width]);
+    }
+}
+
+RayPacket CameraRayGenerator::generatePacket(const float& x, const float& y, const int& packetWidth) const
+{
+    std::array<Ray, RayPacket::MaxSize> rays;
+    generateTile(x, y, packetWidth, packetWidth, rays.data());
+    return RayPacket(rays.data(), packetWidth*packetWidth);
+}
@@ -0,0 +1,308 @@
+#include "./../include/raytracer-sandbox/raypacket.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RAYTRACER_SANDBOX_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+const int RayPacket::MaxSize;
+constexpr float RayPacket::CoherentCosine;
+
+RayPacket::RayPacket(const Ray* r, const int& count)
+{
+    size = std::min(std::max(count, 1), MaxSize);
+    lanes = (size+3)/4*4;
+    coherent = true;
+
+    const float maxValue = numeric_limits<float>::max();
+    minOrigin = maxOrigin = r[0].origin();
+    minInvDirection = maxInvDirection = glm::clamp(r[0].invDirection(), -maxValue, maxValue);
+    for(int i=0; i<lanes; ++i)
+    {
+        //The padding lanes repeat the first ray so that the SIMD kernels only compute valid values
+        rays[i] = i<size ? r[i] : r[0];
+        for(int a=0; a<3; ++a)
+        {
+            origins[a][i] = rays[i].origin()[a];
+            directions[a][i] = rays[i].direction()[a];
+            invDirections[a][i] = rays[i].invDirection()[a];
+        }
+        //An axis-parallel direction has an infinite inverse, which is clamped so that the interval products stay defined
+        const glm::vec3 invDirection = glm::clamp(rays[i].invDirection(), -maxValue, maxValue);
+        minOrigin = glm::min(minOrigin, rays[i].origin());
+        maxOrigin = glm::max(maxOrigin, rays[i].origin());
+        minInvDirection = glm::min(minInvDirection, invDirection);
+        maxInvDirection = glm::max(maxInvDirection, invDirection);
+        coherent = coherent && rays[i].sign()==rays[0].sign() && glm::dot(rays[i].direction(), rays[0].direction())>=CoherentCosine;
+    }
+}
+
+RayPacketHits::RayPacketHits()
+{
+    std::fill(t, t+RayPacket::MaxSize, numeric_limits<float>::infinity());
+    objectIds.fill(-1);
+    primitiveIds.fill(-1);
+    barycentrics.fill(glm::vec2(0.0f));
+}
+
+//Bounds of the product of the intervals [x0,x1] and [y0,y1]
+static void intervalProduct(const float& x0, const float& x1, const float& y0, const float& y1, float& lower, float& upper)
+{
+    const float a = x0*y0, b = x0*y1, c = x1*y0, d = x1*y1;
+    lower = std::min(std::min(a, b), std::min(c, d));
+    upper = std::max(std::max(a, b), std::max(c, d));
+}
+
+bool IntersectInterval(const RayPacket& packet, const Box& box, const float& tMax, float& tEntry)
+{
+    const std::array<glm::vec3,2>& bounds = box.bounds();
+    const std::array<int,3>& sign = packet.rays[0].sign();
+    float entry = 0.0f, exit = tMax;
+    for(int a=0; a<3; ++a)
+    {
+        //The near and far planes are the same for all the rays of a coherent packet
+        const float near = bounds[sign[a]][a], far = bounds[1-sign[a]][a];
+        float lowerNear, upperNear, lowerFar, upperFar;
+        intervalProduct(near-packet.maxOrigin[a], near-packet.minOrigin[a], packet.minInvDirection[a], packet.maxInvDirection[a], lowerNear, upperNear);
+        intervalProduct(far-packet.maxOrigin[a], far-packet.minOrigin[a], packet.minInvDirection[a], packet.maxInvDirection[a], lowerFar, upperFar);
+        //Every ray enters the box after the largest lower bound of the near distances and leaves it before the smallest upper bound of the far ones
+        entry = std::max(entry, lowerNear);
+        exit = std::min(exit, upperFar);
+    }
+    tEntry = entry;
+    return entry<=exit;
+}
+
+#ifdef RAYTRACER_SANDBOX_X86
+
+//Expand the 4 bits of a group of rays into a mask of lanes
+static inline __m128 laneMask(const int& bits)
+{
+    const __m128i lanes = _mm_set_epi32(8, 4, 2, 1);
+    return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(bits), lanes), lanes));
+}
+
+static inline __m128 select(const __m128& mask, const __m128& a, const __m128& b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+int IntersectBox(const RayPacket& packet, const int& mask, const Box& box, const float* tMax)
+{
+    int hitMask = 0;
+    const std::array<glm::vec3,2>& bounds = box.bounds();
+    for(int g=0; g<packet.lanes; g+=4)
+    {
+        const int bits = (mask>>g) & 0xF;
+        if(bits==0) continue;
+
+        __m128 tNear = _mm_setzero_ps();
+        __m128 tFar = _mm_loadu_ps(&tMax[g]);
+        for(int a=0; a<3; ++a)
+        {
+            const __m128 origin = _mm_load_ps(&packet.origins[a][g]);
+            const __m128 invDirection = _mm_load_ps(&packet.invDirections[a][g]);
+            //The near plane of each ray depends on the sign of its direction
+            const __m128 negative = _mm_cmplt_ps(invDirection, _mm_setzero_ps());
+            const __m128 minBound = _mm_set1_ps(bounds[0][a]), maxBound = _mm_set1_ps(bounds[1][a]);
+            const __m128 tMin = _mm_mul_ps(_mm_sub_ps(select(negative, maxBound, minBound), origin), invDirection);
+            const __m128 tMaxAxis = _mm_mul_ps(_mm_sub_ps(select(negative, minBound, maxBound), origin), invDirection);
+            //The second operand is returned when the first one is NaN, which ignores an axis where 0*inf occured
+            tNear = _mm_max_ps(tMin, tNear);
+            tFar = _mm_min_ps(tMaxAxis, tFar);
+        }
+        hitMask |= (_mm_movemask_ps(_mm_cmple_ps(tNear, tFar)) & bits)<<g;
+    }
+    return hitMask;
+}
+
+int IntersectSphere(const RayPacket& packet, const int& mask, const glm::vec3& center, const float& radius, float* t)
+{
+    int hitMask = 0;
+    for(int g=0; g<packet.lanes; g+=4)
+    {
+        const int bits = (mask>>g) & 0xF;
+        if(bits==0) continue;
+
+        const __m128 dx = _mm_load_ps(&packet.directions[0][g]), dy = _mm_load_ps(&packet.directions[1][g]), dz = _mm_load_ps(&packet.directions[2][g]);
+        const __m128 ocx = _mm_sub_ps(_mm_load_ps(&packet.origins[0][g]), _mm_set1_ps(center[0]));
+        const __m128 ocy = _mm_sub_ps(_mm_load_ps(&packet.origins[1][g]), _mm_set1_ps(center[1]));
+        const __m128 ocz = _mm_sub_ps(_mm_load_ps(&packet.origins[2][g]), _mm_set1_ps(center[2]));
+
+        const __m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        const __m128 b = _mm_mul_ps(_mm_set1_ps(2.0f), _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, ocx), _mm_mul_ps(dy, ocy)), _mm_mul_ps(dz, ocz)));
+        const __m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, ocx), _mm_mul_ps(ocy, ocy)), _mm_mul_ps(ocz, ocz)), _mm_set1_ps(radius*radius));
+        const __m128 delta = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(_mm_set1_ps(4.0f), _mm_mul_ps(a, c)));
+
+        //The roots of solveQuadratic(), the nearest positive one being kept
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 root = _mm_sqrt_ps(_mm_max_ps(delta, zero));
+        const __m128 twoA = _mm_mul_ps(_mm_set1_ps(2.0f), a);
+        const __m128 nearRoot = _mm_div_ps(_mm_sub_ps(_mm_sub_ps(zero, b), root), twoA);
+        const __m128 farRoot = _mm_div_ps(_mm_add_ps(_mm_sub_ps(zero, b), root), twoA);
+        const __m128 distance = select(_mm_cmpgt_ps(nearRoot, zero), nearRoot, farRoot);
+
+        const __m128 tClosest = _mm_loadu_ps(&t[g]);
+        __m128 hit = _mm_and_ps(laneMask(bits), _mm_cmpge_ps(delta, zero));
+        hit = _mm_and_ps(hit, _mm_cmpge_ps(farRoot, zero));
+        hit = _mm_and_ps(hit, _mm_cmplt_ps(distance, tClosest));
+        _mm_storeu_ps(&t[g], select(hit, distance, tClosest));
+        hitMask |= _mm_movemask_ps(hit)<<g;
+    }
+    return hitMask;
+}
+
+int IntersectPlane(const RayPacket& packet, const int& mask, const glm::vec3& normal, const float& distanceToOrigin, float* t)
+{
+    int hitMask = 0;
+    const __m128 nx = _mm_set1_ps(normal[0]), ny = _mm_set1_ps(normal[1]), nz = _mm_set1_ps(normal[2]);
+    for(int g=0; g<packet.lanes; g+=4)
+    {
+        const int bits = (mask>>g) & 0xF;
+        if(bits==0) continue;
+
+        const __m128 dotDirection = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(&packet.directions[0][g]), nx),
+                                                          _mm_mul_ps(_mm_load_ps(&packet.directions[1][g]), ny)),
+                                               _mm_mul_ps(_mm_load_ps(&packet.directions[2][g]), nz));
+        const __m128 dotOrigin = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(&packet.origins[0][g]), nx),
+                                                       _mm_mul_ps(_mm_load_ps(&packet.origins[1][g]), ny)),
+                                            _mm_mul_ps(_mm_load_ps(&packet.origins[2][g]), nz));
+        const __m128 distance = _mm_div_ps(_mm_sub_ps(_mm_set1_ps(distanceToOrigin), dotOrigin), dotDirection);
+
+        //Rays parallel to the plane are rejected
+        const __m128 absDotDirection = _mm_andnot_ps(_mm_set1_ps(-0.0f), dotDirection);
+        const __m128 tClosest = _mm_loadu_ps(&t[g]);
+        __m128 hit = _mm_and_ps(laneMask(bits), _mm_cmpgt_ps(absDotDirection, _mm_set1_ps(numeric_limits<float>::epsilon())));
+        hit = _mm_and_ps(hit, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+        hit = _mm_and_ps(hit, _mm_cmplt_ps(distance, tClosest));
+        _mm_storeu_ps(&t[g], select(hit, distance, tClosest));
+        hitMask |= _mm_movemask_ps(hit)<<g;
+    }
+    return hitMask;
+}
+
+int IntersectTriangle(const RayPacket& packet, const int& mask, const PrecomputedTriangle& triangle, float* t, float* u, float* v)
+{
+    int hitMask = 0;
+    const __m128 e1x = _mm_set1_ps(triangle.edge1[0]), e1y = _mm_set1_ps(triangle.edge1[1]), e1z = _mm_set1_ps(triangle.edge1[2]);
+    const __m128 e2x = _mm_set1_ps(triangle.edge2[0]), e2y = _mm_set1_ps(triangle.edge2[1]), e2z = _mm_set1_ps(triangle.edge2[2]);
+    for(int g=0; g<packet.lanes; g+=4)
+    {
+        const int bits = (mask>>g) & 0xF;
+        if(bits==0) continue;
+
+        const __m128 dx = _mm_load_ps(&packet.directions[0][g]), dy = _mm_load_ps(&packet.directions[1][g]), dz = _mm_load_ps(&packet.directions[2][g]);
+
+        //p = direction x edge2, determinant = edge1.p
+        const __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        const __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        const __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+        const __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+        //A null determinant gives NaN coordinates, which fail every comparison below
+        const __m128 invDeterminant = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+
+        //s = origin - v0, u = s.p / determinant
+        const __m128 sx = _mm_sub_ps(_mm_load_ps(&packet.origins[0][g]), _mm_set1_ps(triangle.v0[0]));
+        const __m128 sy = _mm_sub_ps(_mm_load_ps(&packet.origins[1][g]), _mm_set1_ps(triangle.v0[1]));
+        const __m128 sz = _mm_sub_ps(_mm_load_ps(&packet.origins[2][g]), _mm_set1_ps(triangle.v0[2]));
+        const __m128 us = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDeterminant);
+
+        //q = s x edge1, v = direction.q / determinant, distance = edge2.q / determinant
+        const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+        const __m128 vs = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDeterminant);
+        const __m128 distance = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDeterminant);
+
+        const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+        const __m128 tClosest = _mm_loadu_ps(&t[g]);
+        __m128 hit = _mm_and_ps(laneMask(bits), _mm_and_ps(_mm_cmpge_ps(us, zero), _mm_cmpge_ps(vs, zero)));
+        hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(us, vs), one));
+        hit = _mm_and_ps(hit, _mm_cmpge_ps(distance, zero));
+        hit = _mm_and_ps(hit, _mm_cmplt_ps(distance, tClosest));
+        const int hitBits = _mm_movemask_ps(hit);
+        if(hitBits==0) continue;
+
+        _mm_storeu_ps(&t[g], select(hit, distance, tClosest));
+        _mm_storeu_ps(&u[g], select(hit, us, _mm_loadu_ps(&u[g])));
+        _mm_storeu_ps(&v[g], select(hit, vs, _mm_loadu_ps(&v[g])));
+        hitMask |= hitBits<<g;
+    }
+    return hitMask;
+}
+
+#else
+
+//Scalar fallback of the SIMD kernels: the rays of the packet are tested one after another
+
+int IntersectBox(const RayPacket& packet, const int& mask, const Box& box, const float* tMax)
+{
+    int hitMask = 0;
+    for(int i=0; i<packet.size; ++i)
+    {
+        if((mask & (1<<i))==0) continue;
+        std::array<float,2> t;
+        if(Intersect(packet.rays[i], box, t) && t[1]>=0 && t[0]<=tMax[i]) hitMask |= 1<<i;
+    }
+    return hitMask;
+}
+
+int IntersectSphere(const RayPacket& packet, const int& mask, const glm::vec3& center, const float& radius, float* t)
+{
+    int hitMask = 0;
+    for(int i=0; i<packet.size; ++i)
+    {
+        if((mask & (1<<i))==0) continue;
+        const Ray& r = packet.rays[i];
+        const glm::vec3 oc = r.origin()-center;
+        float farRoot, nearRoot;
+        if(!solveQuadratic(glm::dot(r.direction(), r.direction()), 2.0f*glm::dot(r.direction(), oc), glm::dot(oc, oc)-radius*radius, farRoot, nearRoot)) continue;
+        if(farRoot<0.0f) continue;
+        const float distance = nearRoot>0.0f ? nearRoot : farRoot;
+        if(distance>=t[i]) continue;
+        t[i] = distance;
+        hitMask |= 1<<i;
+    }
+    return hitMask;
+}
+
+int IntersectPlane(const RayPacket& packet, const int& mask, const glm::vec3& normal, const float& distanceToOrigin, float* t)
+{
+    int hitMask = 0;
+    for(int i=0; i<packet.size; ++i)
+    {
+        if((mask & (1<<i))==0) continue;
+        const Ray& r = packet.rays[i];
+        const float dotDirection = glm::dot(r.direction(), normal);
+        if(std::abs(dotDirection)<=numeric_limits<float>::epsilon()) continue;
+        const float distance = (distanceToOrigin-glm::dot(r.origin(), normal))/dotDirection;
+        if(distance<0.0f || distance>=t[i]) continue;
+        t[i] = distance;
+        hitMask |= 1<<i;
+    }
+    return hitMask;
+}
+
+int IntersectTriangle(const RayPacket& packet, const int& mask, const PrecomputedTriangle& triangle, float* t, float* u, float* v)
+{
+    int hitMask = 0;
+    for(int i=0; i<packet.size; ++i)
+    {
+        if((mask & (1<<i))==0) continue;
+        float distance;
+        glm::vec3 barycentricCoords;
+        if(!precomputedTriangleRayIntersection(triangle, packet.rays[i], t[i], distance, barycentricCoords)) continue;
+        t[i] = distance;
+        u[i] = barycentricCoords[1];
+        v[i] = barycentricCoords[2];
+        hitMask |= 1<<i;
+    }
+    return hitMask;
+}
+
+#endif
@@ -0,0 +1,344 @@
+#include "./../include/raytracer-sandbox/renderer.hpp"
+#include "./../include/raytracer-sandbox/pathtracing.hpp"
+#include "./../include/raytracer-sandbox/raygenerator.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+
+using namespace std;
+
+const int Renderer::DefaultTileSize;
+const int Renderer::PacketWidth;
+const int Renderer::EdgeSamples;
+
+//Index of the cell (x,y) along the Hilbert curve covering a grid of n x n cells, n being a power of 2
+static int hilbertIndex(const int& n, int x, int y)
+{
+    int index = 0;
+    for(int s=n/2; s>0; s/=2)
+    {
+        const int rx = (x & s)>0;
+        const int ry = (y & s)>0;
+        index += s*s*((3*rx)^ry);
+        //Rotate the quadrant so that the curve inside it starts and ends next to its neighbours
+        if(ry==0)
+        {
+            if(rx==1)
+            {
+                x = n-1-x;
+                y = n-1-y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return index;
+}
+
+Renderer::~Renderer(){}
+
+Renderer::Renderer(const int& threadCount, const int& tileSize)
+    : m_tileSize((std::max(tileSize, 1)+PacketWidth-1)/PacketWidth*PacketWidth),
+      m_pool(threadCount),
+      m_shadowCaches(m_pool.threadCount()),
+      m_frameCount(0),
+      m_cancelledFrame(0)
+{
+}
+
+const int& Renderer::tileSize() const
+{
+    return m_tileSize;
+}
+
+int Renderer::threadCount() const
+{
+    return m_pool.threadCount();
+}
+
+const ThreadPool& Renderer::pool() const
+{
+    return m_pool;
+}
+
+ShadowCache Renderer::shadowCacheCounters() const
+{
+    ShadowCache counters;
+    for(const ShadowCache& cache : m_shadowCaches) counters += cache;
+    return counters;
+}
+
+std::vector<Tile> Renderer::tiles(const int& width, const int& height, const int& tileSize)
+{
+    const int columns = (width+tileSize-1)/tileSize;
+    const int rows = (height+tileSize-1)/tileSize;
+    int n = 1;
+    while(n<columns || n<rows) n *= 2;
+
+    //The curve covers the smallest power of 2 grid containing the tiles, the cells outside the frame being skipped
+    std::vector< std::pair<int,Tile> > orderedTiles;
+    orderedTiles.reserve(columns*rows);
+    for(int j=0; j<rows; ++j)
+    {
+        for(int i=0; i<columns; ++i)
+        {
+            Tile tile;
+            tile.x = i*tileSize;
+            tile.y = j*tileSize;
+            tile.width = std::min(tileSize, width-tile.x);
+            tile.height = std::min(tileSize, height-tile.y);
+            orderedTiles.push_back(std::make_pair(hilbertIndex(n, i, j), tile));
+        }
+    }
+    std::sort(orderedTiles.begin(), orderedTiles.end(), [](const std::pair<int,Tile>& a, const std::pair<int,Tile>& b){ return a.first<b.first; });
+
+    std::vector<Tile> result;
+    result.reserve(orderedTiles.size());
+    for(const std::pair<int,Tile>& t : orderedTiles) result.push_back(t.second);
+    return result;
+}
+
+glm::vec2 Renderer::sampleOffset(const int& index)
+{
+    //Radical inverse of index in bases 2 and 3, the sample 0 being the corner of the pixel as in RenderSettings::pixelOffsets
+    glm::vec2 offset(0,0);
+    const int bases[2] = {2, 3};
+    for(int a=0; a<2; ++a)
+    {
+        float digitWeight = 1.0f/bases[a];
+        for(int i=index; i>0; i/=bases[a])
+        {
+            offset[a] += digitWeight*(i%bases[a]);
+            digitWeight /= bases[a];
+        }
+    }
+    return offset;
+}
+
+bool Renderer::render(const Scene& scene, const std::vector<LightPtr>& lights, const Camera& camera, const RenderSettings& settings,
+                      std::vector<glm::vec3>& image, const TileCallback& tileDone)
+{
+    startFrame();
+
+    FrameBuffer frame(camera.width(), camera.height());
+    const bool done = settings.pixelOffsets.empty() || renderPass(scene, lights, camera, settings, settings.pixelOffsets, frame, tileDone);
+    frame.resolve(image);
+    return done;
+}
+
+bool Renderer::renderProgressive(const Scene& scene, const std::vector<LightPtr>& lights, const Camera& camera, const RenderSettings& settings,
+                                 FrameBuffer& frame, const int& passCount, const PassCallback& passDone, const TileCallback& tileDone)
+{
+    startFrame();
+
+    if(frame.width()!=camera.width() || frame.height()!=camera.height()) frame.resize(camera.width(), camera.height());
+    while(frame.passes()<passCount)
+    {
+        //The pixels of a cancelled pass already have its sample: each pixel takes the next sample of its own sequence
+        if(!renderPass(scene, lights, camera, settings, std::vector<glm::vec2>(), frame, tileDone)) return false;
+        frame.addPass();
+        if(passDone && !passDone(frame)) break;
+    }
+    return true;
+}
+
+bool Renderer::renderAdaptive(const Scene& scene, const std::vector<LightPtr>& lights, const Camera& camera, const RenderSettings& settings,
+                              FrameBuffer& frame, const PassCallback& passDone, const TileCallback& tileDone)
+{
+    startFrame();
+
+    frame.resize(camera.width(), camera.height());
+    const std::vector<glm::vec2> offsets(1, sampleOffset(0));
+    if(!renderPass(scene, lights, camera, settings, offsets, frame, tileDone)) return false;
+    frame.addPass();
+    if(passDone && !passDone(frame)) return true;
+
+    std::vector<char> refined;
+    while(refinedPixels(frame, settings, refined)>0)
+    {
+        if(!renderPixels(scene, lights, camera, settings, refined, frame, tileDone)) return false;
+        frame.addPass();
+        if(passDone && !passDone(frame)) break;
+    }
+    return true;
+}
+
+int Renderer::refinedPixels(const FrameBuffer& frame, const RenderSettings& settings, std::vector<char>& refined)
+{
+    const int width = frame.width(), height = frame.height();
+    //Only the pixels refined by the previous pass have new samples
+    const bool firstPass = (int)refined.size()!=width*height;
+    if(firstPass) refined.assign(width*height, 1);
+    int count = 0;
+    for(int y=0; y<height; ++y)
+    {
+        for(int x=0; x<width; ++x)
+        {
+            if(!refined[x+y*width]) continue;
+            refined[x+y*width] = 0;
+            const int& samples = frame.sampleCount(x, y);
+            if(samples==0 || samples>=settings.maxSamples) continue;
+
+            bool refine = std::sqrt(frame.variance(x, y)/samples)>settings.errorThreshold;
+            if(!refine && samples<EdgeSamples)
+            {
+                //The contrast is measured on the displayed colors, clamped to [0,1]
+                const glm::vec3 color = glm::clamp(frame.color(x, y), 0.0f, 1.0f);
+                const std::array<glm::ivec2,4> neighbours = {{ glm::ivec2(x-1,y), glm::ivec2(x+1,y), glm::ivec2(x,y-1), glm::ivec2(x,y+1) }};
+                for(const glm::ivec2& n : neighbours)
+                {
+                    if(n[0]<0 || n[0]>=width || n[1]<0 || n[1]>=height || frame.sampleCount(n[0], n[1])==0) continue;
+                    const glm::vec3 difference = glm::abs(glm::clamp(frame.color(n[0], n[1]), 0.0f, 1.0f)-color);
+                    if(std::max(difference[0], std::max(difference[1], difference[2]))>settings.contrastThreshold)
+                    {
+                        refine = true;
+                        break;
+                    }
+                }
+            }
+            if(refine)
+            {
+                refined[x+y*width] = 1;
+                ++count;
+            }
+        }
+    }
+    return count;
+}
+
+void Renderer::cancel()
+{
+    cancel(m_frameCount);
+}
+
+void Renderer::cancel(const std::uint64_t& frame)
+{
+    //The frames cancelled only grow, whichever of two concurrent calls comes last
+    std::uint64_t cancelledFrame = m_cancelledFrame;
+    while(cancelledFrame<frame && !m_cancelledFrame.compare_exchange_weak(cancelledFrame, frame));
+}
+
+std::uint64_t Renderer::frameCount() const
+{
+    return m_frameCount;
+}
+
+void Renderer::startFrame()
+{
+    ++m_frameCount;
+    //The cached occluders may belong to the scene of the previous frame
+    for(ShadowCache& cache : m_shadowCaches) cache.clear();
+}
+
+bool Renderer::cancelled() const
+{
+    return m_cancelledFrame>=m_frameCount;
+}
+
+bool Renderer::renderPass(const Scene& scene, const std::vector<LightPtr>& lights, const Camera& camera, const RenderSettings& settings,
+                          const std::vector<glm::vec2>& offsets, FrameBuffer& frame, const TileCallback& tileDone)
+{
+    const CameraRayGenerator rayGenerator(camera);
+    const std::vector<Tile> frameTiles = tiles(camera.width(), camera.height(), m_tileSize);
+    m_pool.run(frameTiles.size(), [&](const int& job, const int& thread)
+    {
+        const Tile& tile = frameTiles[job];
+        ShadowCache* shadowCache = settings.shadowCache ? &m_shadowCaches[thread] : nullptr;
+        for(int j=tile.y; j<tile.y+tile.height; j+=PacketWidth)
+        {
+            for(int i=tile.x; i<tile.x+tile.width; i+=PacketWidth)
+            {
+                //A cancelled frame stops at the next block, the blocks left keeping their previous samples
+                if(cancelled()) return;
+
+                const int blockWidth = std::min(PacketWidth, tile.x+tile.width-i);
+                const int blockHeight = std::min(PacketWidth, tile.y+tile.height-j);
+
+                //Without offsets, the pixels of a block share their number of samples, a cancelled pass stopping between blocks
+                bool sharedOffset = true;
+                for(int y=j; y<j+blockHeight; ++y)
+                {
+                    for(int x=i; x<i+blockWidth; ++x) sharedOffset = sharedOffset && frame.sampleCount(x, y)==frame.sampleCount(i, j);
+                }
+
+                const int sampleCount = offsets.empty() ? 1 : offsets.size();
+                for(int s=0; s<sampleCount; ++s)
+                {
+                    //The blocks crossing the border of the frame trace the rays of the missing pixels too, which are dropped
+                    RayPacket packet;
+                    if(!offsets.empty() || sharedOffset)
+                    {
+                        const glm::vec2 offset = offsets.empty() ? sampleOffset(frame.sampleCount(i, j)) : offsets[s];
+                        packet = rayGenerator.generatePacket(i+offset[0], j+offset[1], PacketWidth);
+                    }
+                    else
+                    {
+                        std::array<Ray, RayPacket::MaxSize> rays;
+                        for(int y=j; y<j+PacketWidth; ++y)
+                        {
+                            for(int x=i; x<i+PacketWidth; ++x)
+                            {
+                                const bool inside = x<i+blockWidth && y<j+blockHeight;
+                                const glm::vec2 offset = sampleOffset(frame.sampleCount(inside ? x : i, inside ? y : j));
+                                rays[(x-i)+(y-j)*PacketWidth] = rayGenerator.generate(x+offset[0], y+offset[1]);
+                            }
+                        }
+                        packet = RayPacket(rays.data(), PacketWidth*PacketWidth);
+                    }
+                    std::array<glm::vec3, RayPacket::MaxSize> colors;
+                    castRayPacket(packet, lights, scene, settings.backgroundColor, settings.shadowColor, settings.bias, settings.maxDepth, 0, colors.data(), shadowCache);
+                    for(int y=j; y<j+blockHeight; ++y)
+                    {
+                        for(int x=i; x<i+blockWidth; ++x)
+                        {
+                            frame.add(x, y, colors[(x-i)+(y-j)*PacketWidth]);
+                        }
+                    }
+                }
+            }
+        }
+        if(tileDone) tileDone(tile);
+    });
+    return !cancelled();
+}
+
+bool Renderer::renderPixels(const Scene& scene, const std::vector<LightPtr>& lights, const Camera& camera, const RenderSettings& settings,
+                            const std::vector<char>& refined, FrameBuffer& frame, const TileCallback& tileDone)
+{
+    const CameraRayGenerator rayGenerator(camera);
+    const std::vector<Tile> frameTiles = tiles(camera.width(), camera.height(), m_tileSize);
+    m_pool.run(frameTiles.size(), [&](const int& job, const int& thread)
+    {
+        const Tile& tile = frameTiles[job];
+        ShadowCache* shadowCache = settings.shadowCache ? &m_shadowCaches[thread] : nullptr;
+
+        //The selected pixels of a tile are close enough for their rays to be traced as packets
+        std::vector<glm::ivec2> pixels;
+        for(int y=tile.y; y<tile.y+tile.height; ++y)
+        {
+            for(int x=tile.x; x<tile.x+tile.width; ++x)
+            {
+                if(refined[x+y*camera.width()]) pixels.push_back(glm::ivec2(x,y));
+            }
+        }
+        for(size_t first=0; first<pixels.size(); first+=RayPacket::MaxSize)
+        {
+            if(cancelled()) return;
+
+            const int count = std::min((int)(pixels.size()-first), RayPacket::MaxSize);
+            std::array<Ray, RayPacket::MaxSize> rays;
+            for(int r=0; r<count; ++r)
+            {
+                const glm::ivec2& p = pixels[first+r];
+                const glm::vec2 offset = sampleOffset(frame.sampleCount(p[0], p[1]));
+                rays[r] = rayGenerator.generate(p[0]+offset[0], p[1]+offset[1]);
+            }
+            const RayPacket packet(rays.data(), count);
+            std::array<glm::vec3, RayPacket::MaxSize> colors;
+            castRayPacket(packet, lights, scene, settings.backgroundColor, settings.shadowColor, settings.bias, settings.maxDepth, 0, colors.data(), shadowCache);
+            for(int r=0; r<count; ++r) frame.add(pixels[first+r][0], pixels[first+r][1], colors[r]);
+        }
+        if(tileDone) tileDone(tile);
+    });
+    return !cancelled();
+}
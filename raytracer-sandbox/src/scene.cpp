@@ -0,0 +1,225 @@
+#include "./../include/raytracer-sandbox/scene.hpp"
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+Scene::~Scene()
+{}
+
+Scene::Scene(const vector<ObjectPtr>& objects, const AccelerationType& accelerationType, const BVHBuildSettings& bvhSettings)
+{
+    m_objects = objects;
+    m_accelerationType = accelerationType;
+    m_bvhSettings = bvhSettings;
+
+    vector<Box> boxes;
+    for(size_t i=0; i<m_objects.size(); ++i)
+    {
+        const ObjectPtr& o = m_objects[i];
+        if(o->bbox().isFinite())
+        {
+            m_boundedObjects.push_back(o);
+            m_boundedObjectIds.push_back(i);
+            boxes.push_back(o->bbox());
+        }
+        else
+        {
+            m_unboundedObjectIds.push_back(i);
+        }
+    }
+
+    if(m_accelerationType == OCTREE)
+    {
+        buildOctree(boxes);
+    }
+    else
+    {
+        m_bvh = BVH(boxes, bvhSettings);
+    }
+}
+
+void Scene::buildOctree(const vector<Box>& boxes)
+{
+    m_octree = nullptr;
+    if(boxes.empty()) return;
+    Box sceneBox = Box::Empty();
+    for(const Box& b : boxes) sceneBox.extend(b);
+    std::array<glm::vec3,2> bounds = sceneBox.bounds();
+    const int maxDepth = 12;
+    m_octree = make_shared< Octree<int> >(Extent(bounds), maxDepth);
+    for(size_t i=0; i<boxes.size(); ++i)
+    {
+        m_octree->insert(i, boxes[i]);
+    }
+}
+
+bool Scene::refit()
+{
+    vector<Box> boxes(m_boundedObjects.size());
+    for(size_t i=0; i<m_boundedObjects.size(); ++i)
+    {
+        boxes[i] = m_boundedObjects[i]->bbox();
+    }
+
+    if(m_accelerationType == OCTREE)
+    {
+        buildOctree(boxes);
+        return true;
+    }
+    return m_bvh.refit(boxes);
+}
+
+const vector<ObjectPtr>& Scene::objects() const
+{
+    return m_objects;
+}
+
+const BVH& Scene::bvh() const
+{
+    return m_bvh;
+}
+
+const shared_ptr< Octree<int> >& Scene::octree() const
+{
+    return m_octree;
+}
+
+const AccelerationType& Scene::accelerationType() const
+{
+    return m_accelerationType;
+}
+
+bool Scene::intersect(const Ray& r, float& tMax, HitRecord& hit) const
+{
+    bool found = false;
+    for(const int& id : m_unboundedObjectIds)
+    {
+        if(!m_objects[id]->Intersect(r, tMax, hit)) continue;
+        hit.objectId = id;
+        found = true;
+    }
+
+    //The object only updates the hit if it is closer than the closest one found so far
+    auto boundedIntersector = [&](const int& id, const Ray& ray, float& tClosest)
+    {
+        if(!m_boundedObjects[id]->Intersect(ray, tClosest, hit)) return false;
+        hit.objectId = m_boundedObjectIds[id];
+        return true;
+    };
+    if(m_octree != nullptr)
+        found = m_octree->intersect(r, tMax, boundedIntersector) || found;
+    else
+        found = m_bvh.intersect(r, tMax, boundedIntersector) || found;
+
+    return found;
+}
+
+void Scene::HitSurface(const Ray& r, const HitRecord& hit, glm::vec3& hitPosition, glm::vec3& hitNormal) const
+{
+    m_objects[hit.objectId]->HitSurface(r, hit, hitPosition, hitNormal);
+    hitNormal = glm::normalize(hitNormal);
+}
+
+bool Scene::occluded(const Ray& r, const float& tMax, const Object* ignoredObject) const
+{
+    const Object* occluder = nullptr;
+    return occluded(r, tMax, ignoredObject, occluder);
+}
+
+bool Scene::occluded(const Ray& r, const float& tMax, const Object* ignoredObject, const Object*& occluder) const
+{
+    occluder = nullptr;
+    auto objectOccluder = [&](const Object* o, const Ray& ray, const float& t)
+    {
+        if(o == ignoredObject || o->material()->type() == MaterialType::FRESNEL) return false;
+        if(!o->Occluded(ray, t)) return false;
+        occluder = o;
+        return true;
+    };
+
+    for(const int& id : m_unboundedObjectIds)
+    {
+        if(objectOccluder(m_objects[id].get(), r, tMax)) return true;
+    }
+
+    auto boundedOccluder = [&](const int& id, const Ray& ray, const float& t)
+    {
+        return objectOccluder(m_boundedObjects[id].get(), ray, t);
+    };
+    if(m_octree != nullptr)
+        return m_octree->occluded(r, tMax, boundedOccluder);
+    return m_bvh.occluded(r, tMax, boundedOccluder);
+}
+
+bool Scene::intersect(const Ray& r, ObjectPtr& closestHitObject, glm::vec3& closestHitPosition, glm::vec3& closestHitNormal) const
+{
+    closestHitObject = nullptr;
+    float tMax = numeric_limits<float>::max();
+    HitRecord hit;
+    if(!intersect(r, tMax, hit)) return false;
+
+    closestHitObject = m_objects[hit.objectId];
+    HitSurface(r, hit, closestHitPosition, closestHitNormal);
+    return true;
+}
+
+int Scene::intersect(const RayPacket& packet, ObjectPtr* closestHitObjects, RayPacketHits& hits) const
+{
+    int hitMask = 0;
+    std::fill(closestHitObjects, closestHitObjects+RayPacket::MaxSize, nullptr);
+
+    if(!packet.coherent || m_octree != nullptr)
+    {
+        for(int i=0; i<packet.size; ++i)
+        {
+            float tMax = numeric_limits<float>::max();
+            HitRecord hit;
+            if(!intersect(packet.rays[i], tMax, hit)) continue;
+            hits.t[i] = tMax;
+            hits.objectIds[i] = hit.objectId;
+            hits.primitiveIds[i] = hit.primitiveId;
+            hits.barycentrics[i] = hit.barycentrics;
+            hitMask |= 1<<i;
+        }
+    }
+    else
+    {
+        //Record the object for the rays it is now the closest hit of
+        auto intersector = [&](const int& id, const int& mask)
+        {
+            const int objectHitMask = m_objects[id]->IntersectPacket(packet, mask, hits);
+            for(int i=0; i<packet.size; ++i)
+            {
+                if(objectHitMask & (1<<i)) hits.objectIds[i] = id;
+            }
+            return objectHitMask;
+        };
+
+        for(const int& id : m_unboundedObjectIds)
+        {
+            hitMask |= intersector(id, packet.mask());
+        }
+
+        auto leafIntersector = [&](const int& first, const int& count, const RayPacket&, const int& mask, float*)
+        {
+            int leafHitMask = 0;
+            for(int i=first; i<first+count; ++i)
+            {
+                leafHitMask |= intersector(m_boundedObjectIds[m_bvh.primitiveIndices()[i]], mask);
+            }
+            return leafHitMask;
+        };
+        hitMask |= m_bvh.intersectPacket(packet, packet.mask(), hits.t, leafIntersector);
+    }
+
+    //Compute the positions and normals of the closest hits only
+    for(int i=0; i<packet.size; ++i)
+    {
+        if((hitMask & (1<<i))==0) continue;
+        const HitRecord hit{hits.t[i], hits.objectIds[i], hits.primitiveIds[i], hits.barycentrics[i]};
+        closestHitObjects[i] = m_objects[hit.objectId];
+        HitSurface(packet.rays[i], hit, hits.positions[i], hits.normals[i]);
+    }
+    return hitMask;
+}
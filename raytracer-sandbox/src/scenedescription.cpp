@@ -0,0 +1,247 @@
+#include "./../include/raytracer-sandbox/scenedescription.hpp"
+#include "./../include/raytracer-sandbox/directionalLight.hpp"
+#include "./../include/raytracer-sandbox/material.hpp"
+#include "./../include/raytracer-sandbox/plane.hpp"
+#include "./../include/raytracer-sandbox/pointLight.hpp"
+#include "./../include/raytracer-sandbox/sphere.hpp"
+#include "./../include/raytracer-sandbox/spotLight.hpp"
+#include "./../include/raytracer-sandbox/tmesh.hpp"
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace std;
+
+static bool readVec3(istream& in, glm::vec3& v)
+{
+    return bool(in >> v[0] >> v[1] >> v[2]);
+}
+
+static bool readMaterial(istream& in, MaterialPtr& material, string& reason)
+{
+    string name;
+    if(!(in >> name))
+    {
+        reason = "missing material";
+        return false;
+    }
+    if(name=="pearl") material = PhongMaterial::Pearl();
+    else if(name=="emerald") material = PhongMaterial::Emerald();
+    else if(name=="bronze") material = PhongMaterial::Bronze();
+    else if(name=="glossy") material = std::make_shared<GlossyMaterial>();
+    else if(name=="fresnel")
+    {
+        float ior;
+        if(!(in >> ior))
+        {
+            reason = "fresnel expects <ior>";
+            return false;
+        }
+        material = std::make_shared<FresnelMaterial>(ior);
+    }
+    else if(name=="phong")
+    {
+        glm::vec3 ambient, diffuse, specular;
+        float shininess;
+        if(!readVec3(in, ambient) || !readVec3(in, diffuse) || !readVec3(in, specular) || !(in >> shininess))
+        {
+            reason = "phong expects <ambient> <diffuse> <specular> <shininess>";
+            return false;
+        }
+        material = std::make_shared<PhongMaterial>(ambient, diffuse, specular, shininess);
+    }
+    else
+    {
+        reason = "unknown material '" + name + "'";
+        return false;
+    }
+    return true;
+}
+
+//Parse a statement, the keyword being already read
+static bool readStatement(const string& keyword, istream& in, const string& directory, SceneDescription& description, string& reason)
+{
+    if(keyword=="camera")
+    {
+        float fov;
+        if(!(in >> fov) || !readVec3(in, description.eye) || !readVec3(in, description.target))
+        {
+            reason = "camera expects <fov> <eye> <target> [<up>]";
+            return false;
+        }
+        description.fov = glm::radians(fov);
+        if(!(in >> ws).eof() && !readVec3(in, description.up))
+        {
+            reason = "camera expects <fov> <eye> <target> [<up>]";
+            return false;
+        }
+    }
+    else if(keyword=="clip")
+    {
+        if(!(in >> description.nearPlane >> description.farPlane))
+        {
+            reason = "clip expects <near> <far>";
+            return false;
+        }
+    }
+    else if(keyword=="background" || keyword=="shadow")
+    {
+        glm::vec3& color = keyword=="background" ? description.settings.backgroundColor : description.settings.shadowColor;
+        if(!readVec3(in, color))
+        {
+            reason = keyword + " expects <color>";
+            return false;
+        }
+    }
+    else if(keyword=="bias")
+    {
+        if(!(in >> description.settings.bias))
+        {
+            reason = "bias expects <bias>";
+            return false;
+        }
+    }
+    else if(keyword=="depth")
+    {
+        if(!(in >> description.settings.maxDepth))
+        {
+            reason = "depth expects <maxDepth>";
+            return false;
+        }
+    }
+    else if(keyword=="sphere")
+    {
+        glm::vec3 center;
+        float radius;
+        MaterialPtr material;
+        if(!readVec3(in, center) || !(in >> radius))
+        {
+            reason = "sphere expects <center> <radius> <material>";
+            return false;
+        }
+        if(!readMaterial(in, material, reason)) return false;
+        description.objects.push_back(std::make_shared<Sphere>(center, radius, material));
+    }
+    else if(keyword=="plane")
+    {
+        glm::vec3 normal, point;
+        MaterialPtr material;
+        if(!readVec3(in, normal) || !readVec3(in, point))
+        {
+            reason = "plane expects <normal> <point> <material>";
+            return false;
+        }
+        if(!readMaterial(in, material, reason)) return false;
+        description.objects.push_back(std::make_shared<Plane>(normal, point, material));
+    }
+    else if(keyword=="mesh")
+    {
+        string path;
+        MaterialPtr material;
+        if(!(in >> path))
+        {
+            reason = "mesh expects <obj path> <material>";
+            return false;
+        }
+        if(!readMaterial(in, material, reason)) return false;
+        const string filename = (directory.empty() || path[0]=='/') ? path : directory + "/" + path;
+        //TMesh does not report a missing file, which would silently render an empty mesh
+        if(!ifstream(filename))
+        {
+            reason = "cannot open mesh '" + filename + "'";
+            return false;
+        }
+        description.objects.push_back(std::make_shared<TMesh>(filename, material));
+    }
+    else if(keyword=="directional")
+    {
+        glm::vec3 direction, ambient, diffuse, specular;
+        if(!readVec3(in, direction) || !readVec3(in, ambient) || !readVec3(in, diffuse) || !readVec3(in, specular))
+        {
+            reason = "directional expects <direction> <ambient> <diffuse> <specular>";
+            return false;
+        }
+        description.lights.push_back(std::make_shared<DirectionalLight>(direction, ambient, diffuse, specular));
+    }
+    else if(keyword=="point")
+    {
+        glm::vec3 position, ambient, diffuse, specular;
+        float constant, linear, quadratic;
+        if(!readVec3(in, position) || !readVec3(in, ambient) || !readVec3(in, diffuse) || !readVec3(in, specular)
+                || !(in >> constant >> linear >> quadratic))
+        {
+            reason = "point expects <position> <ambient> <diffuse> <specular> <constant> <linear> <quadratic>";
+            return false;
+        }
+        description.lights.push_back(std::make_shared<PointLight>(position, ambient, diffuse, specular, constant, linear, quadratic));
+    }
+    else if(keyword=="spot")
+    {
+        glm::vec3 position, direction, ambient, diffuse, specular;
+        float constant, linear, quadratic, innerCutOff, outerCutOff;
+        if(!readVec3(in, position) || !readVec3(in, direction) || !readVec3(in, ambient) || !readVec3(in, diffuse) || !readVec3(in, specular)
+                || !(in >> constant >> linear >> quadratic >> innerCutOff >> outerCutOff))
+        {
+            reason = "spot expects <position> <direction> <ambient> <diffuse> <specular> <constant> <linear> <quadratic> <inner cut off> <outer cut off>";
+            return false;
+        }
+        description.lights.push_back(std::make_shared<SpotLight>(position, direction, ambient, diffuse, specular, constant, linear, quadratic,
+                                                                 std::cos(glm::radians(innerCutOff)), std::cos(glm::radians(outerCutOff))));
+    }
+    else
+    {
+        reason = "unknown statement '" + keyword + "'";
+        return false;
+    }
+
+    string extra;
+    if(in >> extra)
+    {
+        reason = "unexpected '" + extra + "' after " + keyword;
+        return false;
+    }
+    return true;
+}
+
+Camera SceneDescription::camera(const int& width, const int& height) const
+{
+    Camera c(fov, width, height, nearPlane, farPlane);
+    c.view() = glm::lookAt(eye, target, up);
+    return c;
+}
+
+bool read_scene(const string& filename, SceneDescription& description, string& error)
+{
+    ifstream file(filename);
+    if(!file)
+    {
+        error = "cannot open '" + filename + "'";
+        return false;
+    }
+    const size_t separator = filename.find_last_of('/');
+    const string directory = separator==string::npos ? string() : filename.substr(0, separator);
+    if(!read_scene(file, directory, description, error))
+    {
+        error = filename + ":" + error;
+        return false;
+    }
+    return true;
+}
+
+bool read_scene(istream& stream, const string& directory, SceneDescription& description, string& error)
+{
+    string line;
+    for(int lineNumber=1; getline(stream, line); ++lineNumber)
+    {
+        istringstream in(line.substr(0, line.find('#')));
+        string keyword, reason;
+        if(!(in >> keyword)) continue;
+        if(!readStatement(keyword, in, directory, description, reason))
+        {
+            error = std::to_string(lineNumber) + ": " + reason;
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,51 @@
+#include "./../include/raytracer-sandbox/shadowcache.hpp"
+
+using namespace std;
+
+ShadowCache::~ShadowCache(){}
+
+const Object* ShadowCache::occluder(const int& light) const
+{
+    return light<(int)m_occluders.size() ? m_occluders[light] : nullptr;
+}
+
+void ShadowCache::setOccluder(const int& light, const Object* occluder)
+{
+    if(light>=(int)m_occluders.size()) m_occluders.resize(light+1, nullptr);
+    m_occluders[light] = occluder;
+}
+
+void ShadowCache::count(const bool& hit)
+{
+    ++m_lookups;
+    if(hit) ++m_hits;
+}
+
+const uint64_t& ShadowCache::lookups() const
+{
+    return m_lookups;
+}
+
+const uint64_t& ShadowCache::hits() const
+{
+    return m_hits;
+}
+
+float ShadowCache::hitRate() const
+{
+    return m_lookups>0 ? float(m_hits)/float(m_lookups) : 0.0f;
+}
+
+void ShadowCache::clear()
+{
+    m_occluders.clear();
+    m_lookups = 0;
+    m_hits = 0;
+}
+
+ShadowCache& ShadowCache::operator+=(const ShadowCache& cache)
+{
+    m_lookups += cache.m_lookups;
+    m_hits += cache.m_hits;
+    return *this;
+}
@@ -18,30 +18,50 @@ const glm::vec3& Sphere::position() const {return m_position;}
 
 const float& Sphere::radius() const {return m_radius;}
 
-bool Sphere::Intersect(const Ray& r, glm::vec3& hitPosition, glm::vec3& hitNormal) const
+bool Sphere::Intersect(const Ray& r, float& tMax, HitRecord& hit) const
 {
     float a = glm::length2(r.direction());
     float b = 2.0*glm::dot(r.direction(), r.origin()-this->position());
     float c = glm::length2(r.origin()-this->position())-this->radius()*this->radius();
     float t0=-1, t1=-1;
     bool intersect = solveQuadratic(a,b,c,t0,t1);
-    if(intersect)
-    {
-        if(t0<0 && t1<0) return false;
-        float minT = t0;
-        if(t0<t1 && t0>0) minT = t0;
-        if(t0>t1 && t1>0) minT = t1;
-        //if(t0>0 || t1>0)
-        //{
-        hitPosition = r.origin() + minT*r.direction();
-        hitNormal = glm::normalize(hitPosition-this->position());
-        return true;
-        //}
-    }
-    else
+    if(!intersect) return false;
+    if(t0<0 && t1<0) return false;
+    float minT = t0;
+    if(t0<t1 && t0>0) minT = t0;
+    if(t0>t1 && t1>0) minT = t1;
+    if(minT>=tMax) return false;
+    tMax = minT;
+    hit.t = minT;
+    hit.primitiveId = -1;
+    return true;
+}
+
+void Sphere::HitSurface(const Ray& r, const HitRecord& hit, glm::vec3& hitPosition, glm::vec3& hitNormal) const
+{
+    hitPosition = r.origin() + hit.t*r.direction();
+    hitNormal = glm::normalize(hitPosition-this->position());
+}
+
+bool Sphere::Occluded(const Ray& r, const float& tMax) const
+{
+    //Either root in [0,tMax) blocks the ray, whichever is the closest
+    float a = glm::length2(r.direction());
+    float b = 2.0*glm::dot(r.direction(), r.origin()-this->position());
+    float c = glm::length2(r.origin()-this->position())-this->radius()*this->radius();
+    float t0=-1, t1=-1;
+    if(!solveQuadratic(a,b,c,t0,t1)) return false;
+    return (t0>=0 && t0<tMax) || (t1>=0 && t1<tMax);
+}
+
+int Sphere::IntersectPacket(const RayPacket& packet, const int& mask, RayPacketHits& hits) const
+{
+    int hitMask = IntersectSphere(packet, mask, m_position, m_radius, hits.t);
+    for(int i=0; i<packet.size; ++i)
     {
-        return false;
+        if(hitMask & (1<<i)) hits.primitiveIds[i] = -1;
     }
+    return hitMask;
 }
 
 std::ostream& operator << ( std::ostream& out, const Sphere& o)
@@ -159,3 +159,8 @@ glm::vec3 SpotLight::   lightDirectionFrom(const glm::vec3& position) const
 {
     return position==m_position ? glm::vec3(0,0,0) : glm::normalize(position-m_position);
 }
+
+float SpotLight::distanceFrom(const glm::vec3& position) const
+{
+    return glm::length(m_position-position);
+}
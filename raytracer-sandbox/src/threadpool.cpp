@@ -0,0 +1,109 @@
+#include "./../include/raytracer-sandbox/threadpool.hpp"
+#include <algorithm>
+
+using namespace std;
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_batchStarted.notify_all();
+    for(std::thread& t : m_threads) t.join();
+}
+
+ThreadPool::ThreadPool(const int& threadCount)
+    : m_steals(0)
+{
+    int count = threadCount;
+    if(count<=0) count = std::max(1, (int)std::thread::hardware_concurrency());
+    for(int i=0; i<count; ++i) m_queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    for(int i=0; i<count; ++i) m_threads.push_back(std::thread(&ThreadPool::work, this, i));
+}
+
+int ThreadPool::threadCount() const
+{
+    return m_threads.size();
+}
+
+void ThreadPool::run(const int& jobCount, const Job& job)
+{
+    if(jobCount<=0) return;
+
+    //Each thread starts with a contiguous range of jobs
+    const int count = m_queues.size();
+    for(int i=0; i<count; ++i)
+    {
+        std::lock_guard<std::mutex> lock(m_queues[i]->mutex);
+        const int first = (long long)jobCount*i/count, last = (long long)jobCount*(i+1)/count;
+        for(int j=first; j<last; ++j) m_queues[i]->jobs.push_back(j);
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_job = &job;
+    m_steals = 0;
+    m_busyThreads = count;
+    ++m_batch;
+    m_batchStarted.notify_all();
+    m_batchDone.wait(lock, [this]{ return m_busyThreads==0; });
+    m_job = nullptr;
+}
+
+std::uint64_t ThreadPool::steals() const
+{
+    return m_steals;
+}
+
+void ThreadPool::work(const int& thread)
+{
+    std::uint64_t batch = 0;
+    while(true)
+    {
+        const Job* job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_batchStarted.wait(lock, [&]{ return m_stop || m_batch!=batch; });
+            if(m_stop) return;
+            batch = m_batch;
+            job = m_job;
+        }
+
+        //The jobs are only queued before a batch starts: once all the queues are empty, the thread is done
+        int index;
+        while(take(thread, index)) (*job)(index, thread);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(--m_busyThreads==0) m_batchDone.notify_one();
+    }
+}
+
+bool ThreadPool::take(const int& thread, int& job)
+{
+    {
+        Queue& queue = *m_queues[thread];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(!queue.jobs.empty())
+        {
+            job = queue.jobs.front();
+            queue.jobs.pop_front();
+            return true;
+        }
+    }
+
+    //Steal from the back of the other queues, the jobs their owners would have run last
+    const int count = m_queues.size();
+    for(int k=1; k<count; ++k)
+    {
+        Queue& queue = *m_queues[(thread+k)%count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(!queue.jobs.empty())
+        {
+            job = queue.jobs.back();
+            queue.jobs.pop_back();
+            ++m_steals;
+            return true;
+        }
+    }
+    return false;
+}
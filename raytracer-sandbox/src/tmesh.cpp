@@ -1,14 +1,281 @@
 #include "./../include/raytracer-sandbox/tmesh.hpp"
 #include "./../include/raytracer-sandbox/io.hpp"
+#include "./../include/raytracer-sandbox/cache.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
 
 TMesh::~TMesh(){}
 
-TMesh::TMesh(const std::string& filename, const MaterialPtr& material)
+/** @brief Header of a cache file, followed by the arrays of the mesh and its hierarchy, each aligned on 64 bytes. */
+struct TMeshCacheHeader
+{
+    char magic[8]; /*!< "RTSBVH" */
+    std::uint32_t version; /*!< The version of the layout of the file. */
+    std::uint32_t nodeSize; /*!< sizeof(BVHFlatNode). */
+    std::uint64_t key; /*!< The hash of the content of the obj file and of the build settings. */
+    std::uint64_t positionCount;
+    std::uint64_t normalCount;
+    std::uint64_t texCoordCount;
+    std::uint64_t indexCount;
+    std::uint64_t nodeCount;
+    std::uint64_t primitiveIndexCount;
+    std::uint64_t wideNodeCount; /*!< The number of wide nodes, of the width of the settings. */
+    BVHBuildSettings settings; /*!< The settings of the hierarchy, as returned by BVH::settings(). */
+    float builtSahCost;
+    float bbox[2][3]; /*!< The bounding box of the mesh, so that the positions are not read to compute it. */
+};
+
+static const char TMeshCacheMagic[8] = "RTSBVH";
+static const std::uint32_t TMeshCacheVersion = 3;
+static const std::size_t TMeshCacheAlignment = 64;
+
+//The width of the triangle blocks: blocks of 8 are mostly empty unless the leaves hold more than 4 triangles
+static int triangleBlockWidth(const BVHBuildSettings& settings)
+{
+    return SupportsAVX2() && settings.maxLeafSize>4 ? 8 : 4;
+}
+
+static std::size_t alignCacheOffset(const std::size_t& offset)
+{
+    return (offset + TMeshCacheAlignment-1) & ~(TMeshCacheAlignment-1);
+}
+
+//The hash of an obj file and of the settings changing the hierarchy built over it, false if the file cannot be read
+static bool cacheKey(const std::string& filename, const BVHBuildSettings& settings, std::uint64_t& key)
+{
+    //The content of the file rather than its path or status, so that a copy shares the cache and an edit keeping the size and time misses it
+    if(!HashFile(filename, key)) return false;
+    key = HashBytes(&TMeshCacheVersion, sizeof(TMeshCacheVersion), key);
+    key = HashBytes(&settings.method, sizeof(settings.method), key);
+    key = HashBytes(&settings.maxLeafSize, sizeof(settings.maxLeafSize), key);
+    key = HashBytes(&settings.traversalCost, sizeof(settings.traversalCost), key);
+    key = HashBytes(&settings.intersectionCost, sizeof(settings.intersectionCost), key);
+    key = HashBytes(&settings.binCount, sizeof(settings.binCount), key);
+    key = HashBytes(&settings.width, sizeof(settings.width), key);
+    key = HashBytes(&settings.rebuildThreshold, sizeof(settings.rebuildThreshold), key);
+    key = HashBytes(&settings.treeletSize, sizeof(settings.treeletSize), key);
+    key = HashBytes(&settings.spatialSplitBudget, sizeof(settings.spatialSplitBudget), key);
+    key = HashBytes(&settings.spatialSplitOverlap, sizeof(settings.spatialSplitOverlap), key);
+    return true;
+}
+
+static std::string cacheName(const std::uint64_t& key)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bvh", (unsigned long long)key);
+    return name;
+}
+
+TMesh::TMesh(const std::string& filename, const MaterialPtr& material, const BVHBuildSettings& bvhSettings, const ExtentSettingsPtr& extentSettings,
+             const std::string& cacheDirectory)
 {
     this->material() = material;
 
-    read_obj(filename, m_positions, m_indices, m_normals, m_texCoords);
+    std::uint64_t key = 0;
+    const bool cached = !cacheDirectory.empty() && cacheKey(filename, bvhSettings, key);
+    const std::string cacheFilename = cached ? cacheDirectory + "/" + cacheName(key) : std::string();
+    if(!cached || !readCache(cacheFilename, key))
+    {
+        read_obj(filename, m_positions.detach(), m_indices.detach(), m_normals.detach(), m_texCoords.detach());
+
+        //Build the hierarchy over the triangles once at load time
+        m_bvh = BVH(computeBoxes(), bvhSettings, [this](const int& i, const int& axis, const float& position, Box& left, Box& right)
+        {
+            splitTriangle(i, axis, position, left, right);
+        });
+        computeTriangleBlocks();
+        if(cached) writeCache(cacheFilename, key);
+    }
+    if(extentSettings!=nullptr) buildExtentBVH(extentSettings);
+}
+
+std::string TMesh::CacheFilename(const std::string& cacheDirectory, const std::string& filename, const BVHBuildSettings& bvhSettings)
+{
+    std::uint64_t key;
+    if(!cacheKey(filename, bvhSettings, key)) return std::string();
+    return cacheDirectory + "/" + cacheName(key);
+}
+
+//Map an array of the cache file in place and move to the next one
+template<typename TVector>
+static MappedArray<TVector> mapCacheArray(const MappedFilePtr& file, std::size_t& offset, const std::uint64_t& count)
+{
+    typedef typename TVector::value_type T;
+    offset = alignCacheOffset(offset);
+    const T* begin = reinterpret_cast<const T*>(file->data()+offset);
+    offset += count*sizeof(T);
+    return MappedArray<TVector>(file, begin, count);
+}
+
+bool TMesh::readCache(const std::string& cacheFilename, const std::uint64_t& key)
+{
+    const MappedFilePtr file = std::make_shared<MappedFile>(cacheFilename);
+    if(!file->isOpen() || file->size()<sizeof(TMeshCacheHeader)) return false;
+
+    TMeshCacheHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if(std::memcmp(header.magic, TMeshCacheMagic, sizeof(header.magic))!=0 || header.version!=TMeshCacheVersion || header.nodeSize!=sizeof(BVHFlatNode))
+    {
+        return false;
+    }
+
+    //A foreign or truncated file is ignored, the counts being bounded first so that the expected size cannot overflow
+    if(header.key!=key) return false;
+    const std::uint64_t maxCount = std::min<std::uint64_t>(file->size(), std::numeric_limits<int>::max());
+    if(header.positionCount>maxCount || header.normalCount>maxCount || header.texCoordCount>maxCount || header.indexCount>maxCount
+       || header.nodeCount>maxCount || header.primitiveIndexCount>maxCount || header.wideNodeCount>maxCount)
+    {
+        return false;
+    }
+    const int& width = header.settings.width;
+    if((width!=2 && width!=4 && width!=8) || (width==2 && header.wideNodeCount>0)) return false;
+    const std::size_t wideNodeSize = width==8 ? sizeof(WideBVHNode<8>) : sizeof(WideBVHNode<4>);
+    std::size_t size = sizeof(header);
+    size = alignCacheOffset(size) + header.positionCount*sizeof(glm::vec3);
+    size = alignCacheOffset(size) + header.normalCount*sizeof(glm::vec3);
+    size = alignCacheOffset(size) + header.texCoordCount*sizeof(glm::vec2);
+    size = alignCacheOffset(size) + header.indexCount*sizeof(unsigned int);
+    size = alignCacheOffset(size) + header.nodeCount*sizeof(BVHFlatNode);
+    size = alignCacheOffset(size) + header.primitiveIndexCount*sizeof(int);
+    size = alignCacheOffset(size) + header.wideNodeCount*wideNodeSize;
+    if(size!=file->size()) return false;
 
+    std::size_t offset = sizeof(header);
+    MappedArray< std::vector<glm::vec3> > positions = mapCacheArray< std::vector<glm::vec3> >(file, offset, header.positionCount);
+    MappedArray< std::vector<glm::vec3> > normals = mapCacheArray< std::vector<glm::vec3> >(file, offset, header.normalCount);
+    MappedArray< std::vector<glm::vec2> > texCoords = mapCacheArray< std::vector<glm::vec2> >(file, offset, header.texCoordCount);
+    MappedArray< std::vector<unsigned int> > indices = mapCacheArray< std::vector<unsigned int> >(file, offset, header.indexCount);
+    MappedArray<BVHFlatNodes> nodes = mapCacheArray<BVHFlatNodes>(file, offset, header.nodeCount);
+    MappedArray< std::vector<int> > primitiveIndices = mapCacheArray< std::vector<int> >(file, offset, header.primitiveIndexCount);
+    MappedArray< WideBVHNodes<4> > nodes4;
+    MappedArray< WideBVHNodes<8> > nodes8;
+    if(width==4) nodes4 = mapCacheArray< WideBVHNodes<4> >(file, offset, header.wideNodeCount);
+    if(width==8) nodes8 = mapCacheArray< WideBVHNodes<8> >(file, offset, header.wideNodeCount);
+
+    //A corrupted file of the right size would make the traversal and the shading read out of bounds
+    if(indices.size()%3!=0 || (!normals.empty() && normals.size()!=positions.size())) return false;
+    const unsigned int positionCount = positions.size();
+    bool validIndices = true;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(&&:validIndices)
+#endif
+    for(int i=0; i<(int)indices.size(); ++i)
+    {
+        validIndices = validIndices && indices[i]<positionCount;
+    }
+    if(!validIndices) return false;
+    if(!BVH::IsValid(nodes.data(), nodes.size(), primitiveIndices.data(), primitiveIndices.size(), indices.size()/3)) return false;
+    if(width==4 && !BVH::IsValid(nodes4.data(), nodes4.size(), nodes.data(), nodes.size(), primitiveIndices.size())) return false;
+    if(width==8 && !BVH::IsValid(nodes8.data(), nodes8.size(), nodes.data(), nodes.size(), primitiveIndices.size())) return false;
+
+    m_positions = std::move(positions);
+    m_normals = std::move(normals);
+    m_texCoords = std::move(texCoords);
+    m_indices = std::move(indices);
+    m_bbox = Box(glm::vec3(header.bbox[0][0], header.bbox[0][1], header.bbox[0][2]), glm::vec3(header.bbox[1][0], header.bbox[1][1], header.bbox[1][2]));
+    m_bvh = BVH(header.settings, std::move(nodes), std::move(primitiveIndices), header.builtSahCost, std::move(nodes4), std::move(nodes8));
+    computeTriangleBlocks();
+    return true;
+}
+
+//Write an array to the cache file, after padding the previous one
+template<typename T>
+static void writeCacheArray(std::ofstream& file, const T* array, const std::size_t& count)
+{
+    static const char padding[TMeshCacheAlignment] = {};
+    const std::size_t offset = file.tellp();
+    file.write(padding, alignCacheOffset(offset)-offset);
+    file.write(reinterpret_cast<const char*>(array), count*sizeof(T));
+}
+
+void TMesh::writeCache(const std::string& cacheFilename, const std::uint64_t& key) const
+{
+    TMeshCacheHeader header;
+    std::memset(static_cast<void*>(&header), 0, sizeof(header));
+    std::memcpy(header.magic, TMeshCacheMagic, sizeof(header.magic));
+    header.version = TMeshCacheVersion;
+    header.nodeSize = sizeof(BVHFlatNode);
+    header.key = key;
+    header.positionCount = m_positions.size();
+    header.normalCount = m_normals.size();
+    header.texCoordCount = m_texCoords.size();
+    header.indexCount = m_indices.size();
+    header.nodeCount = m_bvh.nodes().size();
+    header.primitiveIndexCount = m_bvh.primitiveIndices().size();
+    header.wideNodeCount = m_bvh.settings().width==8 ? m_bvh.nodes8().size() : m_bvh.nodes4().size();
+    header.settings = m_bvh.settings();
+    header.builtSahCost = m_bvh.builtSahCost();
+    for(int a=0; a<3; ++a)
+    {
+        header.bbox[0][a] = m_bbox.minBound()[a];
+        header.bbox[1][a] = m_bbox.maxBound()[a];
+    }
+
+    const std::string temporaryFilename = cacheFilename + ".tmp";
+    std::ofstream file(temporaryFilename.c_str(), std::ios::binary);
+    if(!file)
+    {
+        std::cerr << "Cannot write the cache file " << cacheFilename << std::endl;
+        return;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeCacheArray(file, m_positions.data(), m_positions.size());
+    writeCacheArray(file, m_normals.data(), m_normals.size());
+    writeCacheArray(file, m_texCoords.data(), m_texCoords.size());
+    writeCacheArray(file, m_indices.data(), m_indices.size());
+    writeCacheArray(file, m_bvh.nodes().data(), m_bvh.nodes().size());
+    writeCacheArray(file, m_bvh.primitiveIndices().data(), m_bvh.primitiveIndices().size());
+    if(m_bvh.settings().width==8) writeCacheArray(file, m_bvh.nodes8().data(), m_bvh.nodes8().size());
+    else writeCacheArray(file, m_bvh.nodes4().data(), m_bvh.nodes4().size());
+    file.close();
+    if(!file || std::rename(temporaryFilename.c_str(), cacheFilename.c_str())!=0)
+    {
+        std::cerr << "Cannot write the cache file " << cacheFilename << std::endl;
+        std::remove(temporaryFilename.c_str());
+    }
+}
+
+void TMesh::buildExtentBVH(const ExtentSettingsPtr& extentSettings)
+{
+    std::vector<Extent> triangleExtents;
+    triangleExtents.reserve(m_indices.size()/3);
+    for(size_t i=0; i<m_indices.size()/3; ++i)
+    {
+        std::vector<glm::vec3> vertices = { m_positions[m_indices[3*i]], m_positions[m_indices[3*i+1]], m_positions[m_indices[3*i+2]] };
+        triangleExtents.push_back(Extent(extentSettings, vertices));
+    }
+    m_extentBVH = ExtentBVH(m_bvh, triangleExtents, extentSettings);
+}
+
+void TMesh::splitTriangle(const int& i, const int& axis, const float& position, Box& left, Box& right) const
+{
+    left = Box::Empty();
+    right = Box::Empty();
+    for(int j=0; j<3; ++j)
+    {
+        const glm::vec3& v0 = m_positions[ m_indices[3*i+j] ];
+        const glm::vec3& v1 = m_positions[ m_indices[3*i+(j+1)%3] ];
+        if(v0[axis]<=position) left.extend(v0);
+        if(v0[axis]>=position) right.extend(v0);
+
+        //The edge crosses the plane
+        if((v0[axis]<position && v1[axis]>position) || (v0[axis]>position && v1[axis]<position))
+        {
+            float t = (position-v0[axis])/(v1[axis]-v0[axis]);
+            glm::vec3 p = v0 + t*(v1-v0);
+            p[axis] = position;
+            left.extend(p);
+            right.extend(p);
+        }
+    }
+}
+
+void TMesh::computeBBox()
+{
     glm::vec3 minBB( std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() );
     glm::vec3 maxBB( -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() );
     for(size_t i=0; i<m_positions.size(); ++i)
@@ -22,17 +289,237 @@ TMesh::TMesh(const std::string& filename, const MaterialPtr& material)
     this->m_bbox = Box(minBB, maxBB);
 }
 
-bool TMesh::Intersect(const Ray& r, glm::vec3& hitPosition, glm::vec3& hitNormal) const
+//Gather the triangles of each leaf into blocks, padded with null triangles
+template<int Width>
+static void buildTriangleBlocks(const BVH& bvh, const MappedArray< std::vector<glm::vec3> >& positions, const MappedArray< std::vector<unsigned int> >& indices,
+                                TriangleBlocks<Width>& blocks, std::vector<int>& leafBlocks)
 {
-    glm::vec3 barycentricCoords;
-    for(size_t i=0; i<m_indices.size()/3; i++)
+    //The blocks of the leaves are counted first so that the leaves fill them in parallel
+    const MappedArray<BVHFlatNodes>& nodes = bvh.nodes();
+    const MappedArray< std::vector<int> >& primitiveIndices = bvh.primitiveIndices();
+    leafBlocks.assign(primitiveIndices.size(), -1);
+    int blockCount = 0;
+    for(const BVHFlatNode& node : nodes)
     {
-        if(triangleRayIntersection(m_positions[ m_indices[3*i] ], m_positions[ m_indices[3*i+1] ], m_positions[ m_indices[3*i+2] ], r, hitPosition, hitNormal, barycentricCoords))
+        if(!node.isLeaf()) continue;
+        leafBlocks[node.offset] = blockCount;
+        blockCount += (node.primitiveCount+Width-1)/Width;
+    }
+    blocks.resize(blockCount);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+    for(int n=0; n<(int)nodes.size(); ++n)
+    {
+        const BVHFlatNode& node = nodes[n];
+        if(!node.isLeaf()) continue;
+        for(int first=0; first<node.primitiveCount; first+=Width)
         {
-            hitNormal = barycentricCoords[0]*m_normals[m_indices[3*i]] + barycentricCoords[1]*m_normals[m_indices[3*i+1]] + barycentricCoords[2]*m_normals[m_indices[3*i+2]];
-            hitNormal = glm::normalize(hitNormal);
-            return true;
+            TriangleBlock<Width>& block = blocks[leafBlocks[node.offset]+first/Width];
+            for(int slot=0; slot<Width; ++slot)
+            {
+                const int triangle = first+slot<node.primitiveCount ? primitiveIndices[node.offset+first+slot] : -1;
+                PrecomputedTriangle precomputed = PrecomputedTriangle{glm::vec3(0), glm::vec3(0), glm::vec3(0)};
+                if(triangle>=0) precomputed = precomputeTriangle(positions[indices[3*triangle]], positions[indices[3*triangle+1]], positions[indices[3*triangle+2]]);
+                for(int a=0; a<3; ++a)
+                {
+                    block.v0[a][slot] = precomputed.v0[a];
+                    block.edge1[a][slot] = precomputed.edge1[a];
+                    block.edge2[a][slot] = precomputed.edge2[a];
+                }
+                block.triangles[slot] = triangle;
+            }
         }
     }
-    return false;
+}
+
+void TMesh::computeTriangleBlocks()
+{
+    m_triangleBlocks4.clear();
+    m_triangleBlocks8.clear();
+    if(triangleBlockWidth(m_bvh.settings())==8)
+    {
+        buildTriangleBlocks(m_bvh, m_positions, m_indices, m_triangleBlocks8, m_leafBlocks);
+    }
+    else
+    {
+        buildTriangleBlocks(m_bvh, m_positions, m_indices, m_triangleBlocks4, m_leafBlocks);
+    }
+}
+
+std::vector<Box> TMesh::computeBoxes()
+{
+    computeBBox();
+
+    std::vector<Box> triangleBoxes(m_indices.size()/3, Box::Empty());
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for(int i=0; i<(int)triangleBoxes.size(); ++i)
+    {
+        for(size_t j=0; j<3; ++j)
+        {
+            triangleBoxes[i].extend(m_positions[ m_indices[3*i+j] ]);
+        }
+    }
+    return triangleBoxes;
+}
+
+bool TMesh::refit()
+{
+    bool rebuilt = m_bvh.refit(computeBoxes());
+    computeTriangleBlocks();
+    if(!m_extentBVH.empty()) buildExtentBVH(m_extentBVH.settings());
+    return rebuilt;
+}
+
+std::vector<glm::vec3>& TMesh::positions()
+{
+    return m_positions.detach();
+}
+
+const MappedArray< std::vector<glm::vec3> >& TMesh::positions() const
+{
+    return m_positions;
+}
+
+std::vector<glm::vec3>& TMesh::normals()
+{
+    return m_normals.detach();
+}
+
+const MappedArray< std::vector<glm::vec3> >& TMesh::normals() const
+{
+    return m_normals;
+}
+
+bool TMesh::Intersect(const Ray& r, float& tMax, HitRecord& hit) const
+{
+    int closestTriangle = -1;
+    glm::vec3 closestBarycentricCoords;
+
+    //Test the blocks of a leaf and keep the triangle hit if it is closer than the closest one found so far
+    auto intersectBlocks = [&](const auto& blocks)
+    {
+        const int width = sizeof(blocks[0].triangles)/sizeof(int);
+        auto leafIntersector = [&](const int& first, const int& count, const Ray& ray, float& t)
+        {
+            bool leafHit = false;
+            const int firstBlock = m_leafBlocks[first];
+            for(int b=firstBlock; b<firstBlock+(count+width-1)/width; ++b)
+            {
+                float distance;
+                glm::vec3 barycentricCoords;
+                const int slot = IntersectTriangles(blocks[b], ray, t, distance, barycentricCoords);
+                if(slot>=0)
+                {
+                    t = distance;
+                    closestTriangle = blocks[b].triangles[slot];
+                    closestBarycentricCoords = barycentricCoords;
+                    leafHit = true;
+                }
+            }
+            return leafHit;
+        };
+        return m_extentBVH.empty() ? m_bvh.intersectLeaves(r, tMax, leafIntersector) : m_extentBVH.intersectLeaves(r, tMax, leafIntersector);
+    };
+
+    bool found = m_triangleBlocks8.empty() ? intersectBlocks(m_triangleBlocks4) : intersectBlocks(m_triangleBlocks8);
+    if(!found) return false;
+
+    hit.t = tMax;
+    hit.primitiveId = closestTriangle;
+    hit.barycentrics = glm::vec2(closestBarycentricCoords[1], closestBarycentricCoords[2]);
+    return true;
+}
+
+void TMesh::HitSurface(const Ray& r, const HitRecord& hit, glm::vec3& hitPosition, glm::vec3& hitNormal) const
+{
+    //Interpolate the vertex normals only for the closest triangle
+    const int& i = hit.primitiveId;
+    const glm::vec3 barycentricCoords(1.0f-hit.barycentrics[0]-hit.barycentrics[1], hit.barycentrics[0], hit.barycentrics[1]);
+    hitPosition = r.origin() + hit.t*r.direction();
+    hitNormal = barycentricCoords[0]*m_normals[m_indices[3*i]] + barycentricCoords[1]*m_normals[m_indices[3*i+1]] + barycentricCoords[2]*m_normals[m_indices[3*i+2]];
+    hitNormal = glm::normalize(hitNormal);
+}
+
+bool TMesh::Occluded(const Ray& r, const float& tMax) const
+{
+    //Any triangle of a leaf hit before tMax blocks the ray
+    auto occludedBlocks = [&](const auto& blocks)
+    {
+        const int width = sizeof(blocks[0].triangles)/sizeof(int);
+        auto leafOccluder = [&](const int& first, const int& count, const Ray& ray, const float& t)
+        {
+            const int firstBlock = m_leafBlocks[first];
+            for(int b=firstBlock; b<firstBlock+(count+width-1)/width; ++b)
+            {
+                float distance;
+                glm::vec3 barycentricCoords;
+                if(IntersectTriangles(blocks[b], ray, t, distance, barycentricCoords)>=0) return true;
+            }
+            return false;
+        };
+        return m_extentBVH.empty() ? m_bvh.occludedLeaves(r, tMax, leafOccluder) : m_extentBVH.occludedLeaves(r, tMax, leafOccluder);
+    };
+    return m_triangleBlocks8.empty() ? occludedBlocks(m_triangleBlocks4) : occludedBlocks(m_triangleBlocks8);
+}
+
+int TMesh::IntersectPacket(const RayPacket& packet, const int& mask, RayPacketHits& hits) const
+{
+    std::array<int, RayPacket::MaxSize> closestTriangles;
+    alignas(16) float us[RayPacket::MaxSize], vs[RayPacket::MaxSize];
+
+    //Test the triangles of the blocks of a leaf one after another, each against all the rays
+    auto intersectBlocks = [&](const auto& blocks)
+    {
+        const int width = sizeof(blocks[0].triangles)/sizeof(int);
+        auto leafIntersector = [&](const int& first, const int& count, const RayPacket& rays, const int& raysMask, float* t)
+        {
+            int hitMask = 0;
+            const int firstBlock = m_leafBlocks[first];
+            for(int b=firstBlock; b<firstBlock+(count+width-1)/width; ++b)
+            {
+                for(int slot=0; slot<width && blocks[b].triangles[slot]>=0; ++slot)
+                {
+                    PrecomputedTriangle triangle;
+                    for(int a=0; a<3; ++a)
+                    {
+                        triangle.v0[a] = blocks[b].v0[a][slot];
+                        triangle.edge1[a] = blocks[b].edge1[a][slot];
+                        triangle.edge2[a] = blocks[b].edge2[a][slot];
+                    }
+                    const int triangleHitMask = IntersectTriangle(rays, raysMask, triangle, t, us, vs);
+                    for(int i=0; i<rays.size; ++i)
+                    {
+                        if(triangleHitMask & (1<<i)) closestTriangles[i] = blocks[b].triangles[slot];
+                    }
+                    hitMask |= triangleHitMask;
+                }
+            }
+            return hitMask;
+        };
+        return m_bvh.intersectPacket(packet, mask, hits.t, leafIntersector);
+    };
+
+    const int hitMask = m_triangleBlocks8.empty() ? intersectBlocks(m_triangleBlocks4) : intersectBlocks(m_triangleBlocks8);
+
+    for(int r=0; r<packet.size; ++r)
+    {
+        if((hitMask & (1<<r))==0) continue;
+        hits.primitiveIds[r] = closestTriangles[r];
+        hits.barycentrics[r] = glm::vec2(us[r], vs[r]);
+    }
+    return hitMask;
+}
+
+const BVH& TMesh::bvh() const
+{
+    return m_bvh;
+}
+
+const ExtentBVH& TMesh::extentBVH() const
+{
+    return m_extentBVH;
 }
@@ -0,0 +1,148 @@
+#include "./../include/raytracer-sandbox/triangleblock.hpp"
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RAYTRACER_SANDBOX_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+#ifdef RAYTRACER_SANDBOX_X86
+
+int IntersectTriangles(const TriangleBlock<4>& block, const Ray& r, const float& tMax, float& t, glm::vec3& barycentricCoords)
+{
+    const __m128 dx = _mm_set1_ps(r.direction()[0]), dy = _mm_set1_ps(r.direction()[1]), dz = _mm_set1_ps(r.direction()[2]);
+    const __m128 e1x = _mm_load_ps(block.edge1[0]), e1y = _mm_load_ps(block.edge1[1]), e1z = _mm_load_ps(block.edge1[2]);
+    const __m128 e2x = _mm_load_ps(block.edge2[0]), e2y = _mm_load_ps(block.edge2[1]), e2z = _mm_load_ps(block.edge2[2]);
+
+    //p = direction x edge2, determinant = edge1.p
+    const __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    const __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    const __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+    const __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+    //A null determinant gives NaN coordinates, which fail every comparison below
+    const __m128 invDeterminant = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+
+    //s = origin - v0, u = s.p / determinant
+    const __m128 sx = _mm_sub_ps(_mm_set1_ps(r.origin()[0]), _mm_load_ps(block.v0[0]));
+    const __m128 sy = _mm_sub_ps(_mm_set1_ps(r.origin()[1]), _mm_load_ps(block.v0[1]));
+    const __m128 sz = _mm_sub_ps(_mm_set1_ps(r.origin()[2]), _mm_load_ps(block.v0[2]));
+    const __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDeterminant);
+
+    //q = s x edge1, v = direction.q / determinant, distance = edge2.q / determinant
+    const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+    const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+    const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+    const __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDeterminant);
+    const __m128 distance = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDeterminant);
+
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    __m128 hit = _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero));
+    hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), one));
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(distance, zero));
+    hit = _mm_and_ps(hit, _mm_cmplt_ps(distance, _mm_set1_ps(tMax)));
+    if(_mm_movemask_ps(hit)==0) return -1;
+
+    //Horizontal minimum of the distances of the hits
+    const __m128 distances = _mm_or_ps(_mm_and_ps(hit, distance), _mm_andnot_ps(hit, _mm_set1_ps(numeric_limits<float>::infinity())));
+    __m128 minimum = _mm_min_ps(distances, _mm_shuffle_ps(distances, distances, _MM_SHUFFLE(2,3,0,1)));
+    minimum = _mm_min_ps(minimum, _mm_shuffle_ps(minimum, minimum, _MM_SHUFFLE(1,0,3,2)));
+    const int slot = __builtin_ctz(_mm_movemask_ps(_mm_and_ps(hit, _mm_cmpeq_ps(distances, minimum))));
+
+    alignas(16) float us[4], vs[4];
+    _mm_store_ps(us, u);
+    _mm_store_ps(vs, v);
+    t = _mm_cvtss_f32(minimum);
+    barycentricCoords = glm::vec3(1.0f-us[slot]-vs[slot], us[slot], vs[slot]);
+    return slot;
+}
+
+__attribute__((target("avx2")))
+int IntersectTriangles(const TriangleBlock<8>& block, const Ray& r, const float& tMax, float& t, glm::vec3& barycentricCoords)
+{
+    const __m256 dx = _mm256_set1_ps(r.direction()[0]), dy = _mm256_set1_ps(r.direction()[1]), dz = _mm256_set1_ps(r.direction()[2]);
+    const __m256 e1x = _mm256_load_ps(block.edge1[0]), e1y = _mm256_load_ps(block.edge1[1]), e1z = _mm256_load_ps(block.edge1[2]);
+    const __m256 e2x = _mm256_load_ps(block.edge2[0]), e2y = _mm256_load_ps(block.edge2[1]), e2z = _mm256_load_ps(block.edge2[2]);
+
+    const __m256 px = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+    const __m256 py = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+    const __m256 pz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+    const __m256 determinant = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, px), _mm256_mul_ps(e1y, py)), _mm256_mul_ps(e1z, pz));
+    const __m256 invDeterminant = _mm256_div_ps(_mm256_set1_ps(1.0f), determinant);
+
+    const __m256 sx = _mm256_sub_ps(_mm256_set1_ps(r.origin()[0]), _mm256_load_ps(block.v0[0]));
+    const __m256 sy = _mm256_sub_ps(_mm256_set1_ps(r.origin()[1]), _mm256_load_ps(block.v0[1]));
+    const __m256 sz = _mm256_sub_ps(_mm256_set1_ps(r.origin()[2]), _mm256_load_ps(block.v0[2]));
+    const __m256 u = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, px), _mm256_mul_ps(sy, py)), _mm256_mul_ps(sz, pz)), invDeterminant);
+
+    const __m256 qx = _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(sz, e1y));
+    const __m256 qy = _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(sx, e1z));
+    const __m256 qz = _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(sy, e1x));
+    const __m256 v = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)), invDeterminant);
+    const __m256 distance = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)), invDeterminant);
+
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+    __m256 hit = _mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_GE_OQ), _mm256_cmp_ps(v, zero, _CMP_GE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(distance, _mm256_set1_ps(tMax), _CMP_LT_OQ));
+    if(_mm256_movemask_ps(hit)==0) return -1;
+
+    const __m256 distances = _mm256_blendv_ps(_mm256_set1_ps(numeric_limits<float>::infinity()), distance, hit);
+    __m256 minimum = _mm256_min_ps(distances, _mm256_permute_ps(distances, _MM_SHUFFLE(2,3,0,1)));
+    minimum = _mm256_min_ps(minimum, _mm256_permute_ps(minimum, _MM_SHUFFLE(1,0,3,2)));
+    minimum = _mm256_min_ps(minimum, _mm256_permute2f128_ps(minimum, minimum, 1));
+    const int slot = __builtin_ctz(_mm256_movemask_ps(_mm256_and_ps(hit, _mm256_cmp_ps(distances, minimum, _CMP_EQ_OQ))));
+
+    alignas(32) float us[8], vs[8];
+    _mm256_store_ps(us, u);
+    _mm256_store_ps(vs, v);
+    t = _mm256_cvtss_f32(minimum);
+    barycentricCoords = glm::vec3(1.0f-us[slot]-vs[slot], us[slot], vs[slot]);
+    return slot;
+}
+
+#else
+
+//Scalar fallback of the SIMD kernels
+template<int Width>
+static int intersectTrianglesScalar(const TriangleBlock<Width>& block, const Ray& r, const float& tMax, float& t, glm::vec3& barycentricCoords)
+{
+    int slot = -1;
+    float closest = tMax;
+    for(int i=0; i<Width; ++i)
+    {
+        const glm::vec3 edge1(block.edge1[0][i], block.edge1[1][i], block.edge1[2][i]);
+        const glm::vec3 edge2(block.edge2[0][i], block.edge2[1][i], block.edge2[2][i]);
+        const glm::vec3 p = glm::cross(r.direction(), edge2);
+        const float determinant = glm::dot(edge1, p);
+        if(determinant==0.0f) continue;
+        const float invDeterminant = 1.0f/determinant;
+        const glm::vec3 s = r.origin() - glm::vec3(block.v0[0][i], block.v0[1][i], block.v0[2][i]);
+        const float u = glm::dot(s, p)*invDeterminant;
+        if(u<0.0f || u>1.0f) continue;
+        const glm::vec3 q = glm::cross(s, edge1);
+        const float v = glm::dot(r.direction(), q)*invDeterminant;
+        if(v<0.0f || u+v>1.0f) continue;
+        const float distance = glm::dot(edge2, q)*invDeterminant;
+        if(distance<0.0f || distance>=closest) continue;
+        closest = distance;
+        slot = i;
+        barycentricCoords = glm::vec3(1.0f-u-v, u, v);
+    }
+    if(slot>=0) t = closest;
+    return slot;
+}
+
+int IntersectTriangles(const TriangleBlock<4>& block, const Ray& r, const float& tMax, float& t, glm::vec3& barycentricCoords)
+{
+    return intersectTrianglesScalar(block, r, tMax, t, barycentricCoords);
+}
+
+int IntersectTriangles(const TriangleBlock<8>& block, const Ray& r, const float& tMax, float& t, glm::vec3& barycentricCoords)
+{
+    return intersectTrianglesScalar(block, r, tMax, t, barycentricCoords);
+}
+
+#endif
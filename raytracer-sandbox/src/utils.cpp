@@ -1,4 +1,6 @@
 #include "./../include/raytracer-sandbox/utils.hpp"
+#include <algorithm>
+#include <array>
 #include <iostream>
 
 using namespace std;
@@ -138,3 +140,111 @@ bool triangleRayIntersection(const glm::vec3 & t1, const glm::vec3 & t2, const g
             return false;
     }
 }
+
+PrecomputedTriangle precomputeTriangle(const glm::vec3 & t1, const glm::vec3 & t2, const glm::vec3 & t3)
+{
+    PrecomputedTriangle triangle;
+    triangle.v0 = t1;
+    triangle.edge1 = t2-t1;
+    triangle.edge2 = t3-t1;
+    return triangle;
+}
+
+bool precomputedTriangleRayIntersection(const PrecomputedTriangle & triangle, const Ray & r, const float & tMax, float & t, glm::vec3 & barycentricCoords)
+{
+    const glm::vec3 p = glm::cross(r.direction(), triangle.edge2);
+    const float determinant = glm::dot(triangle.edge1, p);
+    //The ray is parallel to the plane of the triangle
+    if(determinant==0.0f) return false;
+    const float invDeterminant = 1.0f/determinant;
+
+    const glm::vec3 s = r.origin()-triangle.v0;
+    const float u = glm::dot(s, p)*invDeterminant;
+    if(u<0.0f || u>1.0f) return false;
+
+    const glm::vec3 q = glm::cross(s, triangle.edge1);
+    const float v = glm::dot(r.direction(), q)*invDeterminant;
+    if(v<0.0f || u+v>1.0f) return false;
+
+    const float distance = glm::dot(triangle.edge2, q)*invDeterminant;
+    if(distance<0.0f || distance>=tMax) return false;
+
+    t = distance;
+    barycentricCoords = glm::vec3(1.0f-u-v, u, v);
+    return true;
+}
+
+//Spread the 10 lowest bits of v so that there are two zeros between each of them
+static unsigned int expandBits(unsigned int v)
+{
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+unsigned int MortonCode(const glm::vec3& p)
+{
+    unsigned int quantized[3];
+    for(int a=0; a<3; ++a)
+    {
+        quantized[a] = (unsigned int)std::min(std::max(p[a]*1024.0f, 0.0f), 1023.0f);
+    }
+    return expandBits(quantized[0])*4 + expandBits(quantized[1])*2 + expandBits(quantized[2]);
+}
+
+//Number of keys counted and scattered by a task of RadixSort()
+static const int RadixSortChunkSize = 16384;
+
+void RadixSort(vector<unsigned int>& keys, vector<int>& values, const int& keyBits)
+{
+    const int n = keys.size();
+    const int chunkCount = max(1, n/RadixSortChunkSize);
+    const int chunkSize = (n+chunkCount-1)/chunkCount;
+    vector<unsigned int> sortedKeys(n);
+    vector<int> sortedValues(n);
+    vector< std::array<int,256> > offsets(chunkCount);
+    for(int shift=0; shift<keyBits; shift+=8)
+    {
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for(int c=0; c<chunkCount; ++c)
+        {
+            offsets[c].fill(0);
+            for(int i=c*chunkSize; i<min(n, (c+1)*chunkSize); ++i)
+            {
+                offsets[c][(keys[i]>>shift)&0xFF]++;
+            }
+        }
+
+        //Each chunk writes its keys of a given digit after the ones of the previous chunks
+        int offset = 0;
+        for(int digit=0; digit<256; ++digit)
+        {
+            for(int c=0; c<chunkCount; ++c)
+            {
+                int count = offsets[c][digit];
+                offsets[c][digit] = offset;
+                offset += count;
+            }
+        }
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for(int c=0; c<chunkCount; ++c)
+        {
+            for(int i=c*chunkSize; i<min(n, (c+1)*chunkSize); ++i)
+            {
+                int& o = offsets[c][(keys[i]>>shift)&0xFF];
+                sortedKeys[o] = keys[i];
+                sortedValues[o] = values[i];
+                ++o;
+            }
+        }
+        keys.swap(sortedKeys);
+        values.swap(sortedValues);
+    }
+}
@@ -0,0 +1,105 @@
+#include "./../include/raytracer-sandbox/widebvh.hpp"
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RAYTRACER_SANDBOX_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+#ifdef RAYTRACER_SANDBOX_X86
+
+int IntersectChildren(const WideBVHNode<4>& node, const Ray& r, const float& tMax, float* tEntry)
+{
+    const std::array<int,3>& sign = r.sign();
+    __m128 tNear = _mm_setzero_ps();
+    __m128 tFar = _mm_set1_ps(tMax);
+    for(int a=0; a<3; ++a)
+    {
+        const __m128 origin = _mm_set1_ps(r.origin()[a]);
+        const __m128 invDirection = _mm_set1_ps(r.invDirection()[a]);
+        const __m128 tMin = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[sign[a]][a]), origin), invDirection);
+        const __m128 tMaxAxis = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[1-sign[a]][a]), origin), invDirection);
+        //The second operand is returned when the first one is NaN, which ignores an axis where 0*inf occured
+        tNear = _mm_max_ps(tMin, tNear);
+        tFar = _mm_min_ps(tMaxAxis, tFar);
+    }
+    _mm_storeu_ps(tEntry, tNear);
+    return _mm_movemask_ps(_mm_cmple_ps(tNear, tFar));
+}
+
+__attribute__((target("avx2")))
+int IntersectChildren(const WideBVHNode<8>& node, const Ray& r, const float& tMax, float* tEntry)
+{
+    const std::array<int,3>& sign = r.sign();
+    __m256 tNear = _mm256_setzero_ps();
+    __m256 tFar = _mm256_set1_ps(tMax);
+    for(int a=0; a<3; ++a)
+    {
+        const __m256 origin = _mm256_set1_ps(r.origin()[a]);
+        const __m256 invDirection = _mm256_set1_ps(r.invDirection()[a]);
+        const __m256 tMin = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[sign[a]][a]), origin), invDirection);
+        const __m256 tMaxAxis = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[1-sign[a]][a]), origin), invDirection);
+        tNear = _mm256_max_ps(tMin, tNear);
+        tFar = _mm256_min_ps(tMaxAxis, tFar);
+    }
+    _mm256_storeu_ps(tEntry, tNear);
+    return _mm256_movemask_ps(_mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ));
+}
+
+bool SupportsSSE()
+{
+    return __builtin_cpu_supports("sse");
+}
+
+bool SupportsAVX2()
+{
+    return __builtin_cpu_supports("avx2");
+}
+
+#else
+
+//Scalar fallback of the SIMD kernels
+template<int Width>
+static int intersectChildrenScalar(const WideBVHNode<Width>& node, const Ray& r, const float& tMax, float* tEntry)
+{
+    const std::array<int,3>& sign = r.sign();
+    int mask = 0;
+    for(int i=0; i<Width; ++i)
+    {
+        float tNear = 0.0f, tFar = tMax;
+        for(int a=0; a<3; ++a)
+        {
+            float tMin = (node.bounds[sign[a]][a][i] - r.origin()[a]) * r.invDirection()[a];
+            float tMaxAxis = (node.bounds[1-sign[a]][a][i] - r.origin()[a]) * r.invDirection()[a];
+            tNear = tMin > tNear ? tMin : tNear;
+            tFar = tMaxAxis < tFar ? tMaxAxis : tFar;
+        }
+        tEntry[i] = tNear;
+        if(tNear<=tFar) mask |= 1 << i;
+    }
+    return mask;
+}
+
+int IntersectChildren(const WideBVHNode<4>& node, const Ray& r, const float& tMax, float* tEntry)
+{
+    return intersectChildrenScalar(node, r, tMax, tEntry);
+}
+
+int IntersectChildren(const WideBVHNode<8>& node, const Ray& r, const float& tMax, float* tEntry)
+{
+    return intersectChildrenScalar(node, r, tMax, tEntry);
+}
+
+bool SupportsSSE()
+{
+    return false;
+}
+
+bool SupportsAVX2()
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,170 @@
+#include <iostream>
+#include <random>
+#include <limits>
+#include <type_traits>
+#include <gtest/gtest.h>
+
+#include <raytracer-sandbox/aabbtree.hpp>
+
+using namespace std;
+
+static Box randomBox(mt19937& generator)
+{
+    uniform_real_distribution<float> position(-10.0f, 10.0f), size(0.1f, 1.0f);
+    glm::vec3 minBB(position(generator), position(generator), position(generator));
+    return Box(minBB, minBB + glm::vec3(size(generator), size(generator), size(generator)));
+}
+
+static bool contains(const Box& a, const Box& b)
+{
+    for(int i=0; i<3; ++i)
+    {
+        if(b.minBound()[i]<a.minBound()[i] || b.maxBound()[i]>a.maxBound()[i]) return false;
+    }
+    return true;
+}
+
+//Check parent links, heights, bounds and balance of the sub-tree, return the number of leaves
+static int validate(const NodePtr& node)
+{
+    if(node->isLeaf())
+    {
+        EXPECT_EQ(node->height(), 0);
+        return 1;
+    }
+    EXPECT_EQ(node->left()->parent().lock(), node);
+    EXPECT_EQ(node->right()->parent().lock(), node);
+    EXPECT_EQ(node->height(), 1 + max(node->left()->height(), node->right()->height()));
+    EXPECT_LE(abs(node->left()->height() - node->right()->height()), 1);
+    EXPECT_EQ(contains(node->aabb(), node->left()->aabb()), true);
+    EXPECT_EQ(contains(node->aabb(), node->right()->aabb()), true);
+    return validate(node->left()) + validate(node->right());
+}
+
+static_assert(!std::is_copy_constructible<AABBTree>::value, "the nodes of a tree cannot be shared");
+
+TEST(AABBTree, Insert)
+{
+    AABBTree tree(0.1f);
+    EXPECT_EQ(tree.height(), -1);
+
+    int data = -1;
+    EXPECT_EQ(tree.intersect(Ray(glm::vec3(0,0,0), glm::vec3(0,0,1)), data), false);
+
+    mt19937 generator(1);
+    for(int i=0; i<1000; ++i)
+    {
+        tree.insert(randomBox(generator), i);
+    }
+    EXPECT_EQ(tree.size(), 1000u);
+    EXPECT_EQ(tree.root()->parent().lock(), nullptr);
+    EXPECT_EQ(validate(tree.root()), 1000);
+    //A balanced binary tree of 1000 leaves
+    EXPECT_LE(tree.height(), 20);
+}
+
+TEST(AABBTree, Remove)
+{
+    AABBTree tree(0.1f);
+    mt19937 generator(2);
+    for(int i=0; i<500; ++i)
+    {
+        tree.insert(randomBox(generator), i);
+    }
+    for(int i=0; i<500; i+=2)
+    {
+        EXPECT_EQ(tree.remove(i), true);
+    }
+    EXPECT_EQ(tree.remove(0), false);
+    EXPECT_EQ(tree.size(), 250u);
+    EXPECT_EQ(validate(tree.root()), 250);
+
+    for(int i=1; i<500; i+=2)
+    {
+        tree.remove(i);
+    }
+    EXPECT_EQ(tree.root(), nullptr);
+}
+
+TEST(AABBTree, Update)
+{
+    AABBTree tree(0.5f);
+    tree.insert(Box(glm::vec3(0,0,0), glm::vec3(1,1,1)), 0);
+    tree.insert(Box(glm::vec3(5,5,5), glm::vec3(6,6,6)), 1);
+
+    //Small motion: the object stays inside its fat AABB
+    EXPECT_EQ(tree.update(Box(glm::vec3(0.2,0,0), glm::vec3(1.2,1,1)), 0), false);
+    //Large motion: the leaf is re-inserted
+    EXPECT_EQ(tree.update(Box(glm::vec3(10,0,0), glm::vec3(11,1,1)), 0), true);
+    EXPECT_EQ(tree.update(Box(glm::vec3(10,0,0), glm::vec3(11,1,1)), 42), false);
+
+    //Inserting an existing id moves its leaf
+    tree.insert(Box(glm::vec3(20,0,0), glm::vec3(21,1,1)), 0);
+    EXPECT_EQ(tree.size(), 2u);
+    EXPECT_EQ(validate(tree.root()), 2);
+    int data = -1;
+    EXPECT_EQ(tree.intersect(Ray(glm::vec3(20.5,0.5,-5), glm::vec3(0,0,1)), data), true);
+    EXPECT_EQ(data, 0);
+    EXPECT_EQ(tree.intersect(Ray(glm::vec3(10.5,0.5,-5), glm::vec3(0,0,1)), data), false);
+
+    mt19937 generator(3);
+    for(int i=2; i<300; ++i)
+    {
+        tree.insert(randomBox(generator), i);
+    }
+    for(int frame=0; frame<10; ++frame)
+    {
+        for(int i=0; i<300; i+=3)
+        {
+            tree.update(randomBox(generator), i);
+        }
+    }
+    EXPECT_EQ(validate(tree.root()), 300);
+}
+
+TEST(AABBTree, Intersect)
+{
+    AABBTree tree(0.0f);
+    mt19937 generator(4);
+    vector<Box> boxes;
+    for(int i=0; i<500; ++i)
+    {
+        boxes.push_back(randomBox(generator));
+        tree.insert(boxes.back(), i);
+    }
+
+    auto intersector = [&](const int& id, const Ray& r, float& tMax)
+    {
+        std::array<float,2> t;
+        if(Intersect(r, boxes[id], t) && t[0]>=0 && t[0]<tMax)
+        {
+            tMax = t[0];
+            return true;
+        }
+        return false;
+    };
+
+    uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    for(int i=0; i<200; ++i)
+    {
+        Ray ray(glm::vec3(0,0,-20), glm::vec3(distribution(generator), distribution(generator), 1.0f));
+        float bruteForceT = numeric_limits<float>::max();
+        bool bruteForceHit = false;
+        for(int j=0; j<500; ++j)
+        {
+            bruteForceHit = intersector(j, ray, bruteForceT) || bruteForceHit;
+        }
+        float treeT = numeric_limits<float>::max();
+        EXPECT_EQ(tree.intersect(ray, treeT, intersector), bruteForceHit);
+        EXPECT_EQ(treeT, bruteForceT);
+
+        int data = -1;
+        EXPECT_EQ(tree.intersect(ray, data), bruteForceHit);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
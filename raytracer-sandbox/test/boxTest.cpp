@@ -1,4 +1,5 @@
 #include <iostream>
+#include <limits>
 #include <gtest/gtest.h>
 
 #include <raytracer-sandbox/box.hpp>
@@ -157,6 +158,32 @@ TEST(Box, Intersect)
     EXPECT_EQ(t[1], -0.5);
 }
 
+TEST(Box, Extend)
+{
+    Box box = Box::Empty();
+    EXPECT_EQ(box.surfaceArea(), 0);
+
+    box.extend(glm::vec3(0,0,0));
+    box.extend(Box(glm::vec3(-1,0,0), glm::vec3(1,2,3)));
+    EXPECT_EQ(box.minBound()[0], -1);
+    EXPECT_EQ(box.minBound()[1], 0);
+    EXPECT_EQ(box.minBound()[2], 0);
+    EXPECT_EQ(box.maxBound()[0], 1);
+    EXPECT_EQ(box.maxBound()[1], 2);
+    EXPECT_EQ(box.maxBound()[2], 3);
+
+    EXPECT_EQ(box.center()[0], 0);
+    EXPECT_EQ(box.center()[1], 1);
+    EXPECT_EQ(box.center()[2], 1.5);
+    EXPECT_EQ(box.largestAxis(), 2);
+    EXPECT_EQ(box.surfaceArea(), 2*(2*2+2*3+3*2));
+    EXPECT_EQ(box.isFinite(), true);
+
+    float maxValue = std::numeric_limits<float>::max();
+    Box infiniteBox(glm::vec3(-maxValue,-maxValue,-maxValue), glm::vec3(maxValue,maxValue,maxValue));
+    EXPECT_EQ(infiniteBox.isFinite(), false);
+}
+
 int main(int argc, char **argv)
 {
     testing::InitGoogleTest(&argc, argv);
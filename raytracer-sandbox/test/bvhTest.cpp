@@ -0,0 +1,607 @@
+#include <iostream>
+#include <random>
+#include <limits>
+#include <algorithm>
+#include <gtest/gtest.h>
+
+#include <raytracer-sandbox/bvh.hpp>
+#include <raytracer-sandbox/utils.hpp>
+
+using namespace std;
+
+static vector<Box> randomBoxes(const int& count, const unsigned int& seed)
+{
+    mt19937 generator(seed);
+    uniform_real_distribution<float> position(-10.0f, 10.0f), size(0.1f, 1.0f);
+    vector<Box> boxes;
+    for(int i=0; i<count; ++i)
+    {
+        glm::vec3 minBB(position(generator), position(generator), position(generator));
+        glm::vec3 maxBB = minBB + glm::vec3(size(generator), size(generator), size(generator));
+        boxes.push_back(Box(minBB, maxBB));
+    }
+    return boxes;
+}
+
+static int countPrimitives(const BVH& bvh)
+{
+    int count = 0;
+    for(const BVHFlatNode& node : bvh.nodes()) count += node.primitiveCount;
+    return count;
+}
+
+static bool contains(const Box& a, const Box& b)
+{
+    for(int j=0; j<3; ++j)
+    {
+        if(b.minBound()[j]<a.minBound()[j] || b.maxBound()[j]>a.maxBound()[j]) return false;
+    }
+    return true;
+}
+
+static bool checkBounds(const BVH& bvh, const vector<Box>& boxes)
+{
+    const MappedArray<BVHFlatNodes>& nodes = bvh.nodes();
+    for(size_t n=0; n<nodes.size(); ++n)
+    {
+        if(nodes[n].isLeaf())
+        {
+            for(int i=nodes[n].offset; i<nodes[n].offset+nodes[n].primitiveCount; ++i)
+            {
+                if(!contains(nodes[n].aabb, boxes[bvh.primitiveIndices()[i]])) return false;
+            }
+        }
+        else if(!contains(nodes[n].aabb, nodes[n+1].aabb) || !contains(nodes[n].aabb, nodes[nodes[n].offset].aabb))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int maxLeafSize(const BVH& bvh)
+{
+    int size = 0;
+    for(const BVHFlatNode& node : bvh.nodes()) size = max(size, node.primitiveCount);
+    return size;
+}
+
+TEST(BVH, Constructor)
+{
+    BVH emptyBvh;
+    EXPECT_EQ(emptyBvh.empty(), true);
+
+    vector<Box> boxes = randomBoxes(1000, 1);
+    BVHBuildSettings settings;
+    settings.method = MEDIAN_SPLIT;
+    BVH bvh(boxes, settings);
+    EXPECT_EQ(bvh.empty(), false);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(bvh.nodes().data()) % 64, 0u);
+    EXPECT_EQ(bvh.primitiveIndices().size(), boxes.size());
+    EXPECT_EQ(countPrimitives(bvh), 1000);
+    EXPECT_EQ(checkBounds(bvh, boxes), true);
+}
+
+//Restored nodes are only accepted if their children and leaves stay within the arrays
+TEST(BVH, IsValid)
+{
+    vector<Box> boxes = randomBoxes(200, 3);
+    BVH bvh(boxes);
+    vector<BVHFlatNode> nodes(bvh.nodes().begin(), bvh.nodes().end());
+    vector<int> indices(bvh.primitiveIndices().begin(), bvh.primitiveIndices().end());
+    const int nodeCount = nodes.size(), indexCount = indices.size(), boxCount = boxes.size();
+    EXPECT_EQ(BVH::IsValid(nodes.data(), nodeCount, indices.data(), indexCount, boxCount), true);
+    EXPECT_EQ(BVH::IsValid(nullptr, 0, nullptr, 0, 0), true);
+
+    int branch = 0, leaf = 0;
+    while(nodes[branch].isLeaf()) ++branch;
+    while(!nodes[leaf].isLeaf()) ++leaf;
+
+    vector<BVHFlatNode> corrupted = nodes;
+    corrupted[branch].offset = nodeCount;
+    EXPECT_EQ(BVH::IsValid(corrupted.data(), nodeCount, indices.data(), indexCount, boxCount), false);
+    corrupted[branch].offset = branch;
+    EXPECT_EQ(BVH::IsValid(corrupted.data(), nodeCount, indices.data(), indexCount, boxCount), false);
+    corrupted = nodes;
+    corrupted[branch].primitiveCount = -1;
+    EXPECT_EQ(BVH::IsValid(corrupted.data(), nodeCount, indices.data(), indexCount, boxCount), false);
+    corrupted = nodes;
+    corrupted[leaf].offset = indexCount;
+    EXPECT_EQ(BVH::IsValid(corrupted.data(), nodeCount, indices.data(), indexCount, boxCount), false);
+    corrupted = nodes;
+    corrupted[leaf].primitiveCount = indexCount+1;
+    EXPECT_EQ(BVH::IsValid(corrupted.data(), nodeCount, indices.data(), indexCount, boxCount), false);
+
+    //Leaves whose ranges overlap, or skip primitive ids, are rejected too
+    int nextLeaf = leaf+1;
+    while(!nodes[nextLeaf].isLeaf()) ++nextLeaf;
+    corrupted = nodes;
+    corrupted[nextLeaf].offset = nodes[leaf].offset;
+    EXPECT_EQ(BVH::IsValid(corrupted.data(), nodeCount, indices.data(), indexCount, boxCount), false);
+    corrupted = nodes;
+    corrupted[leaf].primitiveCount -= 1;
+    EXPECT_EQ(BVH::IsValid(corrupted.data(), nodeCount, indices.data(), indexCount, boxCount), false);
+    EXPECT_EQ(BVH::IsValid(nodes.data(), nodeCount-1, indices.data(), indexCount, boxCount), false);
+
+    vector<int> corruptedIndices = indices;
+    corruptedIndices[0] = boxCount;
+    EXPECT_EQ(BVH::IsValid(nodes.data(), nodeCount, corruptedIndices.data(), indexCount, boxCount), false);
+}
+
+//Restored wide nodes are only accepted if their branches form a tree and their leaves are binary leaves
+TEST(BVH, IsValidWide)
+{
+    vector<Box> boxes = randomBoxes(200, 3);
+    BVHBuildSettings settings;
+    settings.width = 4;
+    settings.maxLeafSize = 2;
+    BVH bvh(boxes, settings);
+    if(bvh.settings().width!=4) return;
+    const vector<BVHFlatNode> nodes(bvh.nodes().begin(), bvh.nodes().end());
+    const MappedArray< WideBVHNodes<4> >& wideNodes = bvh.nodes4();
+    const int nodeCount = nodes.size(), wideNodeCount = wideNodes.size(), indexCount = bvh.primitiveIndices().size();
+    EXPECT_EQ(BVH::IsValid(wideNodes.data(), wideNodeCount, nodes.data(), nodeCount, indexCount), true);
+    EXPECT_EQ(BVH::IsValid(wideNodes.data(), 0, nodes.data(), nodeCount, indexCount), false);
+
+    int branch = -1, leaf = -1;
+    for(int i=0; i<4; ++i)
+    {
+        if(wideNodes[0].primitiveCounts[i]==0 && branch<0) branch = i;
+        if(wideNodes[0].primitiveCounts[i]>0 && leaf<0) leaf = i;
+    }
+    ASSERT_GE(branch, 0);
+
+    WideBVHNodes<4> corrupted(wideNodes.begin(), wideNodes.end());
+    corrupted[0].children[branch] = 0;
+    EXPECT_EQ(BVH::IsValid(corrupted.data(), wideNodeCount, nodes.data(), nodeCount, indexCount), false);
+    corrupted[0].children[branch] = wideNodeCount;
+    EXPECT_EQ(BVH::IsValid(corrupted.data(), wideNodeCount, nodes.data(), nodeCount, indexCount), false);
+    corrupted.assign(wideNodes.begin(), wideNodes.end());
+    corrupted[0].children[(branch+1)%4] = wideNodes[0].children[branch];
+    corrupted[0].primitiveCounts[(branch+1)%4] = 0;
+    EXPECT_EQ(BVH::IsValid(corrupted.data(), wideNodeCount, nodes.data(), nodeCount, indexCount), false);
+    if(leaf>=0)
+    {
+        corrupted.assign(wideNodes.begin(), wideNodes.end());
+        corrupted[0].primitiveCounts[leaf] += 1;
+        EXPECT_EQ(BVH::IsValid(corrupted.data(), wideNodeCount, nodes.data(), nodeCount, indexCount), false);
+        corrupted[0].primitiveCounts[leaf] -= 1;
+        corrupted[0].children[leaf] = indexCount;
+        EXPECT_EQ(BVH::IsValid(corrupted.data(), wideNodeCount, nodes.data(), nodeCount, indexCount), false);
+    }
+}
+
+TEST(BVH, Intersect)
+{
+    vector<Box> boxes = randomBoxes(500, 2);
+    BVHBuildSettings medianSettings, sahSettings;
+    medianSettings.method = MEDIAN_SPLIT;
+    medianSettings.maxLeafSize = 2;
+    sahSettings.maxLeafSize = 2;
+    BVH medianBvh(boxes, medianSettings), sahBvh(boxes, sahSettings);
+
+    //The closest box entry point along the ray plays the role of the primitive intersection
+    auto intersector = [&](const int& id, const Ray& r, float& tMax)
+    {
+        std::array<float,2> t;
+        if(Intersect(r, boxes[id], t) && t[0]>=0 && t[0]<tMax)
+        {
+            tMax = t[0];
+            return true;
+        }
+        return false;
+    };
+
+    mt19937 generator(3);
+    uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    for(int i=0; i<200; ++i)
+    {
+        Ray ray(glm::vec3(0,0,-20), glm::vec3(distribution(generator), distribution(generator), 1.0f));
+
+        float bruteForceT = numeric_limits<float>::max();
+        bool bruteForceHit = false;
+        for(size_t j=0; j<boxes.size(); ++j)
+        {
+            bruteForceHit = intersector(j, ray, bruteForceT) || bruteForceHit;
+        }
+
+        float medianT = numeric_limits<float>::max();
+        bool medianHit = medianBvh.intersect(ray, medianT, intersector);
+        EXPECT_EQ(medianHit, bruteForceHit);
+        EXPECT_EQ(medianT, bruteForceT);
+
+        float sahT = numeric_limits<float>::max();
+        bool sahHit = sahBvh.intersect(ray, sahT, intersector);
+        EXPECT_EQ(sahHit, bruteForceHit);
+        EXPECT_EQ(sahT, bruteForceT);
+    }
+}
+
+TEST(BVH, IntersectLeaves)
+{
+    vector<Box> boxes = randomBoxes(500, 2);
+    BVH bvh(boxes);
+
+    auto intersector = [&](const int& id, const Ray& r, float& tMax)
+    {
+        std::array<float,2> t;
+        if(Intersect(r, boxes[id], t) && t[0]>=0 && t[0]<tMax)
+        {
+            tMax = t[0];
+            return true;
+        }
+        return false;
+    };
+
+    //Each leaf is reported once per ray as a range of the primitive indices
+    int leafCount = 0;
+    auto leafIntersector = [&](const int& first, const int& count, const Ray& r, float& tMax)
+    {
+        ++leafCount;
+        EXPECT_GE(first, 0);
+        EXPECT_LE(first+count, (int)bvh.primitiveIndices().size());
+        EXPECT_GE(count, 1);
+        bool hit = false;
+        for(int i=first; i<first+count; ++i)
+        {
+            hit = intersector(bvh.primitiveIndices()[i], r, tMax) || hit;
+        }
+        return hit;
+    };
+
+    mt19937 generator(3);
+    uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    for(int i=0; i<200; ++i)
+    {
+        Ray ray(glm::vec3(0,0,-20), glm::vec3(distribution(generator), distribution(generator), 1.0f));
+        float t = numeric_limits<float>::max(), leavesT = numeric_limits<float>::max();
+        bool hit = bvh.intersect(ray, t, intersector);
+        EXPECT_EQ(bvh.intersectLeaves(ray, leavesT, leafIntersector), hit);
+        EXPECT_EQ(leavesT, t);
+    }
+    EXPECT_GT(leafCount, 0);
+}
+
+TEST(BVH, BinnedSAH)
+{
+    //Two dense clusters far from each other and a few scattered boxes
+    vector<Box> boxes;
+    mt19937 generator(4);
+    uniform_real_distribution<float> cluster(0.0f, 1.0f), scattered(-50.0f, 50.0f);
+    for(int i=0; i<2000; ++i)
+    {
+        glm::vec3 offset = i%2==0 ? glm::vec3(-40,0,0) : glm::vec3(40,0,0);
+        glm::vec3 minBB = offset + glm::vec3(cluster(generator), cluster(generator), cluster(generator));
+        boxes.push_back(Box(minBB, minBB+glm::vec3(0.05f)));
+    }
+    for(int i=0; i<50; ++i)
+    {
+        glm::vec3 minBB(scattered(generator), scattered(generator), scattered(generator));
+        boxes.push_back(Box(minBB, minBB+glm::vec3(0.5f)));
+    }
+
+    BVHBuildSettings medianSettings, sahSettings;
+    medianSettings.method = MEDIAN_SPLIT;
+    sahSettings.parallelThreshold = 256;
+    BVH medianBvh(boxes, medianSettings), sahBvh(boxes, sahSettings);
+    EXPECT_EQ(countPrimitives(sahBvh), (int)boxes.size());
+    EXPECT_EQ(checkBounds(sahBvh, boxes), true);
+    EXPECT_LT(sahBvh.sahCost(), medianBvh.sahCost());
+    EXPECT_LE(maxLeafSize(sahBvh), sahSettings.maxLeafSize);
+
+    //A higher intersection cost produces smaller leaves and a larger traversal cost larger ones
+    BVHBuildSettings largeLeavesSettings;
+    largeLeavesSettings.maxLeafSize = 16;
+    largeLeavesSettings.traversalCost = 8.0f;
+    BVH largeLeavesBvh(boxes, largeLeavesSettings);
+    EXPECT_LE(maxLeafSize(largeLeavesBvh), 16);
+    EXPECT_GT(maxLeafSize(largeLeavesBvh), sahSettings.maxLeafSize);
+
+    //Primitives sharing the same centroid cannot be separated
+    vector<Box> identicalBoxes(10, Box(glm::vec3(0), glm::vec3(1)));
+    BVH identicalBvh(identicalBoxes, sahSettings);
+    EXPECT_EQ(identicalBvh.nodes().size(), 1u);
+    EXPECT_EQ(identicalBvh.nodes()[0].primitiveCount, 10);
+}
+
+TEST(BVH, Linear)
+{
+    vector<Box> boxes = randomBoxes(3000, 5);
+    BVHBuildSettings linearSettings, treeletSettings, sahSettings;
+    linearSettings.method = LINEAR;
+    linearSettings.parallelThreshold = 256;
+    treeletSettings = linearSettings;
+    treeletSettings.treeletSize = 7;
+    BVH linearBvh(boxes, linearSettings), treeletBvh(boxes, treeletSettings), sahBvh(boxes, sahSettings);
+
+    for(const BVH* bvh : {&linearBvh, &treeletBvh})
+    {
+        EXPECT_EQ(countPrimitives(*bvh), (int)boxes.size());
+        EXPECT_EQ(checkBounds(*bvh, boxes), true);
+        EXPECT_LE(maxLeafSize(*bvh), linearSettings.maxLeafSize);
+        vector<int> sortedIndices(bvh->primitiveIndices().begin(), bvh->primitiveIndices().end());
+        sort(sortedIndices.begin(), sortedIndices.end());
+        for(size_t i=0; i<sortedIndices.size(); ++i) EXPECT_EQ(sortedIndices[i], (int)i);
+    }
+
+    //Restructuring the treelets brings the quality of the hierarchy close to the SAH builder
+    EXPECT_LT(treeletBvh.sahCost(), linearBvh.sahCost());
+    EXPECT_LT(treeletBvh.sahCost(), 1.2f*sahBvh.sahCost());
+
+    auto intersector = [&](const int& id, const Ray& r, float& tMax)
+    {
+        std::array<float,2> t;
+        if(Intersect(r, boxes[id], t) && t[0]>=0 && t[0]<tMax)
+        {
+            tMax = t[0];
+            return true;
+        }
+        return false;
+    };
+    mt19937 generator(6);
+    uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    for(int i=0; i<200; ++i)
+    {
+        Ray ray(glm::vec3(0,0,-20), glm::vec3(distribution(generator), distribution(generator), 1.0f));
+        float bruteForceT = numeric_limits<float>::max();
+        for(size_t j=0; j<boxes.size(); ++j) intersector(j, ray, bruteForceT);
+
+        float linearT = numeric_limits<float>::max(), treeletT = numeric_limits<float>::max();
+        linearBvh.intersect(ray, linearT, intersector);
+        treeletBvh.intersect(ray, treeletT, intersector);
+        EXPECT_EQ(linearT, bruteForceT);
+        EXPECT_EQ(treeletT, bruteForceT);
+    }
+
+    //Primitives sharing the same Morton code are still separated
+    vector<Box> identicalBoxes(10, Box(glm::vec3(0), glm::vec3(1)));
+    identicalBoxes.push_back(Box(glm::vec3(5), glm::vec3(6)));
+    BVH identicalBvh(identicalBoxes, linearSettings);
+    EXPECT_EQ(countPrimitives(identicalBvh), 11);
+
+    BVH singleBvh(vector<Box>(1, Box(glm::vec3(0), glm::vec3(1))), linearSettings);
+    EXPECT_EQ(singleBvh.nodes().size(), 1u);
+    EXPECT_EQ(singleBvh.nodes()[0].isLeaf(), true);
+}
+
+template<int Width>
+static int countPrimitives(const MappedArray< WideBVHNodes<Width> >& nodes)
+{
+    int count = 0;
+    for(const WideBVHNode<Width>& node : nodes)
+    {
+        for(int i=0; i<Width; ++i) count += max(node.primitiveCounts[i], 0);
+    }
+    return count;
+}
+
+TEST(BVH, Wide)
+{
+    vector<Box> boxes = randomBoxes(2000, 7);
+    auto intersector = [&](const int& id, const Ray& r, float& tMax)
+    {
+        std::array<float,2> t;
+        if(Intersect(r, boxes[id], t) && t[0]>=0 && t[0]<tMax)
+        {
+            tMax = t[0];
+            return true;
+        }
+        return false;
+    };
+
+    vector<BVH> bvhs;
+    for(int width : {2, 4, 8})
+    {
+        BVHBuildSettings settings;
+        settings.width = width;
+        bvhs.push_back(BVH(boxes, settings));
+    }
+    EXPECT_EQ(bvhs[0].settings().width, 2);
+    EXPECT_EQ(bvhs[0].nodes4().empty() && bvhs[0].nodes8().empty(), true);
+    EXPECT_EQ(bvhs[1].settings().width, 4);
+    EXPECT_EQ(countPrimitives(bvhs[1].nodes4()), (int)boxes.size());
+    EXPECT_LT(bvhs[1].nodes4().size(), bvhs[1].nodes().size()/3);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(bvhs[1].nodes4().data()) % 64, 0u);
+    if(SupportsAVX2())
+    {
+        EXPECT_EQ(bvhs[2].settings().width, 8);
+        EXPECT_EQ(countPrimitives(bvhs[2].nodes8()), (int)boxes.size());
+        EXPECT_LT(bvhs[2].nodes8().size(), bvhs[1].nodes4().size());
+    }
+    else
+    {
+        EXPECT_EQ(bvhs[2].settings().width, 4);
+    }
+
+    mt19937 generator(8);
+    uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    for(int i=0; i<300; ++i)
+    {
+        Ray ray(glm::vec3(distribution(generator), distribution(generator), -20), glm::vec3(distribution(generator), distribution(generator), 1.0f));
+        float bruteForceT = numeric_limits<float>::max();
+        bool bruteForceHit = false;
+        for(size_t j=0; j<boxes.size(); ++j) bruteForceHit = intersector(j, ray, bruteForceT) || bruteForceHit;
+
+        for(const BVH& bvh : bvhs)
+        {
+            float t = numeric_limits<float>::max();
+            EXPECT_EQ(bvh.intersect(ray, t, intersector), bruteForceHit);
+            EXPECT_EQ(t, bruteForceT);
+        }
+    }
+
+    //A single primitive gives a wide root with a single leaf
+    BVHBuildSettings settings;
+    settings.width = 4;
+    BVH singleBvh(vector<Box>(1, Box(glm::vec3(0), glm::vec3(1))), settings);
+    EXPECT_EQ(singleBvh.nodes4().size(), 1u);
+    EXPECT_EQ(singleBvh.nodes4()[0].primitiveCounts[0], 1);
+    EXPECT_EQ(singleBvh.nodes4()[0].primitiveCounts[1], -1);
+    auto hitIntersector = [](const int&, const Ray&, float& tMax)
+    {
+        tMax = 1.0f;
+        return true;
+    };
+    float t = numeric_limits<float>::max();
+    EXPECT_EQ(singleBvh.intersect(Ray(glm::vec3(0.5f,0.5f,-1), glm::vec3(0,0,1)), t, hitIntersector), true);
+    EXPECT_EQ(singleBvh.intersect(Ray(glm::vec3(2.0f,0.5f,-1), glm::vec3(0,0,1)), t, hitIntersector), false);
+}
+
+TEST(BVH, Refit)
+{
+    vector<Box> boxes = randomBoxes(2000, 9);
+    BVHBuildSettings settings;
+    settings.parallelThreshold = 64;
+    BVH bvh(boxes, settings);
+    EXPECT_EQ(bvh.builtSahCost(), bvh.sahCost());
+    const size_t nodeCount = bvh.nodes().size();
+
+    //Small motions only refit the bounds
+    mt19937 generator(10);
+    uniform_real_distribution<float> motion(-0.2f, 0.2f);
+    for(Box& b : boxes)
+    {
+        glm::vec3 offset(motion(generator), motion(generator), motion(generator));
+        b = Box(b.minBound()+offset, b.maxBound()+offset);
+    }
+    EXPECT_EQ(bvh.refit(boxes), false);
+    EXPECT_EQ(bvh.nodes().size(), nodeCount);
+    EXPECT_EQ(checkBounds(bvh, boxes), true);
+    EXPECT_GT(bvh.sahCost(), bvh.builtSahCost());
+
+    auto intersector = [&](const int& id, const Ray& r, float& tMax)
+    {
+        std::array<float,2> t;
+        if(Intersect(r, boxes[id], t) && t[0]>=0 && t[0]<tMax)
+        {
+            tMax = t[0];
+            return true;
+        }
+        return false;
+    };
+    uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    for(int i=0; i<100; ++i)
+    {
+        Ray ray(glm::vec3(0,0,-20), glm::vec3(distribution(generator), distribution(generator), 1.0f));
+        float bruteForceT = numeric_limits<float>::max();
+        for(size_t j=0; j<boxes.size(); ++j) intersector(j, ray, bruteForceT);
+        float t = numeric_limits<float>::max();
+        bvh.intersect(ray, t, intersector);
+        EXPECT_EQ(t, bruteForceT);
+    }
+
+    //Shuffling the primitives degrades the hierarchy until it is rebuilt
+    shuffle(boxes.begin(), boxes.end(), generator);
+    EXPECT_EQ(bvh.refit(boxes), true);
+    EXPECT_EQ(checkBounds(bvh, boxes), true);
+    EXPECT_EQ(bvh.builtSahCost(), bvh.sahCost());
+
+    //Unless rebuilding is disabled
+    settings.rebuildThreshold = 0.0f;
+    BVH refitOnlyBvh(boxes, settings);
+    shuffle(boxes.begin(), boxes.end(), generator);
+    EXPECT_EQ(refitOnlyBvh.refit(boxes), false);
+    EXPECT_EQ(checkBounds(refitOnlyBvh, boxes), true);
+}
+
+TEST(BVH, SpatialSplit)
+{
+    //Small triangles and a few long and thin ones crossing the scene, whose boxes overlap many others
+    mt19937 generator(11);
+    uniform_real_distribution<float> position(-10.0f, 10.0f), offset(-0.05f, 0.05f);
+    vector< std::array<glm::vec3,3> > triangles;
+    vector<Box> boxes;
+    for(int i=0; i<1000; ++i)
+    {
+        glm::vec3 start(position(generator), position(generator), position(generator));
+        glm::vec3 end = i%10==0 ? start + 1.5f*glm::vec3(position(generator), position(generator), position(generator)) : start + glm::vec3(0.3f,0.1f,0.2f);
+        std::array<glm::vec3,3> triangle = {{start, end, end+glm::vec3(offset(generator), 0.1f, offset(generator))}};
+        triangles.push_back(triangle);
+        boxes.push_back(Box::Empty());
+        for(const glm::vec3& v : triangle) boxes.back().extend(v);
+    }
+
+    auto splitter = [&](const int& i, const int& axis, const float& plane, Box& left, Box& right)
+    {
+        left = Box::Empty();
+        right = Box::Empty();
+        for(int j=0; j<3; ++j)
+        {
+            const glm::vec3& v0 = triangles[i][j];
+            const glm::vec3& v1 = triangles[i][(j+1)%3];
+            if(v0[axis]<=plane) left.extend(v0);
+            if(v0[axis]>=plane) right.extend(v0);
+            if((v0[axis]<plane && v1[axis]>plane) || (v0[axis]>plane && v1[axis]<plane))
+            {
+                glm::vec3 p = v0 + (plane-v0[axis])/(v1[axis]-v0[axis])*(v1-v0);
+                p[axis] = plane;
+                left.extend(p);
+                right.extend(p);
+            }
+        }
+    };
+
+    BVHBuildSettings sahSettings, spatialSettings;
+    spatialSettings.method = SPATIAL_SPLIT;
+    spatialSettings.parallelThreshold = 128;
+    BVH sahBvh(boxes, sahSettings), spatialBvh(boxes, spatialSettings, splitter);
+    EXPECT_EQ(spatialBvh.settings().method, SPATIAL_SPLIT);
+    EXPECT_LT(spatialBvh.sahCost(), 0.8f*sahBvh.sahCost());
+
+    //The duplicated references stay within the budget
+    EXPECT_GT(spatialBvh.primitiveIndices().size(), boxes.size());
+    EXPECT_LE(spatialBvh.primitiveIndices().size(), (size_t)((1.0f+spatialSettings.spatialSplitBudget)*boxes.size()));
+    EXPECT_EQ(countPrimitives(spatialBvh), (int)spatialBvh.primitiveIndices().size());
+
+    //The leaves built concurrently still follow each other in depth-first order
+    EXPECT_EQ(BVH::IsValid(spatialBvh.nodes().data(), spatialBvh.nodes().size(), spatialBvh.primitiveIndices().data(),
+                           spatialBvh.primitiveIndices().size(), boxes.size()), true);
+    vector<int> referenced(spatialBvh.primitiveIndices().begin(), spatialBvh.primitiveIndices().end());
+    sort(referenced.begin(), referenced.end());
+    EXPECT_EQ(unique(referenced.begin(), referenced.end())-referenced.begin(), (int)boxes.size());
+
+    //Without budget, no reference is duplicated
+    BVHBuildSettings noBudgetSettings = spatialSettings;
+    noBudgetSettings.spatialSplitBudget = 0.0f;
+    BVH noBudgetBvh(boxes, noBudgetSettings, splitter);
+    EXPECT_EQ(noBudgetBvh.primitiveIndices().size(), boxes.size());
+
+    //Without splitter, the spatial splits fall back to the binned SAH
+    BVH noSplitterBvh(boxes, spatialSettings);
+    EXPECT_EQ(noSplitterBvh.settings().method, BINNED_SAH);
+
+    auto intersector = [&](const int& i, const Ray& r, float& tMax)
+    {
+        glm::vec3 hitPosition, hitNormal, barycentricCoords;
+        if(triangleRayIntersection(triangles[i][0], triangles[i][1], triangles[i][2], r, hitPosition, hitNormal, barycentricCoords))
+        {
+            float t = glm::length(hitPosition-r.origin());
+            if(t<tMax)
+            {
+                tMax = t;
+                return true;
+            }
+        }
+        return false;
+    };
+    uniform_real_distribution<float> direction(-1.0f, 1.0f);
+    int hitCount = 0;
+    for(int i=0; i<500; ++i)
+    {
+        Ray ray(glm::vec3(position(generator), position(generator), -20), glm::vec3(direction(generator), direction(generator), 1.0f));
+        float bruteForceT = numeric_limits<float>::max();
+        bool bruteForceHit = false;
+        for(size_t j=0; j<triangles.size(); ++j) bruteForceHit = intersector(j, ray, bruteForceT) || bruteForceHit;
+        float t = numeric_limits<float>::max();
+        EXPECT_EQ(spatialBvh.intersect(ray, t, intersector), bruteForceHit);
+        EXPECT_EQ(t, bruteForceT);
+        hitCount += bruteForceHit;
+    }
+    EXPECT_GT(hitCount, 0);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,96 @@
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <gtest/gtest.h>
+#include <raytracer-sandbox/cache.hpp>
+#include "config.h"
+
+using namespace std;
+
+TEST(MappedFile, Open)
+{
+    MappedFile missing("nonepath.bin");
+    EXPECT_EQ(missing.isOpen(), false);
+    EXPECT_EQ(missing.size(), size_t(0));
+
+    string filename = CurrentBinaryDir()+"/mappedFileTest.bin";
+    {
+        ofstream file(filename.c_str(), ios::binary);
+        file << "raytracer-sandbox";
+    }
+    {
+        MappedFile file(filename);
+        ASSERT_EQ(file.isOpen(), true);
+        ASSERT_EQ(file.size(), size_t(17));
+        EXPECT_EQ(string(file.data(), file.size()), "raytracer-sandbox");
+    }
+    remove(filename.c_str());
+}
+
+TEST(HashBytes, FNV1a)
+{
+    //Reference values of the 64-bit FNV-1a function
+    EXPECT_EQ(HashBytes("", 0), 14695981039346656037ull);
+    EXPECT_EQ(HashBytes("a", 1), 0xaf63dc4c8601ec8cull);
+    EXPECT_EQ(HashBytes("foobar", 6), 0x85944171f73967e8ull);
+
+    //Hashing in several blocks is hashing the concatenation
+    EXPECT_EQ(HashBytes("bar", 3, HashBytes("foo", 3)), HashBytes("foobar", 6));
+    EXPECT_NE(HashBytes("foobaz", 6), HashBytes("foobar", 6));
+}
+
+//Hashing by words gives the same hash whatever the alignment of the block and hashes the bytes after the last word
+TEST(HashWords, Blocks)
+{
+    const char text[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+    vector<char> shifted(sizeof(text)+1);
+    std::memcpy(shifted.data()+1, text, sizeof(text));
+    EXPECT_EQ(HashWords(shifted.data()+1, sizeof(text)), HashWords(text, sizeof(text)));
+    EXPECT_EQ(HashWords(text, 3), HashBytes(text, 3));
+    EXPECT_NE(HashWords(text, 17), HashWords(text, 16));
+
+    //A change of any byte of a word changes the hash
+    for(int i=0; i<16; ++i)
+    {
+        char edited[sizeof(text)];
+        std::memcpy(edited, text, sizeof(text));
+        edited[i] ^= 1;
+        EXPECT_NE(HashWords(edited, sizeof(text)), HashWords(text, sizeof(text)));
+    }
+}
+
+//The hash of a file only depends on its content, not on its path or modification time
+TEST(HashFile, Content)
+{
+    uint64_t hash = 0, copyHash = 0, editedHash = 0;
+    EXPECT_EQ(HashFile("nonepath.obj", hash), false);
+
+    string filename = CurrentBinaryDir()+"/hashFileTest.obj", copyFilename = CurrentBinaryDir()+"/hashFileCopyTest.obj";
+    for(const string& name : { filename, copyFilename })
+    {
+        ofstream file(name.c_str(), ios::binary);
+        file << "v 0 0 0\nv 1 0 0";
+    }
+    ASSERT_EQ(HashFile(filename, hash), true);
+    ASSERT_EQ(HashFile(copyFilename, copyHash), true);
+    EXPECT_EQ(copyHash, hash);
+
+    //An edit keeping the size of the file changes its hash
+    {
+        ofstream file(filename.c_str(), ios::binary);
+        file << "v 0 0 0\nv 2 0 0";
+    }
+    ASSERT_EQ(HashFile(filename, editedHash), true);
+    EXPECT_NE(editedHash, hash);
+    remove(filename.c_str());
+    remove(copyFilename.c_str());
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
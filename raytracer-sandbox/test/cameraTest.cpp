@@ -111,6 +111,29 @@ TEST(Camera, ComputeRayThroughPixel)
     EXPECT_EQ(r.direction()[2], -1.0);
 }
 
+TEST(Camera, ComputeRayPacket)
+{
+    float fov=100.0, width=1280, height=720, near=1, far=100;
+    Camera camera(fov, width, height, near, far);
+
+    //The ray i+j*packetWidth goes through the pixel (x+i, y+j)
+    for(int packetWidth=2; packetWidth<=4; packetWidth+=2)
+    {
+        RayPacket packet = camera.computeRayPacket(100.5, 200.5, packetWidth);
+        EXPECT_EQ(packet.size, packetWidth*packetWidth);
+        EXPECT_EQ(packet.coherent, true);
+        for(int j=0; j<packetWidth; ++j)
+        {
+            for(int i=0; i<packetWidth; ++i)
+            {
+                Ray r = camera.computeRayThroughPixel(100.5+i, 200.5+j);
+                EXPECT_EQ(packet.rays[i+j*packetWidth].origin(), r.origin());
+                EXPECT_EQ(packet.rays[i+j*packetWidth].direction(), r.direction());
+            }
+        }
+    }
+}
+
 TEST(Camera, CameraStream)
 {
     float fov=100.0, width=1280, height=720, near=1, far=100;
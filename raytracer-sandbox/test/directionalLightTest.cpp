@@ -42,6 +42,7 @@ TEST(DirectionalLight, LightFromDirection)
     EXPECT_EQ(light.lightDirectionFrom(glm::vec3(0,0,0))[0], direction[0]);
     EXPECT_EQ(light.lightDirectionFrom(glm::vec3(0,0,0))[1], direction[1]);
     EXPECT_EQ(light.lightDirectionFrom(glm::vec3(0,0,0))[2], direction[2]);
+    EXPECT_EQ(light.distanceFrom(glm::vec3(0,0,0)), numeric_limits<float>::max());
 }
 
 TEST(DirectionalLight, PhongIllumination)
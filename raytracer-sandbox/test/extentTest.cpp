@@ -68,6 +68,33 @@ TEST(ExtentSettings, Clone_Constructor)
     }
 }
 
+TEST(ExtentSettings, KDOP_Constructor)
+{
+    ExtentSettingsPtr settings7 = ExtentSettings::KDOP7_Settings();
+    ExtentSettingsPtr settings13 = ExtentSettings::KDOP13_Settings();
+    ASSERT_EQ(settings7->planeSetNormals().size(), size_t(7));
+    ASSERT_EQ(settings13->planeSetNormals().size(), size_t(13));
+
+    //The first normals are the axes and every normal is unit and distinct from the others
+    const std::vector< glm::vec3 >& normals = settings13->planeSetNormals();
+    for(size_t i=0; i<3; ++i)
+    {
+        EXPECT_EQ(normals[i], ExtentSettings::AABB_Settings()->planeSetNormals()[i]);
+    }
+    for(size_t i=0; i<normals.size(); ++i)
+    {
+        EXPECT_FLOAT_EQ(glm::length(normals[i]), 1.0f);
+        if(i<7)
+        {
+            EXPECT_EQ(normals[i], settings7->planeSetNormals()[i]);
+        }
+        for(size_t j=0; j<i; ++j)
+        {
+            EXPECT_LT(std::abs(glm::dot(normals[i], normals[j])), 0.9f);
+        }
+    }
+}
+
 TEST(Extent, Default_Constructor)
 {
     ExtentSettingsPtr settings=nullptr;
@@ -0,0 +1,206 @@
+#include <random>
+#include <gtest/gtest.h>
+#include <raytracer-sandbox/extentbvh.hpp>
+#include <raytracer-sandbox/utils.hpp>
+
+using namespace std;
+
+//Thin planks oriented along the diagonals of the cube, whose bounding boxes are mostly empty
+static vector< array<glm::vec3,3> > diagonalPlanks(const int& plankCount)
+{
+    mt19937 generator(3);
+    uniform_real_distribution<float> position(-10.0f, 10.0f), direction(-1.0f, 1.0f);
+    const glm::vec3 diagonals[4] = { glm::normalize(glm::vec3(1,1,1)), glm::normalize(glm::vec3(-1,1,1)),
+                                     glm::normalize(glm::vec3(1,-1,1)), glm::normalize(glm::vec3(1,1,-1)) };
+    vector< array<glm::vec3,3> > triangles;
+    for(int i=0; i<plankCount; ++i)
+    {
+        glm::vec3 center(position(generator), position(generator), position(generator));
+        const glm::vec3& d = diagonals[i%4];
+        glm::vec3 w = 0.05f*glm::normalize(glm::cross(d, glm::vec3(direction(generator), direction(generator), direction(generator))));
+        triangles.push_back({{center-d-w, center+d-w, center+d+w}});
+        triangles.push_back({{center-d-w, center+d+w, center-d+w}});
+    }
+    return triangles;
+}
+
+static vector<Box> triangleBoxes(const vector< array<glm::vec3,3> >& triangles)
+{
+    vector<Box> boxes(triangles.size(), Box::Empty());
+    for(size_t i=0; i<triangles.size(); ++i)
+    {
+        for(const glm::vec3& v : triangles[i]) boxes[i].extend(v);
+    }
+    return boxes;
+}
+
+static vector<Extent> triangleExtents(const vector< array<glm::vec3,3> >& triangles, const ExtentSettingsPtr& settings)
+{
+    vector<Extent> extents;
+    for(const array<glm::vec3,3>& triangle : triangles)
+    {
+        vector<glm::vec3> vertices(triangle.begin(), triangle.end());
+        extents.push_back(Extent(settings, vertices));
+    }
+    return extents;
+}
+
+static vector<Ray> randomRays(const int& rayCount)
+{
+    mt19937 generator(5);
+    uniform_real_distribution<float> position(-10.0f, 10.0f);
+    vector<Ray> rays;
+    for(int i=0; i<rayCount; ++i)
+    {
+        glm::vec3 origin = 2.0f*glm::vec3(position(generator), position(generator), position(generator));
+        glm::vec3 target = 0.5f*glm::vec3(position(generator), position(generator), position(generator));
+        rays.push_back(Ray(origin, target-origin));
+    }
+    return rays;
+}
+
+TEST(ExtentBVH, Default_Constructor)
+{
+    ExtentBVH bvh;
+    EXPECT_EQ(bvh.empty(), true);
+    float tMax = numeric_limits<float>::max();
+    auto intersector = [](const int&, const Ray&, float&){ return true; };
+    EXPECT_EQ(bvh.intersect(Ray(glm::vec3(0,0,0), glm::vec3(0,0,1)), tMax, intersector), false);
+}
+
+TEST(ExtentBVH, Slabs)
+{
+    vector< array<glm::vec3,3> > triangles = diagonalPlanks(100);
+    vector<Box> boxes = triangleBoxes(triangles);
+    BVH bvh(boxes);
+
+    ExtentSettingsPtr settings = ExtentSettings::KDOP7_Settings();
+    ExtentBVH extentBVH(bvh, triangleExtents(triangles, settings), settings);
+    ASSERT_EQ(extentBVH.lanes(), 8);
+    ASSERT_EQ(extentBVH.nodes().size(), bvh.nodes().size());
+    ASSERT_EQ(extentBVH.slabs().size(), bvh.nodes().size()*16);
+    EXPECT_EQ(extentBVH.primitiveIndices(), vector<int>(bvh.primitiveIndices().begin(), bvh.primitiveIndices().end()));
+
+    //The axis slabs of each node are its bounding box and the padding slab is infinite
+    for(size_t n=0; n<bvh.nodes().size(); ++n)
+    {
+        const float* slabs = &extentBVH.slabs()[n*16];
+        for(int a=0; a<3; ++a)
+        {
+            EXPECT_FLOAT_EQ(slabs[a], bvh.nodes()[n].aabb.minBound()[a]);
+            EXPECT_FLOAT_EQ(slabs[8+a], bvh.nodes()[n].aabb.maxBound()[a]);
+        }
+        EXPECT_EQ(slabs[7], -numeric_limits<float>::max());
+        EXPECT_EQ(slabs[15], numeric_limits<float>::max());
+    }
+
+    //The wide nodes only keep the diagonal slabs, as their boxes hold the axis ones
+    EXPECT_EQ(extentBVH.width(), bvh.settings().width);
+    ASSERT_EQ(extentBVH.cullingNormals().size(), 4u);
+    const int width = extentBVH.width();
+    const size_t wideNodeCount = width==8 ? bvh.nodes8().size() : width==4 ? bvh.nodes4().size() : 0;
+    EXPECT_EQ(extentBVH.wideSlabs().size(), wideNodeCount*2*width*4);
+}
+
+TEST(ExtentBVH, Intersect)
+{
+    vector< array<glm::vec3,3> > triangles = diagonalPlanks(500);
+    BVH bvh(triangleBoxes(triangles));
+
+    auto intersector = [&](const int& i, const Ray& r, float& tMax)
+    {
+        glm::vec3 hitPosition, hitNormal, barycentricCoords;
+        if(triangleRayIntersection(triangles[i][0], triangles[i][1], triangles[i][2], r, hitPosition, hitNormal, barycentricCoords))
+        {
+            float distance = glm::length(hitPosition-r.origin());
+            if(distance<tMax)
+            {
+                tMax = distance;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    vector<Ray> rays = randomRays(500);
+    //Axis-aligned rays have slabs parallel to them
+    rays.push_back(Ray(glm::vec3(0,0,-30), glm::vec3(0,0,1)));
+    rays.push_back(Ray(glm::vec3(1,-30,2), glm::vec3(0,1,0)));
+
+    BVHBuildSettings binarySettings;
+    binarySettings.width = 2;
+    BVH binaryBVH(triangleBoxes(triangles), binarySettings);
+
+    for(ExtentSettingsPtr settings : { ExtentSettings::AABB_Settings(), ExtentSettings::KDOP7_Settings(), ExtentSettings::KDOP13_Settings() })
+    for(const BVH* hierarchy : { &bvh, &binaryBVH })
+    {
+        ExtentBVH extentBVH(*hierarchy, triangleExtents(triangles, settings), settings);
+        EXPECT_EQ(extentBVH.lanes(), 4*(((int)settings->planeSetNormals().size()+3)/4));
+        //The slabs of the axes are the boxes of the wide nodes, which leaves the ones of an AABB with no culling slabs
+        if(settings->planeSetNormals().size()==3)
+        {
+            EXPECT_TRUE(extentBVH.cullingNormals().empty());
+            EXPECT_TRUE(extentBVH.wideSlabs().empty());
+        }
+        for(const Ray& r : rays)
+        {
+            float bruteForceT = numeric_limits<float>::max();
+            for(size_t i=0; i<triangles.size(); ++i) intersector(i, r, bruteForceT);
+
+            float tMax = numeric_limits<float>::max();
+            bool hit = extentBVH.intersect(r, tMax, intersector);
+            EXPECT_EQ(hit, bruteForceT<numeric_limits<float>::max());
+            EXPECT_FLOAT_EQ(tMax, bruteForceT);
+        }
+    }
+}
+
+TEST(ExtentBVH, TriangleTests)
+{
+    vector< array<glm::vec3,3> > triangles = diagonalPlanks(2000);
+    BVH bvh(triangleBoxes(triangles));
+    vector<Ray> rays = randomRays(5000);
+
+    //Trace the rays through a hierarchy and count the ray/triangle tests
+    auto countTests = [&](const auto& hierarchy)
+    {
+        long tests = 0;
+        auto intersector = [&](const int& i, const Ray& r, float& tMax)
+        {
+            ++tests;
+            glm::vec3 hitPosition, hitNormal, barycentricCoords;
+            if(triangleRayIntersection(triangles[i][0], triangles[i][1], triangles[i][2], r, hitPosition, hitNormal, barycentricCoords))
+            {
+                float distance = glm::length(hitPosition-r.origin());
+                if(distance<tMax)
+                {
+                    tMax = distance;
+                    return true;
+                }
+            }
+            return false;
+        };
+        for(const Ray& r : rays)
+        {
+            float tMax = numeric_limits<float>::max();
+            hierarchy.intersect(r, tMax, intersector);
+        }
+        return tests;
+    };
+
+    long aabbTests = countTests(bvh);
+    ExtentSettingsPtr settings7 = ExtentSettings::KDOP7_Settings();
+    long kdop7Tests = countTests(ExtentBVH(bvh, triangleExtents(triangles, settings7), settings7));
+    ExtentSettingsPtr settings13 = ExtentSettings::KDOP13_Settings();
+    long kdop13Tests = countTests(ExtentBVH(bvh, triangleExtents(triangles, settings13), settings13));
+
+    //The diagonal slabs cull most of the empty corners of the boxes
+    EXPECT_LT(kdop7Tests, aabbTests/2);
+    EXPECT_LT(kdop13Tests, kdop7Tests);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
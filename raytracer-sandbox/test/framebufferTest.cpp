@@ -0,0 +1,61 @@
+#include <iostream>
+#include <gtest/gtest.h>
+#include <raytracer-sandbox/framebuffer.hpp>
+
+using namespace std;
+
+TEST(FrameBuffer, Constructor)
+{
+    FrameBuffer frame(4, 3);
+    EXPECT_EQ(frame.width(), 4);
+    EXPECT_EQ(frame.height(), 3);
+    EXPECT_EQ(frame.passes(), 0);
+    EXPECT_EQ(frame.sampleCount(), 0u);
+    EXPECT_EQ(frame.color(3, 2), glm::vec3(0,0,0));
+
+    FrameBuffer empty;
+    EXPECT_EQ(empty.width(), 0);
+    EXPECT_EQ(empty.sampleCount(), 0u);
+}
+
+//The color of a pixel is the mean of its own samples
+TEST(FrameBuffer, Add)
+{
+    FrameBuffer frame(4, 3);
+    frame.add(1, 2, glm::vec3(1,0,0));
+    frame.add(1, 2, glm::vec3(0,1,0));
+    for(int i=0; i<3; ++i) frame.add(3, 0, glm::vec3(1,1,0));
+    frame.addPass();
+    EXPECT_EQ(frame.passes(), 1);
+    EXPECT_EQ(frame.sampleCount(1, 2), 2);
+    EXPECT_EQ(frame.sampleCount(3, 0), 3);
+    EXPECT_EQ(frame.sampleCount(), 5u);
+    EXPECT_EQ(frame.color(1, 2), glm::vec3(0.5,0.5,0));
+    EXPECT_EQ(frame.color(3, 0), glm::vec3(1,1,0));
+
+    EXPECT_NEAR(frame.variance(1, 2), 0.5f, 1e-6);
+    EXPECT_EQ(frame.variance(3, 0), 0.0f);
+    EXPECT_EQ(frame.variance(0, 0), 0.0f);
+
+    std::vector<glm::vec3> image;
+    frame.resolve(image);
+    ASSERT_EQ(image.size(), 12u);
+    EXPECT_EQ(image[1+2*4], glm::vec3(0.5,0.5,0));
+    EXPECT_EQ(image[3], glm::vec3(1,1,0));
+    EXPECT_EQ(image[0], glm::vec3(0,0,0));
+
+    frame.clear();
+    EXPECT_EQ(frame.passes(), 0);
+    EXPECT_EQ(frame.sampleCount(), 0u);
+    EXPECT_EQ(frame.width(), 4);
+
+    frame.resize(2, 2);
+    frame.resolve(image);
+    EXPECT_EQ(image.size(), 4u);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
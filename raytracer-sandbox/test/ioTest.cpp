@@ -1,3 +1,5 @@
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <gtest/gtest.h>
 
@@ -26,6 +28,35 @@ TEST(IO, read_obj)
     EXPECT_EQ(texcoords.size(), size_t(3));
 }
 
+TEST(IO, write_ppm)
+{
+    const std::vector<glm::vec3> image = { glm::vec3(1,0,0), glm::vec3(0,0.5,2), glm::vec3(-1,0,0), glm::vec3(0,0,1) };
+    const std::string filename = CurrentBinaryDir()+"/writePpmTest.ppm";
+
+    EXPECT_FALSE(write_ppm(filename, 3, 2, image));
+    ASSERT_TRUE(write_ppm(filename, 2, 2, image));
+
+    std::ifstream file(filename, std::ios::binary);
+    std::string magic;
+    int width, height, maxValue;
+    file >> magic >> width >> height >> maxValue;
+    file.get();
+    EXPECT_EQ(magic, "P6");
+    EXPECT_EQ(width, 2);
+    EXPECT_EQ(height, 2);
+    EXPECT_EQ(maxValue, 255);
+
+    //The colors are clamped to [0,1], the rows following each other from the top
+    unsigned char pixels[12];
+    file.read((char*)pixels, 12);
+    ASSERT_TRUE(bool(file));
+    const unsigned char expected[12] = { 255,0,0, 0,128,255, 0,0,0, 0,0,255 };
+    for(int i=0; i<12; ++i) EXPECT_EQ(pixels[i], expected[i]);
+    EXPECT_EQ(file.get(), EOF);
+    file.close();
+    remove(filename.c_str());
+}
+
 int main(int argc, char **argv)
 {
     testing::InitGoogleTest(&argc, argv);
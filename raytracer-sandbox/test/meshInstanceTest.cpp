@@ -0,0 +1,79 @@
+#include <iostream>
+#include <gtest/gtest.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <raytracer-sandbox/meshInstance.hpp>
+#include <raytracer-sandbox/scene.hpp>
+#include "config.h"
+
+using namespace std;
+
+TEST(MeshInstance, Constructor)
+{
+    string filename = CurrentBinaryDir()+"/../test/meshes/triangle.obj";
+    shared_ptr<const TMesh> mesh = make_shared<TMesh>(filename, PhongMaterial::Bronze());
+    PhongMaterialPtr material = PhongMaterial::Emerald();
+
+    //Scale by 2 then translate along x
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(10,0,0)) * glm::scale(glm::mat4(1.0f), glm::vec3(2.0f));
+    MeshInstance instance(mesh, transform, material);
+    EXPECT_EQ(instance.mesh(), mesh);
+    EXPECT_EQ(instance.material(), material);
+
+    Box instanceBox = instance.bbox();
+    EXPECT_FLOAT_EQ(instanceBox.minBound()[0], 9.0f);
+    EXPECT_FLOAT_EQ(instanceBox.minBound()[1], -1.0f);
+    EXPECT_FLOAT_EQ(instanceBox.maxBound()[0], 11.0f);
+    EXPECT_FLOAT_EQ(instanceBox.maxBound()[1], 1.0f);
+    EXPECT_FLOAT_EQ(instanceBox.maxBound()[2], 0.0f);
+}
+
+TEST(MeshInstance, Intersect)
+{
+    string filename = CurrentBinaryDir()+"/../test/meshes/triangle.obj";
+    shared_ptr<const TMesh> mesh = make_shared<TMesh>(filename, PhongMaterial::Bronze());
+
+    //Rotate the triangle to face x, then translate it
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(5,0,0)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0,1,0));
+    MeshInstance instance(mesh, transform, PhongMaterial::Emerald());
+
+    glm::vec3 hitPosition, hitNormal;
+    EXPECT_EQ(instance.Intersect(Ray(glm::vec3(0,0,0), glm::vec3(0,0,1)), hitPosition, hitNormal), false);
+    EXPECT_EQ(instance.Intersect(Ray(glm::vec3(0,0,0), glm::vec3(1,0,0)), hitPosition, hitNormal), true);
+    EXPECT_NEAR(hitPosition[0], 5.0f, 1e-5f);
+    EXPECT_NEAR(hitPosition[1], 0.0f, 1e-5f);
+    EXPECT_NEAR(hitPosition[2], 0.0f, 1e-5f);
+    EXPECT_NEAR(hitNormal[0], 1.0f, 1e-5f);
+    EXPECT_NEAR(hitNormal[1], 0.0f, 1e-5f);
+    EXPECT_NEAR(hitNormal[2], 0.0f, 1e-5f);
+}
+
+TEST(MeshInstance, Scene)
+{
+    string filename = CurrentBinaryDir()+"/../test/meshes/triangle.obj";
+    shared_ptr<const TMesh> mesh = make_shared<TMesh>(filename, PhongMaterial::Bronze());
+
+    //A row of instances sharing the same mesh, each with its own material
+    vector<ObjectPtr> objects;
+    for(int i=0; i<500; ++i)
+    {
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(2.0f*i,0,0));
+        objects.push_back( make_shared<MeshInstance>(mesh, transform, PhongMaterial::Emerald()) );
+    }
+    EXPECT_EQ(mesh.use_count(), 501);
+    Scene scene(objects);
+
+    ObjectPtr hitObject;
+    glm::vec3 hitPosition, hitNormal;
+    EXPECT_EQ(scene.intersect(Ray(glm::vec3(2.0f*123,0,-1), glm::vec3(0,0,1)), hitObject, hitPosition, hitNormal), true);
+    EXPECT_EQ(hitObject, objects[123]);
+    EXPECT_NEAR(hitPosition[0], 246.0f, 1e-4f);
+    EXPECT_NEAR(hitPosition[2], 0.0f, 1e-5f);
+    EXPECT_EQ(scene.intersect(Ray(glm::vec3(2.0f*123+1.0f,0,-1), glm::vec3(0,0,1)), hitObject, hitPosition, hitNormal), false);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
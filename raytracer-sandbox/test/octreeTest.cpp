@@ -1,12 +1,111 @@
 #include <iostream>
+#include <random>
+#include <limits>
 #include <gtest/gtest.h>
 #include <raytracer-sandbox/octree.hpp>
 
 using namespace std;
 
+static Extent unitExtent(const float& halfSize)
+{
+    std::array<glm::vec3,2> bounds = {{ glm::vec3(-halfSize,-halfSize,-halfSize), glm::vec3(halfSize,halfSize,halfSize) }};
+    return Extent(bounds);
+}
+
 TEST(Octree, Constructor_Normal)
 {
-    EXPECT_EQ(true, true);
+    Octree<int> octree(unitExtent(1.0f), 4);
+    EXPECT_EQ(octree.maxDepth(), 4);
+    EXPECT_EQ(octree.root()->isLeaf(), true);
+    EXPECT_EQ(octree.root()->dataObject().empty(), true);
+    EXPECT_EQ(octree.extent().bounds()[1][0], 1.0f);
+}
+
+TEST(Octree, Insert)
+{
+    Octree<int> octree(unitExtent(1.0f), 4);
+
+    //A single object stays in the root leaf
+    octree.insert(make_pair(0, glm::vec3(-0.5,-0.5,-0.5)));
+    EXPECT_EQ(octree.root()->isLeaf(), true);
+    EXPECT_EQ(octree.root()->dataObject().size(), 1u);
+
+    //A second object splits the root, cells follow the (x,y,z) -> 4x+2y+z indexing
+    octree.insert(make_pair(1, glm::vec3(0.5,-0.5,0.5)));
+    EXPECT_EQ(octree.root()->isLeaf(), false);
+    EXPECT_EQ(octree.root()->dataObject().empty(), true);
+    EXPECT_NE(octree.root()->children()[0], nullptr);
+    EXPECT_NE(octree.root()->children()[5], nullptr);
+    EXPECT_EQ(octree.root()->children()[5]->dataObject()[0].first, 1);
+    EXPECT_EQ(octree.root()->children()[5]->extent().bounds()[0][0], 0.0f);
+    EXPECT_EQ(octree.root()->children()[5]->extent().bounds()[1][1], 0.0f);
+
+    //A box straddling the center of the root is kept in the root
+    octree.insert(2, Box(glm::vec3(-0.1,-0.1,-0.1), glm::vec3(0.1,0.1,0.1)));
+    EXPECT_EQ(octree.root()->dataObject().size(), 1u);
+    EXPECT_EQ(octree.root()->dataObject()[0].first, 2);
+}
+
+TEST(Octree, Intersect)
+{
+    //Random boxes, some of them straddling cells, play the role of the objects
+    mt19937 generator(5);
+    uniform_real_distribution<float> position(-9.0f, 8.0f), size(0.1f, 1.0f);
+    vector<Box> boxes;
+    Octree<int> octree(unitExtent(10.0f), 8);
+    for(int i=0; i<500; ++i)
+    {
+        glm::vec3 minBB(position(generator), position(generator), position(generator));
+        boxes.push_back(Box(minBB, minBB + glm::vec3(size(generator), size(generator), size(generator))));
+        octree.insert(i, boxes.back());
+    }
+
+    auto intersector = [&](const int& id, const Ray& r, float& tMax)
+    {
+        std::array<float,2> t;
+        if(Intersect(r, boxes[id], t) && t[0]>=0 && t[0]<tMax)
+        {
+            tMax = t[0];
+            return true;
+        }
+        return false;
+    };
+
+    uniform_real_distribution<float> direction(-1.0f, 1.0f);
+    for(int i=0; i<500; ++i)
+    {
+        //Rays in every direction, from inside and outside the octree
+        glm::vec3 origin = (i%2==0) ? glm::vec3(0,0,0) : glm::vec3(direction(generator), direction(generator), direction(generator))*20.0f;
+        Ray ray(origin, glm::vec3(direction(generator), direction(generator), direction(generator)));
+
+        float bruteForceT = numeric_limits<float>::max();
+        bool bruteForceHit = false;
+        for(size_t j=0; j<boxes.size(); ++j)
+        {
+            bruteForceHit = intersector(j, ray, bruteForceT) || bruteForceHit;
+        }
+        float octreeT = numeric_limits<float>::max();
+        EXPECT_EQ(octree.intersect(ray, octreeT, intersector), bruteForceHit);
+        EXPECT_EQ(octreeT, bruteForceT);
+    }
+
+    //Axis aligned rays, parallel to the splitting planes
+    std::array<glm::vec3,6> axes = {{ glm::vec3(1,0,0), glm::vec3(-1,0,0), glm::vec3(0,1,0), glm::vec3(0,-1,0), glm::vec3(0,0,1), glm::vec3(0,0,-1) }};
+    for(const glm::vec3& axis : axes)
+    {
+        for(int i=0; i<50; ++i)
+        {
+            Ray ray(glm::vec3(direction(generator), direction(generator), direction(generator))*8.0f, axis);
+            float bruteForceT = numeric_limits<float>::max();
+            for(size_t j=0; j<boxes.size(); ++j)
+            {
+                intersector(j, ray, bruteForceT);
+            }
+            float octreeT = numeric_limits<float>::max();
+            octree.intersect(ray, octreeT, intersector);
+            EXPECT_EQ(octreeT, bruteForceT);
+        }
+    }
 }
 
 int main(int argc, char **argv)
@@ -4,6 +4,9 @@
 #include <raytracer-sandbox/sphere.hpp>
 #include <raytracer-sandbox/pathtracing.hpp>
 #include <raytracer-sandbox/directionalLight.hpp>
+#include <raytracer-sandbox/pointLight.hpp>
+#include <raytracer-sandbox/plane.hpp>
+#include <raytracer-sandbox/scene.hpp>
 
 TEST(Pathtracing, Pathtrace)
 {
@@ -42,6 +45,17 @@ TEST(Pathtracing, Pathtrace)
     objects.push_back( sphere );
     success = pathTrace(viewRay, objects, closestHitObject, closestHitPosition, closestHitNormal);
     EXPECT_EQ(success, false);
+
+    //Case 3 : The closest sphere is hit, whatever the order of the objects
+    objects.clear();
+    viewRay = Ray(glm::vec3(0,0,-5), glm::vec3(0,0,1));
+    objects.push_back( std::make_shared<Sphere>(glm::vec3(0,0,5), 1.0f, material) );
+    sphere = std::make_shared<Sphere>(glm::vec3(0,0,0), 1.0f, material);
+    objects.push_back( sphere );
+    success = pathTrace(viewRay, objects, closestHitObject, closestHitPosition, closestHitNormal);
+    EXPECT_EQ(success, true);
+    EXPECT_EQ(closestHitObject, sphere);
+    EXPECT_EQ(closestHitPosition[2], -1);
 }
 
 TEST(Pathtracing, CastRay_Phong)
@@ -77,6 +91,31 @@ TEST(Pathtracing, CastRay_Phong)
     EXPECT_EQ(color[2], 3);
 }
 
+TEST(Pathtracing, CastRay_Shadow)
+{
+    PhongMaterialPtr material = PhongMaterial::Bronze();
+    SpherePtr sphere = std::make_shared<Sphere>(glm::vec3(0,0,0), 1.0f, material);
+    SpherePtr occluder = std::make_shared<Sphere>(glm::vec3(0,4,-5), 0.5f, material);
+    std::vector<ObjectPtr> objects = {sphere, occluder};
+
+    //The light lies between the hit at (0,0,-1) and the occluder
+    std::vector<LightPtr> lights;
+    glm::vec3 ambient(1.0,1.0,1.0), diffuse(1.0,1.0,1.0), specular(1.0,1.0,1.0);
+    lights.push_back( std::make_shared<PointLight>(glm::vec3(0,2,-3), ambient, diffuse, specular, 1.0f, 0.0f, 0.0f) );
+
+    Ray viewRay(glm::vec3(0,0,-5), glm::vec3(0,0,1));
+    int depth=0, maxDepth=4;
+    float bias = 1e-3;
+    glm::vec3 backgroundColor(0,0,0), shadowColor(0.5,0.5,0.5);
+    EXPECT_NE(castRay(viewRay, lights, objects, backgroundColor, shadowColor, bias, maxDepth, depth), shadowColor);
+    EXPECT_NE(castRay(viewRay, lights, Scene(objects), backgroundColor, shadowColor, bias, maxDepth, depth), shadowColor);
+
+    //The occluder now lies between the hit and the light
+    objects[1] = std::make_shared<Sphere>(glm::vec3(0,1,-2), 0.3f, material);
+    EXPECT_EQ(castRay(viewRay, lights, objects, backgroundColor, shadowColor, bias, maxDepth, depth), shadowColor);
+    EXPECT_EQ(castRay(viewRay, lights, Scene(objects), backgroundColor, shadowColor, bias, maxDepth, depth), shadowColor);
+}
+
 TEST(Pathtracing, CastRay_Glossy)
 {
     //Material
@@ -171,6 +210,56 @@ TEST(Pathtracing, CastRay_Default)
     EXPECT_EQ(color[2], 0);
 }
 
+TEST(Pathtracing, CastRayPacket_Secondary)
+{
+    //Mirror and glass spheres in front of diffuse ones
+    std::vector<ObjectPtr> objects;
+    GlossyMaterialPtr glossyMaterial = std::make_shared<GlossyMaterial>();
+    FresnelMaterialPtr fresnelMaterial = std::make_shared<FresnelMaterial>(1.5f);
+    for(int i=0; i<5; ++i)
+    {
+        objects.push_back( std::make_shared<Sphere>(glm::vec3(2*i-4, 0, 0), 0.9f, i%2==0 ? MaterialPtr(glossyMaterial) : MaterialPtr(fresnelMaterial)) );
+        objects.push_back( std::make_shared<Sphere>(glm::vec3(2*i-4, 1, -4), 1.0f, PhongMaterial::Emerald()) );
+    }
+    objects.push_back( std::make_shared<Plane>(glm::vec3(0,1,0), glm::vec3(0,-1,0), PhongMaterial::Pearl()) );
+    Scene scene(objects);
+
+    glm::vec3 lightDirection(0,-1,-1), ambient(0.5,0.5,0.5), diffuse(1.0,1.0,1.0), specular(1.0,1.0,1.0);
+    std::vector<LightPtr> lights;
+    lights.push_back( std::make_shared<DirectionalLight>(lightDirection, ambient, diffuse, specular) );
+
+    //Rays from a point in front of the spheres
+    std::vector<Ray> rays;
+    for(int x=0; x<64; ++x)
+    {
+        for(int y=0; y<32; ++y)
+        {
+            rays.push_back( Ray(glm::vec3(0,1,8), glm::vec3((x-32)/40.0f, (y-24)/40.0f, -1)) );
+        }
+    }
+
+    int maxDepth=4;
+    float bias = 1e-3;
+    glm::vec3 backgroundColor(0.2,0.2,0.2), shadowColor(0.0,0.0,0.0);
+    //The reflection and refraction rays of a packet are shaded as the ones of a single ray
+    for(size_t first=0; first<rays.size(); first+=RayPacket::MaxSize)
+    {
+        RayPacket packet(rays.data()+first, RayPacket::MaxSize);
+        glm::vec3 colors[RayPacket::MaxSize];
+        castRayPacket(packet, lights, scene, backgroundColor, shadowColor, bias, maxDepth, 0, colors);
+        for(int i=0; i<packet.size; ++i)
+        {
+            glm::vec3 color = castRay(rays[first+i], lights, scene, backgroundColor, shadowColor, bias, maxDepth, 0);
+            EXPECT_NEAR(glm::length(colors[i]-color), 0.0f, 1e-4);
+        }
+    }
+
+    //Rays beyond the maximum depth bring back the background
+    glm::vec3 colors[RayPacket::MaxSize];
+    castRayPacket(RayPacket(rays.data(), RayPacket::MaxSize), lights, scene, backgroundColor, shadowColor, bias, maxDepth, maxDepth+1, colors);
+    EXPECT_EQ(colors[0], backgroundColor);
+}
+
 int main(int argc, char **argv)
 {
     testing::InitGoogleTest(&argc, argv);
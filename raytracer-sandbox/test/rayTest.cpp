@@ -1,5 +1,6 @@
 #include <iostream>
 #include <sstream>
+#include <limits>
 #include <raytracer-sandbox/ray.hpp>
 #include <gtest/gtest.h>
 
@@ -23,6 +24,21 @@ TEST(Ray, Constructor)
     EXPECT_EQ(ray.sign()[2], 0);
 }
 
+//A direction normalized and inverted by the caller is kept as is
+TEST(Ray, ConstructorNormalized)
+{
+    const glm::vec3 origin(1,2,3), direction(0.6f,0,-0.8f);
+    const Ray ray(origin, direction, glm::vec3(1.0f/0.6f, std::numeric_limits<float>::infinity(), -1.0f/0.8f));
+    const Ray reference(origin, direction);
+    for(int a=0; a<3; ++a)
+    {
+        EXPECT_EQ(ray.origin()[a], reference.origin()[a]);
+        EXPECT_EQ(ray.direction()[a], direction[a]);
+        EXPECT_FLOAT_EQ(ray.invDirection()[a], reference.invDirection()[a]);
+        EXPECT_EQ(ray.sign()[a], reference.sign()[a]);
+    }
+}
+
 TEST(Ray, RayStream)
 {
     glm::vec3 origin(0,0,0), direction(0,0,1);
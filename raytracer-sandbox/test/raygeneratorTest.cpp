@@ -0,0 +1,101 @@
+#include <iostream>
+#include <gtest/gtest.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <raytracer-sandbox/raygenerator.hpp>
+
+using namespace std;
+
+static void expectNear(const Ray& r1, const Ray& r2)
+{
+    for(int a=0; a<3; ++a)
+    {
+        EXPECT_NEAR(r1.origin()[a], r2.origin()[a], 1e-5);
+        EXPECT_NEAR(r1.direction()[a], r2.direction()[a], 1e-5);
+        EXPECT_NEAR(1.0f/r1.invDirection()[a], r2.direction()[a], 1e-5);
+        EXPECT_EQ(r1.sign()[a], r2.sign()[a]);
+    }
+}
+
+//The generated rays are the ones of the camera, whatever its view matrix
+TEST(CameraRayGenerator, Generate)
+{
+    float fov=100.0, width=1280, height=720, near=1, far=100;
+    Camera camera(fov, width, height, near, far);
+    glm::mat4 view(1.0);
+    view = glm::rotate(view, 0.3f, glm::vec3(1.0,1.0,0.0));
+    view = glm::translate(view, glm::vec3(1,-2,3));
+
+    for(int k=0; k<2; ++k)
+    {
+        if(k==1) camera.view() = view;
+        CameraRayGenerator generator(camera);
+        const glm::vec3 cameraPosition = camera.computePosition();
+        for(int a=0; a<3; ++a) EXPECT_NEAR(generator.origin()[a], cameraPosition[a], 1e-5);
+        for(float y=0.5; y<height; y+=97.0)
+        {
+            for(float x=0.5; x<width; x+=131.0)
+            {
+                expectNear(generator.generate(x, y), camera.computeRayThroughPixel(x, y));
+            }
+        }
+    }
+}
+
+//The rays of a row, a tile or a packet are the ones generated one by one, including
+//the pixels left after the last group of 4 handled with SIMD
+TEST(CameraRayGenerator, GenerateTile)
+{
+    float fov=100.0, width=1280, height=720, near=1, far=100;
+    Camera camera(fov, width, height, near, far);
+    camera.view() = glm::translate(glm::mat4(1.0), glm::vec3(1,-2,3));
+    CameraRayGenerator generator(camera);
+
+    const int tileWidth = 7, tileHeight = 3;
+    std::vector<Ray> rays(tileWidth*tileHeight);
+    generator.generateTile(100.5, 200.25, tileWidth, tileHeight, rays.data());
+    for(int j=0; j<tileHeight; ++j)
+    {
+        for(int i=0; i<tileWidth; ++i)
+        {
+            expectNear(rays[i+j*tileWidth], generator.generate(100.5+i, 200.25+j));
+        }
+    }
+
+    //A row longer than the internal chunks
+    std::vector<Ray> row(width);
+    generator.generateRow(0.5, 10.5, width, row.data());
+    for(int i=0; i<width; ++i) expectNear(row[i], generator.generate(0.5+i, 10.5));
+
+    for(int packetWidth=2; packetWidth<=4; packetWidth+=2)
+    {
+        const RayPacket packet = generator.generatePacket(100.5, 200.5, packetWidth);
+        const RayPacket cameraPacket = camera.computeRayPacket(100.5, 200.5, packetWidth);
+        EXPECT_EQ(packet.size, cameraPacket.size);
+        EXPECT_EQ(packet.coherent, cameraPacket.coherent);
+        for(int i=0; i<packet.size; ++i) expectNear(packet.rays[i], cameraPacket.rays[i]);
+    }
+}
+
+//The generator keeps the camera it was updated with until the next update
+TEST(CameraRayGenerator, Update)
+{
+    float fov=100.0, width=1280, height=720, near=1, far=100;
+    Camera camera(fov, width, height, near, far);
+    CameraRayGenerator generator(camera);
+    const Ray r1 = camera.computeRayThroughPixel(300.5, 400.5);
+
+    camera.view() = glm::translate(glm::mat4(1.0), glm::vec3(1,-2,3));
+    expectNear(generator.generate(300.5, 400.5), r1);
+
+    generator.update(camera);
+    expectNear(generator.generate(300.5, 400.5), camera.computeRayThroughPixel(300.5, 400.5));
+    EXPECT_NEAR(generator.origin()[0], -1, 1e-5);
+    EXPECT_NEAR(generator.origin()[1], 2, 1e-5);
+    EXPECT_NEAR(generator.origin()[2], -3, 1e-5);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,278 @@
+#include <iostream>
+#include <random>
+#include <limits>
+#include <gtest/gtest.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <raytracer-sandbox/raypacket.hpp>
+#include <raytracer-sandbox/camera.hpp>
+#include <raytracer-sandbox/directionalLight.hpp>
+#include <raytracer-sandbox/pathtracing.hpp>
+#include <raytracer-sandbox/plane.hpp>
+#include <raytracer-sandbox/scene.hpp>
+#include <raytracer-sandbox/sphere.hpp>
+#include <raytracer-sandbox/tmesh.hpp>
+#include "config.h"
+
+using namespace std;
+
+//A camera at (0,0,8) looking to -Z
+static Camera testCamera(const int& width, const int& height)
+{
+    Camera camera(glm::radians(60.0f), width, height, 1.0f, 100.0f);
+    camera.view() = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -8.0f))*camera.view();
+    return camera;
+}
+
+//Random rays starting around a point and pointing around a random direction
+static RayPacket randomPacket(mt19937& generator, const int& size)
+{
+    uniform_real_distribution<float> offset(-0.1f, 0.1f), direction(-1.0f, 1.0f);
+    const glm::vec3 mainDirection(direction(generator), direction(generator), 2.0f);
+    vector<Ray> rays;
+    for(int i=0; i<size; ++i)
+    {
+        rays.push_back(Ray(glm::vec3(offset(generator), offset(generator), -3.0f+offset(generator)),
+                           mainDirection+glm::vec3(offset(generator), offset(generator), offset(generator))));
+    }
+    return RayPacket(rays.data(), size);
+}
+
+TEST(RayPacket, Constructor)
+{
+    vector<Ray> rays;
+    rays.push_back(Ray(glm::vec3(0,0,0), glm::vec3(1,0.2,1)));
+    rays.push_back(Ray(glm::vec3(1,0,0), glm::vec3(1,0.3,1)));
+    rays.push_back(Ray(glm::vec3(0,2,0), glm::vec3(1,0.2,1.3)));
+    rays.push_back(Ray(glm::vec3(0,0,-1), glm::vec3(1.2,0.2,1)));
+    rays.push_back(Ray(glm::vec3(0,0,0), glm::vec3(1,0,1)));
+
+    RayPacket packet(rays.data(), rays.size());
+    EXPECT_EQ(packet.size, 5);
+    EXPECT_EQ(packet.lanes, 8);
+    EXPECT_EQ(packet.mask(), 0x1F);
+    EXPECT_EQ(packet.coherent, true);
+    EXPECT_EQ(packet.minOrigin, glm::vec3(0,0,-1));
+    EXPECT_EQ(packet.maxOrigin, glm::vec3(1,2,0));
+    //The infinite inverse direction of the last ray is clamped
+    EXPECT_EQ(packet.maxInvDirection[1], numeric_limits<float>::max());
+    for(int i=0; i<packet.lanes; ++i)
+    {
+        const Ray& r = i<5 ? rays[i] : rays[0];
+        for(int a=0; a<3; ++a)
+        {
+            EXPECT_EQ(packet.origins[a][i], r.origin()[a]);
+            EXPECT_EQ(packet.directions[a][i], r.direction()[a]);
+        }
+    }
+
+    //Same signs but out of the cone of the first direction
+    rays.push_back(Ray(glm::vec3(0,0,0), glm::vec3(0.1,1,0.1)));
+    EXPECT_EQ(RayPacket(rays.data(), rays.size()).coherent, false);
+
+    //Opposite directions along y
+    rays.back() = Ray(glm::vec3(0,0,0), glm::vec3(1,-0.1,1));
+    EXPECT_EQ(RayPacket(rays.data(), rays.size()).coherent, false);
+
+    //The primary rays of a block of pixels lie well inside the cone, even in a corner of the frame
+    EXPECT_EQ(testCamera(64, 48).computeRayPacket(0, 0, 4).coherent, true);
+
+    RayPacketHits hits;
+    for(int i=0; i<RayPacket::MaxSize; ++i) EXPECT_EQ(hits.t[i], numeric_limits<float>::infinity());
+}
+
+TEST(RayPacket, IntersectInterval)
+{
+    mt19937 generator(0);
+    uniform_real_distribution<float> position(-2.0f, 2.0f), extent(0.05f, 1.0f);
+    int tested = 0, culled = 0;
+    for(int n=0; n<2000; ++n)
+    {
+        const RayPacket packet = randomPacket(generator, 16);
+        if(!packet.coherent) continue;
+        ++tested;
+        const glm::vec3 minBound(position(generator), position(generator), position(generator));
+        const Box box(minBound, minBound+glm::vec3(extent(generator), extent(generator), extent(generator)));
+        const float tMax = 1.0f+2.0f*extent(generator);
+
+        //The test is conservative: a box hit by any ray of the packet is never culled
+        bool anyHit = false;
+        for(int i=0; i<packet.size; ++i)
+        {
+            std::array<float,2> t;
+            anyHit = anyHit || (Intersect(packet.rays[i], box, t) && t[1]>=0 && t[0]<=tMax);
+        }
+        float tEntry;
+        const bool hit = IntersectInterval(packet, box, tMax, tEntry);
+
+        //The rays tested one by one match the scalar test
+        float tMaxs[RayPacket::MaxSize];
+        std::fill(tMaxs, tMaxs+RayPacket::MaxSize, tMax);
+        const int boxMask = IntersectBox(packet, packet.mask(), box, tMaxs);
+        for(int i=0; i<packet.size; ++i)
+        {
+            std::array<float,2> t;
+            const bool rayHit = Intersect(packet.rays[i], box, t) && t[1]>=0 && t[0]<=tMax;
+            EXPECT_EQ((boxMask>>i)&1, rayHit ? 1 : 0);
+        }
+        if(anyHit)
+        {
+            EXPECT_EQ(hit, true);
+        }
+        if(!hit) ++culled;
+    }
+    //Most random boxes are culled
+    EXPECT_GT(tested, 1000);
+    EXPECT_GT(culled, tested/2);
+}
+
+TEST(RayPacket, Kernels)
+{
+    mt19937 generator(1);
+    uniform_real_distribution<float> position(-1.0f, 1.0f);
+    for(int n=0; n<200; ++n)
+    {
+        const RayPacket packet = randomPacket(generator, 1+n%RayPacket::MaxSize);
+        const int mask = packet.mask() & ~2;
+        const MaterialPtr material = PhongMaterial::Bronze();
+        Sphere sphere(glm::vec3(position(generator), position(generator), position(generator)), 0.5f, material);
+        Plane plane(glm::vec3(position(generator), position(generator), 1.0f), glm::vec3(0.0f, 0.0f, position(generator)), material);
+        const glm::vec3 t1(position(generator), position(generator), position(generator));
+        const PrecomputedTriangle triangle = precomputeTriangle(t1, t1+glm::vec3(position(generator), position(generator), 0), t1+glm::vec3(position(generator), 0, position(generator)));
+
+        alignas(16) float sphereT[RayPacket::MaxSize], planeT[RayPacket::MaxSize], triangleT[RayPacket::MaxSize];
+        alignas(16) float u[RayPacket::MaxSize], v[RayPacket::MaxSize];
+        std::fill(sphereT, sphereT+RayPacket::MaxSize, numeric_limits<float>::infinity());
+        std::fill(planeT, planeT+RayPacket::MaxSize, numeric_limits<float>::infinity());
+        std::fill(triangleT, triangleT+RayPacket::MaxSize, numeric_limits<float>::infinity());
+        const int sphereMask = IntersectSphere(packet, mask, sphere.position(), sphere.radius(), sphereT);
+        const int planeMask = IntersectPlane(packet, mask, plane.normal(), plane.distanceToOrigin(), planeT);
+        const int triangleMask = IntersectTriangle(packet, mask, triangle, triangleT, u, v);
+
+        for(int i=0; i<packet.size; ++i)
+        {
+            const Ray& r = packet.rays[i];
+            glm::vec3 hitPosition, hitNormal, barycentricCoords;
+            float t;
+            //Only the rays of the mask are tested
+            const bool tested = (mask & (1<<i))!=0;
+
+            const bool sphereHit = tested && sphere.Intersect(r, hitPosition, hitNormal);
+            EXPECT_EQ((sphereMask>>i)&1, sphereHit ? 1 : 0);
+            if(sphereHit)
+            {
+                EXPECT_NEAR(sphereT[i], glm::length(hitPosition-r.origin()), 1e-4);
+            }
+
+            const bool planeHit = tested && plane.Intersect(r, hitPosition, hitNormal);
+            EXPECT_EQ((planeMask>>i)&1, planeHit ? 1 : 0);
+            if(planeHit)
+            {
+                EXPECT_NEAR(planeT[i], glm::length(hitPosition-r.origin()), 1e-4);
+            }
+
+            const bool triangleHit = tested && precomputedTriangleRayIntersection(triangle, r, numeric_limits<float>::infinity(), t, barycentricCoords);
+            EXPECT_EQ((triangleMask>>i)&1, triangleHit ? 1 : 0);
+            if(triangleHit)
+            {
+                EXPECT_NEAR(triangleT[i], t, 1e-5);
+                EXPECT_NEAR(u[i], barycentricCoords[1], 1e-5);
+                EXPECT_NEAR(v[i], barycentricCoords[2], 1e-5);
+            }
+        }
+    }
+}
+
+//Compare the packet intersection of a scene with the scalar one for the packets of a camera
+static void compareWithScalar(const Scene& scene, Camera& camera, const int& packetWidth)
+{
+    int hitCount = 0;
+    for(int x=0; x<camera.width(); x+=packetWidth)
+    {
+        for(int y=0; y<camera.height(); y+=packetWidth)
+        {
+            const RayPacket packet = camera.computeRayPacket(x, y, packetWidth);
+            std::array<ObjectPtr, RayPacket::MaxSize> objects;
+            RayPacketHits hits;
+            const int hitMask = scene.intersect(packet, objects.data(), hits);
+            for(int i=0; i<packet.size; ++i)
+            {
+                ObjectPtr closestHitObject;
+                glm::vec3 hitPosition, hitNormal;
+                const bool hit = scene.intersect(packet.rays[i], closestHitObject, hitPosition, hitNormal);
+                EXPECT_EQ((hitMask>>i)&1, hit ? 1 : 0);
+                EXPECT_EQ(objects[i], closestHitObject);
+                if(hit && objects[i]==closestHitObject)
+                {
+                    ++hitCount;
+                    EXPECT_NEAR(glm::length(hits.positions[i]-hitPosition), 0.0f, 1e-3);
+                    EXPECT_NEAR(glm::length(hits.normals[i]-hitNormal), 0.0f, 1e-3);
+                }
+            }
+        }
+    }
+    EXPECT_GT(hitCount, 0);
+}
+
+TEST(RayPacket, Scene)
+{
+    string filename = CurrentBinaryDir()+"/../test/meshes/stack.obj";
+    const MaterialPtr material = PhongMaterial::Bronze();
+    vector<ObjectPtr> objects;
+    objects.push_back( make_shared<TMesh>(filename, material) );
+    objects.push_back( make_shared<Plane>(glm::vec3(0,1,0), glm::vec3(0,-1.5,0), material) );
+    mt19937 generator(2);
+    uniform_real_distribution<float> position(-3.0f, 3.0f);
+    for(int i=0; i<30; ++i)
+    {
+        objects.push_back( make_shared<Sphere>(glm::vec3(position(generator), position(generator), position(generator)-2.0f), 0.3f, material) );
+    }
+    Scene scene(objects);
+
+    //The packets of the central pixels straddle the view direction and are traced ray after ray
+    Camera camera = testCamera(64, 48);
+    compareWithScalar(scene, camera, 2);
+    compareWithScalar(scene, camera, 4);
+
+    Scene octreeScene(objects, OCTREE);
+    compareWithScalar(octreeScene, camera, 4);
+}
+
+TEST(RayPacket, CastRayPacket)
+{
+    std::vector<LightPtr> lights;
+    DirectionalLightPtr light = std::make_shared<DirectionalLight>();
+    light->setDirection( glm::vec3(0.0,-1.0,0.0) );
+    lights.push_back(light);
+
+    vector<ObjectPtr> objects;
+    objects.push_back( make_shared<Sphere>(glm::vec3(0.0,1.0,0.0), 1.0, PhongMaterial::Emerald()) );
+    objects.push_back( make_shared<Sphere>(glm::vec3(-3,1.0,0.0), 1.0, std::make_shared<GlossyMaterial>()) );
+    objects.push_back( make_shared<Sphere>(glm::vec3(3,1.0,0.0), 1.0, std::make_shared<FresnelMaterial>(1.5)) );
+    objects.push_back( make_shared<Plane>(glm::vec3(0.0,1.0,0.0), glm::vec3(0.0,-1,0.0), PhongMaterial::Pearl()) );
+    Scene scene(objects);
+
+    Camera camera = testCamera(32, 32);
+    const glm::vec3 backgroundColor(0.1f, 0.2f, 0.3f), shadowColor(0.0f);
+    const float bias = 0.001f;
+    const int maxDepth = 4;
+    for(int x=0; x<camera.width(); x+=4)
+    {
+        for(int y=0; y<camera.height(); y+=4)
+        {
+            const RayPacket packet = camera.computeRayPacket(x, y, 4);
+            std::array<glm::vec3, RayPacket::MaxSize> colors;
+            castRayPacket(packet, lights, scene, backgroundColor, shadowColor, bias, maxDepth, 0, colors.data());
+            for(int i=0; i<packet.size; ++i)
+            {
+                const glm::vec3 color = castRay(packet.rays[i], lights, scene, backgroundColor, shadowColor, bias, maxDepth, 0);
+                EXPECT_NEAR(glm::length(colors[i]-color), 0.0f, 1e-3);
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
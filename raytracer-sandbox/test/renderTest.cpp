@@ -10,6 +10,7 @@
 #include <raytracer-sandbox/material.hpp>
 #include <raytracer-sandbox/object.hpp>
 #include <raytracer-sandbox/pathtracing.hpp>
+#include <raytracer-sandbox/scene.hpp>
 #include <raytracer-sandbox/sphere.hpp>
 #include <raytracer-sandbox/plane.hpp>
 #include <raytracer-sandbox/tmesh.hpp>
@@ -89,6 +90,7 @@ TEST(Render, Coverage)
 
     //string meshFilename ="./../../raytracer-sandbox/meshes/suzanneLowRes.obj";
     //objects.push_back( std::make_shared<TMesh>(meshFilename, PhongMaterial::Emerald()) );
+    Scene scene(objects);
 
     std::vector<glm::vec2> pixelOffset;
     pixelOffset.push_back(glm::vec2(0,0));
@@ -106,7 +108,7 @@ TEST(Render, Coverage)
             for(size_t k=0; k<pixelOffset.size(); ++k)
             {
                 Ray viewRay = camera.computeRayThroughPixel( i+pixelOffset[k][0], j+pixelOffset[k][1] );
-                pixelColor += castRay(viewRay, lights, objects, backgroundColor, shadowColor, bias, maxDepth, depth);
+                pixelColor += castRay(viewRay, lights, scene, backgroundColor, shadowColor, bias, maxDepth, depth);
             }
             pixelColor/=(float)(pixelOffset.size());
         }
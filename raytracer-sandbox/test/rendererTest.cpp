@@ -0,0 +1,363 @@
+#include <iostream>
+#include <atomic>
+#include <mutex>
+#include <gtest/gtest.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <raytracer-sandbox/renderer.hpp>
+#include <raytracer-sandbox/directionalLight.hpp>
+#include <raytracer-sandbox/pathtracing.hpp>
+#include <raytracer-sandbox/plane.hpp>
+#include <raytracer-sandbox/raygenerator.hpp>
+#include <raytracer-sandbox/sphere.hpp>
+
+using namespace std;
+
+//The tiles cover each pixel once, consecutive tiles being neighbours on a square power of 2 grid
+TEST(Renderer, Tiles)
+{
+    for(const glm::ivec2& size : { glm::ivec2(64,64), glm::ivec2(100,37), glm::ivec2(5,3) })
+    {
+        std::vector<int> coverage(size[0]*size[1], 0);
+        for(const Tile& tile : Renderer::tiles(size[0], size[1], 16))
+        {
+            EXPECT_GT(tile.width, 0);
+            EXPECT_GT(tile.height, 0);
+            for(int y=tile.y; y<tile.y+tile.height; ++y)
+            {
+                for(int x=tile.x; x<tile.x+tile.width; ++x) ++coverage[x+y*size[0]];
+            }
+        }
+        for(const int& c : coverage) EXPECT_EQ(c, 1);
+    }
+
+    const std::vector<Tile> tiles = Renderer::tiles(64, 64, 16);
+    ASSERT_EQ(tiles.size(), 16u);
+    EXPECT_EQ(tiles[0].x, 0);
+    EXPECT_EQ(tiles[0].y, 0);
+    for(size_t i=1; i<tiles.size(); ++i)
+    {
+        EXPECT_EQ(std::abs(tiles[i].x-tiles[i-1].x)+std::abs(tiles[i].y-tiles[i-1].y), 16);
+    }
+}
+
+static Scene testScene(std::vector<LightPtr>& lights)
+{
+    const glm::vec3 ambient(0.2,0.2,0.2), diffuse(0.8,0.8,0.8), specular(0.8,0.8,0.8);
+    lights.push_back( std::make_shared<DirectionalLight>(glm::vec3(0.0,-1.0,0.0), ambient, diffuse, specular) );
+
+    vector<ObjectPtr> objects;
+    objects.push_back( make_shared<Sphere>(glm::vec3(0.0,1.0,0.0), 1.0, PhongMaterial::Emerald()) );
+    objects.push_back( make_shared<Sphere>(glm::vec3(3,1.0,0.0), 1.0, std::make_shared<FresnelMaterial>(1.5)) );
+    objects.push_back( make_shared<Plane>(glm::vec3(0.0,1.0,0.0), glm::vec3(0.0,-1,0.0), PhongMaterial::Pearl()) );
+    return Scene(objects);
+}
+
+static Camera testCamera(const int& width, const int& height)
+{
+    Camera camera(glm::radians(60.0f), width, height, 1.0f, 100.0f);
+    camera.view() = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -8.0f))*camera.view();
+    return camera;
+}
+
+//The frame is the average of the colors of the samples of each pixel, whatever the number of threads
+TEST(Renderer, Render)
+{
+    std::vector<LightPtr> lights;
+    const Scene scene = testScene(lights);
+    const Camera camera = testCamera(37, 21);
+    RenderSettings settings;
+    settings.backgroundColor = glm::vec3(0.1f, 0.2f, 0.3f);
+
+    const CameraRayGenerator rayGenerator(camera);
+    for(int threadCount=1; threadCount<=3; ++threadCount)
+    {
+        Renderer renderer(threadCount, 8);
+        EXPECT_EQ(renderer.threadCount(), threadCount);
+        EXPECT_EQ(renderer.tileSize(), 8);
+
+        std::mutex mutex;
+        std::vector<Tile> doneTiles;
+        std::vector<glm::vec3> image;
+        EXPECT_TRUE(renderer.render(scene, lights, camera, settings, image, [&](const Tile& tile)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            doneTiles.push_back(tile);
+        }));
+        EXPECT_EQ(doneTiles.size(), Renderer::tiles(37, 21, 8).size());
+        ASSERT_EQ(image.size(), 37u*21u);
+
+        for(int y=0; y<camera.height(); ++y)
+        {
+            for(int x=0; x<camera.width(); ++x)
+            {
+                glm::vec3 color(0,0,0);
+                for(const glm::vec2& offset : settings.pixelOffsets)
+                {
+                    const Ray r = rayGenerator.generate(x+offset[0], y+offset[1]);
+                    color += castRay(r, lights, scene, settings.backgroundColor, settings.shadowColor, settings.bias, settings.maxDepth, 0);
+                }
+                color /= (float)settings.pixelOffsets.size();
+                EXPECT_NEAR(glm::length(image[x+y*camera.width()]-color), 0.0f, 1e-3);
+            }
+        }
+    }
+}
+
+//The shadow caches, off by default, only change the number of shadow rays traversing the scene
+TEST(Renderer, ShadowCache)
+{
+    std::vector<LightPtr> lights;
+    const Scene scene = testScene(lights);
+    const Camera camera = testCamera(37, 21);
+    RenderSettings settings;
+    EXPECT_FALSE(settings.shadowCache);
+
+    Renderer renderer(2, 8);
+    std::vector<glm::vec3> image, cachedImage;
+    EXPECT_TRUE(renderer.render(scene, lights, camera, settings, image));
+    EXPECT_EQ(renderer.shadowCacheCounters().lookups(), 0u);
+
+    settings.shadowCache = true;
+    EXPECT_TRUE(renderer.render(scene, lights, camera, settings, cachedImage));
+    const ShadowCache counters = renderer.shadowCacheCounters();
+    EXPECT_GT(counters.lookups(), 0u);
+    EXPECT_GT(counters.hits(), 0u);
+    EXPECT_LE(counters.hits(), counters.lookups());
+    ASSERT_EQ(cachedImage.size(), image.size());
+    for(size_t i=0; i<image.size(); ++i) EXPECT_NEAR(glm::length(cachedImage[i]-image[i]), 0.0f, 1e-5);
+}
+
+//The samples follow the Halton sequence from the corner of the pixel
+TEST(Renderer, SampleOffset)
+{
+    EXPECT_EQ(Renderer::sampleOffset(0), glm::vec2(0,0));
+    EXPECT_EQ(Renderer::sampleOffset(1), glm::vec2(0.5f,1.0f/3.0f));
+    EXPECT_EQ(Renderer::sampleOffset(2), glm::vec2(0.25f,2.0f/3.0f));
+    for(int i=0; i<100; ++i)
+    {
+        const glm::vec2 offset = Renderer::sampleOffset(i);
+        EXPECT_TRUE(offset[0]>=0 && offset[0]<1 && offset[1]>=0 && offset[1]<1);
+    }
+}
+
+//The passes of a progressive rendering add one sample per pixel at the offset of the pass
+TEST(Renderer, RenderProgressive)
+{
+    std::vector<LightPtr> lights;
+    const Scene scene = testScene(lights);
+    const Camera camera = testCamera(37, 21);
+    RenderSettings settings;
+
+    Renderer renderer(2, 8);
+    FrameBuffer frame;
+    std::vector<int> previewPasses;
+    EXPECT_TRUE(renderer.renderProgressive(scene, lights, camera, settings, frame, 3, [&](const FrameBuffer& f)
+    {
+        previewPasses.push_back(f.passes());
+        return true;
+    }));
+    EXPECT_EQ(previewPasses, std::vector<int>({1, 2, 3}));
+    EXPECT_EQ(frame.width(), 37);
+    EXPECT_EQ(frame.height(), 21);
+    EXPECT_EQ(frame.sampleCount(), 3u*37u*21u);
+
+    //Same samples as a rendering at once with the offsets of the passes
+    settings.pixelOffsets = { Renderer::sampleOffset(0), Renderer::sampleOffset(1), Renderer::sampleOffset(2) };
+    std::vector<glm::vec3> image, progressiveImage;
+    renderer.render(scene, lights, camera, settings, image);
+    frame.resolve(progressiveImage);
+    for(size_t i=0; i<image.size(); ++i) EXPECT_NEAR(glm::length(image[i]-progressiveImage[i]), 0.0f, 1e-5);
+
+    //A frame is completed where it stopped, the pass callback stopping the rendering
+    EXPECT_TRUE(renderer.renderProgressive(scene, lights, camera, settings, frame, 10, [](const FrameBuffer&){ return false; }));
+    EXPECT_EQ(frame.passes(), 4);
+    EXPECT_EQ(frame.sampleCount(0,0), 4);
+
+    //A frame of another size is emptied
+    const Camera largerCamera = testCamera(40, 21);
+    EXPECT_TRUE(renderer.renderProgressive(scene, lights, largerCamera, settings, frame, 1));
+    EXPECT_EQ(frame.passes(), 1);
+    EXPECT_EQ(frame.sampleCount(), 40u*21u);
+}
+
+//A cancelled frame stops before its last tiles, the next frame starting uncancelled
+TEST(Renderer, Cancel)
+{
+    std::vector<LightPtr> lights;
+    const Scene scene = testScene(lights);
+    const Camera camera = testCamera(64, 64);
+    RenderSettings settings;
+
+    Renderer renderer(2, 8);
+    std::atomic<int> doneTiles(0);
+    FrameBuffer frame;
+    EXPECT_FALSE(renderer.renderProgressive(scene, lights, camera, settings, frame, 2, Renderer::PassCallback(), [&](const Tile&)
+    {
+        if(++doneTiles==4) renderer.cancel();
+    }));
+    EXPECT_EQ(frame.passes(), 0);
+    EXPECT_LT(doneTiles, 64);
+    EXPECT_GT(frame.sampleCount(), 0u);
+    EXPECT_LT(frame.sampleCount(), 64u*64u);
+
+    //Retarget: the frame is restarted, for instance from another camera
+    frame.clear();
+    renderer.cancel();
+    EXPECT_TRUE(renderer.renderProgressive(scene, lights, camera, settings, frame, 2));
+    EXPECT_EQ(frame.passes(), 2);
+    EXPECT_EQ(frame.sampleCount(), 2u*64u*64u);
+
+    //A frame cancelled by its number before it starts stops at once, the frames after it starting uncancelled
+    const std::uint64_t cancelledFrame = renderer.frameCount()+1;
+    renderer.cancel(cancelledFrame);
+    frame.clear();
+    std::vector<glm::vec3> image;
+    EXPECT_FALSE(renderer.renderAdaptive(scene, lights, camera, settings, frame));
+    EXPECT_EQ(renderer.frameCount(), cancelledFrame);
+    EXPECT_EQ(frame.passes(), 0);
+    EXPECT_EQ(frame.sampleCount(), 0u);
+    EXPECT_TRUE(renderer.render(scene, lights, camera, settings, image));
+    renderer.cancel(cancelledFrame);
+    EXPECT_TRUE(renderer.renderProgressive(scene, lights, camera, settings, frame, 1));
+    EXPECT_EQ(frame.sampleCount(), 64u*64u);
+}
+
+//A frame cancelled during a pass is resumed with the next sample of each pixel, the samples of a pixel being distinct
+TEST(Renderer, ResumeProgressive)
+{
+    std::vector<LightPtr> lights;
+    const Scene scene = testScene(lights);
+    const Camera camera = testCamera(37, 21);
+    RenderSettings settings;
+
+    //A single thread renders the tiles in a fixed order, so that the tiles resumed are always the same
+    Renderer renderer(1, 8);
+    const int tileCount = Renderer::tiles(37, 21, 8).size();
+    std::atomic<int> doneTiles(0);
+    FrameBuffer frame;
+    EXPECT_FALSE(renderer.renderProgressive(scene, lights, camera, settings, frame, 3, Renderer::PassCallback(), [&](const Tile&)
+    {
+        if(++doneTiles==tileCount+tileCount/2) renderer.cancel();
+    }));
+    EXPECT_EQ(frame.passes(), 1);
+    EXPECT_GT(frame.sampleCount(), 37u*21u);
+    EXPECT_LT(frame.sampleCount(), 2u*37u*21u);
+
+    EXPECT_TRUE(renderer.renderProgressive(scene, lights, camera, settings, frame, 3));
+    EXPECT_EQ(frame.passes(), 3);
+
+    //Each pixel is the average of the first samples of its sequence, which differs from a pixel sampled twice at the same offset
+    const CameraRayGenerator rayGenerator(camera);
+    int resumedPixels = 0, sensitivePixels = 0;
+    for(int y=0; y<camera.height(); ++y)
+    {
+        for(int x=0; x<camera.width(); ++x)
+        {
+            const int& samples = frame.sampleCount(x, y);
+            ASSERT_TRUE(samples==3 || samples==4);
+            if(samples==4) ++resumedPixels;
+            std::vector<glm::vec3> colors;
+            for(int i=0; i<samples; ++i)
+            {
+                const glm::vec2 offset = Renderer::sampleOffset(i);
+                for(int k=0; k<i; ++k) EXPECT_NE(offset, Renderer::sampleOffset(k));
+                colors.push_back(castRay(rayGenerator.generate(x+offset[0], y+offset[1]), lights, scene, settings.backgroundColor, settings.shadowColor, settings.bias, settings.maxDepth, 0));
+            }
+            glm::vec3 color(0,0,0);
+            for(const glm::vec3& c : colors) color += c;
+            color /= (float)samples;
+            EXPECT_NEAR(glm::length(frame.color(x, y)-color), 0.0f, 1e-4);
+            if(samples==4)
+            {
+                const glm::vec3 duplicated = (colors[0]+2.0f*colors[1]+colors[2])/4.0f;
+                if(glm::length(duplicated-color)>1e-3) ++sensitivePixels;
+            }
+        }
+    }
+    EXPECT_GT(resumedPixels, 0);
+    EXPECT_GT(sensitivePixels, 0);
+}
+
+//The edges of a frame of one sample per pixel and its noisy pixels are refined, up to the maximum number of samples
+TEST(Renderer, RefinedPixels)
+{
+    RenderSettings settings;
+    FrameBuffer frame(4, 1);
+    frame.add(0, 0, glm::vec3(0,0,0));
+    frame.add(1, 0, glm::vec3(0,0,0));
+    frame.add(2, 0, glm::vec3(1,1,1));
+    frame.add(3, 0, glm::vec3(1,1,1));
+    std::vector<char> refined;
+    EXPECT_EQ(Renderer::refinedPixels(frame, settings, refined), 2);
+    EXPECT_EQ(refined, std::vector<char>({0, 1, 1, 0}));
+
+    //Samples agreeing on both sides of the edge
+    for(int i=0; i<Renderer::EdgeSamples-1; ++i)
+    {
+        frame.add(1, 0, glm::vec3(0,0,0));
+        frame.add(2, 0, glm::vec3(1,1,1));
+    }
+    EXPECT_EQ(Renderer::refinedPixels(frame, settings, refined), 0);
+
+    //A noisy pixel is refined until the maximum number of samples
+    frame.clear();
+    refined.clear();
+    for(int x=0; x<4; ++x) frame.add(x, 0, glm::vec3(0.5,0.5,0.5));
+    frame.add(0, 0, glm::vec3(0.58,0.5,0.5));
+    EXPECT_EQ(Renderer::refinedPixels(frame, settings, refined), 1);
+    EXPECT_EQ(refined[0], 1);
+    for(int i=2; i<settings.maxSamples; ++i) frame.add(0, 0, glm::vec3(i%2 ? 0.6 : 0.4, 0.5, 0.5));
+    EXPECT_EQ(Renderer::refinedPixels(frame, settings, refined), 0);
+}
+
+//An adaptive frame keeps one sample on flat regions and is closer to the converged frame than one sample per pixel
+TEST(Renderer, RenderAdaptive)
+{
+    std::vector<LightPtr> lights;
+    const Scene scene = testScene(lights);
+    const Camera camera = testCamera(64, 48);
+    RenderSettings settings;
+
+    Renderer renderer(2, 8);
+    FrameBuffer frame;
+    int passes = 0;
+    EXPECT_TRUE(renderer.renderAdaptive(scene, lights, camera, settings, frame, [&](const FrameBuffer& f)
+    {
+        EXPECT_EQ(f.passes(), ++passes);
+        return true;
+    }));
+    EXPECT_GT(frame.passes(), 1);
+    EXPECT_EQ(frame.sampleCount(0, 0), 1);
+    int maxSamples = 0;
+    for(int y=0; y<48; ++y)
+    {
+        for(int x=0; x<64; ++x)
+        {
+            EXPECT_GE(frame.sampleCount(x, y), 1);
+            maxSamples = std::max(maxSamples, frame.sampleCount(x, y));
+        }
+    }
+    EXPECT_EQ(maxSamples, settings.maxSamples);
+    EXPECT_LT(frame.sampleCount(), 4u*64u*48u);
+
+    std::vector<glm::vec3> reference, image, adaptiveImage;
+    settings.pixelOffsets.clear();
+    for(int i=0; i<settings.maxSamples; ++i) settings.pixelOffsets.push_back(Renderer::sampleOffset(i));
+    renderer.render(scene, lights, camera, settings, reference);
+    settings.pixelOffsets.resize(1);
+    renderer.render(scene, lights, camera, settings, image);
+    frame.resolve(adaptiveImage);
+    float error = 0.0f, adaptiveError = 0.0f;
+    for(size_t i=0; i<reference.size(); ++i)
+    {
+        error += glm::length(image[i]-reference[i]);
+        adaptiveError += glm::length(adaptiveImage[i]-reference[i]);
+    }
+    EXPECT_LT(adaptiveError, 0.5f*error);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
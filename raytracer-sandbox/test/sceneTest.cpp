@@ -0,0 +1,245 @@
+#include <iostream>
+#include <random>
+#include <gtest/gtest.h>
+
+#include <raytracer-sandbox/scene.hpp>
+#include <raytracer-sandbox/sphere.hpp>
+#include <raytracer-sandbox/plane.hpp>
+#include <raytracer-sandbox/tmesh.hpp>
+#include "config.h"
+
+using namespace std;
+
+TEST(Scene, Constructor)
+{
+    PhongMaterialPtr material = PhongMaterial::Bronze();
+    vector<ObjectPtr> objects;
+    objects.push_back( make_shared<Sphere>(glm::vec3(0,0,0), 1.0f, material) );
+    objects.push_back( make_shared<Plane>(glm::vec3(0,1,0), glm::vec3(0,-1,0), material) );
+
+    Scene scene(objects);
+    EXPECT_EQ(scene.objects().size(), objects.size());
+    //Only the sphere is bounded
+    EXPECT_EQ(scene.bvh().primitiveIndices().size(), 1u);
+}
+
+TEST(Scene, Intersect)
+{
+    PhongMaterialPtr material = PhongMaterial::Bronze();
+    vector<ObjectPtr> objects;
+    ObjectPtr closestHitObject;
+    glm::vec3 hitPosition, hitNormal;
+
+    //Case 1 : The closest of two aligned spheres is hit
+    SpherePtr farSphere = make_shared<Sphere>(glm::vec3(0,0,5), 1.0f, material);
+    SpherePtr nearSphere = make_shared<Sphere>(glm::vec3(0,0,0), 1.0f, material);
+    objects.push_back(farSphere);
+    objects.push_back(nearSphere);
+    Scene scene(objects);
+    Ray ray(glm::vec3(0,0,-5), glm::vec3(0,0,1));
+    EXPECT_EQ(scene.intersect(ray, closestHitObject, hitPosition, hitNormal), true);
+    EXPECT_EQ(closestHitObject, nearSphere);
+    EXPECT_EQ(hitPosition[2], -1);
+    EXPECT_EQ(hitNormal[2], -1);
+
+    //Case 2 : An unbounded plane in front of the spheres is hit
+    PlanePtr plane = make_shared<Plane>(glm::vec3(0,0,1), glm::vec3(0,0,-3), material);
+    objects.push_back(plane);
+    scene = Scene(objects);
+    EXPECT_EQ(scene.intersect(ray, closestHitObject, hitPosition, hitNormal), true);
+    EXPECT_EQ(closestHitObject, plane);
+    EXPECT_EQ(hitPosition[2], -3);
+
+    //Case 3 : No intersection
+    ray = Ray(glm::vec3(0,10,-5), glm::vec3(0,1,0));
+    EXPECT_EQ(scene.intersect(ray, closestHitObject, hitPosition, hitNormal), false);
+    EXPECT_EQ(closestHitObject, nullptr);
+}
+
+TEST(Scene, Intersect_HitRecord)
+{
+    PhongMaterialPtr material = PhongMaterial::Bronze();
+    vector<ObjectPtr> objects;
+    objects.push_back( make_shared<Sphere>(glm::vec3(5,0,0), 1.0f, material) );
+    objects.push_back( make_shared<TMesh>(CurrentBinaryDir()+"/../test/meshes/stack.obj", material) );
+    objects.push_back( make_shared<Plane>(glm::vec3(0,0,1), glm::vec3(0,0,-3), material) );
+    Scene scene(objects);
+
+    //Case 1 : The first triangle of the mesh, at z=2, is hit
+    Ray ray(glm::vec3(0,0,2.5), glm::vec3(0,0,-1));
+    float tMax = numeric_limits<float>::max();
+    HitRecord hit;
+    EXPECT_EQ(scene.intersect(ray, tMax, hit), true);
+    EXPECT_FLOAT_EQ(tMax, 0.5f);
+    EXPECT_FLOAT_EQ(hit.t, 0.5f);
+    EXPECT_EQ(hit.objectId, 1);
+    EXPECT_EQ(hit.primitiveId, 0);
+    EXPECT_NEAR(hit.barycentrics[0], 0.25f, 1e-6);
+    EXPECT_NEAR(hit.barycentrics[1], 0.5f, 1e-6);
+    glm::vec3 hitPosition, hitNormal;
+    scene.HitSurface(ray, hit, hitPosition, hitNormal);
+    EXPECT_FLOAT_EQ(hitPosition[2], 2.0f);
+    EXPECT_EQ(hitNormal, glm::vec3(1,0,0));
+
+    //Case 2 : The hit lies beyond tMax
+    tMax = 0.4f;
+    hit = HitRecord();
+    EXPECT_EQ(scene.intersect(ray, tMax, hit), false);
+    EXPECT_EQ(tMax, 0.4f);
+    EXPECT_EQ(hit.objectId, -1);
+
+    //Case 3 : Below the mesh, the unbounded plane is hit
+    ray = Ray(glm::vec3(0,0,-0.5), glm::vec3(0,0,-1));
+    tMax = numeric_limits<float>::max();
+    hit = HitRecord();
+    EXPECT_EQ(scene.intersect(ray, tMax, hit), true);
+    EXPECT_FLOAT_EQ(hit.t, 2.5f);
+    EXPECT_EQ(hit.objectId, 2);
+    EXPECT_EQ(hit.primitiveId, -1);
+    scene.HitSurface(ray, hit, hitPosition, hitNormal);
+    EXPECT_FLOAT_EQ(hitPosition[2], -3.0f);
+}
+
+TEST(Scene, Occluded)
+{
+    PhongMaterialPtr material = PhongMaterial::Bronze();
+    mt19937 generator(8);
+    uniform_real_distribution<float> position(-10.0f, 10.0f), radius(0.1f, 1.0f), direction(-0.5f, 0.5f), distance(0.0f, 40.0f);
+    vector<ObjectPtr> objects;
+    for(int i=0; i<300; ++i)
+    {
+        glm::vec3 center(position(generator), position(generator), position(generator));
+        objects.push_back( make_shared<Sphere>(center, radius(generator), material) );
+    }
+    objects.push_back( make_shared<Plane>(glm::vec3(0,1,0), glm::vec3(0,-12,0), material) );
+
+    //A ray is occluded exactly when its closest hit lies before the maximum distance
+    for(const AccelerationType& accelerationType : {BOUNDING_VOLUME_HIERARCHY, OCTREE})
+    {
+        Scene scene(objects, accelerationType);
+        for(int i=0; i<200; ++i)
+        {
+            Ray ray(glm::vec3(0,0,-20), glm::vec3(direction(generator), direction(generator), 1.0f));
+            const float tMax = distance(generator);
+            float tClosest = numeric_limits<float>::max();
+            HitRecord hit;
+            const bool expected = scene.intersect(ray, tClosest, hit) && tClosest<tMax;
+            EXPECT_EQ(scene.occluded(ray, tMax), expected);
+        }
+    }
+
+    //Transparent and ignored objects let the ray through
+    SpherePtr glass = make_shared<Sphere>(glm::vec3(0,0,0), 1.0f, make_shared<FresnelMaterial>(FresnelMaterial::GlassIOR()));
+    SpherePtr opaque = make_shared<Sphere>(glm::vec3(0,0,5), 1.0f, material);
+    Scene scene({glass, opaque});
+    Ray ray(glm::vec3(0,0,-5), glm::vec3(0,0,1));
+    EXPECT_EQ(scene.occluded(ray, 3.0f), false);
+    EXPECT_EQ(scene.occluded(ray, numeric_limits<float>::max()), true);
+    EXPECT_EQ(scene.occluded(ray, numeric_limits<float>::max(), opaque.get()), false);
+}
+
+TEST(Scene, Intersect_RandomSpheres)
+{
+    PhongMaterialPtr material = PhongMaterial::Bronze();
+    mt19937 generator(4);
+    uniform_real_distribution<float> position(-10.0f, 10.0f), radius(0.1f, 0.5f), direction(-0.5f, 0.5f);
+    vector<ObjectPtr> objects;
+    for(int i=0; i<300; ++i)
+    {
+        glm::vec3 center(position(generator), position(generator), position(generator));
+        objects.push_back( make_shared<Sphere>(center, radius(generator), material) );
+    }
+    Scene scene(objects);
+
+    for(int i=0; i<200; ++i)
+    {
+        Ray ray(glm::vec3(0,0,-20), glm::vec3(direction(generator), direction(generator), 1.0f));
+
+        //Brute force closest hit
+        ObjectPtr expectedObject = nullptr;
+        float expectedDistance = numeric_limits<float>::max();
+        for(const ObjectPtr& o : objects)
+        {
+            glm::vec3 p, n;
+            if(o->Intersect(ray, p, n) && glm::length(p-ray.origin())<expectedDistance)
+            {
+                expectedDistance = glm::length(p-ray.origin());
+                expectedObject = o;
+            }
+        }
+
+        ObjectPtr closestHitObject;
+        glm::vec3 hitPosition, hitNormal;
+        scene.intersect(ray, closestHitObject, hitPosition, hitNormal);
+        EXPECT_EQ(closestHitObject, expectedObject);
+    }
+}
+
+TEST(Scene, Intersect_Octree)
+{
+    PhongMaterialPtr material = PhongMaterial::Bronze();
+    mt19937 generator(6);
+    uniform_real_distribution<float> position(-10.0f, 10.0f), radius(0.1f, 1.5f), direction(-0.5f, 0.5f);
+    vector<ObjectPtr> objects;
+    for(int i=0; i<300; ++i)
+    {
+        glm::vec3 center(position(generator), position(generator), position(generator));
+        objects.push_back( make_shared<Sphere>(center, radius(generator), material) );
+    }
+    objects.push_back( make_shared<Plane>(glm::vec3(0,1,0), glm::vec3(0,-12,0), material) );
+
+    //The octree and the BVH give the same closest hits on the same scene
+    Scene bvhScene(objects, BOUNDING_VOLUME_HIERARCHY);
+    Scene octreeScene(objects, OCTREE);
+    EXPECT_EQ(bvhScene.octree(), nullptr);
+    EXPECT_NE(octreeScene.octree(), nullptr);
+    EXPECT_EQ(octreeScene.accelerationType(), OCTREE);
+
+    for(int i=0; i<200; ++i)
+    {
+        Ray ray(glm::vec3(0,0,-20), glm::vec3(direction(generator), direction(generator), 1.0f));
+        ObjectPtr bvhObject, octreeObject;
+        glm::vec3 bvhPosition, octreePosition, hitNormal;
+        EXPECT_EQ(bvhScene.intersect(ray, bvhObject, bvhPosition, hitNormal), octreeScene.intersect(ray, octreeObject, octreePosition, hitNormal));
+        EXPECT_EQ(bvhObject, octreeObject);
+    }
+}
+
+TEST(Scene, Refit)
+{
+    string filename = CurrentBinaryDir()+"/../test/meshes/triangle.obj";
+    vector<ObjectPtr> objects;
+    vector<TMeshPtr> meshes;
+    for(int i=0; i<20; ++i)
+    {
+        meshes.push_back( make_shared<TMesh>(filename, PhongMaterial::Bronze()) );
+        for(glm::vec3& p : meshes.back()->positions()) p += glm::vec3(2.0f*i,0,0);
+        meshes.back()->refit();
+        objects.push_back(meshes.back());
+    }
+
+    for(const AccelerationType& accelerationType : {BOUNDING_VOLUME_HIERARCHY, OCTREE})
+    {
+        Scene scene(objects, accelerationType);
+
+        //Lift the fifth mesh
+        for(glm::vec3& p : meshes[5]->positions()) p += glm::vec3(0,0,5);
+        meshes[5]->refit();
+        EXPECT_EQ(scene.refit(), accelerationType==OCTREE);
+
+        ObjectPtr hitObject;
+        glm::vec3 hitPosition, hitNormal;
+        EXPECT_EQ(scene.intersect(Ray(glm::vec3(10,0,10), glm::vec3(0,0,-1)), hitObject, hitPosition, hitNormal), true);
+        EXPECT_EQ(hitObject, objects[5]);
+        EXPECT_EQ(hitPosition[2], 5);
+
+        for(glm::vec3& p : meshes[5]->positions()) p -= glm::vec3(0,0,5);
+        meshes[5]->refit();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,126 @@
+#include <iostream>
+#include <sstream>
+#include <gtest/gtest.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <raytracer-sandbox/scenedescription.hpp>
+#include <raytracer-sandbox/directionalLight.hpp>
+#include <raytracer-sandbox/material.hpp>
+#include <raytracer-sandbox/plane.hpp>
+#include <raytracer-sandbox/sphere.hpp>
+#include <raytracer-sandbox/spotLight.hpp>
+#include <raytracer-sandbox/tmesh.hpp>
+#include "config.h"
+
+using namespace std;
+
+TEST(SceneDescription, Read)
+{
+    istringstream stream(
+        "# A test scene\n"
+        "camera 45 0 2 10  0 0 0\n"
+        "clip 0.5 50\n"
+        "background 0.1 0.2 0.3   # sky\n"
+        "bias 0.01\n"
+        "depth 2\n"
+        "\n"
+        "sphere 0 1 0 1.5 emerald\n"
+        "sphere 3 1 0 1 fresnel 1.33\n"
+        "plane 0 1 0  0 -1 0 phong 0.1 0.1 0.1  0.5 0.5 0.5  1 1 1  32\n"
+        "mesh triangle.obj glossy\n"
+        "directional 0 -1 0  0.2 0.2 0.2  0.8 0.8 0.8  0.8 0.8 0.8\n"
+        "spot 0 5 0  0 -1 0  1 1 1  1 1 1  1 1 1  1 0 0  60 60\n"
+        );
+    SceneDescription description;
+    string error;
+    ASSERT_TRUE(read_scene(stream, CurrentSourceDir()+"/test/meshes", description, error)) << error;
+
+    EXPECT_FLOAT_EQ(description.fov, glm::radians(45.0f));
+    EXPECT_EQ(description.eye, glm::vec3(0,2,10));
+    EXPECT_EQ(description.up, glm::vec3(0,1,0));
+    EXPECT_FLOAT_EQ(description.nearPlane, 0.5f);
+    EXPECT_FLOAT_EQ(description.farPlane, 50.0f);
+    EXPECT_EQ(description.settings.backgroundColor, glm::vec3(0.1f,0.2f,0.3f));
+    EXPECT_FLOAT_EQ(description.settings.bias, 0.01f);
+    EXPECT_EQ(description.settings.maxDepth, 2);
+
+    ASSERT_EQ(description.objects.size(), 4u);
+    SpherePtr sphere = std::dynamic_pointer_cast<Sphere>(description.objects[0]);
+    ASSERT_TRUE(sphere!=nullptr);
+    EXPECT_EQ(sphere->position(), glm::vec3(0,1,0));
+    EXPECT_FLOAT_EQ(sphere->radius(), 1.5f);
+    FresnelMaterialPtr fresnel = std::dynamic_pointer_cast<FresnelMaterial>(description.objects[1]->material());
+    ASSERT_TRUE(fresnel!=nullptr);
+    EXPECT_FLOAT_EQ(fresnel->ior(), 1.33f);
+    PhongMaterialPtr phong = std::dynamic_pointer_cast<PhongMaterial>(description.objects[2]->material());
+    ASSERT_TRUE(phong!=nullptr);
+    EXPECT_FLOAT_EQ(phong->shininess(), 32.0f);
+    EXPECT_TRUE(std::dynamic_pointer_cast<TMesh>(description.objects[3])!=nullptr);
+    EXPECT_TRUE(std::dynamic_pointer_cast<GlossyMaterial>(description.objects[3]->material())!=nullptr);
+
+    ASSERT_EQ(description.lights.size(), 2u);
+    DirectionalLightPtr directional = std::dynamic_pointer_cast<DirectionalLight>(description.lights[0]);
+    ASSERT_TRUE(directional!=nullptr);
+    EXPECT_EQ(directional->ambient(), glm::vec3(0.2f,0.2f,0.2f));
+    SpotLightPtr spot = std::dynamic_pointer_cast<SpotLight>(description.lights[1]);
+    ASSERT_TRUE(spot!=nullptr);
+    EXPECT_NEAR(spot->innerCutOff(), 0.5f, 1e-6f);
+}
+
+//The camera is the one the viewer builds by translating the view
+TEST(SceneDescription, Camera)
+{
+    SceneDescription description;
+    description.eye = glm::vec3(0,0,8);
+    description.target = glm::vec3(0,0,0);
+    const Camera camera = description.camera(64, 48);
+    EXPECT_EQ(camera.width(), 64);
+    EXPECT_EQ(camera.height(), 48);
+
+    const glm::mat4 expected = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -8.0f));
+    for(int i=0; i<4; ++i)
+    {
+        for(int j=0; j<4; ++j) EXPECT_NEAR(camera.view()[i][j], expected[i][j], 1e-6f);
+    }
+}
+
+//Each invalid line is reported with its number
+TEST(SceneDescription, Errors)
+{
+    const std::vector<std::string> invalidLines = {
+        "teapot 0 0 0",
+        "sphere 0 1 0 emerald",
+        "sphere 0 1 0 1 gold",
+        "sphere 0 1 0 1 fresnel",
+        "camera 60 0 0 8 0 0 0 0 1",
+        "depth 4 4",
+        "mesh missing.obj pearl",
+    };
+    for(const std::string& line : invalidLines)
+    {
+        istringstream stream("# comment\n" + line + "\n");
+        SceneDescription description;
+        string error;
+        EXPECT_FALSE(read_scene(stream, CurrentSourceDir()+"/test/meshes", description, error)) << line;
+        EXPECT_EQ(error.compare(0, 3, "2: "), 0) << error;
+    }
+
+    SceneDescription description;
+    string error;
+    EXPECT_FALSE(read_scene("nonepath.scene", description, error));
+    EXPECT_FALSE(error.empty());
+}
+
+TEST(SceneDescription, ReadFile)
+{
+    SceneDescription description;
+    string error;
+    ASSERT_TRUE(read_scene(CurrentSourceDir()+"/scenes/spheres.scene", description, error)) << error;
+    EXPECT_EQ(description.objects.size(), 4u);
+    EXPECT_EQ(description.lights.size(), 1u);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,87 @@
+#include <iostream>
+#include <gtest/gtest.h>
+#include <raytracer-sandbox/shadowcache.hpp>
+#include <raytracer-sandbox/directionalLight.hpp>
+#include <raytracer-sandbox/pathtracing.hpp>
+#include <raytracer-sandbox/plane.hpp>
+#include <raytracer-sandbox/pointLight.hpp>
+#include <raytracer-sandbox/scene.hpp>
+#include <raytracer-sandbox/sphere.hpp>
+
+using namespace std;
+
+TEST(ShadowCache, Counters)
+{
+    ShadowCache cache;
+    EXPECT_EQ(cache.occluder(0), nullptr);
+    EXPECT_EQ(cache.hitRate(), 0.0f);
+
+    Sphere sphere(glm::vec3(0,0,0), 1.0f, PhongMaterial::Bronze());
+    cache.setOccluder(2, &sphere);
+    EXPECT_EQ(cache.occluder(0), nullptr);
+    EXPECT_EQ(cache.occluder(2), &sphere);
+
+    cache.count(true);
+    cache.count(true);
+    cache.count(true);
+    cache.count(false);
+    EXPECT_EQ(cache.lookups(), 4u);
+    EXPECT_EQ(cache.hits(), 3u);
+    EXPECT_EQ(cache.hitRate(), 0.75f);
+
+    ShadowCache other;
+    other.count(false);
+    cache += other;
+    EXPECT_EQ(cache.lookups(), 5u);
+    EXPECT_EQ(cache.hits(), 3u);
+
+    cache.clear();
+    EXPECT_EQ(cache.occluder(2), nullptr);
+    EXPECT_EQ(cache.lookups(), 0u);
+}
+
+TEST(ShadowCache, CastRay)
+{
+    //A floor in the shadow of a sphere for a point light, lit by a directional light
+    PhongMaterialPtr material = PhongMaterial::Bronze();
+    vector<ObjectPtr> objects;
+    objects.push_back( make_shared<Plane>(glm::vec3(0,1,0), glm::vec3(0,-1,0), material) );
+    objects.push_back( make_shared<Sphere>(glm::vec3(0,1,0), 1.0f, material) );
+    Scene scene(objects);
+
+    vector<LightPtr> lights;
+    glm::vec3 ambient(0.1,0.1,0.1), diffuse(1.0,1.0,1.0), specular(1.0,1.0,1.0);
+    lights.push_back( make_shared<PointLight>(glm::vec3(0,5,0), ambient, diffuse, specular, 1.0f, 0.0f, 0.0f) );
+    lights.push_back( make_shared<DirectionalLight>(glm::vec3(1,-1,0), ambient, diffuse, specular) );
+
+    //The cache changes how the shadow rays are answered, not their answer
+    ShadowCache cache;
+    glm::vec3 backgroundColor(0,0,0), shadowColor(0.2,0.2,0.2);
+    for(int y=0; y<16; ++y)
+    {
+        for(int x=0; x<16; ++x)
+        {
+            Ray ray(glm::vec3(0,8,-8), glm::vec3(-0.4f+x*0.05f, -1.0f, 1.0f-y*0.05f));
+            glm::vec3 expected = castRay(ray, lights, scene, backgroundColor, shadowColor, 1e-3f, 4, 0);
+            EXPECT_EQ(castRay(ray, lights, scene, backgroundColor, shadowColor, 1e-3f, 4, 0, &cache), expected);
+            EXPECT_EQ(castRay(ray, lights, objects, backgroundColor, shadowColor, 1e-3f, 4, 0, &cache), castRay(ray, lights, objects, backgroundColor, shadowColor, 1e-3f, 4, 0));
+        }
+    }
+    EXPECT_GT(cache.lookups(), 0u);
+    EXPECT_GT(cache.hits(), 0u);
+    EXPECT_EQ(cache.occluder(0), objects[1].get());
+
+    //A packet looks the cache up once per light for each ray hitting a surface
+    vector<Ray> rays;
+    for(int x=0; x<RayPacket::MaxSize; ++x) rays.push_back(Ray(glm::vec3(0,8,-8), glm::vec3(-0.4f+x*0.05f, -1.0f, 1.0f)));
+    glm::vec3 colors[RayPacket::MaxSize];
+    ShadowCache packetCache;
+    castRayPacket(RayPacket(rays.data(), rays.size()), lights, scene, backgroundColor, shadowColor, 1e-3f, 4, 0, colors, &packetCache);
+    EXPECT_EQ(packetCache.lookups(), 2u*rays.size());
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -70,6 +70,7 @@ TEST(SpotLight, LightFromDirection)
     EXPECT_EQ(light.lightDirectionFrom(glm::vec3(0,0,0))[0], glm::normalize(-light.position())[0]);
     EXPECT_EQ(light.lightDirectionFrom(glm::vec3(0,0,0))[1], glm::normalize(-light.position())[1]);
     EXPECT_EQ(light.lightDirectionFrom(glm::vec3(0,0,0))[2], glm::normalize(-light.position())[2]);
+    EXPECT_EQ(light.distanceFrom(glm::vec3(0,0,-2)), 3);
 }
 
 TEST(SpotLight, PhongIllumination)
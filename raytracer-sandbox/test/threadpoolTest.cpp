@@ -0,0 +1,56 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <raytracer-sandbox/threadpool.hpp>
+
+using namespace std;
+
+//Every job of a batch runs exactly once, on a valid thread, whatever the number of threads and jobs
+TEST(ThreadPool, Run)
+{
+    for(int threadCount=1; threadCount<=4; ++threadCount)
+    {
+        ThreadPool pool(threadCount);
+        EXPECT_EQ(pool.threadCount(), threadCount);
+        for(int jobCount : {0, 1, 3, 100})
+        {
+            std::vector< std::atomic<int> > runs(jobCount);
+            for(std::atomic<int>& r : runs) r = 0;
+            std::atomic<bool> validThreads(true);
+            pool.run(jobCount, [&](const int& job, const int& thread)
+            {
+                ++runs[job];
+                if(thread<0 || thread>=threadCount) validThreads = false;
+            });
+            for(int i=0; i<jobCount; ++i) EXPECT_EQ(runs[i], 1);
+            EXPECT_TRUE(validThreads);
+        }
+    }
+
+    ThreadPool defaultPool;
+    EXPECT_GE(defaultPool.threadCount(), 1);
+}
+
+//The jobs of a slow thread are stolen by the others
+TEST(ThreadPool, Steal)
+{
+    ThreadPool pool(2);
+    const int jobCount = 20;
+    std::vector<int> threads(jobCount, -1);
+    pool.run(jobCount, [&](const int& job, const int& thread)
+    {
+        //The first half of the jobs is queued on thread 0 and made slow
+        if(job<jobCount/2) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        threads[job] = thread;
+    });
+    EXPECT_GT(pool.steals(), 0u);
+    //The last jobs of thread 0 are the ones stolen
+    EXPECT_EQ(threads[jobCount/2-1], 1);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
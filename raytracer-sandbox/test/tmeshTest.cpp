@@ -1,4 +1,10 @@
 #include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <iterator>
+#include <random>
 #include <gtest/gtest.h>
 
 #include <raytracer-sandbox/tmesh.hpp>
@@ -61,6 +67,313 @@ TEST(TMesh, Intersect)
     EXPECT_EQ(hitNormal[2], 1);
 }
 
+TEST(TMesh, Intersect_Closest)
+{
+    string filename = CurrentBinaryDir()+"/../test/meshes/stack.obj";
+    PhongMaterialPtr material = PhongMaterial::Bronze();
+    TMesh mesh(filename, material);
+    EXPECT_EQ(mesh.bvh().primitiveIndices().size(), 3u);
+
+    bool success = false;
+    glm::vec3 hitPosition, hitNormal;
+
+    //From below, the triangle at z=0 is the closest
+    Ray ray(glm::vec3(0.0,0.0,-0.5), glm::vec3(0.0,0.0,1.0));
+    success = mesh.Intersect(ray, hitPosition, hitNormal);
+    EXPECT_EQ(success, true);
+    EXPECT_EQ(hitPosition[2], 0);
+    EXPECT_EQ(hitNormal[2], 1);
+
+    //From above, the triangle at z=2 is the closest
+    ray = Ray(glm::vec3(0.0,0.0,2.5), glm::vec3(0.0,0.0,-1.0));
+    success = mesh.Intersect(ray, hitPosition, hitNormal);
+    EXPECT_EQ(success, true);
+    EXPECT_EQ(hitPosition[2], 2);
+    EXPECT_EQ(hitNormal[0], 1);
+
+    //From in-between, the triangle at z=1 is the closest
+    ray = Ray(glm::vec3(0.0,0.0,1.5), glm::vec3(0.0,0.0,-1.0));
+    success = mesh.Intersect(ray, hitPosition, hitNormal);
+    EXPECT_EQ(success, true);
+    EXPECT_EQ(hitPosition[2], 1);
+    EXPECT_EQ(hitNormal[1], 1);
+}
+
+TEST(TMesh, Occluded)
+{
+    string filename = CurrentBinaryDir()+"/../test/meshes/stack.obj";
+    TMesh mesh(filename, PhongMaterial::Bronze());
+
+    //The triangles lie at z=2, z=1 and z=0 below the origin of the ray
+    Ray ray(glm::vec3(0.0,0.0,2.5), glm::vec3(0.0,0.0,-1.0));
+    EXPECT_EQ(mesh.Occluded(ray, numeric_limits<float>::max()), true);
+    EXPECT_EQ(mesh.Occluded(ray, 0.6f), true);
+    EXPECT_EQ(mesh.Occluded(ray, 0.4f), false);
+
+    //Beside the triangles
+    ray = Ray(glm::vec3(2.0,0.0,2.5), glm::vec3(0.0,0.0,-1.0));
+    EXPECT_EQ(mesh.Occluded(ray, numeric_limits<float>::max()), false);
+}
+
+TEST(TMesh, SpatialSplit)
+{
+    string filename = CurrentBinaryDir()+"/../test/meshes/stack.obj";
+    BVHBuildSettings settings;
+    settings.method = SPATIAL_SPLIT;
+    settings.maxLeafSize = 1;
+    TMesh mesh(filename, PhongMaterial::Bronze(), settings);
+    EXPECT_EQ(mesh.bvh().settings().method, SPATIAL_SPLIT);
+
+    glm::vec3 hitPosition, hitNormal;
+    for(float x : {-0.4f, 0.0f, 0.4f})
+    {
+        EXPECT_EQ(mesh.Intersect(Ray(glm::vec3(x,-0.4f,-0.5f), glm::vec3(0,0,1)), hitPosition, hitNormal), true);
+        EXPECT_EQ(hitPosition[2], 0);
+        EXPECT_EQ(mesh.Intersect(Ray(glm::vec3(x,-0.4f,2.5f), glm::vec3(0,0,-1)), hitPosition, hitNormal), true);
+        EXPECT_EQ(hitPosition[2], 2);
+    }
+}
+
+TEST(TMesh, ExtentBVH)
+{
+    string filename = CurrentBinaryDir()+"/../test/meshes/stack.obj";
+    TMesh boxMesh(filename, PhongMaterial::Bronze());
+    TMesh dopMesh(filename, PhongMaterial::Bronze(), BVHBuildSettings(), ExtentSettings::KDOP13_Settings());
+    EXPECT_EQ(boxMesh.extentBVH().empty(), true);
+    ASSERT_EQ(dopMesh.extentBVH().empty(), false);
+    EXPECT_EQ(dopMesh.extentBVH().lanes(), 16);
+
+    //Both hierarchies find the same hits
+    for(float x : {-0.4f, 0.0f, 0.4f, 2.0f})
+    {
+        Ray ray(glm::vec3(x,-0.4f,2.5f), glm::vec3(0.1f,0.1f,-1));
+        glm::vec3 boxPosition, boxNormal, dopPosition, dopNormal;
+        bool boxHit = boxMesh.Intersect(ray, boxPosition, boxNormal);
+        EXPECT_EQ(dopMesh.Intersect(ray, dopPosition, dopNormal), boxHit);
+        if(boxHit)
+        {
+            EXPECT_EQ(dopPosition, boxPosition);
+        }
+    }
+
+    //The k-DOPs follow the vertices when refitted
+    for(glm::vec3& p : dopMesh.positions()) p += glm::vec3(10,0,0);
+    dopMesh.refit();
+    glm::vec3 hitPosition, hitNormal;
+    EXPECT_EQ(dopMesh.Intersect(Ray(glm::vec3(10,-0.4f,2.5f), glm::vec3(0,0,-1)), hitPosition, hitNormal), true);
+    EXPECT_EQ(dopMesh.Intersect(Ray(glm::vec3(0,-0.4f,2.5f), glm::vec3(0,0,-1)), hitPosition, hitNormal), false);
+}
+
+TEST(TMesh, TriangleBlocks)
+{
+    //Leaves of 4 triangles are tested by blocks of 4, larger leaves by blocks of 8 when AVX2 is supported
+    string filename = CurrentBinaryDir()+"/../test/meshes/stack.obj";
+    BVHBuildSettings settings;
+    settings.maxLeafSize = 8;
+    TMesh blocks4(filename, PhongMaterial::Bronze());
+    TMesh blocks8(filename, PhongMaterial::Bronze(), settings);
+
+    std::mt19937 generator(5);
+    std::uniform_real_distribution<float> position(-1.0f, 1.0f);
+    int hitCount = 0;
+    for(int i=0; i<200; ++i)
+    {
+        Ray ray(glm::vec3(position(generator), position(generator), 3), glm::vec3(0.3f*position(generator), 0.3f*position(generator), -1));
+        glm::vec3 position4, normal4, position8, normal8;
+        bool hit = blocks4.Intersect(ray, position4, normal4);
+        ASSERT_EQ(blocks8.Intersect(ray, position8, normal8), hit);
+        if(hit)
+        {
+            ++hitCount;
+            EXPECT_NEAR(glm::length(position8-position4), 0.0f, 1e-5f);
+            EXPECT_NEAR(glm::length(normal8-normal4), 0.0f, 1e-5f);
+        }
+    }
+    EXPECT_GT(hitCount, 0);
+}
+
+TEST(TMesh, Cache)
+{
+    string filename = CurrentBinaryDir()+"/../test/meshes/stack.obj";
+    string cacheDirectory = CurrentBinaryDir();
+    BVHBuildSettings settings;
+    settings.maxLeafSize = 1;
+    string cacheFilename = TMesh::CacheFilename(cacheDirectory, filename, settings);
+    ASSERT_EQ(cacheFilename.empty(), false);
+    EXPECT_EQ(TMesh::CacheFilename(cacheDirectory, "nonepath.obj", settings).empty(), true);
+    remove(cacheFilename.c_str());
+
+    //Other settings give another cache file
+    BVHBuildSettings otherSettings = settings;
+    otherSettings.method = MEDIAN_SPLIT;
+    EXPECT_NE(TMesh::CacheFilename(cacheDirectory, filename, otherSettings), cacheFilename);
+
+    //A copy of the obj file at another path shares the cache file
+    string copyFilename = CurrentBinaryDir()+"/stackCopy.obj";
+    {
+        ifstream source(filename.c_str(), ios::binary);
+        ofstream copy(copyFilename.c_str(), ios::binary);
+        copy << source.rdbuf();
+    }
+    EXPECT_EQ(TMesh::CacheFilename(cacheDirectory, copyFilename, settings), cacheFilename);
+    remove(copyFilename.c_str());
+
+    //The first load writes the cache file and the second one reads it back
+    const TMesh built(filename, PhongMaterial::Bronze(), settings, nullptr, cacheDirectory);
+    ASSERT_EQ(ifstream(cacheFilename.c_str()).good(), true);
+    const TMesh cached(filename, PhongMaterial::Bronze(), settings, nullptr, cacheDirectory);
+
+    //The arrays of the cached mesh are read in place from the file
+    EXPECT_EQ(built.positions().isMapped(), false);
+    EXPECT_EQ(cached.positions().isMapped(), true);
+    EXPECT_EQ(cached.bvh().nodes().isMapped(), true);
+    EXPECT_EQ(cached.bvh().primitiveIndices().isMapped(), true);
+    EXPECT_EQ(cached.positions(), built.positions());
+    EXPECT_EQ(cached.normals(), built.normals());
+    EXPECT_EQ(cached.bbox().bounds(), built.bbox().bounds());
+    EXPECT_EQ(cached.bvh().primitiveIndices(), built.bvh().primitiveIndices());
+    EXPECT_EQ(cached.bvh().settings().maxLeafSize, 1);
+    EXPECT_EQ(cached.bvh().settings().width, built.bvh().settings().width);
+    EXPECT_EQ(cached.bvh().nodes4().size(), built.bvh().nodes4().size());
+    EXPECT_EQ(cached.bvh().nodes8().size(), built.bvh().nodes8().size());
+    for(size_t i=0; i<built.bvh().nodes4().size(); ++i)
+    {
+        EXPECT_EQ(std::memcmp(&cached.bvh().nodes4()[i], &built.bvh().nodes4()[i], sizeof(WideBVHNode<4>)), 0);
+    }
+    for(size_t i=0; i<built.bvh().nodes8().size(); ++i)
+    {
+        EXPECT_EQ(std::memcmp(&cached.bvh().nodes8()[i], &built.bvh().nodes8()[i], sizeof(WideBVHNode<8>)), 0);
+    }
+    EXPECT_EQ(cached.bvh().builtSahCost(), built.bvh().builtSahCost());
+    ASSERT_EQ(cached.bvh().nodes().size(), built.bvh().nodes().size());
+    for(size_t i=0; i<built.bvh().nodes().size(); ++i)
+    {
+        EXPECT_EQ(cached.bvh().nodes()[i].aabb.bounds(), built.bvh().nodes()[i].aabb.bounds());
+        EXPECT_EQ(cached.bvh().nodes()[i].offset, built.bvh().nodes()[i].offset);
+        EXPECT_EQ(cached.bvh().nodes()[i].primitiveCount, built.bvh().nodes()[i].primitiveCount);
+    }
+
+    glm::vec3 hitPosition, hitNormal;
+    EXPECT_EQ(cached.Intersect(Ray(glm::vec3(0,-0.4f,2.5f), glm::vec3(0,0,-1)), hitPosition, hitNormal), true);
+    EXPECT_EQ(hitPosition[2], 2);
+
+    //A corrupted cache file is ignored and written again
+    {
+        ofstream file(cacheFilename.c_str(), ios::binary);
+        file << "corrupted";
+    }
+    TMesh rebuilt(filename, PhongMaterial::Bronze(), settings, nullptr, cacheDirectory);
+    EXPECT_EQ(rebuilt.bvh().primitiveIndices(), built.bvh().primitiveIndices());
+    EXPECT_GT(ifstream(cacheFilename.c_str(), ios::binary | ios::ate).tellg(), 9);
+
+    //So is a file of the right size whose last wide node has a leaf beyond the primitive indices
+    {
+        fstream file(cacheFilename.c_str(), ios::binary | ios::in | ios::out);
+        const int corrupted = numeric_limits<int>::max();
+        file.seekp(-(int)sizeof(int), ios::end);
+        file.write(reinterpret_cast<const char*>(&corrupted), sizeof(int));
+    }
+    TMesh restored(filename, PhongMaterial::Bronze(), settings, nullptr, cacheDirectory);
+    EXPECT_EQ(restored.bvh().primitiveIndices(), built.bvh().primitiveIndices());
+    EXPECT_EQ(restored.Intersect(Ray(glm::vec3(0,-0.4f,2.5f), glm::vec3(0,0,-1)), hitPosition, hitNormal), true);
+    EXPECT_EQ(static_cast<const TMesh&>(restored).positions().isMapped(), false);
+
+    //So is a file whose leaves overlap, which would make them fill the same triangle blocks
+    {
+        fstream file(cacheFilename.c_str(), ios::binary | ios::in | ios::out);
+        const string content((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        const MappedArray<BVHFlatNodes>& nodes = built.bvh().nodes();
+        const size_t nodeOffset = content.find(string(reinterpret_cast<const char*>(nodes.data()), nodes.size()*sizeof(BVHFlatNode)));
+        ASSERT_NE(nodeOffset, string::npos);
+        int first = 0;
+        while(!nodes[first].isLeaf()) ++first;
+        int second = first+1;
+        while(!nodes[second].isLeaf()) ++second;
+        BVHFlatNode corrupted = nodes[second];
+        corrupted.offset = nodes[first].offset;
+        file.seekp(nodeOffset+second*sizeof(BVHFlatNode));
+        file.write(reinterpret_cast<const char*>(&corrupted), sizeof(BVHFlatNode));
+    }
+    const TMesh overlapping(filename, PhongMaterial::Bronze(), settings, nullptr, cacheDirectory);
+    EXPECT_EQ(overlapping.positions().isMapped(), false);
+    EXPECT_EQ(overlapping.bvh().primitiveIndices(), built.bvh().primitiveIndices());
+
+    //Moving the vertices of a cached mesh copies them out of the file, which is left untouched
+    TMesh moved(filename, PhongMaterial::Bronze(), settings, nullptr, cacheDirectory);
+    ASSERT_EQ(static_cast<const TMesh&>(moved).positions().isMapped(), true);
+    for(glm::vec3& position : moved.positions()) position += glm::vec3(0,0,1);
+    moved.refit();
+    EXPECT_EQ(static_cast<const TMesh&>(moved).positions().isMapped(), false);
+    EXPECT_EQ(moved.Intersect(Ray(glm::vec3(0,-0.4f,3.5f), glm::vec3(0,0,-1)), hitPosition, hitNormal), true);
+    EXPECT_EQ(hitPosition[2], 3);
+    const TMesh reloaded(filename, PhongMaterial::Bronze(), settings, nullptr, cacheDirectory);
+    EXPECT_EQ(reloaded.positions(), built.positions());
+    remove(cacheFilename.c_str());
+}
+
+TEST(TMesh, CacheSpatialSplit)
+{
+    //Long and thin triangles crossing the mesh, enough of them for the spatial split builder to run tasks
+    string filename = CurrentBinaryDir()+"/spatialSplitTest.obj";
+    const int triangleCount = 2000;
+    {
+        mt19937 generator(13);
+        uniform_real_distribution<float> position(-10.0f, 10.0f);
+        ofstream file(filename.c_str());
+        file << "vt 0 0\nvn 0 0 1\n";
+        for(int i=0; i<triangleCount; ++i)
+        {
+            glm::vec3 start(position(generator), position(generator), position(generator));
+            glm::vec3 end = i%10==0 ? start + 1.5f*glm::vec3(position(generator), position(generator), position(generator)) : start + glm::vec3(0.3f,0.1f,0.2f);
+            file << "v " << start[0] << " " << start[1] << " " << start[2] << "\n";
+            file << "v " << end[0] << " " << end[1] << " " << end[2] << "\n";
+            file << "v " << end[0] << " " << end[1]+0.1f << " " << end[2] << "\n";
+        }
+        for(int i=0; i<triangleCount; ++i)
+        {
+            file << "f " << 3*i+1 << "/1/1 " << 3*i+2 << "/1/1 " << 3*i+3 << "/1/1\n";
+        }
+    }
+    string cacheDirectory = CurrentBinaryDir();
+    BVHBuildSettings settings;
+    settings.method = SPATIAL_SPLIT;
+    settings.parallelThreshold = 128;
+    string cacheFilename = TMesh::CacheFilename(cacheDirectory, filename, settings);
+    ASSERT_EQ(cacheFilename.empty(), false);
+    remove(cacheFilename.c_str());
+
+    //The leaves built concurrently are stored in depth-first order, so that the second load is served from the cache
+    const TMesh built(filename, PhongMaterial::Bronze(), settings, nullptr, cacheDirectory);
+    ASSERT_EQ(built.bvh().settings().method, SPATIAL_SPLIT);
+    EXPECT_GT(built.bvh().primitiveIndices().size(), (size_t)triangleCount);
+    const TMesh cached(filename, PhongMaterial::Bronze(), settings, nullptr, cacheDirectory);
+    EXPECT_EQ(cached.positions().isMapped(), true);
+    EXPECT_EQ(cached.bvh().nodes().isMapped(), true);
+    EXPECT_EQ(cached.bvh().primitiveIndices().isMapped(), true);
+    EXPECT_EQ(cached.bvh().primitiveIndices(), built.bvh().primitiveIndices());
+    remove(cacheFilename.c_str());
+    remove(filename.c_str());
+}
+
+TEST(TMesh, Refit)
+{
+    string filename = CurrentBinaryDir()+"/../test/meshes/stack.obj";
+    TMesh mesh(filename, PhongMaterial::Bronze());
+
+    //Move the whole mesh along x
+    for(glm::vec3& p : mesh.positions()) p += glm::vec3(10,0,0);
+    EXPECT_EQ(mesh.refit(), false);
+    EXPECT_EQ(mesh.bbox().minBound()[0], mesh.bvh().nodes()[0].aabb.minBound()[0]);
+
+    glm::vec3 hitPosition, hitNormal;
+    Ray ray(glm::vec3(0,0,3), glm::vec3(0,0,-1));
+    EXPECT_EQ(mesh.Intersect(ray, hitPosition, hitNormal), false);
+    ray = Ray(glm::vec3(10,0,3), glm::vec3(0,0,-1));
+    EXPECT_EQ(mesh.Intersect(ray, hitPosition, hitNormal), true);
+    EXPECT_EQ(hitPosition[0], 10);
+    EXPECT_EQ(hitPosition[2], 2);
+}
+
 int main(int argc, char **argv)
 {
     testing::InitGoogleTest(&argc, argv);
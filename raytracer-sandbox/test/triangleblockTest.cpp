@@ -0,0 +1,105 @@
+#include <iostream>
+#include <random>
+#include <limits>
+#include <gtest/gtest.h>
+#include <raytracer-sandbox/triangleblock.hpp>
+#include <raytracer-sandbox/utils.hpp>
+#include <raytracer-sandbox/widebvh.hpp>
+
+using namespace std;
+
+//Fill a block with random triangles, the last slot being unused
+template<int Width>
+static TriangleBlock<Width> randomBlock(mt19937& generator, vector<PrecomputedTriangle>& triangles)
+{
+    uniform_real_distribution<float> position(-1.0f, 1.0f);
+    TriangleBlock<Width> block;
+    triangles.clear();
+    for(int slot=0; slot<Width; ++slot)
+    {
+        PrecomputedTriangle triangle = PrecomputedTriangle{glm::vec3(0), glm::vec3(0), glm::vec3(0)};
+        if(slot<Width-1)
+        {
+            glm::vec3 t1(position(generator), position(generator), position(generator));
+            triangle = precomputeTriangle(t1, t1+glm::vec3(position(generator), position(generator), 0), t1+glm::vec3(position(generator), 0, position(generator)));
+            triangles.push_back(triangle);
+        }
+        for(int a=0; a<3; ++a)
+        {
+            block.v0[a][slot] = triangle.v0[a];
+            block.edge1[a][slot] = triangle.edge1[a];
+            block.edge2[a][slot] = triangle.edge2[a];
+        }
+        block.triangles[slot] = slot<Width-1 ? slot : -1;
+    }
+    return block;
+}
+
+//Compare the block kernel with precomputedTriangleRayIntersection on random rays
+template<int Width>
+static void compareWithScalar()
+{
+    mt19937 generator(13);
+    uniform_real_distribution<float> position(-1.0f, 1.0f);
+    vector<PrecomputedTriangle> triangles;
+    int hitCount = 0;
+    for(int i=0; i<200; ++i)
+    {
+        TriangleBlock<Width> block = randomBlock<Width>(generator, triangles);
+        for(int j=0; j<20; ++j)
+        {
+            Ray ray(glm::vec3(position(generator), position(generator), 3), glm::vec3(0.5f*position(generator), 0.5f*position(generator), -1));
+            const float tMax = j%4==0 ? 3.0f : numeric_limits<float>::max();
+
+            int expectedSlot = -1;
+            float expectedT = tMax;
+            glm::vec3 expectedBarycentricCoords;
+            for(size_t slot=0; slot<triangles.size(); ++slot)
+            {
+                float t;
+                glm::vec3 barycentricCoords;
+                if(precomputedTriangleRayIntersection(triangles[slot], ray, expectedT, t, barycentricCoords))
+                {
+                    expectedSlot = slot;
+                    expectedT = t;
+                    expectedBarycentricCoords = barycentricCoords;
+                }
+            }
+
+            float t = -1.0f;
+            glm::vec3 barycentricCoords;
+            const int slot = IntersectTriangles(block, ray, tMax, t, barycentricCoords);
+            ASSERT_EQ(slot, expectedSlot);
+            if(slot>=0)
+            {
+                ++hitCount;
+                EXPECT_NEAR(t, expectedT, 1e-5f);
+                for(int a=0; a<3; ++a) EXPECT_NEAR(barycentricCoords[a], expectedBarycentricCoords[a], 1e-4f);
+            }
+        }
+    }
+    EXPECT_GT(hitCount, 100);
+}
+
+TEST(TriangleBlock, Layout)
+{
+    EXPECT_EQ(sizeof(TriangleBlock<4>)%32, size_t(0));
+    EXPECT_EQ(sizeof(TriangleBlock<8>)%32, size_t(0));
+}
+
+TEST(TriangleBlock, Intersect4)
+{
+    compareWithScalar<4>();
+}
+
+TEST(TriangleBlock, Intersect8)
+{
+    if(!SupportsAVX2()) return;
+    compareWithScalar<8>();
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,5 +1,8 @@
 #include <iostream>
 #include <sstream>
+#include <random>
+#include <limits>
+#include <algorithm>
 #include <gtest/gtest.h>
 
 #include <raytracer-sandbox/utils.hpp>
@@ -189,6 +192,89 @@ TEST(Utils, TriangleRayIntersection)
     EXPECT_EQ(barycentricCoords[2], 0.5);
 }
 
+TEST(Utils, PrecomputedTriangleRayIntersection)
+{
+    glm::vec3 t1(-0.5,0,0), t2(0.5,0,0), t3(0,1,0);
+    PrecomputedTriangle triangle = precomputeTriangle(t1, t2, t3);
+    EXPECT_EQ(triangle.v0, t1);
+    EXPECT_EQ(triangle.edge1, t2-t1);
+    EXPECT_EQ(triangle.edge2, t3-t1);
+
+    float t = -1.0f;
+    glm::vec3 barycentricCoords;
+    const float tMax = std::numeric_limits<float>::max();
+
+    //Ray parallel to the plane of the triangle, then missing the triangle
+    EXPECT_EQ(precomputedTriangleRayIntersection(triangle, Ray(glm::vec3(1,0,1), glm::vec3(1,0,0)), tMax, t, barycentricCoords), false);
+    EXPECT_EQ(precomputedTriangleRayIntersection(triangle, Ray(glm::vec3(1,0,1), glm::vec3(0,0,-1)), tMax, t, barycentricCoords), false);
+    EXPECT_EQ(t, -1.0f);
+
+    //Ray hitting the triangle from both sides, but not behind its origin nor beyond tMax
+    EXPECT_EQ(precomputedTriangleRayIntersection(triangle, Ray(glm::vec3(0,0.5,1), glm::vec3(0,0,-1)), tMax, t, barycentricCoords), true);
+    EXPECT_FLOAT_EQ(t, 1.0f);
+    EXPECT_FLOAT_EQ(barycentricCoords[0], 0.25f);
+    EXPECT_FLOAT_EQ(barycentricCoords[1], 0.25f);
+    EXPECT_FLOAT_EQ(barycentricCoords[2], 0.5f);
+    EXPECT_EQ(precomputedTriangleRayIntersection(triangle, Ray(glm::vec3(0,0.5,-2), glm::vec3(0,0,1)), tMax, t, barycentricCoords), true);
+    EXPECT_FLOAT_EQ(t, 2.0f);
+    EXPECT_EQ(precomputedTriangleRayIntersection(triangle, Ray(glm::vec3(0,0.5,1), glm::vec3(0,0,1)), tMax, t, barycentricCoords), false);
+    EXPECT_EQ(precomputedTriangleRayIntersection(triangle, Ray(glm::vec3(0,0.5,1), glm::vec3(0,0,-1)), 1.0f, t, barycentricCoords), false);
+
+    //Same hits as triangleRayIntersection
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<float> position(-1.0f, 1.0f);
+    int hitCount = 0;
+    for(int i=0; i<1000; ++i)
+    {
+        Ray ray(glm::vec3(position(generator), position(generator), 2), glm::vec3(position(generator), position(generator), -1));
+        glm::vec3 hitPosition, hitNormal, expectedBarycentricCoords;
+        bool expectedHit = triangleRayIntersection(t1, t2, t3, ray, hitPosition, hitNormal, expectedBarycentricCoords);
+        bool hit = precomputedTriangleRayIntersection(triangle, ray, tMax, t, barycentricCoords);
+        ASSERT_EQ(hit, expectedHit);
+        if(hit)
+        {
+            ++hitCount;
+            EXPECT_NEAR(t, glm::length(hitPosition-ray.origin()), 1e-5f);
+            for(int j=0; j<3; ++j) EXPECT_NEAR(barycentricCoords[j], expectedBarycentricCoords[j], 1e-5f);
+        }
+    }
+    EXPECT_GT(hitCount, 0);
+}
+
+//The radix sort is stable and only reads the given number of bits
+TEST(Utils, RadixSort)
+{
+    mt19937 generator(1);
+    for(const int& keyBits : { 5, 30 })
+    {
+        std::uniform_int_distribution<unsigned int> key(0, (1u<<keyBits)-1);
+        //Enough keys to be sorted by several chunks
+        vector<unsigned int> keys(40000);
+        vector<int> values(keys.size());
+        for(size_t i=0; i<keys.size(); ++i)
+        {
+            keys[i] = key(generator);
+            values[i] = i;
+        }
+        vector< pair<unsigned int,int> > expected;
+        for(size_t i=0; i<keys.size(); ++i) expected.push_back(make_pair(keys[i], values[i]));
+        stable_sort(expected.begin(), expected.end(), [](const pair<unsigned int,int>& a, const pair<unsigned int,int>& b){ return a.first<b.first; });
+
+        RadixSort(keys, values, keyBits);
+        for(size_t i=0; i<keys.size(); ++i)
+        {
+            ASSERT_EQ(keys[i], expected[i].first);
+            ASSERT_EQ(values[i], expected[i].second);
+        }
+    }
+
+    vector<unsigned int> keys = { 3, 1, 2, 1 };
+    vector<int> values = { 0, 1, 2, 3 };
+    RadixSort(keys, values, 2);
+    EXPECT_EQ(keys, vector<unsigned int>({ 1, 1, 2, 3 }));
+    EXPECT_EQ(values, vector<int>({ 1, 3, 2, 0 }));
+}
+
 int main(int argc, char **argv)
 {
     testing::InitGoogleTest(&argc, argv);